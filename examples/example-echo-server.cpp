@@ -5,38 +5,41 @@
 
 #include <assert.h>
 
-void
-serve_client(mn::Socket client)
+struct Client
 {
-	auto data = mn::str_new();
-	mn_defer({
-		mn::str_free(data);
-		mn::socket_close(client);
-	});
-	size_t read_bytes = 0, write_bytes = 0;
+	mn::Fabric fabric;
+	mn::Socket socket;
+};
 
-	do
+// echoes whatever the client has sent so far, then waits for the client socket to be readable again without blocking
+// any of the fabric's workers, so a few workers can serve a lot of idle clients
+void
+serve_client(Client* client)
+{
+	char buffer[1024];
+	while (true)
 	{
-		mn::str_resize(data, 1024);
-		auto [read_bytes_count, err] = mn::socket_read(client, mn::block_from(data), mn::INFINITE_TIMEOUT);
-		if (err)
+		auto [read_bytes, err] = mn::socket_read(client->socket, mn::block_from(buffer), mn::NO_TIMEOUT);
+		if (err == mn::MN_SOCKET_ERROR_TIMEOUT)
 		{
-			mn::print("client disconnected");
-			break;
+			mn::fabric_io_do(client->fabric, mn::socket_fd(client->socket), mn::REACTOR_EVENT_READ, [client] {
+				serve_client(client);
+			});
+			return;
 		}
-		read_bytes = read_bytes_count;
 
-		if(read_bytes > 0)
+		if (err || read_bytes == 0)
 		{
-			mn::str_resize(data, read_bytes);
-			write_bytes = mn::socket_write(client, mn::block_from(data));
-			assert(write_bytes == read_bytes && "socket_write failed");
+			mn::print("client disconnected\n");
+			mn::fabric_io_cancel(client->fabric, mn::socket_fd(client->socket));
+			mn::socket_close(client->socket);
+			mn::free(client);
+			return;
 		}
-		else if (read_bytes == 0)
-		{
-			mn::print("Read timeout\n");
-		}
-	} while(read_bytes > 0);
+
+		[[maybe_unused]] auto write_bytes = mn::socket_write(client->socket, mn::Block{buffer, read_bytes});
+		assert(write_bytes == read_bytes && "socket_write failed");
+	}
 }
 
 int
@@ -57,9 +60,16 @@ main()
 	{
 		auto client_socket = mn::socket_accept(socket, { 1000 });
 		if (client_socket)
-			mn::go(f, [client_socket] { serve_client(client_socket); });
+		{
+			auto client = mn::alloc<Client>();
+			client->fabric = f;
+			client->socket = client_socket;
+			mn::fabric_do(f, [client] { serve_client(client); });
+		}
 		else
+		{
 			mn::print("socket accept timed out, trying again\n");
+		}
 	}
 	return 0;
-}
\ No newline at end of file
+}
@@ -4,8 +4,21 @@
 #include <mn/Defer.h>
 
 int
-main()
+main(int argc, char** argv)
 {
+	// read the given file directly from memory if there's one, otherwise read the standard input
+	auto reader = mn::reader_stdin();
+	if (argc > 1)
+	{
+		reader = mn::reader_mapped(argv[1]);
+		if (reader == nullptr)
+		{
+			mn::printerr("cannot open file '{}'\n", argv[1]);
+			return -1;
+		}
+	}
+	mn_defer(if (reader != mn::reader_stdin()) mn::reader_free(reader));
+
 	// create tmp string
 	auto line	 = mn::str_new();
 	mn_defer(mn::str_free(line));
@@ -14,7 +27,7 @@ main()
 	mn_defer(destruct(freq));
 
 	// while we can read line
-	while (mn::readln(line))
+	while (mn::readln(reader, line))
 	{
 		// split words, which return a tmp Buf<Str>
 		auto words = mn::str_split(line, " ", true);
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "mn/Exports.h"
+#include "mn/Base.h"
+#include "mn/Task.h"
+#include "mn/File.h"
+#include "mn/Socket.h"
+#include "mn/Fabric.h"
+
+#include <stdint.h>
+
+namespace mn
+{
+	// async io operation flags
+	enum ASYNC_IO_FLAG
+	{
+		ASYNC_IO_FLAG_NONE = 0,
+		// links this operation with the next one, the next operation doesn't start until this one completes and if this
+		// one fails the rest of the chain is cancelled (their result is -ECANCELED), use it to write then sync a file
+		// for example
+		ASYNC_IO_FLAG_LINK = 1 << 0,
+	};
+
+	// the completion of an async io operation
+	struct Async_IO_Completion
+	{
+		// number of transferred bytes, or a negative os error code (-errno) if the operation failed
+		int64_t result;
+		// the accepted socket for accept operations, the callback owns it
+		Socket socket;
+		// whether more completions will follow for the same operation (multishot accept)
+		bool more;
+	};
+
+	// the callback which receives the completion of an async io operation, it's called on one of the fabric's workers
+	using Async_IO_Callback = Task<void(const Async_IO_Completion&)>;
+
+	// async io engine settings
+	struct Async_IO_Settings
+	{
+		// max count of queued operations before they're submitted to the os, default: 256
+		size_t queue_depth;
+		// uses the fallback path even if the os supports io_uring, mainly used for testing
+		bool force_fallback;
+	};
+
+	// an async io engine, on linux it uses io_uring to submit a batch of reads/writes to the os in a single syscall,
+	// if io_uring isn't available (other oses, old kernels, disabled by seccomp) it falls back to executing the
+	// operations with the normal blocking calls on the fabric's workers, in both cases the completion callbacks are
+	// called on the fabric's workers, operations are queued until async_io_submit is called
+	typedef struct IAsync_IO* Async_IO;
+
+	// creates a new async io engine which delivers its completions to the given fabric
+	MN_EXPORT Async_IO
+	async_io_new(Fabric fabric, Async_IO_Settings settings = {});
+
+	// cancels the in flight operations (their callbacks are still called) then frees the given async io engine
+	MN_EXPORT void
+	async_io_free(Async_IO self);
+
+	// destruct overload for async io free
+	inline static void
+	destruct(Async_IO self)
+	{
+		async_io_free(self);
+	}
+
+	// returns whether the given async io engine is backed by io_uring
+	MN_EXPORT bool
+	async_io_is_native(Async_IO self);
+
+	// registers the given buffers with the os so that the fixed read/write operations don't have to map them on each
+	// operation, it can only be called once, returns whether it succeeded
+	MN_EXPORT bool
+	async_io_register_buffers(Async_IO self, const Block* buffers, size_t count);
+
+	// queues a read from the given file at the given offset (negative offset means the file's cursor)
+	MN_EXPORT void
+	async_io_file_read(Async_IO self, File file, Block data, int64_t offset, Async_IO_Callback callback, int flags = ASYNC_IO_FLAG_NONE);
+
+	// queues a write to the given file at the given offset (negative offset means the file's cursor)
+	MN_EXPORT void
+	async_io_file_write(Async_IO self, File file, Block data, int64_t offset, Async_IO_Callback callback, int flags = ASYNC_IO_FLAG_NONE);
+
+	// queues a read into a registered buffer, data should be inside the buffer with the given index
+	MN_EXPORT void
+	async_io_file_read_fixed(Async_IO self, File file, size_t buffer_index, Block data, int64_t offset, Async_IO_Callback callback, int flags = ASYNC_IO_FLAG_NONE);
+
+	// queues a write from a registered buffer, data should be inside the buffer with the given index
+	MN_EXPORT void
+	async_io_file_write_fixed(Async_IO self, File file, size_t buffer_index, Block data, int64_t offset, Async_IO_Callback callback, int flags = ASYNC_IO_FLAG_NONE);
+
+	// queues a sync of the given file's data to the disk
+	MN_EXPORT void
+	async_io_file_sync(Async_IO self, File file, Async_IO_Callback callback, int flags = ASYNC_IO_FLAG_NONE);
+
+	// queues a read from the given socket
+	MN_EXPORT void
+	async_io_socket_read(Async_IO self, Socket socket, Block data, Async_IO_Callback callback, int flags = ASYNC_IO_FLAG_NONE);
+
+	// queues a write to the given socket
+	MN_EXPORT void
+	async_io_socket_write(Async_IO self, Socket socket, Block data, Async_IO_Callback callback, int flags = ASYNC_IO_FLAG_NONE);
+
+	// queues an accept on the given listening socket, if multishot is true the callback is called for each accepted
+	// connection until it fails or the engine is freed
+	MN_EXPORT void
+	async_io_socket_accept(Async_IO self, Socket socket, bool multishot, Async_IO_Callback callback);
+
+	// submits all the queued operations to the os in a single call and returns their count
+	MN_EXPORT size_t
+	async_io_submit(Async_IO self);
+
+	// returns the count of operations which were queued but didn't complete yet
+	MN_EXPORT size_t
+	async_io_pending(Async_IO self);
+
+	// wraps any callable into an async io callback
+	template<typename TFunc>
+	inline static Async_IO_Callback
+	async_io_callback(TFunc&& f)
+	{
+		return Async_IO_Callback::make_with_allocator(worker_task_allocator(), std::forward<TFunc>(f));
+	}
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include "mn/Base.h"
+#include "mn/Memory.h"
+#include "mn/Buf.h"
+#include "mn/Map.h"
+#include "mn/Thread.h"
+#include "mn/Defer.h"
+
+namespace mn
+{
+	// a shard of the concurrent map
+	template<typename TKey, typename TValue, typename THash = Hash<TKey>>
+	struct CMap_Shard
+	{
+		Mutex_RW mtx;
+		Map<TKey, TValue, THash> map;
+	};
+
+	// a concurrent hash map which can be shared between threads, it's split into shards each one is a normal hash map
+	// guarded by its own read-write mutex, so operations on different shards don't contend with each other and
+	// lookups on the same shard run in parallel, unlike map the concurrent map owns its keys and values, they are
+	// destructed when they're replaced, removed or when the map is freed
+	template<typename TKey, typename TValue, typename THash = Hash<TKey>>
+	struct CMap
+	{
+		Buf<CMap_Shard<TKey, TValue, THash>> _shards;
+	};
+
+	// creates a new concurrent hash map with the given count of shards (rounded up to a power of 2), more shards
+	// means less contention between threads at the cost of some memory
+	template<typename TKey, typename TValue, typename THash = Hash<TKey>>
+	inline static CMap<TKey, TValue, THash>
+	cmap_new(size_t shards_count = 64)
+	{
+		assert(shards_count <= 65536);
+
+		size_t count = 1;
+		while (count < shards_count)
+			count *= 2;
+
+		CMap<TKey, TValue, THash> self{};
+		self._shards = buf_new<CMap_Shard<TKey, TValue, THash>>();
+		buf_resize(self._shards, count);
+		for (auto& shard: self._shards)
+		{
+			shard.mtx = mutex_rw_new("CMap shard");
+			shard.map = map_new<TKey, TValue, THash>();
+		}
+		return self;
+	}
+
+	// frees the given concurrent hash map along with its keys and values
+	template<typename TKey, typename TValue, typename THash = Hash<TKey>>
+	inline static void
+	cmap_free(CMap<TKey, TValue, THash>& self)
+	{
+		for (auto& shard: self._shards)
+		{
+			destruct(shard.map);
+			mutex_rw_free(shard.mtx);
+		}
+		buf_free(self._shards);
+	}
+
+	// destruct overload for concurrent hash map free
+	template<typename TKey, typename TValue, typename THash = Hash<TKey>>
+	inline static void
+	destruct(CMap<TKey, TValue, THash>& self)
+	{
+		cmap_free(self);
+	}
+
+	// the shard is picked using the high bits of the mixed hash, the shard's map uses the low bits
+	template<typename TKey, typename TValue, typename THash = Hash<TKey>>
+	inline static CMap_Shard<TKey, TValue, THash>&
+	_cmap_shard(CMap<TKey, TValue, THash>& self, const TKey& key)
+	{
+		auto hash = _hash_table_mix(THash()(key));
+		auto index = (hash >> (sizeof(size_t) * 8 - 16)) & (self._shards.count - 1);
+		return self._shards[index];
+	}
+
+	// searches for the given key and if it's found calls the given function with the key value pair while holding the
+	// shard's read lock, the function shouldn't modify the concurrent map, returns whether the key was found
+	template<typename TKey, typename TValue, typename THash = Hash<TKey>, typename TFunc>
+	inline static bool
+	cmap_lookup_with(CMap<TKey, TValue, THash>& self, const TKey& key, TFunc&& func)
+	{
+		auto& shard = _cmap_shard(self, key);
+		mutex_read_lock(shard.mtx);
+		mn_defer(mutex_read_unlock(shard.mtx));
+
+		auto it = map_lookup(shard.map, key);
+		if (it == nullptr)
+			return false;
+		func(*it);
+		return true;
+	}
+
+	// searches for the given key and if it's found clones its value into out, returns whether the key was found
+	template<typename TKey, typename TValue, typename THash = Hash<TKey>>
+	inline static bool
+	cmap_lookup(CMap<TKey, TValue, THash>& self, const TKey& key, TValue& out)
+	{
+		return cmap_lookup_with(self, key, [&out](const Key_Value<const TKey, TValue>& kv) {
+			out = clone(kv.value);
+		});
+	}
+
+	// inserts the given key and value into the concurrent map or replaces the value if the key already exists, the map
+	// takes ownership of both, in case the key already exists the given key and the old value are destructed, returns
+	// true if the key was inserted
+	template<typename TKey, typename TValue, typename THash = Hash<TKey>>
+	inline static bool
+	cmap_insert_or_assign(CMap<TKey, TValue, THash>& self, const TKey& key, const TValue& value)
+	{
+		auto& shard = _cmap_shard(self, key);
+		mutex_write_lock(shard.mtx);
+		mn_defer(mutex_write_unlock(shard.mtx));
+
+		if (auto it = map_lookup(shard.map, key))
+		{
+			destruct(it->value);
+			it->value = value;
+			TKey duplicate_key = key;
+			destruct(duplicate_key);
+			return false;
+		}
+
+		map_insert(shard.map, key, value);
+		return true;
+	}
+
+	// removes the given key from the concurrent map and destructs it along with its value, returns whether it found
+	// and removed the key
+	template<typename TKey, typename TValue, typename THash = Hash<TKey>>
+	inline static bool
+	cmap_remove(CMap<TKey, TValue, THash>& self, const TKey& key)
+	{
+		auto& shard = _cmap_shard(self, key);
+		mutex_write_lock(shard.mtx);
+		mn_defer(mutex_write_unlock(shard.mtx));
+
+		auto it = map_lookup(shard.map, key);
+		if (it == nullptr)
+			return false;
+
+		Key_Value<TKey, TValue> kv{it->key, it->value};
+		map_remove(shard.map, kv.key);
+		destruct(kv);
+		return true;
+	}
+
+	// returns the count of the elements in the concurrent map, other threads may change it while it's being counted
+	template<typename TKey, typename TValue, typename THash = Hash<TKey>>
+	inline static size_t
+	cmap_count(CMap<TKey, TValue, THash>& self)
+	{
+		size_t res = 0;
+		for (auto& shard: self._shards)
+		{
+			mutex_read_lock(shard.mtx);
+			res += shard.map.count;
+			mutex_read_unlock(shard.mtx);
+		}
+		return res;
+	}
+
+	// calls the given function with every key value pair in the concurrent map, each shard is visited while holding
+	// its read lock so the function sees a consistent snapshot of each shard, but not of the whole map, the function
+	// shouldn't modify the concurrent map
+	template<typename TKey, typename TValue, typename THash = Hash<TKey>, typename TFunc>
+	inline static void
+	cmap_for_each(CMap<TKey, TValue, THash>& self, TFunc&& func)
+	{
+		for (auto& shard: self._shards)
+		{
+			mutex_read_lock(shard.mtx);
+			mn_defer(mutex_read_unlock(shard.mtx));
+
+			for (const auto& kv: shard.map)
+				func(kv);
+		}
+	}
+}
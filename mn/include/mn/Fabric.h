@@ -8,6 +8,7 @@
 #include "mn/Defer.h"
 #include "mn/OS.h"
 #include "mn/Stream.h"
+#include "mn/Reactor.h"
 
 #include <atomic>
 #include <chrono>
@@ -72,16 +73,41 @@ namespace mn
 	MN_EXPORT void
 	worker_task_batch_do(Worker self, const Fabric_Task* ptr, size_t count);
 
+	// returns the allocator used for the closures of the tasks scheduled from the current thread, if it's a worker
+	// it returns the worker's task pool which recycles the memory of the finished tasks, otherwise it returns
+	// the top allocator
+	MN_EXPORT Allocator
+	worker_task_allocator();
+
 	// schedules any callable into the worker queue
 	template<typename TFunc>
 	inline static void
 	worker_do(Worker self, TFunc&& f)
 	{
 		Fabric_Task entry{};
-		entry.task = Task<void()>::make(std::forward<TFunc>(f));
+		entry.task = Task<void()>::make_with_allocator(worker_task_allocator(), std::forward<TFunc>(f));
 		worker_task_do(self, entry);
 	}
 
+	// worker statistics, mainly about the worker's tmp arena which is cleared after each job
+	struct Worker_Stats
+	{
+		// number of jobs the worker has executed
+		size_t jobs_count;
+		// number of tmp arena clear_all calls (after each job, and after each compute invocation)
+		size_t tmp_clear_count;
+		// number of tmp arena clear_all calls which had to free or decommit memory
+		size_t tmp_readjust_count;
+		// memory currently committed/allocated by the tmp arena
+		size_t tmp_total_mem;
+		// maximum memory used by the tmp arena at any point in time
+		size_t tmp_highwater_mem;
+	};
+
+	// returns the statistics of the given worker, they're updated after each job
+	MN_EXPORT Worker_Stats
+	worker_stats(Worker self);
+
 	// returns the local worker of the calling thread if it has one, if it doesn't have a worker it will return nullptr
 	MN_EXPORT Worker
 	worker_local();
@@ -160,6 +186,14 @@ namespace mn
 		// will use to start evicting these workers if the blocking_workers_count >= workers_count * blocking_workers_threshold
 		// default: 0.5f
 		float blocking_workers_threshold;
+		// closures which don't fit in the task's small storage and are smaller than this size are allocated from
+		// the scheduling worker's task pool, bigger closures are allocated from the worker's default allocator
+		// default: 512
+		size_t task_spill_size;
+		// size of the virtual memory region reserved for each worker's tmp arena, the region is committed lazily
+		// and resetting it after each job is O(1), workers fall back to allocating blocks once it's full
+		// default: 1GB
+		size_t worker_tmp_reserve_size;
 		// function which will be executed after each worker finishes executing a job
 		Task<void()> after_each_job;
 		// function which will be executed when a new worker is started
@@ -181,7 +215,8 @@ namespace mn
 		fabric_free(self);
 	}
 
-	// adds a task to the fabric
+	// adds a task to the fabric, if it's called from one of the fabric's workers the task is pushed into
+	// the worker's local queue where idle workers can steal it, otherwise it's scheduled into one of the workers
 	MN_EXPORT void
 	fabric_task_do(Fabric self, const Fabric_Task& task);
 
@@ -195,7 +230,7 @@ namespace mn
 	fabric_do(Fabric self, TFunc&& f)
 	{
 		Fabric_Task entry{};
-		entry.task = Task<void()>::make(std::forward<TFunc>(f));
+		entry.task = Task<void()>::make_with_allocator(worker_task_allocator(), std::forward<TFunc>(f));
 		fabric_task_do(self, entry);
 	}
 
@@ -203,6 +238,30 @@ namespace mn
 	MN_EXPORT Fabric
 	fabric_local();
 
+	// schedules the given task into the fabric once the given handle (socket, pipe, etc..) is ready for one of the
+	// given events (REACTOR_EVENT flags), the wait is one shot so the task should wait again if it wants to be
+	// notified again, and since handles might be reported spuriously it should do non-blocking reads/writes
+	// (socket_read with NO_TIMEOUT for example), this way a fabric can serve a lot of mostly idle connections with
+	// a fixed count of workers because no worker is blocked on them, the handles are watched by a reactor thread
+	// which is started on the first call, if it fails the task is freed and it returns false
+	MN_EXPORT bool
+	fabric_io_task_do(Fabric self, int64_t handle, int events, const Fabric_Task& task);
+
+	// schedules any callable into the fabric once the given handle is ready for one of the given events
+	template<typename TFunc>
+	inline static bool
+	fabric_io_do(Fabric self, int64_t handle, int events, TFunc&& f)
+	{
+		Fabric_Task entry{};
+		entry.task = Task<void()>::make_with_allocator(worker_task_allocator(), std::forward<TFunc>(f));
+		return fabric_io_task_do(self, handle, events, entry);
+	}
+
+	// stops waiting on the given handle and frees its pending task if it has one, it should be called before the
+	// handle is closed
+	MN_EXPORT void
+	fabric_io_cancel(Fabric self, int64_t handle);
+
 	// represents the compute interface dimensions which is used to specify
 	// how many tasks you need along x, y, and z axis
 	// similar to graphics compute dispatch interface
@@ -230,13 +289,38 @@ namespace mn
 		Compute_Dims global_invocation_id;
 	};
 
+	// converts the given linear index into a position within the given dimensions, x is the fastest changing one
+	inline static Compute_Dims
+	_compute_dims_from_index(Compute_Dims dims, size_t index)
+	{
+		Compute_Dims res{};
+		res.x = index % dims.x;
+		index /= dims.x;
+		res.y = index % dims.y;
+		res.z = index / dims.y;
+		return res;
+	}
+
+	// advances the given position to the next one within the given dimensions, x is the fastest changing one
+	inline static void
+	_compute_dims_next(Compute_Dims dims, Compute_Dims& pos)
+	{
+		if (++pos.x < dims.x)
+			return;
+		pos.x = 0;
+		if (++pos.y < dims.y)
+			return;
+		pos.y = 0;
+		++pos.z;
+	}
+
 	// schedules the given callable into the given fabric
 	template<typename TFunc>
 	inline static void
 	go(Fabric f, TFunc&& fn)
 	{
 		Fabric_Task entry{};
-		entry.task = Task<void()>::make(std::forward<TFunc>(fn));
+		entry.task = Task<void()>::make_with_allocator(worker_task_allocator(), std::forward<TFunc>(fn));
 		fabric_task_do(f, entry);
 	}
 
@@ -246,7 +330,7 @@ namespace mn
 	go(Worker worker, TFunc&& fn)
 	{
 		Fabric_Task entry{};
-		entry.task = Task<void()>::make(std::forward<TFunc>(fn));
+		entry.task = Task<void()>::make_with_allocator(worker_task_allocator(), std::forward<TFunc>(fn));
 		worker_task_do(worker, entry);
 	}
 
@@ -259,13 +343,13 @@ namespace mn
 		if (Fabric f = fabric_local())
 		{
 			Fabric_Task entry{};
-			entry.task = Task<void()>::make(std::forward<TFunc>(fn));
+			entry.task = Task<void()>::make_with_allocator(worker_task_allocator(), std::forward<TFunc>(fn));
 			fabric_task_do(f, entry);
 		}
 		else if (Worker w = worker_local())
 		{
 			Fabric_Task entry{};
-			entry.task = Task<void()>::make(std::forward<TFunc>(fn));
+			entry.task = Task<void()>::make_with_allocator(worker_task_allocator(), std::forward<TFunc>(fn));
 			worker_task_do(w, entry);
 		}
 		else
@@ -1057,4 +1141,87 @@ namespace mn
 		else
 			_multi_threaded_compute_tiled(f, global, tile_size, mn::Task<void(Compute_Args)>::make(std::forward<TFunc>(fn)));
 	}
+
+	// calls fn(begin, end) over the range [0, count) using the given fabric, the range is split into a range per
+	// worker, and the ranges are lazily subdivided when there are idle workers, each range is processed in chunks
+	// whose size is tuned using the measured cost of the processed indices
+	MN_EXPORT void
+	_multi_threaded_range(Fabric self, size_t count, Task<void(size_t, size_t)> fn);
+
+	// calls the given function for each position within the given size, fn(Compute_Dims id), using the given fabric
+	// if the fabric is null it will execute the function on the calling thread
+	template<typename TFunc>
+	inline static void
+	parallel_for(Fabric f, Compute_Dims size, TFunc&& fn)
+	{
+		auto range_fn = [&fn, size](size_t begin, size_t end) {
+			auto id = _compute_dims_from_index(size, begin);
+			for (size_t i = begin; i < end; ++i, _compute_dims_next(size, id))
+				fn(id);
+		};
+
+		auto count = size.x * size.y * size.z;
+		if (count == 0)
+			return;
+
+		if (f == nullptr)
+			range_fn(0, count);
+		else
+			_multi_threaded_range(f, count, Task<void(size_t, size_t)>::make(range_fn));
+	}
+
+	// calls the given function for each position within the given size, using the local fabric if there's one
+	template<typename TFunc>
+	inline static void
+	parallel_for(Compute_Dims size, TFunc&& fn)
+	{
+		parallel_for(fabric_local(), size, std::forward<TFunc>(fn));
+	}
+
+	// accumulates a value over each position within the given size using the given fabric, each range of positions
+	// starts from the identity value and accumulates into it using fn(T& acc, Compute_Dims id), then the partial
+	// values are combined using reduce(T& acc, const T& partial) in no particular order, so reduce should be
+	// associative and commutative, if the fabric is null it will execute on the calling thread
+	template<typename T, typename TFunc, typename TReduce>
+	inline static T
+	parallel_reduce(Fabric f, Compute_Dims size, const T& identity, TFunc&& fn, TReduce&& reduce)
+	{
+		T res = identity;
+
+		auto count = size.x * size.y * size.z;
+		if (count == 0)
+			return res;
+
+		if (f == nullptr)
+		{
+			auto id = _compute_dims_from_index(size, 0);
+			for (size_t i = 0; i < count; ++i, _compute_dims_next(size, id))
+				fn(res, id);
+			return res;
+		}
+
+		auto mtx = mutex_new("parallel_reduce");
+		mn_defer(mutex_free(mtx));
+
+		auto range_fn = [&](size_t begin, size_t end) {
+			T acc = identity;
+			auto id = _compute_dims_from_index(size, begin);
+			for (size_t i = begin; i < end; ++i, _compute_dims_next(size, id))
+				fn(acc, id);
+
+			mutex_lock(mtx);
+			reduce(res, acc);
+			mutex_unlock(mtx);
+		};
+		_multi_threaded_range(f, count, Task<void(size_t, size_t)>::make(range_fn));
+		return res;
+	}
+
+	// accumulates a value over each position within the given size, using the local fabric if there's one
+	template<typename T, typename TFunc, typename TReduce>
+	inline static T
+	parallel_reduce(Compute_Dims size, const T& identity, TFunc&& fn, TReduce&& reduce)
+	{
+		return parallel_reduce(fabric_local(), size, identity, std::forward<TFunc>(fn), std::forward<TReduce>(reduce));
+	}
 }
\ No newline at end of file
@@ -261,6 +261,25 @@ namespace mn
 		return file_mmap(str_lit(filename), offset, size, io_mode, open_mode, share_mode);
 	}
 
+	// hints for how a mapped file will be accessed, the os is free to ignore them
+	enum MAPPED_FILE_HINT
+	{
+		MAPPED_FILE_HINT_NONE = 0,
+		// the file will be read sequentially, the os reads ahead aggressively and can drop the pages behind the reader
+		MAPPED_FILE_HINT_SEQUENTIAL = 1 << 0,
+		// the file will be accessed randomly, the os doesn't read ahead
+		MAPPED_FILE_HINT_RANDOM = 1 << 1,
+		// the file will be needed soon, the os starts reading it in the background
+		MAPPED_FILE_HINT_WILL_NEED = 1 << 2,
+		// backs the mapping with huge pages (if the os and the filesystem support it) to reduce the tlb misses
+		MAPPED_FILE_HINT_HUGE_PAGES = 1 << 3,
+	};
+
+	// applies the given hints (MAPPED_FILE_HINT flags) to the given mapped file, and returns whether the os accepted
+	// all of them
+	MN_EXPORT bool
+	file_mmap_hint(Mapped_File* self, int hints);
+
 	// unmaps the given mapped file, and returns whether the unmap was successful
 	MN_EXPORT bool
 	file_unmap(Mapped_File* self);
@@ -45,6 +45,29 @@ namespace mn::ipc
 
 	// OS communication primitives
 
+	// sputnik transport options
+	enum SPUTNIK_TRANSPORT
+	{
+		// unix domain socket on linux/mac, and named pipe on windows
+		SPUTNIK_TRANSPORT_SOCKET,
+		// a pair of shared memory ring buffers (one for each direction) with futex wakeups, it's only supported on
+		// linux, other oses fall back to the socket transport, the socket is still used to establish the connection
+		// and to detect when the other process dies
+		SPUTNIK_TRANSPORT_SHM,
+	};
+
+	// sputnik settings, the server and the client should use the same transport, a shm client/server fails to
+	// connect/accept if the other side uses the socket transport
+	struct Sputnik_Settings
+	{
+		SPUTNIK_TRANSPORT transport;
+		// size of each ring buffer in bytes (shm transport only), it's rounded up to a power of 2, default: 1MB
+		size_t ring_size;
+		// max time to wait for the other side's handshake while connecting/accepting (shm transport only), the client
+		// waits for the server to accept the connection so it should cover the server's accept delay, default: 5s
+		Timeout handshake_timeout;
+	};
+
 	// sputnik is an inter-process communicateion protocol
 	typedef struct ISputnik* Sputnik;
 
@@ -57,6 +80,9 @@ namespace mn::ipc
 		};
 		Str name;
 		uint64_t read_msg_size;
+		Sputnik_Settings settings;
+		// shared memory transport state, it's null for the socket transport
+		struct ISputnik_Shm* shm;
 
 		MN_EXPORT void
 		dispose() override;
@@ -80,24 +106,24 @@ namespace mn::ipc
 
 	// creates a new sputnik instance with the given name, if it fails it will return nullptr
 	MN_EXPORT Sputnik
-	sputnik_new(const Str& name);
+	sputnik_new(const Str& name, Sputnik_Settings settings = {});
 
 	// creates a new sputnik instance with the given name, if it fails it will return nullptr
 	inline static Sputnik
-	sputnik_new(const char* name)
+	sputnik_new(const char* name, Sputnik_Settings settings = {})
 	{
-		return sputnik_new(str_lit(name));
+		return sputnik_new(str_lit(name), settings);
 	}
 
 	// connects to a given sputnik instance with the given name, if it fails it will return nullptr
 	MN_EXPORT Sputnik
-	sputnik_connect(const Str& name);
+	sputnik_connect(const Str& name, Sputnik_Settings settings = {});
 
 	// connects to a given sputnik instance with the given name, if it fails it will return nullptr
 	inline static Sputnik
-	sputnik_connect(const char* name)
+	sputnik_connect(const char* name, Sputnik_Settings settings = {})
 	{
-		return sputnik_connect(str_lit(name));
+		return sputnik_connect(str_lit(name), settings);
 	}
 
 	// frees the given sputnik instance
@@ -114,7 +140,7 @@ namespace mn::ipc
 	sputnik_accept(Sputnik self, Timeout timeout);
 
 	// tries to read from the given sputnik instance within the given timeout window
-	// returns the number of read bytes
+	// returns the number of read bytes, 0 means that it timed out or the other side has disconnected
 	MN_EXPORT size_t
 	sputnik_read(Sputnik self, Block data, Timeout timeout);
 
@@ -122,6 +148,12 @@ namespace mn::ipc
 	MN_EXPORT size_t
 	sputnik_write(Sputnik self, Block data);
 
+	// writes the given blocks into the given sputnik instance with a single call (gather write) when the os supports it
+	// and returns the number of written bytes, with the shm transport the blocks are published to the reader at once
+	// and concurrent writers don't interleave
+	MN_EXPORT size_t
+	sputnik_writev(Sputnik self, const Block* blocks, size_t count);
+
 	// disconnects the given sputnik instance
 	MN_EXPORT bool
 	sputnik_disconnect(Sputnik self);
@@ -146,4 +178,41 @@ namespace mn::ipc
 	// allocates and reads a single message
 	MN_EXPORT Str
 	sputnik_msg_read_alloc(Sputnik self, Timeout timeout, Allocator allocator = allocator_top());
+
+	// a buffered message channel on top of a sputnik instance, it uses the same message protocol so the other side
+	// can use the normal sputnik message functions, outgoing messages are coalesced into a buffer and written with a
+	// single call when it's flushed, incoming messages are read in large chunks into a reusable buffer
+	typedef struct ISputnik_Channel* Sputnik_Channel;
+
+	// creates a new channel on top of the given sputnik instance (it doesn't own it) with the given buffer size
+	MN_EXPORT Sputnik_Channel
+	sputnik_channel_new(Sputnik sputnik, size_t buffer_size = 64 * 1024);
+
+	// flushes then frees the given channel
+	MN_EXPORT void
+	sputnik_channel_free(Sputnik_Channel self);
+
+	// destruct overload for sputnik channel free
+	inline static void
+	destruct(Sputnik_Channel self)
+	{
+		sputnik_channel_free(self);
+	}
+
+	// queues a message into the given channel, the queued messages are written when they exceed the buffer size or
+	// when the channel is flushed, messages larger than the buffer are written directly without copying them, returns
+	// false if writing failed
+	MN_EXPORT bool
+	sputnik_channel_msg_write(Sputnik_Channel self, Block data);
+
+	// writes all the queued messages with a single call, returns false if writing failed
+	MN_EXPORT bool
+	sputnik_channel_flush(Sputnik_Channel self);
+
+	// reads all the messages which are ready (at least one) within the given timeout window, it clears the given
+	// messages buffer and pushes a block for each message into it, the blocks point into the channel's read buffer so
+	// they're only valid until the next read, returns the count of read messages, 0 means that it timed out or the
+	// other side has disconnected
+	MN_EXPORT size_t
+	sputnik_channel_msg_read_batch(Sputnik_Channel self, Buf<Block>& messages, Timeout timeout);
 }
\ No newline at end of file
@@ -6,6 +6,14 @@
 #include "mn/Map.h"
 #include "mn/Result.h"
 #include "mn/Fmt.h"
+#include "mn/Stream.h"
+#include "mn/Reader.h"
+#include "mn/Task.h"
+
+namespace mn
+{
+	typedef struct IFabric* Fabric;
+}
 
 namespace mn::json
 {
@@ -205,15 +213,264 @@ namespace mn::json
 		return *self.as_object;
 	}
 
+	// json parse settings
+	struct Parse_Settings
+	{
+		// parses without the simd structural index, the lexer walks the content one byte at a time instead, it's
+		// mostly useful to compare both, default: false
+		bool no_structural_index;
+	};
+
 	// tries to parse json value from the encoded string
 	MN_EXPORT Result<Value>
-	parse(const Str& content);
+	parse(const Str& content, Parse_Settings settings = {});
 
 	// tries to parse json value from the encoded string
 	inline static Result<Value>
-	parse(const char* content)
+	parse(const char* content, Parse_Settings settings = {})
+	{
+		return parse(str_lit(content), settings);
+	}
+
+	// a string as it appears in the parsed content (escaped), or the unescaped copy of it once it's accessed
+	struct Doc_String
+	{
+		const char* ptr;
+		size_t count;
+	};
+
+	// a node in the tape of a parsed json document, arrays and objects are followed by their children in the tape,
+	// the children of an object are key value runs where the keys are string nodes
+	struct Doc_Node
+	{
+		Value::KIND kind;
+		// strings only: whether the string in the content has escape sequences
+		bool escaped;
+		// strings only: whether as_string points to the unescaped null terminated copy in the document's arena
+		bool materialized;
+		// arrays: count of elements, objects: count of key value pairs
+		uint32_t count;
+		union
+		{
+			bool as_bool;
+			double as_number;
+			Doc_String as_string;
+			// arrays and objects: index of the node which comes after the last child of this node
+			size_t end;
+		};
+	};
+
+	// a parsed json document, unlike json::Value which allocates each string, array and object separately the whole
+	// document lives in a flat tape of nodes and the root is the first node in it, strings are views into the parsed
+	// content (so it should outlive the document) and they're unescaped lazily on access, objects aren't hashed
+	// unless a big one is looked up, and freeing the document doesn't walk the nodes
+	struct Doc
+	{
+		Buf<Doc_Node> tape;
+		// the unescaped strings and the object indices are allocated from this arena
+		memory::Arena* arena;
+		// maps the index of the big objects which were looked up to their key -> value node index hash table
+		Map<size_t, Map<Str, size_t>> object_indices;
+	};
+
+	// tries to parse a json document from the encoded string, the document refers to the given content so it should
+	// outlive it
+	MN_EXPORT Result<Doc>
+	doc_parse(const Str& content, Parse_Settings settings = {});
+
+	// tries to parse a json document from the encoded string, the document refers to the given content so it should
+	// outlive it
+	inline static Result<Doc>
+	doc_parse(const char* content, Parse_Settings settings = {})
+	{
+		return doc_parse(str_lit(content), settings);
+	}
+
+	// frees the given json document
+	MN_EXPORT void
+	doc_free(Doc& self);
+
+	// destruct overload for doc free
+	inline static void
+	destruct(Doc& self)
+	{
+		doc_free(self);
+	}
+
+	// returns the index of the node which comes after the given node and its children, inside arrays and objects
+	// it's the next sibling
+	inline static size_t
+	doc_next(const Doc& self, size_t index)
+	{
+		const auto& node = self.tape[index];
+		if (node.kind == Value::KIND_ARRAY || node.kind == Value::KIND_OBJECT)
+			return node.end;
+		return index + 1;
+	}
+
+	// returns the index of the element at the given index inside the given array node, or SIZE_MAX if it's out of
+	// range, the elements are walked so it's linear in the count of elements
+	MN_EXPORT size_t
+	doc_array_at(const Doc& self, size_t array, size_t index);
+
+	// returns the unescaped string of the given string node, the string is owned by the document and it's null
+	// terminated, the first access copies it into the document's arena and the following accesses reuse it
+	MN_EXPORT Str
+	doc_string(Doc& self, size_t index);
+
+	// searches for a key inside the given object node and returns the index of its value node, or SIZE_MAX if the
+	// key doesn't exist, if the key is repeated the last one wins, small objects are searched linearly and big ones
+	// are hashed on their first lookup, lookups aren't thread safe since they might update the document
+	MN_EXPORT size_t
+	doc_object_lookup(Doc& self, size_t object, const Str& key);
+
+	// searches for a key inside the given object node and returns the index of its value node, or SIZE_MAX if the
+	// key doesn't exist
+	inline static size_t
+	doc_object_lookup(Doc& self, size_t object, const char* key)
+	{
+		return doc_object_lookup(self, object, str_lit(key));
+	}
+
+	// converts the given node and its children into a json value
+	MN_EXPORT Value
+	doc_to_value(Doc& self, size_t index);
+
+	// an event emitted by the streaming parser
+	struct Event
+	{
+		enum KIND
+		{
+			// the buffered input is consumed, feed more input or finish it (only for parsers without a source)
+			KIND_NEED_INPUT,
+			// the input is finished and all of its documents are complete
+			KIND_END,
+			KIND_BEGIN_OBJECT,
+			KIND_END_OBJECT,
+			KIND_BEGIN_ARRAY,
+			KIND_END_ARRAY,
+			// an object key, its value is the next event
+			KIND_KEY,
+			KIND_NULL,
+			KIND_BOOL,
+			KIND_NUMBER,
+			KIND_STRING,
+		};
+
+		KIND kind;
+		// nesting depth of the event, top level values are at depth 0 and the content of an object or array is one
+		// level deeper than its begin and end events
+		size_t depth;
+		bool as_bool;
+		double as_number;
+		// keys and strings: the unescaped string, it's owned by the parser and it's valid until the next event
+		Str as_string;
+	};
+
+	// streaming parser settings
+	struct Event_Parser_Settings
+	{
+		// max size in bytes of a single string or number, it bounds the parser's memory, default: 0 (unlimited)
+		size_t max_token_size;
+		// max nesting depth of objects and arrays, default: 1024
+		size_t max_depth;
+		// accepts a sequence of top level values separated by whitespace (newline delimited json for example)
+		// instead of a single one
+		bool multiple_documents;
+		// size of the chunks which are read from the parser's stream or reader, default: 64KB
+		size_t read_size;
+	};
+
+	// an event based (sax like) streaming json parser, it holds only the part of the input which wasn't parsed yet
+	// so it can parse documents which don't fit in memory, and it can be resumed when the input arrives in chunks,
+	// the events are pulled one at a time with event_parser_next
+	typedef struct IEvent_Parser* Event_Parser;
+
+	// creates a new streaming parser which parses the input given to event_parser_feed
+	MN_EXPORT Event_Parser
+	event_parser_new(Event_Parser_Settings settings = {});
+
+	// creates a new streaming parser which reads its input from the given stream until it reads 0 bytes
+	MN_EXPORT Event_Parser
+	event_parser_stream_new(Stream stream, Event_Parser_Settings settings = {});
+
+	// creates a new streaming parser which reads its input from the given reader until it reads 0 bytes
+	MN_EXPORT Event_Parser
+	event_parser_reader_new(Reader reader, Event_Parser_Settings settings = {});
+
+	// frees the given streaming parser
+	MN_EXPORT void
+	event_parser_free(Event_Parser self);
+
+	// destruct overload for event parser free
+	inline static void
+	destruct(Event_Parser self)
+	{
+		event_parser_free(self);
+	}
+
+	// appends the given chunk of input to the parser, the chunk is copied so it can be reused after the call
+	MN_EXPORT void
+	event_parser_feed(Event_Parser self, Block data);
+
+	// appends the given chunk of input to the parser
+	inline static void
+	event_parser_feed(Event_Parser self, const Str& data)
+	{
+		event_parser_feed(self, block_from(data));
+	}
+
+	// appends the given chunk of input to the parser
+	inline static void
+	event_parser_feed(Event_Parser self, const char* data)
+	{
+		event_parser_feed(self, block_lit(data));
+	}
+
+	// marks the end of the input, after it the parser reports the end of the documents instead of asking for more input
+	MN_EXPORT void
+	event_parser_finish(Event_Parser self);
+
+	// parses the next event, it returns KIND_NEED_INPUT when the parser has no source and it needs more input to
+	// complete the next event, errors are sticky so all the following calls return the same error
+	MN_EXPORT Result<Event>
+	event_parser_next(Event_Parser self);
+
+	// reads the next non empty line of the given newline delimited json reader into line and parses it into doc, the
+	// document refers to line so it's valid as long as line isn't changed, the document is reused between the calls
+	// (free it with doc_free once you're done), returns false at the end of the reader, if the line is invalid it
+	// returns its error and the next call continues from the next line
+	MN_EXPORT Result<bool>
+	ndjson_next(Reader reader, Str& line, Doc& doc);
+
+	// the callback which is called for each line in a parallel newline delimited json parse with the line number
+	// (starting from 1) and its parsed document or error, the document is only valid until the callback returns
+	using Ndjson_Callback = Task<void(size_t line_number, Doc& doc, const Err& err)>;
+
+	// parallel newline delimited json parse settings
+	struct Ndjson_Parallel_Settings
+	{
+		// the lines are sent to the fabric's workers in batches of about this size in bytes, default: 256KB
+		size_t batch_size;
+		// max count of batches which are read but not parsed yet, it bounds the memory to about
+		// batch_size * max_batches, default: 16
+		size_t max_batches;
+	};
+
+	// reads the lines of the given newline delimited json reader on the calling thread and parses them in batches on
+	// the fabric's workers, the callback is called concurrently from multiple workers and the lines aren't reported
+	// in order, it blocks until all the lines are parsed and returns the count of non empty lines
+	MN_EXPORT size_t
+	ndjson_parse_parallel(Reader reader, Fabric fabric, Ndjson_Callback callback, Ndjson_Parallel_Settings settings = {});
+
+	// reads the lines of the given newline delimited json reader on the calling thread and parses them in batches on
+	// the fabric's workers, the callback is called concurrently from multiple workers and the lines aren't reported
+	// in order, it blocks until all the lines are parsed and returns the count of non empty lines
+	template<typename TFunc>
+	inline static size_t
+	ndjson_parse_parallel(Reader reader, Fabric fabric, TFunc&& callback, Ndjson_Parallel_Settings settings = {})
 	{
-		return parse(str_lit(content));
+		return ndjson_parse_parallel(reader, fabric, Ndjson_Callback::make(std::forward<TFunc>(callback)), settings);
 	}
 }
 
@@ -271,4 +528,4 @@ namespace fmt
 			return ctx.out();
 		}
 	};
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -6,6 +6,17 @@
 
 #include <assert.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MN_HASH_SSE2 1
+#include <emmintrin.h>
+#else
+#define MN_HASH_SSE2 0
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 namespace mn
 {
 	// a key value pair, used in hash map implementation
@@ -271,83 +282,166 @@ namespace mn
 	}
 
 
-	// hash table slot flags
-	enum HASH_FLAGS: uint8_t { HASH_EMPTY, HASH_USED, HASH_DELETED };
+	// hash table control bytes, every slot in the table has a control byte, a full slot stores the 7-bit tag of its
+	// value's hash, empty and deleted slots have the most significant bit set so they never match a tag
+	enum HASH_CONTROL: int8_t { HASH_CONTROL_EMPTY = -128, HASH_CONTROL_DELETED = -2 };
+
+	// control bytes are probed in groups of this many slots at a time
+	constexpr static size_t HASH_GROUP_WIDTH = 16;
+
+	// bit mask of the matched slots in a group, bit i corresponds to the i-th slot in the group
+	using Hash_Group_Mask = uint32_t;
 
-	// hash table slot with the index and hash
-	struct Hash_Slot
+	// returns the index of the least significant set bit in the given mask, mask must not be zero
+	inline static uint32_t
+	_hash_group_mask_lowest(Hash_Group_Mask mask)
 	{
-		// most signficant 2 bits = HASH_FLAGS enum
-		// remaining bits = index
-		size_t index;
-		size_t hash;
-	};
+		#if defined(_MSC_VER)
+			unsigned long res = 0;
+			_BitScanForward(&res, mask);
+			return uint32_t(res);
+		#else
+			return uint32_t(__builtin_ctz(mask));
+		#endif
+	}
 
-	// returns the flags of the given hash slot
-	inline static HASH_FLAGS
-	hash_slot_flags(Hash_Slot s)
+	// returns the count of unset bits above the most significant set bit in the given group mask, mask must not be zero
+	inline static uint32_t
+	_hash_group_mask_leading_zeros(Hash_Group_Mask mask)
 	{
-		if constexpr (sizeof(size_t) == 8)
-			return HASH_FLAGS((s.index & 0xC000000000000000) >> 62);
-		else if constexpr (sizeof(size_t) == 4)
-			return HASH_FLAGS((s.index & 0xC0000000) >> 30);
+		#if defined(_MSC_VER)
+			unsigned long res = 0;
+			_BitScanReverse(&res, mask);
+			return uint32_t(HASH_GROUP_WIDTH - 1 - res);
+		#else
+			return uint32_t(__builtin_clz(mask)) - (32 - HASH_GROUP_WIDTH);
+		#endif
 	}
 
-	// returns the index of the given hash slot
-	inline static size_t
-	hash_slot_index(Hash_Slot s)
+	// returns a mask of the slots in the group starting at the given control byte which have the given control value
+	inline static Hash_Group_Mask
+	_hash_group_match(const int8_t* control, int8_t value)
 	{
-		if constexpr (sizeof(size_t) == 8)
-			return size_t(s.index & 0x3FFFFFFFFFFFFFFF);
-		else if constexpr (sizeof(size_t) == 4)
-			return size_t(s.index & 0x3FFFFFFF);
+		#if MN_HASH_SSE2
+			auto group = _mm_loadu_si128((const __m128i*)control);
+			return Hash_Group_Mask(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(value), group)));
+		#else
+			Hash_Group_Mask res = 0;
+			for (size_t i = 0; i < HASH_GROUP_WIDTH; ++i)
+				res |= Hash_Group_Mask(control[i] == value) << i;
+			return res;
+		#endif
+	}
+
+	// returns a mask of the empty and deleted slots in the group starting at the given control byte
+	inline static Hash_Group_Mask
+	_hash_group_match_non_full(const int8_t* control)
+	{
+		#if MN_HASH_SSE2
+			return Hash_Group_Mask(_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)control)));
+		#else
+			Hash_Group_Mask res = 0;
+			for (size_t i = 0; i < HASH_GROUP_WIDTH; ++i)
+				res |= Hash_Group_Mask(control[i] < 0) << i;
+			return res;
+		#endif
 	}
 
-	// sets the flags of the given hash slot
-	inline static Hash_Slot
-	hash_slot_set_flags(Hash_Slot s, HASH_FLAGS f)
+	// user hashes can be weak (trivial types hash to themselves), so we mix them before splitting them into the
+	// probe start position (high bits) and the 7-bit control tag (low bits)
+	inline static size_t
+	_hash_table_mix(size_t hash)
 	{
 		if constexpr (sizeof(size_t) == 8)
 		{
-			s.index &= ~0xC000000000000000;
-			s.index |= (size_t(f) << 62);
+			hash ^= hash >> 33;
+			hash *= 0xff51afd7ed558ccd;
+			hash ^= hash >> 33;
 		}
 		else if constexpr (sizeof(size_t) == 4)
 		{
-			s.index &= ~0xC0000000;
-			s.index |= (size_t(f) << 30);
+			hash ^= hash >> 16;
+			hash *= 0x85ebca6b;
+			hash ^= hash >> 13;
 		}
-		return s;
+		return hash;
 	}
 
-	// sets the index of the given hash slot
-	inline static Hash_Slot
-	hash_slot_set_index(Hash_Slot s, size_t index)
+	inline static int8_t
+	_hash_table_tag(size_t hash)
 	{
-		if constexpr (sizeof(size_t) == 8)
-		{
-			s.index &= ~0x3FFFFFFFFFFFFFFF;
-			s.index |= (size_t(index) & 0x3FFFFFFFFFFFFFFF);
-		}
-		else if constexpr (sizeof(size_t) == 4)
+		return int8_t(hash & 0x7F);
+	}
+
+	// max count of full and deleted slots before the table should grow, which is 7/8th of the table
+	inline static size_t
+	_hash_table_growth_capacity(size_t cap)
+	{
+		return cap - (cap >> 3);
+	}
+
+	// quadratic probing over groups, given that capacity is a power of 2 it visits every group exactly once
+	struct _Hash_Probe
+	{
+		size_t position;
+		size_t step;
+		size_t mask;
+	};
+
+	inline static _Hash_Probe
+	_hash_probe_new(size_t hash, size_t cap)
+	{
+		return _Hash_Probe{(hash >> 7) & (cap - 1), 0, cap - 1};
+	}
+
+	inline static void
+	_hash_probe_next(_Hash_Probe& self)
+	{
+		self.step += HASH_GROUP_WIDTH;
+		self.position = (self.position + self.step) & self.mask;
+	}
+
+	inline static size_t
+	_hash_probe_slot(const _Hash_Probe& self, uint32_t offset)
+	{
+		return (self.position + offset) & self.mask;
+	}
+
+	// the control buffer has HASH_GROUP_WIDTH - 1 extra bytes at the end which mirror the first bytes of the table
+	// so that a group can be loaded at any slot without wrapping around
+	inline static void
+	_hash_control_set(Buf<int8_t>& control, size_t cap, size_t index, int8_t value)
+	{
+		control[index] = value;
+		control[((index - (HASH_GROUP_WIDTH - 1)) & (cap - 1)) + (HASH_GROUP_WIDTH - 1)] = value;
+	}
+
+	// returns the first empty or deleted slot in the probe sequence of the given hash
+	inline static size_t
+	_hash_control_find_non_full(const Buf<int8_t>& control, size_t cap, size_t hash)
+	{
+		auto probe = _hash_probe_new(hash, cap);
+		while (true)
 		{
-			s.index &= ~0x3FFFFFFF;
-			s.index |= (size_t(index) & 0x3FFFFFFF);
+			auto match = _hash_group_match_non_full(control.ptr + probe.position);
+			if (match)
+				return _hash_probe_slot(probe, _hash_group_mask_lowest(match));
+			_hash_probe_next(probe);
 		}
-		return s;
 	}
 
-	// a hash set
+	// a hash set, it's an open addressing table which stores a control byte and the index of the value per slot, the
+	// values themselves are stored densely in the values buffer in insertion order (removal swaps the last value into
+	// the removed value's place)
 	template<typename T, typename THash = Hash<T>>
 	struct Set
 	{
-		Buf<Hash_Slot> _slots;
+		Buf<int8_t> _control;
+		Buf<size_t> _slots;
 		Buf<T> values;
 		size_t count;
 		size_t _deleted_count;
-		size_t _used_count_threshold;
-		size_t _used_count_shrink_threshold;
-		size_t _deleted_count_threshold;
+		size_t _growth_left;
 	};
 
 	// creates a new hash set instance with the top/default allocator
@@ -356,7 +450,8 @@ namespace mn
 	set_new()
 	{
 		Set<T, THash> self{};
-		self._slots = buf_new<Hash_Slot>();
+		self._control = buf_new<int8_t>();
+		self._slots = buf_new<size_t>();
 		self.values = buf_new<T>();
 		return self;
 	}
@@ -367,7 +462,8 @@ namespace mn
 	set_with_allocator(Allocator allocator)
 	{
 		Set<T, THash> self{};
-		self._slots = buf_with_allocator<Hash_Slot>(allocator);
+		self._control = buf_with_allocator<int8_t>(allocator);
+		self._slots = buf_with_allocator<size_t>(allocator);
 		self.values = buf_with_allocator<T>(allocator);
 		return self;
 	}
@@ -377,10 +473,12 @@ namespace mn
 	inline static void
 	set_free(Set<T, THash>& self)
 	{
+		buf_free(self._control);
 		buf_free(self._slots);
 		buf_free(self.values);
 		self.count = 0;
 		self._deleted_count = 0;
+		self._growth_left = 0;
 	}
 
 	// destruct overload for the given hash set
@@ -388,10 +486,12 @@ namespace mn
 	inline static void
 	destruct(Set<T, THash>& self)
 	{
+		buf_free(self._control);
 		buf_free(self._slots);
 		destruct(self.values);
 		self.count = 0;
 		self._deleted_count = 0;
+		self._growth_left = 0;
 	}
 
 	// clears the given hash set content, note this doesn't free any complex data structure stored in the hash set
@@ -399,10 +499,11 @@ namespace mn
 	inline static void
 	set_clear(Set<T, THash>& self)
 	{
-		buf_fill(self._slots, Hash_Slot{});
+		buf_fill(self._control, int8_t(HASH_CONTROL_EMPTY));
 		buf_clear(self.values);
 		self.count = 0;
 		self._deleted_count = 0;
+		self._growth_left = _hash_table_growth_capacity(self._slots.count);
 	}
 
 	// returns the capacity of the given hash set
@@ -413,194 +514,101 @@ namespace mn
 		return self._slots.count;
 	}
 
-	struct _Hash_Search_Result
-	{
-		size_t hash;
-		size_t index;
-	};
-
+	// returns the slot of the given key or the capacity if it doesn't exist, hash is the mixed hash of the key
 	template<typename T, typename THash = Hash<T>>
-	inline static _Hash_Search_Result
-	_set_find_slot_for_insert(const Buf<Hash_Slot>& _slots, const Buf<T>& values, const T& key, size_t* external_hash)
+	inline static size_t
+	_set_find_slot_for_lookup(const Set<T, THash>& self, const T& key, size_t hash)
 	{
-		_Hash_Search_Result res{};
-		if (external_hash)
-			res.hash = *external_hash;
-		else
-			res.hash = THash()(key);
-
-		auto cap = _slots.count;
-		if (cap == 0) return res;
-
-		auto index = res.hash & (cap - 1);
-		auto ix = index;
-
-		size_t first_deleted_slot_index = 0;
-		bool found_first_deleted_slot = false;
+		auto cap = self._slots.count;
+		if (cap == 0) return cap;
 
-		// linear probing
-		while(true)
+		auto tag = _hash_table_tag(hash);
+		auto probe = _hash_probe_new(hash, cap);
+		while (true)
 		{
-			auto slot = _slots[ix];
-			auto slot_hash = slot.hash;
-			auto slot_index = hash_slot_index(slot);
-			auto slot_flags = hash_slot_flags(slot);
-			switch (slot_flags)
+			auto group = self._control.ptr + probe.position;
+			for (auto match = _hash_group_match(group, tag); match; match &= match - 1)
 			{
-			// this position is not empty but if it's the same value then we return it
-			case HASH_FLAGS::HASH_USED:
-			{
-				if (slot_hash == res.hash && values[slot_index] == key)
-				{
-					res.index = ix;
-					return res;
-				}
-				break;
-			}
-			// this is an empty slot then we can use it
-			case HASH_FLAGS::HASH_EMPTY:
-			{
-				// we didn't find the key, so check the first deleted slot if we found one then
-				// reuse it
-				if (found_first_deleted_slot)
-				{
-					res.index = first_deleted_slot_index;
-				}
-				// we didn't find the key, so use the first empty slot
-				else
-				{
-					res.index = ix;
-				}
-				return res;
-				break;
-			}
-			// this is a deleted slot we'll remember it just in case we wanted to resuse it
-			case HASH_FLAGS::HASH_DELETED:
-			{
-				if (found_first_deleted_slot == false)
-				{
-					first_deleted_slot_index = ix;
-					found_first_deleted_slot = true;
-				}
-				break;
-			}
-			default: assert(false && "unreachable"); return _Hash_Search_Result{};
+				auto ix = _hash_probe_slot(probe, _hash_group_mask_lowest(match));
+				if (self.values[self._slots[ix]] == key)
+					return ix;
 			}
 
-			// the position is not empty and the key is not the same
-			++ix;
-			ix &= (cap - 1);
+			// an empty slot terminates any probe sequence, so the key doesn't exist
+			if (_hash_group_match(group, HASH_CONTROL_EMPTY))
+				return cap;
 
-			// if we went full circle then we just return the cap to signal no index has been found
-			if (ix == index)
-			{
-				ix = cap;
-				break;
-			}
+			_hash_probe_next(probe);
 		}
-
-		res.index = ix;
-		return res;
 	}
 
+	// returns the slot which points to the value at the given index, the value must exist in the table
 	template<typename T, typename THash = Hash<T>>
-	inline static _Hash_Search_Result
-	_set_find_slot_for_lookup(const Set<T, THash>& self, const T& key)
+	inline static size_t
+	_set_find_slot_for_index(const Set<T, THash>& self, size_t index)
 	{
-		_Hash_Search_Result res{};
-		res.hash = THash()(key);
-
-		auto cap = self._slots.count;
-		if (cap == 0) return res;
-
-		auto index = res.hash & (cap - 1);
-		auto ix = index;
-
-		// linear probing
-		while(true)
+		auto hash = _hash_table_mix(THash()(self.values[index]));
+		auto tag = _hash_table_tag(hash);
+		auto probe = _hash_probe_new(hash, self._slots.count);
+		while (true)
 		{
-			auto slot = self._slots[ix];
-			auto slot_hash = slot.hash;
-			auto slot_index = hash_slot_index(slot);
-			auto slot_flags = hash_slot_flags(slot);
-
-			// if the cell is empty then we didn't find the value
-			if (slot_flags == HASH_FLAGS::HASH_EMPTY)
+			auto group = self._control.ptr + probe.position;
+			for (auto match = _hash_group_match(group, tag); match; match &= match - 1)
 			{
-				ix = cap;
-				break;
-			}
-
-			// if the cell is used and it's the same value then we found it
-			if (slot_flags == HASH_FLAGS::HASH_USED &&
-				slot_hash == res.hash &&
-				self.values[slot_index] == key)
-			{
-				break;
-			}
-
-			// the position is not used or the key is not the same
-			++ix;
-			ix &= (cap - 1);
-
-			// if we went full circle then we just return the cap to signal no index has been found
-			if (ix == index)
-			{
-				ix = cap;
-				break;
+				auto ix = _hash_probe_slot(probe, _hash_group_mask_lowest(match));
+				if (self._slots[ix] == index)
+					return ix;
 			}
+			_hash_probe_next(probe);
 		}
-
-		res.index = ix;
-		return res;
 	}
 
+	// rebuilds the table with the given capacity (power of 2), this also gets rid of all the deleted slots
 	template<typename T, typename THash = Hash<T>>
 	inline static void
-	_set_reserve_exact(Set<T, THash>& self, size_t new_count)
+	_set_reserve_exact(Set<T, THash>& self, size_t new_cap)
 	{
-		auto new_slots = buf_with_allocator<Hash_Slot>(self._slots.allocator);
-		buf_resize_fill(new_slots, new_count, Hash_Slot{});
+		assert(new_cap >= HASH_GROUP_WIDTH && (new_cap & (new_cap - 1)) == 0);
 
-		self._deleted_count = 0;
-		// if 12/16th of table is occupied, grow
-		self._used_count_threshold = new_count - (new_count >> 2);
-		// if deleted count is 3/16th of table, rebuild
-		self._deleted_count_threshold = (new_count >> 3) + (new_count >> 4);
-		// if table is only 4/16th full, shrink
-		self._used_count_shrink_threshold = new_count >> 2;
-
-		// do a rehash
-		if (self.count != 0)
+		auto new_control = buf_with_allocator<int8_t>(self._control.allocator);
+		buf_resize_fill(new_control, new_cap + HASH_GROUP_WIDTH - 1, int8_t(HASH_CONTROL_EMPTY));
+		auto new_slots = buf_with_allocator<size_t>(self._slots.allocator);
+		buf_resize(new_slots, new_cap);
+
+		// do a rehash, we go through the dense values instead of the old slots which is more cache friendly
+		for (size_t i = 0; i < self.values.count; ++i)
 		{
-			for (size_t i = 0; i < self._slots.count; ++i)
-			{
-				auto slot = self._slots[i];
-				auto flags = hash_slot_flags(slot);
-				if (flags == HASH_FLAGS::HASH_USED)
-				{
-					auto index = hash_slot_index(slot);
-					auto res = _set_find_slot_for_insert<T, THash>(new_slots, self.values, self.values[index], &slot.hash);
-					new_slots[res.index] = slot;
-				}
-			}
+			auto hash = _hash_table_mix(THash()(self.values[i]));
+			auto ix = _hash_control_find_non_full(new_control, new_cap, hash);
+			_hash_control_set(new_control, new_cap, ix, _hash_table_tag(hash));
+			new_slots[ix] = i;
 		}
 
+		buf_free(self._control);
 		buf_free(self._slots);
+		self._control = new_control;
 		self._slots = new_slots;
+		self._deleted_count = 0;
+		self._growth_left = _hash_table_growth_capacity(new_cap) - self.count;
 	}
 
 	template<typename T, typename THash = Hash<T>>
 	inline static void
 	_set_maintain_space_complexity(Set<T, THash>& self)
 	{
-		if (self._slots.count == 0)
+		auto cap = self._slots.count;
+		if (cap == 0)
 		{
-			_set_reserve_exact(self, 8);
+			_set_reserve_exact(self, HASH_GROUP_WIDTH);
 		}
-		else if (self.count + 1 > self._used_count_threshold)
+		// if the table is mostly filled with deleted slots we rebuild it in place, otherwise we grow
+		else if (self.count * 32 <= cap * 25)
+		{
+			_set_reserve_exact(self, cap);
+		}
+		else
 		{
-			_set_reserve_exact(self, self._slots.count * 2);
+			_set_reserve_exact(self, cap * 2);
 		}
 	}
 
@@ -609,16 +617,13 @@ namespace mn
 	inline static void
 	set_reserve(Set<T, THash>& self, size_t added_count)
 	{
-		if (added_count == 0)
+		if (added_count == 0 || added_count <= self._growth_left)
 			return;
 
-		auto new_cap = self.count + added_count;
-		new_cap *= 4;
-		new_cap = new_cap / 3 + 1;
-		if (new_cap > self._used_count_threshold)
-		{
-			_set_reserve_exact(self, new_cap);
-		}
+		auto new_cap = self._slots.count > HASH_GROUP_WIDTH ? self._slots.count : HASH_GROUP_WIDTH;
+		while (_hash_table_growth_capacity(new_cap) < self.count + added_count)
+			new_cap *= 2;
+		_set_reserve_exact(self, new_cap);
 	}
 
 	// inserts an element into the hash set and returns an iterator to it
@@ -626,43 +631,34 @@ namespace mn
 	inline static const T*
 	set_insert(Set<T, THash>& self, const T& key)
 	{
-		_set_maintain_space_complexity(self);
+		auto hash = _hash_table_mix(THash()(key));
 
-		auto res = _set_find_slot_for_insert<T, THash>(self._slots, self.values, key, nullptr);
-
-		auto& slot = self._slots[res.index];
-		auto flags = hash_slot_flags(slot);
-		switch(flags)
-		{
-		case HASH_FLAGS::HASH_EMPTY:
+		auto ix = _set_find_slot_for_lookup(self, key, hash);
+		if (ix != self._slots.count)
 		{
-			slot = hash_slot_set_flags(slot, HASH_FLAGS::HASH_USED);
-			slot = hash_slot_set_index(slot, self.count);
-			slot.hash = res.hash;
-			++self.count;
-			return buf_push(self.values, key);
-		}
-		case HASH_FLAGS::HASH_DELETED:
-		{
-			slot = hash_slot_set_flags(slot, HASH_FLAGS::HASH_USED);
-			slot = hash_slot_set_index(slot, self.count);
-			slot.hash = res.hash;
-			++self.count;
-			--self._deleted_count;
-			return buf_push(self.values, key);
-		}
-		case HASH_FLAGS::HASH_USED:
-		{
-			auto index = hash_slot_index(slot);
+			auto index = self._slots[ix];
 			self.values[index] = key;
 			return &self.values[index];
 		}
-		default:
+
+		// we can always reuse a deleted slot, but taking an empty slot requires growth space
+		if (self._slots.count > 0)
+			ix = _hash_control_find_non_full(self._control, self._slots.count, hash);
+		if (self._slots.count == 0 || (self._growth_left == 0 && self._control[ix] == HASH_CONTROL_EMPTY))
 		{
-			assert(false && "unreachable");
-			return nullptr;
-		}
+			_set_maintain_space_complexity(self);
+			ix = _hash_control_find_non_full(self._control, self._slots.count, hash);
 		}
+
+		if (self._control[ix] == HASH_CONTROL_DELETED)
+			--self._deleted_count;
+		else
+			--self._growth_left;
+
+		_hash_control_set(self._control, self._slots.count, ix, _hash_table_tag(hash));
+		self._slots[ix] = self.count;
+		++self.count;
+		return buf_push(self.values, key);
 	}
 
 	// searches for the given key in the hash set and returns an iterator to it, if the key doesn't exist it will return
@@ -671,12 +667,10 @@ namespace mn
 	inline static const T*
 	set_lookup(const Set<T, THash>& self, const T& key)
 	{
-		auto res = _set_find_slot_for_lookup(self, key);
-		if (res.index == self._slots.count)
+		auto ix = _set_find_slot_for_lookup(self, key, _hash_table_mix(THash()(key)));
+		if (ix == self._slots.count)
 			return nullptr;
-		auto& slot = self._slots[res.index];
-		auto index = hash_slot_index(slot);
-		return (const T*)(self.values.ptr + index);
+		return (const T*)(self.values.ptr + self._slots[ix]);
 	}
 
 	// remove the given value from the hash set, and returns whether it found and removed the element
@@ -684,39 +678,42 @@ namespace mn
 	inline static bool
 	set_remove(Set<T, THash>& self, const T& key)
 	{
-		auto res = _set_find_slot_for_lookup(self, key);
-		if (res.index == self._slots.count)
+		auto cap = self._slots.count;
+		auto ix = _set_find_slot_for_lookup(self, key, _hash_table_mix(THash()(key)));
+		if (ix == cap)
 			return false;
-		auto& slot = self._slots[res.index];
-		auto index = hash_slot_index(slot);
-		slot = hash_slot_set_flags(slot, HASH_FLAGS::HASH_DELETED);
-
-		if (index == self.count - 1)
+		auto index = self._slots[ix];
+
+		// if there's an empty slot in every group window which contains this slot then no probe sequence could have
+		// passed over it, in which case we can mark it empty instead of deleted
+		auto empty_before = _hash_group_match(self._control.ptr + ((ix - HASH_GROUP_WIDTH) & (cap - 1)), HASH_CONTROL_EMPTY);
+		auto empty_after = _hash_group_match(self._control.ptr + ix, HASH_CONTROL_EMPTY);
+		bool was_never_full =
+			empty_before && empty_after &&
+			_hash_group_mask_lowest(empty_after) + _hash_group_mask_leading_zeros(empty_before) < HASH_GROUP_WIDTH;
+		if (was_never_full)
 		{
-			buf_remove(self.values, index);
+			_hash_control_set(self._control, cap, ix, HASH_CONTROL_EMPTY);
+			++self._growth_left;
 		}
 		else
 		{
-			// fixup the index of the last element after swap
-			auto last_res = _set_find_slot_for_lookup(self, self.values[self.count - 1]);
-			self._slots[last_res.index] = hash_slot_set_index(self._slots[last_res.index], index);
-			buf_remove(self.values, index);
+			_hash_control_set(self._control, cap, ix, HASH_CONTROL_DELETED);
+			++self._deleted_count;
 		}
 
+		// fixup the index of the last element after swap
+		if (index != self.count - 1)
+			self._slots[_set_find_slot_for_index(self, self.count - 1)] = index;
+		buf_remove(self.values, index);
 		--self.count;
-		++self._deleted_count;
 
 		// rehash because of size is too low
-		if (self.count < self._used_count_shrink_threshold && self._slots.count > 8)
+		if (self.count < (cap >> 2) && cap > HASH_GROUP_WIDTH)
 		{
-			_set_reserve_exact(self, self._slots.count >> 1);
+			_set_reserve_exact(self, cap >> 1);
 			buf_shrink_to_fit(self.values);
 		}
-		// rehash because of too many deleted values
-		else if (self._deleted_count > self._deleted_count_threshold)
-		{
-			_set_reserve_exact(self, self._slots.count);
-		}
 		return true;
 	}
 
@@ -726,6 +723,7 @@ namespace mn
 	set_clone(const Set<T, THash>& other, Allocator allocator = allocator_top())
 	{
 		Set<T, THash> self = other;
+		self._control = buf_memcpy_clone(other._control, allocator);
 		self._slots = buf_memcpy_clone(other._slots, allocator);
 		self.values = buf_clone(other.values, allocator);
 		return self;
@@ -738,6 +736,7 @@ namespace mn
 	set_memcpy_clone(const Set<T, THash>& other, Allocator allocator = allocator_top())
 	{
 		Set<T, THash> self = other;
+		self._control = buf_memcpy_clone(other._control, allocator);
 		self._slots = buf_memcpy_clone(other._slots, allocator);
 		self.values = buf_memcpy_clone(other.values, allocator);
 		return self;
@@ -3,6 +3,7 @@
 #include "mn/Exports.h"
 #include "mn/Base.h"
 #include "mn/memory/Interface.h"
+#include "mn/memory/Aligned.h"
 #include "mn/memory/Stack.h"
 #include "mn/memory/Arena.h"
 #include "mn/memory/Buddy.h"
@@ -159,6 +160,17 @@ namespace mn
 		return alloc_construct<memory::Arena>(block_size, meta);
 	}
 
+	// creates a new arena allocator which is backed by a reserved virtual memory region of the given size, the region
+	// is committed lazily, if the reservation fails it works like a normal arena
+	// read more about arena allocator in Arena.h
+	inline static memory::Arena*
+	allocator_arena_virtual_new(size_t reserve_size = 1ULL * 1024ULL * 1024ULL * 1024ULL, size_t block_size = 4096, Allocator meta = memory::clib())
+	{
+		auto self = alloc_construct<memory::Arena>(block_size, meta);
+		self->reserve_virtual(reserve_size);
+		return self;
+	}
+
 	// creates a new buddy allocator with the given heap size and meta allocator
 	// read more about buddy allocator in Buddy.h
 	inline static memory::Buddy*
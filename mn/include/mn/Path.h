@@ -3,6 +3,7 @@
 #include "mn/Exports.h"
 #include "mn/Base.h"
 #include "mn/Str.h"
+#include "mn/Task.h"
 
 namespace mn
 {
@@ -168,6 +169,113 @@ namespace mn
 		return path_entries(path.ptr, allocator);
 	}
 
+	// the kind of an entry reported by the path walker
+	enum PATH_WALK_KIND
+	{
+		PATH_WALK_KIND_FILE,
+		PATH_WALK_KIND_FOLDER,
+		// symlinks are reported as is, they are never followed
+		PATH_WALK_KIND_SYMLINK,
+		// devices, pipes, sockets, etc..
+		PATH_WALK_KIND_OTHER,
+	};
+
+	// the order in which the path walker visits the tree
+	enum PATH_WALK_ORDER
+	{
+		// a folder's content is visited right after the folder itself
+		PATH_WALK_ORDER_DEPTH_FIRST,
+		// a folder's content is visited after all the entries with lower depth
+		PATH_WALK_ORDER_BREADTH_FIRST,
+	};
+
+	// path walker settings
+	struct Path_Walk_Settings
+	{
+		// default: depth first
+		PATH_WALK_ORDER order;
+		// fills the size and last write time of each entry, otherwise the walker only uses the kind which the os
+		// reports with the folder content and doesn't stat any entry (unless the filesystem doesn't report it)
+		bool stat;
+		// max depth of the reported entries, the direct children of the root have depth 1, default: 0 (no limit)
+		size_t max_depth;
+	};
+
+	// an entry reported by the path walker, the strings point into the walker's memory and are only valid until the
+	// next call to path_walker_next
+	struct Path_Walk_Entry
+	{
+		PATH_WALK_KIND kind;
+		// the name of the entry
+		const char* name;
+		// the path of the entry which is the root path joined with the names of its parents and the entry name
+		const char* path;
+		size_t depth;
+		// whether size and last_write_time are filled
+		bool has_stat;
+		int64_t size;
+		// the same time which file_last_write_time returns
+		int64_t last_write_time;
+	};
+
+	// a path walker is a streaming iterator over a folder tree, unlike path_entries it doesn't allocate memory for
+	// each entry, it reads the folder content in big batches into buffers which it reuses
+	typedef struct IPath_Walker* Path_Walker;
+
+	// creates a new path walker which walks the tree under the given root folder, it returns nullptr if it fails
+	MN_EXPORT Path_Walker
+	path_walker_new(const char* root, Path_Walk_Settings settings = {});
+
+	// creates a new path walker which walks the tree under the given root folder, it returns nullptr if it fails
+	inline static Path_Walker
+	path_walker_new(const Str& root, Path_Walk_Settings settings = {})
+	{
+		return path_walker_new(root.ptr, settings);
+	}
+
+	// frees the given path walker
+	MN_EXPORT void
+	path_walker_free(Path_Walker self);
+
+	// destruct overload for path walker free
+	inline static void
+	destruct(Path_Walker self)
+	{
+		path_walker_free(self);
+	}
+
+	// gets the next entry of the tree, it returns false when the walk is over
+	MN_EXPORT bool
+	path_walker_next(Path_Walker self, Path_Walk_Entry& entry);
+
+	// skips the content of the last reported folder
+	MN_EXPORT void
+	path_walker_skip(Path_Walker self);
+
+	// the callback which is called for each entry in a parallel walk, for folders it returns whether the walk should
+	// go into the folder's content
+	using Path_Walk_Callback = Task<bool(const Path_Walk_Entry&)>;
+
+	typedef struct IFabric* Fabric;
+
+	// walks the tree under the given root folder by walking each folder on one of the fabric's workers, it blocks
+	// until the whole tree is walked, the callback is called concurrently from multiple workers, settings.order is
+	// ignored, the only guarantee is that a folder is reported before its content, returns false if the root folder
+	// can't be opened
+	MN_EXPORT bool
+	path_walk_parallel(const char* root, Fabric fabric, Path_Walk_Callback callback, Path_Walk_Settings settings = {});
+
+	// walks the tree under the given root folder by walking each folder on one of the fabric's workers, it blocks
+	// until the whole tree is walked, the callback is called concurrently from multiple workers, settings.order is
+	// ignored, the only guarantee is that a folder is reported before its content, returns false if the root folder
+	// can't be opened
+	template<typename TFunc>
+	inline static bool
+	path_walk_parallel(const Str& root, Fabric fabric, TFunc&& callback, Path_Walk_Settings settings = {})
+	{
+		return path_walk_parallel(root.ptr, fabric, Path_Walk_Callback::make(std::forward<TFunc>(callback)), settings);
+	}
+
 	// returns the absolute path of the executable
 	MN_EXPORT Str
 	path_executable(Allocator allocator = allocator_top());
@@ -334,6 +442,47 @@ namespace mn
 		return folder_copy(src.ptr, dst.ptr);
 	}
 
+	// the progress of a parallel folder copy
+	struct Folder_Copy_Progress
+	{
+		size_t files_count;
+		size_t files_copied;
+		int64_t bytes_count;
+		int64_t bytes_copied;
+	};
+
+	// the callback which receives the progress of a parallel folder copy, it's called after each copied file on one
+	// of the fabric's workers, calls are serialized so it doesn't need its own lock
+	using Folder_Copy_Progress_Callback = Task<void(const Folder_Copy_Progress&)>;
+
+	// copies a folder and the contained files/folders from src to dst by walking the tree first then copying the
+	// files concurrently on the given fabric, it blocks until all the files are copied and returns whether it
+	// succeeded, the given progress callback (if any) is called after each copied file, links are followed and copied
+	// as the files/folders they point to
+	MN_EXPORT bool
+	folder_copy(const char* src, const char* dst, Fabric fabric, Folder_Copy_Progress_Callback progress = {});
+
+	// copies a folder and the contained files/folders from src to dst by walking the tree first then copying the
+	// files concurrently on the given fabric, it blocks until all the files are copied and returns whether it
+	// succeeded, the given progress callback (if any) is called after each copied file, links are followed and copied
+	// as the files/folders they point to
+	inline static bool
+	folder_copy(const Str& src, const Str& dst, Fabric fabric, Folder_Copy_Progress_Callback progress = {})
+	{
+		return folder_copy(src.ptr, dst.ptr, fabric, std::move(progress));
+	}
+
+	// copies a folder and the contained files/folders from src to dst by walking the tree first then copying the
+	// files concurrently on the given fabric, it blocks until all the files are copied and returns whether it
+	// succeeded, the given progress function is called after each copied file, links are followed and copied as the
+	// files/folders they point to
+	template<typename TFunc>
+	inline static bool
+	folder_copy(const Str& src, const Str& dst, Fabric fabric, TFunc&& progress)
+	{
+		return folder_copy(src.ptr, dst.ptr, fabric, Folder_Copy_Progress_Callback::make(std::forward<TFunc>(progress)));
+	}
+
 	// moves a folder and the contained files/folders from src to dst, and returns whether it succeeded
 	inline static bool
 	folder_move(const char* src, const char* dst)
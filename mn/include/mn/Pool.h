@@ -15,6 +15,12 @@ namespace mn
 	MN_EXPORT Pool
 	pool_new(size_t element_size, size_t bucket_size, Allocator meta_allocator = allocator_top());
 
+	// creates a new thread safe memory pool for the given element size, each thread caches free elements in magazines
+	// (fixed size stacks of free elements) and exchanges whole magazines with a lock free depot, which means elements can
+	// be put back from any thread without bouncing cache lines on each operation, use pool_get/pool_put to work with it
+	MN_EXPORT Pool
+	pool_concurrent_new(size_t element_size, size_t bucket_size, Allocator meta_allocator = allocator_top());
+
 	// frees the given memory pool
 	MN_EXPORT void
 	pool_free(Pool pool);
@@ -33,4 +39,12 @@ namespace mn
 	// puts back the given memory into the pool to be reused later
 	MN_EXPORT void
 	pool_put(Pool pool, void* ptr);
+
+	// gets the given count of elements from the pool and writes them into the given ptrs array
+	MN_EXPORT void
+	pool_get_n(Pool pool, void** ptrs, size_t count);
+
+	// puts back the given count of elements into the pool
+	MN_EXPORT void
+	pool_put_n(Pool pool, void** ptrs, size_t count);
 }
\ No newline at end of file
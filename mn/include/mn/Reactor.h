@@ -0,0 +1,66 @@
+#pragma once
+
+#include "mn/Exports.h"
+#include "mn/Base.h"
+
+#include <stdint.h>
+
+namespace mn
+{
+	// io readiness events which the reactor can watch for
+	enum REACTOR_EVENT
+	{
+		REACTOR_EVENT_NONE = 0,
+		// the handle has data to read or a connection to accept
+		REACTOR_EVENT_READ = 1 << 0,
+		// the handle can be written to without blocking
+		REACTOR_EVENT_WRITE = 1 << 1,
+		// the handle was closed by the other side or has an error, it's reported even if it wasn't requested
+		REACTOR_EVENT_ERROR = 1 << 2,
+	};
+
+	// a ready handle returned from reactor_wait
+	struct Reactor_Event
+	{
+		int64_t handle;
+		int events;
+	};
+
+	// a reactor is an os io readiness notification mechanism (epoll on linux, kqueue on mac, WSAPoll on windows) which
+	// can watch a lot of non-blocking handles (sockets, pipes) with a single thread
+	typedef struct IReactor* Reactor;
+
+	// creates a new reactor, it returns nullptr if it fails
+	MN_EXPORT Reactor
+	reactor_new();
+
+	// frees the given reactor, it doesn't close any of the watched handles
+	MN_EXPORT void
+	reactor_free(Reactor self);
+
+	// destruct overload for reactor free
+	inline static void
+	destruct(Reactor self)
+	{
+		reactor_free(self);
+	}
+
+	// watches the given handle for the given events (REACTOR_EVENT flags), the watch is one shot, once the handle is
+	// reported by reactor_wait it's not reported again until it's armed again, handles might be reported spuriously
+	// so reading/writing them should handle the would block case, returns whether it succeeded
+	MN_EXPORT bool
+	reactor_arm(Reactor self, int64_t handle, int events);
+
+	// stops watching the given handle, it should be called before the handle is closed
+	MN_EXPORT void
+	reactor_remove(Reactor self, int64_t handle);
+
+	// waits until one of the watched handles is ready or the given timeout passes or the reactor is woken up, it
+	// fills the given events array with the ready handles and returns their count
+	MN_EXPORT size_t
+	reactor_wait(Reactor self, Reactor_Event* events, size_t events_count, Timeout timeout);
+
+	// wakes up a thread which is blocked in reactor_wait, it can be called from any thread
+	MN_EXPORT void
+	reactor_wake(Reactor self);
+}
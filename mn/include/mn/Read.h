@@ -331,20 +331,11 @@ namespace mn
 		{
 			auto bytes = reader_peek(reader, request_size);
 
-			bool found_newline = false;
-			for(size_t i = 0; i < bytes.size; ++i)
+			if (auto newline = bytes.size ? (const char*)::memchr(bytes.ptr, '\n', bytes.size) : nullptr)
 			{
-				char byte = ((char*)bytes.ptr)[i];
-				if(byte == '\n')
-				{
-					found_newline = true;
-					newline_offset = i;
-					break;
-				}
-			}
-
-			if(found_newline)
+				newline_offset = newline - (const char*)bytes.ptr;
 				break;
+			}
 			else if(last_size == bytes.size)
 				break;
 
@@ -375,6 +366,38 @@ namespace mn
 		}
 	}
 
+	// reads a line from the reader without copying it, the line excludes the line ending and points into the
+	// reader's memory so it's only valid until the next read from the reader, with a mapped reader it points directly
+	// into the mapped file, it returns the count of the consumed bytes which is 0 at the end of the reader
+	inline static size_t
+	readln_view(Reader reader, Block& line)
+	{
+		size_t request_size = 0;
+		size_t last_size = size_t(-1);
+		while(true)
+		{
+			auto bytes = reader_peek(reader, request_size);
+			if (auto newline = bytes.size ? (const char*)::memchr(bytes.ptr, '\n', bytes.size) : nullptr)
+			{
+				line = Block{bytes.ptr, size_t(newline - (const char*)bytes.ptr)};
+				size_t consumed = line.size + 1;
+				//because of the \r\n on window
+				if (line.size > 0 && ((char*)line.ptr)[line.size - 1] == '\r')
+					--line.size;
+				return reader_skip(reader, consumed);
+			}
+
+			if (last_size == bytes.size)
+			{
+				line = bytes;
+				return reader_skip(reader, bytes.size);
+			}
+
+			request_size = bytes.size + 1024;
+			last_size = bytes.size;
+		}
+	}
+
 	inline static size_t
 	readln(Str& value)
 	{
@@ -4,6 +4,7 @@
 #include "mn/Base.h"
 #include "mn/Str.h"
 #include "mn/Stream.h"
+#include "mn/File.h"
 
 namespace mn
 {
@@ -20,10 +21,48 @@ namespace mn
 	MN_EXPORT Reader
 	reader_new(Stream stream, Allocator allocator = allocator_top());
 
+	// ring buffered reader settings
+	struct Reader_Ring_Settings
+	{
+		// the capacity of the ring buffer which bounds the reader's memory and the max size of a peek, it's rounded up
+		// to the os page size when the buffer is mirrored, default: 64KB
+		size_t capacity;
+		// any peek which needs more data refills the buffer, and so does any peek while the buffered data is below this
+		// size, a refill reads as much as the free space allows, default: 0
+		size_t refill_watermark;
+		// disables the mirrored (double mapped) buffer, without it the reader moves the unconsumed data to the start of
+		// the buffer when it reaches the end, the reader also falls back to this if the os can't mirror the buffer
+		bool disable_mirroring;
+	};
+
+	// returns a newly created reader on top of the given stream which buffers the data in a fixed capacity ring buffer,
+	// unlike reader_new its memory doesn't grow if it's peeked ahead of what's consumed, and the mirrored ring buffer
+	// gives contiguous peeks without moving the data around
+	MN_EXPORT Reader
+	reader_ring_new(Stream stream, Reader_Ring_Settings settings = {}, Allocator allocator = allocator_top());
+
 	// returns a newly created reader on top of the given string (copies the string internally)
 	MN_EXPORT Reader
 	reader_str(const Str& str);
 
+	// returns a newly created reader which reads directly from the given mapped file without copying it into an
+	// internal buffer, the mapped file should outlive the reader
+	MN_EXPORT Reader
+	reader_mapped(Mapped_File* file, Allocator allocator = allocator_top());
+
+	// maps the given file and returns a reader on top of it which owns the mapping, the mapping is hinted for
+	// sequential access, returns nullptr if the file can't be mapped
+	MN_EXPORT Reader
+	reader_mapped(const char* filename, Allocator allocator = allocator_top());
+
+	// maps the given file and returns a reader on top of it which owns the mapping, the mapping is hinted for
+	// sequential access, returns nullptr if the file can't be mapped
+	inline static Reader
+	reader_mapped(const Str& filename, Allocator allocator = allocator_top())
+	{
+		return reader_mapped(filename.ptr, allocator);
+	}
+
 	// returns the given reader after configuring it to wrapt the string
 	MN_EXPORT Reader
 	reader_wrap_str(Reader reader, const Str& str);
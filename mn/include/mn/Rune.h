@@ -15,6 +15,30 @@ namespace mn
 	MN_EXPORT size_t
 	rune_count(const char* str);
 
+	// returns the count of runes in the given count of bytes, it counts the bytes which aren't utf-8 continuation bytes
+	// so it doesn't validate the encoding
+	MN_EXPORT size_t
+	rune_count(const char* str, size_t count);
+
+	// returns whether all the given bytes are ascii
+	MN_EXPORT bool
+	rune_all_ascii(const char* str, size_t count);
+
+	// returns whether the given bytes are valid utf-8, it rejects overlong encodings, surrogates, runes above
+	// U+10FFFF and truncated sequences
+	MN_EXPORT bool
+	rune_utf8_valid(const char* str, size_t count);
+
+	// converts the ascii prefix of src to lower case and writes it into dst, it stops at the first non ascii byte and
+	// returns the count of converted bytes, dst should have room for count bytes
+	MN_EXPORT size_t
+	rune_ascii_lower(char* dst, const char* src, size_t count);
+
+	// converts the ascii prefix of src to upper case and writes it into dst, it stops at the first non ascii byte and
+	// returns the count of converted bytes, dst should have room for count bytes
+	MN_EXPORT size_t
+	rune_ascii_upper(char* dst, const char* src, size_t count);
+
 	// converts a rune to lower case
 	MN_EXPORT Rune
 	rune_lower(Rune c);
@@ -19,6 +19,7 @@ typedef struct mn_simd_support
 	bool sse4a_supportted;
 	bool sse5_supportted;
 	bool avx_supportted;
+	bool avx2_supportted;
 } mn_simd_support;
 
 // returns the support status of various SIMD extensions
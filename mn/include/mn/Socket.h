@@ -3,6 +3,7 @@
 #include "mn/Stream.h"
 #include "mn/Str.h"
 #include "mn/Result.h"
+#include "mn/File.h"
 
 namespace mn
 {
@@ -62,6 +63,39 @@ namespace mn
 		}
 	}
 
+	// a socket address (ip and port), it's used to address datagrams and it can hold ipv4 and ipv6 addresses
+	struct Socket_Address
+	{
+		// os sockaddr storage
+		alignas(8) uint8_t storage[128];
+		uint32_t size;
+	};
+
+	// resolves the given address and port into a socket address, and returns whether it succeeded
+	MN_EXPORT bool
+	socket_address_from(SOCKET_FAMILY family, const Str& address, const Str& port, Socket_Address& res);
+
+	// resolves the given address and port into a socket address, and returns whether it succeeded
+	inline static bool
+	socket_address_from(SOCKET_FAMILY family, const char* address, const char* port, Socket_Address& res)
+	{
+		return socket_address_from(family, str_lit(address), str_lit(port), res);
+	}
+
+	// returns the numeric string representation of the given socket address, "127.0.0.1:4000" or "[::1]:4000"
+	MN_EXPORT Str
+	socket_address_str(const Socket_Address& self, Allocator allocator = allocator_top());
+
+	// a single datagram which is used with the batched datagram functions
+	struct Socket_Datagram
+	{
+		// the datagram bytes, when receiving it's the buffer which receives the datagram and its size is updated to
+		// the count of received bytes, datagrams larger than the buffer are truncated
+		Block data;
+		// the destination address when sending, or the source address when receiving
+		Socket_Address address;
+	};
+
 	// a socket handle
 	typedef struct ISocket* Socket;
 
@@ -70,6 +104,10 @@ namespace mn
 		int64_t handle;
 		SOCKET_FAMILY family;
 		SOCKET_TYPE type;
+		// zerocopy writes state, see socket_zerocopy_enable
+		bool zerocopy;
+		uint32_t zerocopy_sent;
+		uint32_t zerocopy_completed;
 
 		MN_EXPORT virtual void
 		dispose() override;
@@ -142,7 +180,8 @@ namespace mn
 	socket_disconnect(Socket self);
 
 	// tries to read from the given socket within the given timeout window and returns the number
-	// of read bytes or an error
+	// of read bytes or an error, with NO_TIMEOUT it doesn't block and returns MN_SOCKET_ERROR_TIMEOUT if there's
+	// nothing to read which is useful with fabric_io_do
 	MN_EXPORT Result<size_t, MN_SOCKET_ERROR>
 	socket_read(Socket self, Block data, Timeout timeout);
 
@@ -150,6 +189,68 @@ namespace mn
 	MN_EXPORT size_t
 	socket_write(Socket self, Block data);
 
+	// writes the given blocks into the given socket with a single call (gather write) and returns the number of
+	// written bytes, use it to write a header and a payload without concatenating them
+	MN_EXPORT size_t
+	socket_writev(Socket self, const Block* blocks, size_t count);
+
+	// sends the given range of the given file into the given socket without copying it through userspace (sendfile
+	// on linux/mac, TransmitFile on windows) and returns the number of sent bytes
+	MN_EXPORT size_t
+	socket_sendfile(Socket self, File file, int64_t offset, size_t size);
+
+	// enables zerocopy writes (MSG_ZEROCOPY) on the given socket and returns whether the os supports them, if it doesn't
+	// socket_write_zerocopy falls back to socket_write, zerocopy only pays off for large writes (> 10KB)
+	MN_EXPORT bool
+	socket_zerocopy_enable(Socket self);
+
+	// writes the given block into the given socket without copying it into the kernel and returns the number of
+	// written bytes, the given block must stay alive and unchanged until socket_zerocopy_reap reports that the write
+	// has completed
+	MN_EXPORT size_t
+	socket_write_zerocopy(Socket self, Block data);
+
+	// collects the completion notifications of the zerocopy writes, it waits within the given timeout window for the
+	// pending writes and returns the count of zerocopy writes which are still pending, the writes complete in order so
+	// once it returns n only the buffers of the last n zerocopy writes are still used by the os
+	MN_EXPORT size_t
+	socket_zerocopy_reap(Socket self, Timeout timeout);
+
+	// tries to receive a single datagram from the given socket within the given timeout window, it fills the given
+	// address with the sender's address and returns the number of received bytes or an error
+	MN_EXPORT Result<size_t, MN_SOCKET_ERROR>
+	socket_recv_from(Socket self, Block data, Socket_Address& address, Timeout timeout);
+
+	// sends the given block as a single datagram to the given address and returns the number of sent bytes
+	MN_EXPORT size_t
+	socket_send_to(Socket self, Block data, const Socket_Address& address);
+
+	// waits within the given timeout window for datagrams then receives as many of the ready ones as it can into the
+	// given datagrams with a single call (recvmmsg on linux), it returns the count of received datagrams or an error
+	MN_EXPORT Result<size_t, MN_SOCKET_ERROR>
+	socket_recv_many(Socket self, Socket_Datagram* datagrams, size_t count, Timeout timeout);
+
+	// sends the given datagrams with a single call (sendmmsg on linux) and returns the count of sent datagrams
+	MN_EXPORT size_t
+	socket_send_many(Socket self, const Socket_Datagram* datagrams, size_t count);
+
+	// sends the given block as a train of datagrams of the given segment size (the last one might be smaller) to the
+	// given address, on linux the kernel splits the block (UDP GSO) so the whole train costs a single call, returns
+	// the number of sent bytes
+	MN_EXPORT size_t
+	socket_send_segmented(Socket self, Block data, size_t segment_size, const Socket_Address& address);
+
+	// enables receive coalescing (UDP GRO) on the given socket and returns whether the os supports it, after enabling
+	// it datagrams from the same sender should be received with socket_recv_segmented
+	MN_EXPORT bool
+	socket_gro_enable(Socket self);
+
+	// tries to receive a train of datagrams which the os coalesced into the given block, it fills the given address
+	// with the sender's address and the given segment size with the size of each datagram in the train (the last one
+	// might be smaller), it returns the number of received bytes or an error
+	MN_EXPORT Result<size_t, MN_SOCKET_ERROR>
+	socket_recv_segmented(Socket self, Block data, Socket_Address& address, size_t& segment_size, Timeout timeout);
+
 	// returns the file desriptor behind the given socket
 	MN_EXPORT int64_t
 	socket_fd(Socket self);
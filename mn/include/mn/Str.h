@@ -60,10 +60,17 @@ namespace mn
 	str_rune_count(const Str& self)
 	{
 		if(self.count)
-			return rune_count(self.ptr);
+			return rune_count(self.ptr, self.count);
 		return 0;
 	}
 
+	// returns whether the given string is valid utf-8
+	inline static bool
+	str_utf8_valid(const Str& self)
+	{
+		return rune_utf8_valid(self.ptr, self.count);
+	}
+
 	// pushes the second string into the first one
 	MN_EXPORT void
 	str_push(Str& self, const char* str);
@@ -4,6 +4,7 @@
 
 #include <utility>
 #include <functional>
+#include <type_traits>
 
 namespace mn
 {
@@ -15,83 +16,47 @@ namespace mn
 	template<typename R, typename ... Args>
 	struct Task<R(Args...)>
 	{
-		struct Concept
-		{
-			virtual ~Concept() = default;
-			virtual R invoke(Args... args) = 0;
-		};
-
-		template<typename F, bool Small>
-		struct Model;
+		// tasks dispatch through plain function pointers, which keeps them pod and avoids the vtable indirection
+		using Invoke_Fn = R(*)(void*, Args...);
+		using Free_Fn = void(*)(void*);
 
+		// callables passed as lvalues are stored by reference, the rest are moved into the task
 		template<typename F>
-		struct Model<F, true> final: Concept
-		{
-			F fn;
-
-			template<typename G>
-			Model(G&& f)
-				:fn(std::forward<G>(f))
-			{}
-
-			template<typename G>
-			Model(Allocator, G&& f)
-				:fn(std::forward<G>(f))
-			{}
-
-			R invoke(Args... args) override
-			{
-				return std::invoke(fn, std::forward<Args>(args)...);
-			}
-		};
+		using Callable = std::conditional_t<
+			std::is_lvalue_reference_v<F>,
+			std::reference_wrapper<std::remove_reference_t<F>>,
+			std::remove_cv_t<std::remove_reference_t<F>>
+		>;
 
+		// big closures are stored in memory allocated from the given allocator
 		template<typename F>
-		struct Model<F, false> final : Concept
+		struct Spilled
 		{
 			Allocator allocator;
 			F* fn;
-
-			template<typename G>
-			Model(G&& f)
-			{
-				allocator = allocator_top();
-				fn = alloc_construct_from<F>(allocator, std::forward<G>(f));
-			}
-
-			template<typename G>
-			Model(Allocator a, G&& f)
-			{
-				allocator = a;
-				fn = alloc_construct_from<F>(allocator, std::forward<F>(f));
-			}
-
-			~Model() override
-			{
-				free_destruct_from(allocator, fn);
-			}
-
-			R invoke(Args... args) override
-			{
-				return std::invoke(*fn, std::forward<Args>(args)...);
-			}
 		};
 
-		static constexpr size_t SMALL_SIZE = sizeof(void*) * 7;
-		alignas(Concept) unsigned char concept[SMALL_SIZE];
-		bool isSet;
-
-		Concept& _self()
-		{
-			return *static_cast<Concept*>(static_cast<void*>(concept));
-		}
+		static constexpr size_t SMALL_SIZE = sizeof(void*) * 6;
+		alignas(void*) unsigned char storage[SMALL_SIZE];
+		Invoke_Fn invoke_fn;
+		Free_Fn free_fn;
 
 		R operator()(Args... args)
 		{
-			return _self().invoke(std::forward<Args>(args)...);
+			return invoke_fn(storage, std::forward<Args>(args)...);
 		}
 
 		// bool casting operator to check if the task is holding a closure
-		operator bool() const { return isSet; }
+		operator bool() const { return invoke_fn != nullptr; }
+
+		// returns whether the given callable type is stored inside the task without any allocations
+		template<typename F>
+		static constexpr bool
+		is_small()
+		{
+			using Fn = Callable<F>;
+			return sizeof(Fn) <= SMALL_SIZE && alignof(Fn) <= alignof(void*);
+		}
 
 		// creates a new empty task
 		inline static Task<R(Args...)>
@@ -106,22 +71,45 @@ namespace mn
 		inline static Task<R(Args...)>
 		make(F&& f)
 		{
-			constexpr bool is_small = sizeof(Model<F, true>) <= SMALL_SIZE;
-			Task<R(Args...)> self{};
-			::new (&self.concept) Model<F, is_small>(std::forward<F>(f));
-			self.isSet = true;
-			return self;
+			if constexpr (is_small<F>())
+				return make_with_allocator(nullptr, std::forward<F>(f));
+			else
+				return make_with_allocator(allocator_top(), std::forward<F>(f));
 		}
 
-		// creates a new task from the given callable using the given allocator
+		// creates a new task from the given callable using the given allocator, the allocator is only used if
+		// the callable doesn't fit in the task's small storage
 		template<typename F>
 		inline static Task<R(Args...)>
 		make_with_allocator(Allocator allocator, F&& f)
 		{
-			constexpr bool is_small = sizeof(Model<F, true>) <= SMALL_SIZE;
+			using Fn = Callable<F>;
+
 			Task<R(Args...)> self{};
-			::new (&self.concept) Model<F, is_small>(allocator, std::forward<F>(f));
-			self.isSet = true;
+			if constexpr (is_small<F>())
+			{
+				::new (self.storage) Fn(std::forward<F>(f));
+				self.invoke_fn = [](void* storage, Args... args) -> R {
+					return std::invoke(*static_cast<Fn*>(storage), std::forward<Args>(args)...);
+				};
+				if constexpr (std::is_trivially_destructible_v<Fn> == false)
+				{
+					self.free_fn = [](void* storage) {
+						static_cast<Fn*>(storage)->~Fn();
+					};
+				}
+			}
+			else
+			{
+				::new (self.storage) Spilled<Fn>{allocator, alloc_construct_from<Fn>(allocator, std::forward<F>(f))};
+				self.invoke_fn = [](void* storage, Args... args) -> R {
+					return std::invoke(*static_cast<Spilled<Fn>*>(storage)->fn, std::forward<Args>(args)...);
+				};
+				self.free_fn = [](void* storage) {
+					auto spilled = static_cast<Spilled<Fn>*>(storage);
+					free_destruct_from(spilled->allocator, spilled->fn);
+				};
+			}
 			return self;
 		}
 	};
@@ -131,10 +119,12 @@ namespace mn
 	inline static void
 	task_free(Task<R(Args...)>& self)
 	{
-		if (self.isSet)
+		if (self.invoke_fn)
 		{
-			self._self().~Concept();
-			self.isSet = false;
+			if (self.free_fn)
+				self.free_fn(self.storage);
+			self.invoke_fn = nullptr;
+			self.free_fn = nullptr;
 		}
 	}
 
@@ -5,6 +5,7 @@
 #include "mn/OS.h"
 
 #include <stdint.h>
+#include <atomic>
 
 #define mn_mutex_new_with_srcloc(name) mn::mutex_new_with_srcloc([&](const char* func_name) -> const mn::Source_Location* { const static mn::Source_Location srcloc { name, func_name, __FILE__, __LINE__, 0 }; return &srcloc; }(__FUNCTION__))
 #define mn_mutex_rw_new_with_srcloc(name) mn::mutex_rw_new_with_srcloc([&](const char* func_name) -> const mn::Source_Location* { const static mn::Source_Location srcloc { name, func_name, __FILE__, __LINE__, 0 }; return &srcloc; }(__FUNCTION__))
@@ -210,6 +211,20 @@ namespace mn
 	MN_EXPORT void
 	cond_var_notify_all(Cond_Var self);
 
+	// blocks the calling thread while the given value is equal to the expected value, it might wake up
+	// spuriously so it should be called in a loop which checks the value, it uses the os futex on linux,
+	// WaitOnAddress on windows, and ulock on macos
+	MN_EXPORT void
+	futex_wait(std::atomic<int32_t>& value, int32_t expected);
+
+	// wakes one of the threads waiting on the given value
+	MN_EXPORT void
+	futex_wake_one(std::atomic<int32_t>& value);
+
+	// wakes all the threads waiting on the given value
+	MN_EXPORT void
+	futex_wake_all(std::atomic<int32_t>& value);
+
 	// a waitgroup is a sync primitive which is a counter you can wait on until it reaches zero
 	typedef struct IWaitgroup* Waitgroup;
 
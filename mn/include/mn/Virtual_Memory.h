@@ -9,7 +9,31 @@ namespace mn
 	MN_EXPORT Block
 	virtual_alloc(void* address_hint, size_t size);
 
-	// frees a block from OS virtual memory
+	// frees a block from OS virtual memory, it also releases reserved blocks
 	MN_EXPORT void
 	virtual_free(Block block);
+
+	// reserves a block of address space using OS virtual memory without committing it, accessing the memory
+	// is not allowed until it's committed, it returns an empty block if it fails
+	MN_EXPORT Block
+	virtual_reserve(void* address_hint, size_t size);
+
+	// commits the given block of a reserved memory, the block should be page aligned, returns whether it succeeded
+	MN_EXPORT bool
+	virtual_commit(Block block);
+
+	// decommits the given block of a reserved memory returning its pages to the OS while keeping the address space
+	// reserved, the block should be page aligned
+	MN_EXPORT void
+	virtual_decommit(Block block);
+
+	// allocates a mirrored block of memory, the memory right after the returned block maps the same pages as the
+	// block itself, so a ring buffer can access any wrapped range of up to block.size bytes contiguously, the size is
+	// rounded up to the os page size (allocation granularity on windows), it returns an empty block if it fails
+	MN_EXPORT Block
+	virtual_alloc_mirrored(size_t size);
+
+	// frees a mirrored block which was allocated using virtual_alloc_mirrored
+	MN_EXPORT void
+	virtual_free_mirrored(Block block);
 }
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "mn/Exports.h"
+#include "mn/memory/Interface.h"
+#include "mn/Base.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace mn::memory
+{
+	// aligned is an allocator adapter which guarantees a minimum alignment (up to 4096) for all the blocks allocated
+	// from its parent allocator regardless of the alignment requested, which is useful for containers like buf and str
+	// which only request the alignment of their element type, for example:
+	// mn::memory::Aligned aligned{mn::memory::tmp(), 64};
+	// auto floats = mn::buf_with_allocator<float>(&aligned);
+	// blocks are over-allocated from the parent to fit the alignment padding, for one-off aligned allocations from
+	// an arena use Arena::alloc_aligned instead
+	// note: the adapter should outlive the containers using it
+	struct Aligned : Interface
+	{
+		Interface* parent;
+		size_t alignment;
+
+		// creates a new aligned adapter with the given parent allocator and minimum alignment (power of 2)
+		MN_EXPORT
+		Aligned(Interface* parent, size_t alignment);
+
+		// allocates a block from the parent allocator with the max of the given and minimum alignment
+		MN_EXPORT Block
+		alloc(size_t size, uint8_t alignment) override;
+
+		// frees the given block to the parent allocator
+		MN_EXPORT void
+		free(Block block) override;
+	};
+}
@@ -39,6 +39,16 @@ namespace mn::memory
 		size_t clear_all_readjust_threshold;
 		size_t clear_all_current_highwater;
 		size_t clear_all_previous_highwater;
+		// number of clear_all calls, and the number of them which had to readjust (free/decommit) the memory
+		size_t clear_all_count;
+		size_t clear_all_readjust_count;
+		// reserved virtual memory region which backs the arena (if it's reserved using reserve_virtual)
+		// the region is committed lazily as the arena grows, once it's full the arena falls back to allocating
+		// blocks from the meta allocator
+		Block reserved;
+		// amount of committed memory from the beginning of the reserved region
+		size_t reserved_committed_mem;
+		uint8_t* reserved_alloc_head;
 
 		// creates a new arena allocator with the given block size (in bytes), and the meta allocator (defaults to system malloc)
 		MN_EXPORT
@@ -52,6 +62,11 @@ namespace mn::memory
 		MN_EXPORT Block
 		alloc(size_t size, uint8_t alignment) override;
 
+		// allocates a block with the given size and alignment, the alignment should be a power of 2 and up to 4096
+		// (page size), only the padding needed to align the block is wasted
+		MN_EXPORT Block
+		alloc_aligned(size_t size, size_t alignment);
+
 		// does nothing, arena doesn't support individual frees
 		MN_EXPORT void
 		free(Block block) override;
@@ -60,11 +75,19 @@ namespace mn::memory
 		MN_EXPORT void
 		grow(size_t size);
 
+		// backs the arena with a reserved virtual memory region of the given size, which makes clear_all an O(1)
+		// operation that never frees memory to the meta allocator, unused memory is decommitted periodically instead
+		// it should be called on an empty arena, returns false if it fails to reserve the region
+		MN_EXPORT bool
+		reserve_virtual(size_t reserve_size);
+
 		// frees the entire arena to the meta allocator
 		MN_EXPORT void
 		free_all();
 
 		// resets the allocation state back but doesn't free the memory to the meta allocator, which is useful for memory reuse
+		// if the arena grew beyond its first block it's readjusted by freeing all the memory and allocating a
+		// single block which fits the highwater memory, virtual arenas only decommit the unused memory periodically
 		MN_EXPORT void
 		clear_all();
 
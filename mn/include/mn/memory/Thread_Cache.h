@@ -0,0 +1,38 @@
+#pragma once
+
+#include "mn/Exports.h"
+#include "mn/memory/Interface.h"
+#include "mn/Base.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace mn::memory
+{
+	// thread cache is a general purpose allocator which scales across threads, it's modeled after tcmalloc
+	// small blocks (up to 32KB) are rounded up to a size class and served from a per thread cache without any locking,
+	// when a thread's cache of a size class is empty it's refilled with a batch of blocks from a central transfer cache
+	// and when it's too full a batch of blocks is released back to the transfer cache, blocks can be freed from any
+	// thread, they will be cached by the freeing thread, big blocks are allocated directly from the system's malloc
+	// it guarantees 16 bytes alignment just like malloc, you can install it using allocator_push to make buf, str,
+	// map, etc.. allocate from it
+	struct Thread_Cache : Interface
+	{
+		// allocates a new block with the given size from the calling thread's cache
+		MN_EXPORT Block
+		alloc(size_t size, uint8_t alignment) override;
+
+		// frees the given block into the calling thread's cache, if the block is empty it does nothing
+		MN_EXPORT void
+		free(Block block) override;
+	};
+
+	// returns the global instance of the thread cache allocator
+	MN_EXPORT Thread_Cache*
+	thread_cache();
+
+	// releases all the blocks cached by the calling thread back to the central transfer cache, which is useful before
+	// a thread goes idle for a long time, it's done automatically when the thread exits
+	MN_EXPORT void
+	thread_cache_flush();
+}
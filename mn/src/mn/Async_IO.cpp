@@ -0,0 +1,969 @@
+#include "mn/Async_IO.h"
+#include "mn/Memory.h"
+#include "mn/Buf.h"
+#include "mn/Pool.h"
+#include "mn/Thread.h"
+#include "mn/Defer.h"
+#include "mn/Log.h"
+
+#include <atomic>
+#include <errno.h>
+#include <string.h>
+
+#if OS_LINUX && __has_include(<linux/io_uring.h>)
+#define MN_ASYNC_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#else
+#define MN_ASYNC_IO_URING 0
+#endif
+
+#if OS_WINDOWS
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace mn
+{
+	enum ASYNC_IO_OP_KIND
+	{
+		ASYNC_IO_OP_KIND_FILE_READ,
+		ASYNC_IO_OP_KIND_FILE_WRITE,
+		ASYNC_IO_OP_KIND_FILE_SYNC,
+		ASYNC_IO_OP_KIND_SOCKET_READ,
+		ASYNC_IO_OP_KIND_SOCKET_WRITE,
+		ASYNC_IO_OP_KIND_SOCKET_ACCEPT,
+	};
+
+	struct Async_IO_Op
+	{
+		ASYNC_IO_OP_KIND kind;
+		int flags;
+		File file;
+		Socket socket;
+		Block data;
+		int64_t offset;
+		bool fixed;
+		size_t buffer_index;
+		bool multishot;
+		// io_uring multishot accept needs linux 5.19, on older kernels we re-arm a single shot accept instead
+		bool rearm;
+		// index of the operation in the engine's in flight list while it's in the io_uring
+		size_t in_flight_index;
+		Async_IO_Callback callback;
+		// one reference for the operation itself, and one for each completion which is being delivered, multishot
+		// completions might be delivered concurrently so the operation is freed when the last one finishes
+		std::atomic<int32_t> atomic_refs;
+	};
+
+	// the socket poll timeout used by the fallback path so that blocking operations notice when the engine is freed
+	constexpr static uint32_t ASYNC_IO_FALLBACK_POLL_IN_MS = 100;
+	constexpr static size_t ASYNC_IO_DEFAULT_QUEUE_DEPTH = 256;
+
+	#if MN_ASYNC_IO_URING
+	// user data of the internal operations, they don't have an Async_IO_Op
+	constexpr static uint64_t ASYNC_IO_URING_STOP = 0;
+	constexpr static uint64_t ASYNC_IO_URING_CANCEL = 1;
+
+	#ifndef IORING_ACCEPT_MULTISHOT
+	#define IORING_ACCEPT_MULTISHOT (1U << 0)
+	#endif
+
+	// the opcodes which the engine uses, READ, RECV and SEND are missing before linux 5.6
+	constexpr static uint8_t ASYNC_IO_URING_OPCODES[] = {
+		IORING_OP_NOP,
+		IORING_OP_READ,
+		IORING_OP_WRITE,
+		IORING_OP_READ_FIXED,
+		IORING_OP_WRITE_FIXED,
+		IORING_OP_FSYNC,
+		IORING_OP_RECV,
+		IORING_OP_SEND,
+		IORING_OP_ACCEPT,
+		IORING_OP_ASYNC_CANCEL,
+	};
+
+	// an io_uring instance, the submission and completion queues are shared with the kernel
+	struct Async_IO_Uring
+	{
+		int fd;
+		uint32_t sq_entries;
+		Block sq_ring;
+		Block cq_ring;
+		Block sqes_block;
+		io_uring_sqe* sqes;
+		uint32_t* sq_head;
+		uint32_t* sq_tail;
+		uint32_t* sq_mask;
+		uint32_t* sq_array;
+		uint32_t* cq_head;
+		uint32_t* cq_tail;
+		uint32_t* cq_mask;
+		io_uring_cqe* cqes;
+		// count of sqes which were pushed into the submission queue but not submitted to the kernel yet
+		uint32_t to_submit;
+	};
+
+	inline static bool
+	_async_io_uring_init(Async_IO_Uring& self, uint32_t entries)
+	{
+		io_uring_params params{};
+		auto fd = int(::syscall(__NR_io_uring_setup, entries, &params));
+		if (fd < 0)
+			return false;
+
+		self.fd = fd;
+		self.sq_entries = params.sq_entries;
+		self.sq_ring.size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+		self.cq_ring.size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		if (params.features & IORING_FEAT_SINGLE_MMAP)
+		{
+			if (self.cq_ring.size > self.sq_ring.size)
+				self.sq_ring.size = self.cq_ring.size;
+			self.cq_ring.size = self.sq_ring.size;
+		}
+
+		self.sq_ring.ptr = ::mmap(nullptr, self.sq_ring.size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+		if (self.sq_ring.ptr == MAP_FAILED)
+		{
+			::close(fd);
+			return false;
+		}
+
+		if (params.features & IORING_FEAT_SINGLE_MMAP)
+		{
+			self.cq_ring.ptr = self.sq_ring.ptr;
+		}
+		else
+		{
+			self.cq_ring.ptr = ::mmap(nullptr, self.cq_ring.size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+			if (self.cq_ring.ptr == MAP_FAILED)
+			{
+				::munmap(self.sq_ring.ptr, self.sq_ring.size);
+				::close(fd);
+				return false;
+			}
+		}
+
+		self.sqes_block.size = params.sq_entries * sizeof(io_uring_sqe);
+		self.sqes_block.ptr = ::mmap(nullptr, self.sqes_block.size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+		if (self.sqes_block.ptr == MAP_FAILED)
+		{
+			if (self.cq_ring.ptr != self.sq_ring.ptr)
+				::munmap(self.cq_ring.ptr, self.cq_ring.size);
+			::munmap(self.sq_ring.ptr, self.sq_ring.size);
+			::close(fd);
+			return false;
+		}
+
+		auto sq = (char*)self.sq_ring.ptr;
+		self.sq_head = (uint32_t*)(sq + params.sq_off.head);
+		self.sq_tail = (uint32_t*)(sq + params.sq_off.tail);
+		self.sq_mask = (uint32_t*)(sq + params.sq_off.ring_mask);
+		self.sq_array = (uint32_t*)(sq + params.sq_off.array);
+		self.sqes = (io_uring_sqe*)self.sqes_block.ptr;
+
+		auto cq = (char*)self.cq_ring.ptr;
+		self.cq_head = (uint32_t*)(cq + params.cq_off.head);
+		self.cq_tail = (uint32_t*)(cq + params.cq_off.tail);
+		self.cq_mask = (uint32_t*)(cq + params.cq_off.ring_mask);
+		self.cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+		self.to_submit = 0;
+		return true;
+	}
+
+	inline static void
+	_async_io_uring_free(Async_IO_Uring& self)
+	{
+		::munmap(self.sqes_block.ptr, self.sqes_block.size);
+		if (self.cq_ring.ptr != self.sq_ring.ptr)
+			::munmap(self.cq_ring.ptr, self.cq_ring.size);
+		::munmap(self.sq_ring.ptr, self.sq_ring.size);
+		::close(self.fd);
+	}
+
+	// returns whether the kernel supports all the opcodes which the engine uses, the probe itself needs linux 5.6
+	// so older kernels use the fallback path
+	inline static bool
+	_async_io_uring_probe(Async_IO_Uring& self)
+	{
+		constexpr static unsigned OPS_COUNT = 256;
+		alignas(io_uring_probe) char buffer[sizeof(io_uring_probe) + OPS_COUNT * sizeof(io_uring_probe_op)] = {};
+		auto probe = (io_uring_probe*)buffer;
+		if (::syscall(__NR_io_uring_register, self.fd, IORING_REGISTER_PROBE, probe, OPS_COUNT) < 0)
+			return false;
+
+		for (auto opcode: ASYNC_IO_URING_OPCODES)
+		{
+			if (opcode > probe->last_op || (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) == 0)
+				return false;
+		}
+		return true;
+	}
+
+	// submits the pushed sqes to the kernel and returns their count, if the kernel is out of resources or the
+	// completion queue overflowed (EAGAIN, EBUSY) the sqes stay in the queue and they're submitted by the next call
+	inline static size_t
+	_async_io_uring_submit(Async_IO_Uring& self)
+	{
+		size_t res = 0;
+		while (self.to_submit > 0)
+		{
+			auto submitted = ::syscall(__NR_io_uring_enter, self.fd, self.to_submit, 0, 0, nullptr, 0);
+			if (submitted < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				if (errno != EAGAIN && errno != EBUSY)
+					log_error("async io: io_uring_enter failed to submit {} operations, {}", self.to_submit, ::strerror(errno));
+				break;
+			}
+			self.to_submit -= uint32_t(submitted);
+			res += size_t(submitted);
+		}
+		return res;
+	}
+
+	// returns a zeroed sqe from the submission queue, or nullptr if the queue is full
+	inline static io_uring_sqe*
+	_async_io_uring_sqe_try(Async_IO_Uring& self)
+	{
+		auto tail = *self.sq_tail;
+		auto head = __atomic_load_n(self.sq_head, __ATOMIC_ACQUIRE);
+		if (tail - head >= self.sq_entries)
+			return nullptr;
+
+		auto index = tail & *self.sq_mask;
+		auto sqe = &self.sqes[index];
+		::memset(sqe, 0, sizeof(*sqe));
+		self.sq_array[index] = index;
+		return sqe;
+	}
+
+	// publishes the last sqe returned from _async_io_uring_sqe to the kernel
+	inline static void
+	_async_io_uring_push(Async_IO_Uring& self)
+	{
+		__atomic_store_n(self.sq_tail, *self.sq_tail + 1, __ATOMIC_RELEASE);
+		++self.to_submit;
+	}
+	#endif
+
+	struct IAsync_IO
+	{
+		Fabric fabric;
+		Async_IO_Settings settings;
+		Pool ops_pool;
+		std::atomic<size_t> atomic_pending;
+		std::atomic<bool> atomic_running;
+		bool buffers_registered;
+
+		// guards the submission queue and the in flight operations (or the queued operations in case of the fallback
+		// path)
+		Mutex mtx;
+		// operations which are queued but not submitted yet, only used by the fallback path
+		Buf<Async_IO_Op*> queued;
+		// operations which are in the io_uring, they're cancelled one by one when the engine is freed
+		Buf<Async_IO_Op*> in_flight;
+
+		bool native;
+		#if MN_ASYNC_IO_URING
+		Async_IO_Uring ring;
+		Thread completion_thread;
+		#endif
+	};
+
+	inline static void
+	_async_io_op_release(Async_IO self, Async_IO_Op* op)
+	{
+		if (op->atomic_refs.fetch_sub(1) == 1)
+		{
+			task_free(op->callback);
+			pool_put(self->ops_pool, op);
+			self->atomic_pending.fetch_sub(1);
+		}
+	}
+
+	// calls the operation's callback with the given completion on one of the fabric's workers
+	inline static void
+	_async_io_deliver(Async_IO self, Async_IO_Op* op, const Async_IO_Completion& completion)
+	{
+		op->atomic_refs.fetch_add(1);
+		fabric_do(self->fabric, [self, op, completion] {
+			op->callback(completion);
+			_async_io_op_release(self, op);
+		});
+		if (completion.more == false)
+			_async_io_op_release(self, op);
+	}
+
+	inline static void
+	_async_io_deliver_cancelled(Async_IO self, Async_IO_Op* op)
+	{
+		Async_IO_Completion completion{};
+		completion.result = -ECANCELED;
+		_async_io_deliver(self, op, completion);
+	}
+
+	inline static Socket
+	_async_io_socket_from_handle(Socket listener, int64_t handle)
+	{
+		auto self = alloc_construct<ISocket>();
+		self->handle = handle;
+		self->family = listener->family;
+		self->type = listener->type;
+		return self;
+	}
+
+	inline static int64_t
+	_async_io_socket_error_to_os(MN_SOCKET_ERROR error)
+	{
+		switch (error)
+		{
+		case MN_SOCKET_ERROR_OUT_OF_MEMORY:
+			return -ENOMEM;
+		case MN_SOCKET_ERROR_TIMEOUT:
+			return -ETIMEDOUT;
+		case MN_SOCKET_ERROR_CONNECTION_CLOSED:
+			return -ECONNRESET;
+		case MN_SOCKET_ERROR_INTERNAL_ERROR:
+			return -EINVAL;
+		default:
+			return -EIO;
+		}
+	}
+
+	#if MN_ASYNC_IO_URING
+	// returns a zeroed sqe from the submission queue, the caller should hold the engine's mutex, if the queue is full
+	// it submits the pending sqes, and if the kernel can't take them yet (EBUSY once the completion queue overflows)
+	// it waits without holding the mutex so that the completion thread can deliver its completions meanwhile
+	inline static io_uring_sqe*
+	_async_io_uring_sqe(Async_IO self)
+	{
+		while (true)
+		{
+			if (auto sqe = _async_io_uring_sqe_try(self->ring))
+				return sqe;
+			if (_async_io_uring_submit(self->ring) > 0)
+				continue;
+
+			mutex_unlock(self->mtx);
+			thread_sleep(0);
+			mutex_lock(self->mtx);
+		}
+	}
+
+	// fills an sqe for the given operation, the caller should hold the engine's mutex, it returns false if the engine
+	// is being freed, async_io_free might cancel the in flight operations while we wait for an sqe without the mutex
+	inline static bool
+	_async_io_uring_prepare(Async_IO self, Async_IO_Op* op, bool track = true)
+	{
+		auto sqe = _async_io_uring_sqe(self);
+		if (self->atomic_running.load() == false)
+			return false;
+
+		if (track)
+		{
+			op->in_flight_index = self->in_flight.count;
+			buf_push(self->in_flight, op);
+		}
+
+		sqe->user_data = uint64_t(op);
+		if (op->flags & ASYNC_IO_FLAG_LINK)
+			sqe->flags |= IOSQE_IO_LINK;
+
+		switch (op->kind)
+		{
+		case ASYNC_IO_OP_KIND_FILE_READ:
+		case ASYNC_IO_OP_KIND_FILE_WRITE:
+		{
+			bool read = op->kind == ASYNC_IO_OP_KIND_FILE_READ;
+			if (op->fixed)
+			{
+				sqe->opcode = read ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+				sqe->buf_index = uint16_t(op->buffer_index);
+			}
+			else
+			{
+				sqe->opcode = read ? IORING_OP_READ : IORING_OP_WRITE;
+			}
+			sqe->fd = op->file->linux_handle;
+			sqe->addr = uint64_t(op->data.ptr);
+			sqe->len = uint32_t(op->data.size);
+			sqe->off = op->offset < 0 ? uint64_t(-1) : uint64_t(op->offset);
+			break;
+		}
+		case ASYNC_IO_OP_KIND_FILE_SYNC:
+			sqe->opcode = IORING_OP_FSYNC;
+			sqe->fd = op->file->linux_handle;
+			break;
+		case ASYNC_IO_OP_KIND_SOCKET_READ:
+		case ASYNC_IO_OP_KIND_SOCKET_WRITE:
+			sqe->opcode = op->kind == ASYNC_IO_OP_KIND_SOCKET_READ ? IORING_OP_RECV : IORING_OP_SEND;
+			sqe->fd = int(op->socket->handle);
+			sqe->addr = uint64_t(op->data.ptr);
+			sqe->len = uint32_t(op->data.size);
+			break;
+		case ASYNC_IO_OP_KIND_SOCKET_ACCEPT:
+			sqe->opcode = IORING_OP_ACCEPT;
+			sqe->fd = int(op->socket->handle);
+			if (op->multishot && op->rearm == false)
+				sqe->ioprio |= IORING_ACCEPT_MULTISHOT;
+			break;
+		default:
+			assert(false && "unreachable");
+			break;
+		}
+		_async_io_uring_push(self->ring);
+		return true;
+	}
+
+	// removes the given operation from the in flight list, the caller should hold the engine's mutex
+	inline static void
+	_async_io_uring_untrack(Async_IO self, Async_IO_Op* op)
+	{
+		auto last = buf_top(self->in_flight);
+		last->in_flight_index = op->in_flight_index;
+		self->in_flight[op->in_flight_index] = last;
+		buf_pop(self->in_flight);
+	}
+
+	// re-arms the given accept operation unless the engine is being freed, the check is done under the engine's mutex
+	// so that async_io_free either cancels the re-armed accept or the accept isn't re-armed at all
+	inline static bool
+	_async_io_uring_rearm(Async_IO self, Async_IO_Op* op)
+	{
+		mutex_lock(self->mtx);
+		mn_defer(mutex_unlock(self->mtx));
+
+		if (self->atomic_running.load() == false || _async_io_uring_prepare(self, op, false) == false)
+		{
+			_async_io_uring_untrack(self, op);
+			return false;
+		}
+
+		_async_io_uring_submit(self->ring);
+		return true;
+	}
+
+	inline static void
+	_async_io_uring_complete(Async_IO self, const io_uring_cqe& cqe)
+	{
+		auto op = (Async_IO_Op*)cqe.user_data;
+		op->atomic_refs.load(std::memory_order_acquire);
+
+		Async_IO_Completion completion{};
+		completion.result = cqe.res;
+		completion.more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+
+		if (op->kind == ASYNC_IO_OP_KIND_SOCKET_ACCEPT)
+		{
+			// old kernels reject the multishot flag, so we switch to re-arming single shot accepts
+			if (op->multishot && op->rearm == false && cqe.res == -EINVAL && completion.more == false)
+			{
+				op->rearm = true;
+				if (_async_io_uring_rearm(self, op))
+					return;
+				completion.result = -ECANCELED;
+				_async_io_deliver(self, op, completion);
+				return;
+			}
+
+			if (cqe.res >= 0)
+				completion.socket = _async_io_socket_from_handle(op->socket, cqe.res);
+
+			if (op->rearm && cqe.res >= 0)
+			{
+				completion.more = _async_io_uring_rearm(self, op);
+				_async_io_deliver(self, op, completion);
+				return;
+			}
+		}
+
+		if (completion.more == false)
+		{
+			mutex_lock(self->mtx);
+			_async_io_uring_untrack(self, op);
+			mutex_unlock(self->mtx);
+		}
+		_async_io_deliver(self, op, completion);
+	}
+
+	// reaps the completion queue and delivers the completions to the fabric
+	inline static void
+	_async_io_uring_completion_main(void* arg)
+	{
+		auto self = (Async_IO)arg;
+		auto& ring = self->ring;
+
+		auto cqes = buf_with_allocator<io_uring_cqe>(memory::clib());
+		mn_defer(buf_free(cqes));
+
+		bool running = true;
+		while (running)
+		{
+			auto res = ::syscall(__NR_io_uring_enter, ring.fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+			if (res < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+				break;
+
+			// the completions are copied out and their slots are given back to the kernel before any of them is
+			// delivered because delivering might wait for the engine's mutex, and the mutex holder might be waiting
+			// for the kernel to take its sqes which it won't do while the completion queue is full
+			buf_clear(cqes);
+			auto head = *ring.cq_head;
+			auto tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+			for (; head != tail; ++head)
+				buf_push(cqes, ring.cqes[head & *ring.cq_mask]);
+			__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+
+			for (const auto& cqe: cqes)
+			{
+				if (cqe.user_data == ASYNC_IO_URING_STOP)
+					running = false;
+				else if (cqe.user_data != ASYNC_IO_URING_CANCEL)
+					_async_io_uring_complete(self, cqe);
+			}
+		}
+	}
+	#endif
+
+	// executes the given operation using the normal blocking calls, it returns the result and the accepted socket
+	inline static int64_t
+	_async_io_fallback_execute(Async_IO self, Async_IO_Op* op, Socket& accepted)
+	{
+		switch (op->kind)
+		{
+		case ASYNC_IO_OP_KIND_FILE_READ:
+		case ASYNC_IO_OP_KIND_FILE_WRITE:
+		{
+			bool read = op->kind == ASYNC_IO_OP_KIND_FILE_READ;
+			if (op->offset < 0)
+				return int64_t(read ? file_read(op->file, op->data) : file_write(op->file, op->data));
+
+			worker_block_ahead();
+			mn_defer(worker_block_clear());
+			#if OS_WINDOWS
+				OVERLAPPED overlapped{};
+				overlapped.Offset = DWORD(uint64_t(op->offset) & 0xFFFFFFFF);
+				overlapped.OffsetHigh = DWORD(uint64_t(op->offset) >> 32);
+				DWORD bytes = 0;
+				BOOL ok = FALSE;
+				if (read)
+					ok = ::ReadFile(op->file->winos_handle, op->data.ptr, DWORD(op->data.size), &bytes, &overlapped);
+				else
+					ok = ::WriteFile(op->file->winos_handle, op->data.ptr, DWORD(op->data.size), &bytes, &overlapped);
+				if (ok == FALSE && ::GetLastError() != ERROR_HANDLE_EOF)
+					return -EIO;
+				return int64_t(bytes);
+			#else
+				#if OS_MACOS
+					auto handle = op->file->macos_handle;
+				#else
+					auto handle = op->file->linux_handle;
+				#endif
+				auto res = read ?
+					::pread(handle, op->data.ptr, op->data.size, off_t(op->offset)) :
+					::pwrite(handle, op->data.ptr, op->data.size, off_t(op->offset));
+				return res < 0 ? -int64_t(errno) : int64_t(res);
+			#endif
+		}
+		case ASYNC_IO_OP_KIND_FILE_SYNC:
+		{
+			worker_block_ahead();
+			mn_defer(worker_block_clear());
+			#if OS_WINDOWS
+				return ::FlushFileBuffers(op->file->winos_handle) ? 0 : -EIO;
+			#elif OS_MACOS
+				return ::fsync(op->file->macos_handle) == 0 ? 0 : -int64_t(errno);
+			#else
+				return ::fsync(op->file->linux_handle) == 0 ? 0 : -int64_t(errno);
+			#endif
+		}
+		case ASYNC_IO_OP_KIND_SOCKET_READ:
+		{
+			while (true)
+			{
+				auto [read_bytes, err] = socket_read(op->socket, op->data, {ASYNC_IO_FALLBACK_POLL_IN_MS});
+				if (err == MN_SOCKET_ERROR_OK)
+					return int64_t(read_bytes);
+				if (err != MN_SOCKET_ERROR_TIMEOUT)
+					return _async_io_socket_error_to_os(err);
+				if (self->atomic_running.load() == false)
+					return -ECANCELED;
+			}
+		}
+		case ASYNC_IO_OP_KIND_SOCKET_WRITE:
+			return int64_t(socket_write(op->socket, op->data));
+		case ASYNC_IO_OP_KIND_SOCKET_ACCEPT:
+		{
+			while (self->atomic_running.load())
+			{
+				accepted = socket_accept(op->socket, {ASYNC_IO_FALLBACK_POLL_IN_MS});
+				if (accepted)
+					return accepted->handle;
+			}
+			return -ECANCELED;
+		}
+		default:
+			assert(false && "unreachable");
+			return -EINVAL;
+		}
+	}
+
+	// executes a chain of linked operations in order, once an operation fails the rest of the chain is cancelled
+	inline static void
+	_async_io_fallback_run(Async_IO self, Async_IO_Op** ops, size_t count)
+	{
+		bool cancelled = false;
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto op = ops[i];
+			Async_IO_Completion completion{};
+			if (cancelled)
+			{
+				completion.result = -ECANCELED;
+				op->callback(completion);
+				_async_io_op_release(self, op);
+				continue;
+			}
+
+			// multishot accept keeps the worker until the engine is freed, it's a blocking call so sysmon will
+			// replace the worker in the meantime
+			while (true)
+			{
+				completion.socket = nullptr;
+				completion.result = _async_io_fallback_execute(self, op, completion.socket);
+				completion.more = op->multishot && completion.result >= 0;
+				op->callback(completion);
+				if (completion.more == false)
+					break;
+			}
+
+			if (completion.result < 0)
+				cancelled = true;
+			_async_io_op_release(self, op);
+		}
+	}
+
+	inline static Async_IO_Op*
+	_async_io_op_new(Async_IO self, ASYNC_IO_OP_KIND kind, int flags, const Async_IO_Callback& callback)
+	{
+		auto op = (Async_IO_Op*)pool_get(self->ops_pool);
+		::memset((void*)op, 0, sizeof(*op));
+		op->kind = kind;
+		op->flags = flags;
+		op->callback = callback;
+		self->atomic_pending.fetch_add(1);
+		return op;
+	}
+
+	inline static void
+	_async_io_queue(Async_IO self, Async_IO_Op* op)
+	{
+		// the completion thread gets the operation through the kernel, it acquires the reference count to make sure it
+		// sees the operation's fields
+		op->atomic_refs.store(1, std::memory_order_release);
+
+		mutex_lock(self->mtx);
+		mn_defer(mutex_unlock(self->mtx));
+
+		// the callbacks might queue more operations while the engine is being freed, they're cancelled right away
+		// because the in flight operations were already cancelled (or submitted in case of the fallback path)
+		if (self->atomic_running.load() == false)
+		{
+			_async_io_deliver_cancelled(self, op);
+			return;
+		}
+
+		#if MN_ASYNC_IO_URING
+		if (self->native)
+		{
+			if (_async_io_uring_prepare(self, op) == false)
+			{
+				_async_io_deliver_cancelled(self, op);
+				return;
+			}
+			// we can't split a chain of linked operations across submissions
+			if (self->ring.to_submit >= self->settings.queue_depth && (op->flags & ASYNC_IO_FLAG_LINK) == 0)
+				_async_io_uring_submit(self->ring);
+			return;
+		}
+		#endif
+
+		buf_push(self->queued, op);
+	}
+
+	// schedules the queued chains of linked operations, an unterminated chain waits for the rest of its operations
+	// unless end_chain is true, in which case its last operation ends it just like io_uring does at submission
+	inline static size_t
+	_async_io_fallback_submit(Async_IO self, bool end_chain = false)
+	{
+		auto tasks = buf_with_allocator<Fabric_Task>(memory::tmp());
+		size_t res = 0;
+		{
+			mutex_lock(self->mtx);
+			mn_defer(mutex_unlock(self->mtx));
+
+			size_t chain_start = 0;
+			for (size_t i = 0; i < self->queued.count; ++i)
+			{
+				bool chain_end = (self->queued[i]->flags & ASYNC_IO_FLAG_LINK) == 0;
+				if (end_chain && i + 1 == self->queued.count)
+					chain_end = true;
+				if (chain_end == false)
+					continue;
+
+				auto chain = buf_with_allocator<Async_IO_Op*>(memory::clib());
+				buf_reserve(chain, i + 1 - chain_start);
+				for (size_t j = chain_start; j <= i; ++j)
+					buf_push(chain, self->queued[j]);
+				Fabric_Task task{};
+				task.task = Task<void()>::make_with_allocator(worker_task_allocator(), [self, chain]() mutable {
+					_async_io_fallback_run(self, chain.ptr, chain.count);
+					buf_free(chain);
+				});
+				buf_push(tasks, task);
+				chain_start = i + 1;
+			}
+
+			res = chain_start;
+			auto remaining = self->queued.count - chain_start;
+			::memmove(self->queued.ptr, self->queued.ptr + chain_start, remaining * sizeof(Async_IO_Op*));
+			buf_resize(self->queued, remaining);
+		}
+
+		if (tasks.count > 0)
+			fabric_task_batch_do(self->fabric, tasks.ptr, tasks.count);
+		return res;
+	}
+
+
+	// API
+	Async_IO
+	async_io_new(Fabric fabric, Async_IO_Settings settings)
+	{
+		if (settings.queue_depth == 0)
+			settings.queue_depth = ASYNC_IO_DEFAULT_QUEUE_DEPTH;
+
+		auto self = alloc_zerod<IAsync_IO>();
+		self->fabric = fabric;
+		self->settings = settings;
+		self->ops_pool = pool_concurrent_new(sizeof(Async_IO_Op), 256);
+		self->atomic_pending = 0;
+		self->atomic_running = true;
+		self->mtx = mutex_new("async io mutex");
+		self->queued = buf_new<Async_IO_Op*>();
+		self->in_flight = buf_new<Async_IO_Op*>();
+
+		#if MN_ASYNC_IO_URING
+		if (settings.force_fallback == false && _async_io_uring_init(self->ring, uint32_t(settings.queue_depth * 2)))
+		{
+			if (_async_io_uring_probe(self->ring))
+			{
+				self->native = true;
+				self->completion_thread = thread_new(_async_io_uring_completion_main, self, "async io completion thread");
+			}
+			else
+			{
+				_async_io_uring_free(self->ring);
+			}
+		}
+		#endif
+
+		return self;
+	}
+
+	void
+	async_io_free(Async_IO self)
+	{
+		self->atomic_running.store(false);
+		// an unterminated chain of linked operations would wait forever for the rest of its operations in the
+		// fallback path, so its last operation ends it like the io_uring submission does
+		if (self->native)
+			async_io_submit(self);
+		else
+			_async_io_fallback_submit(self, true);
+
+		#if MN_ASYNC_IO_URING
+		if (self->native)
+		{
+			// cancel the in flight operations one by one using their user data since cancelling any operation needs
+			// linux 5.19, the operations which already started (file reads, etc..) can't be cancelled so we wait for
+			// them to finish, the cancel completions themselves are ignored
+			{
+				mutex_lock(self->mtx);
+				mn_defer(mutex_unlock(self->mtx));
+				// waiting for an sqe releases the mutex and the completion thread removes the completed operations
+				// from the in flight list meanwhile, so we go over a copy of it, no operation is added to it anymore
+				auto in_flight = buf_memcpy_clone(self->in_flight, memory::tmp());
+				for (auto op: in_flight)
+				{
+					auto sqe = _async_io_uring_sqe(self);
+					sqe->opcode = IORING_OP_ASYNC_CANCEL;
+					sqe->fd = -1;
+					sqe->addr = uint64_t(op);
+					sqe->user_data = ASYNC_IO_URING_CANCEL;
+					_async_io_uring_push(self->ring);
+				}
+				_async_io_uring_submit(self->ring);
+			}
+			worker_block_on([self] { return self->atomic_pending.load() == 0; });
+
+			{
+				mutex_lock(self->mtx);
+				mn_defer(mutex_unlock(self->mtx));
+				auto sqe = _async_io_uring_sqe(self);
+				sqe->opcode = IORING_OP_NOP;
+				sqe->user_data = ASYNC_IO_URING_STOP;
+				_async_io_uring_push(self->ring);
+				_async_io_uring_submit(self->ring);
+			}
+			thread_join(self->completion_thread);
+			thread_free(self->completion_thread);
+			_async_io_uring_free(self->ring);
+		}
+		#endif
+
+		worker_block_on([self] { return self->atomic_pending.load() == 0; });
+
+		buf_free(self->queued);
+		buf_free(self->in_flight);
+		mutex_free(self->mtx);
+		pool_free(self->ops_pool);
+		free(self);
+	}
+
+	bool
+	async_io_is_native(Async_IO self)
+	{
+		return self->native;
+	}
+
+	bool
+	async_io_register_buffers(Async_IO self, const Block* buffers, size_t count)
+	{
+		if (self->buffers_registered)
+			return false;
+
+		#if MN_ASYNC_IO_URING
+		if (self->native)
+		{
+			auto iovecs = buf_with_allocator<iovec>(memory::tmp());
+			for (size_t i = 0; i < count; ++i)
+				buf_push(iovecs, iovec{buffers[i].ptr, buffers[i].size});
+			if (::syscall(__NR_io_uring_register, self->ring.fd, IORING_REGISTER_BUFFERS, iovecs.ptr, unsigned(count)) < 0)
+				return false;
+		}
+		#else
+		(void)buffers;
+		(void)count;
+		#endif
+
+		self->buffers_registered = true;
+		return true;
+	}
+
+	void
+	async_io_file_read(Async_IO self, File file, Block data, int64_t offset, Async_IO_Callback callback, int flags)
+	{
+		auto op = _async_io_op_new(self, ASYNC_IO_OP_KIND_FILE_READ, flags, callback);
+		op->file = file;
+		op->data = data;
+		op->offset = offset;
+		_async_io_queue(self, op);
+	}
+
+	void
+	async_io_file_write(Async_IO self, File file, Block data, int64_t offset, Async_IO_Callback callback, int flags)
+	{
+		auto op = _async_io_op_new(self, ASYNC_IO_OP_KIND_FILE_WRITE, flags, callback);
+		op->file = file;
+		op->data = data;
+		op->offset = offset;
+		_async_io_queue(self, op);
+	}
+
+	void
+	async_io_file_read_fixed(Async_IO self, File file, size_t buffer_index, Block data, int64_t offset, Async_IO_Callback callback, int flags)
+	{
+		auto op = _async_io_op_new(self, ASYNC_IO_OP_KIND_FILE_READ, flags, callback);
+		op->file = file;
+		op->data = data;
+		op->offset = offset;
+		op->fixed = true;
+		op->buffer_index = buffer_index;
+		_async_io_queue(self, op);
+	}
+
+	void
+	async_io_file_write_fixed(Async_IO self, File file, size_t buffer_index, Block data, int64_t offset, Async_IO_Callback callback, int flags)
+	{
+		auto op = _async_io_op_new(self, ASYNC_IO_OP_KIND_FILE_WRITE, flags, callback);
+		op->file = file;
+		op->data = data;
+		op->offset = offset;
+		op->fixed = true;
+		op->buffer_index = buffer_index;
+		_async_io_queue(self, op);
+	}
+
+	void
+	async_io_file_sync(Async_IO self, File file, Async_IO_Callback callback, int flags)
+	{
+		auto op = _async_io_op_new(self, ASYNC_IO_OP_KIND_FILE_SYNC, flags, callback);
+		op->file = file;
+		_async_io_queue(self, op);
+	}
+
+	void
+	async_io_socket_read(Async_IO self, Socket socket, Block data, Async_IO_Callback callback, int flags)
+	{
+		auto op = _async_io_op_new(self, ASYNC_IO_OP_KIND_SOCKET_READ, flags, callback);
+		op->socket = socket;
+		op->data = data;
+		_async_io_queue(self, op);
+	}
+
+	void
+	async_io_socket_write(Async_IO self, Socket socket, Block data, Async_IO_Callback callback, int flags)
+	{
+		auto op = _async_io_op_new(self, ASYNC_IO_OP_KIND_SOCKET_WRITE, flags, callback);
+		op->socket = socket;
+		op->data = data;
+		_async_io_queue(self, op);
+	}
+
+	void
+	async_io_socket_accept(Async_IO self, Socket socket, bool multishot, Async_IO_Callback callback)
+	{
+		auto op = _async_io_op_new(self, ASYNC_IO_OP_KIND_SOCKET_ACCEPT, ASYNC_IO_FLAG_NONE, callback);
+		op->socket = socket;
+		op->multishot = multishot;
+		_async_io_queue(self, op);
+	}
+
+	size_t
+	async_io_submit(Async_IO self)
+	{
+		#if MN_ASYNC_IO_URING
+		if (self->native)
+		{
+			mutex_lock(self->mtx);
+			mn_defer(mutex_unlock(self->mtx));
+			return _async_io_uring_submit(self->ring);
+		}
+		#endif
+
+		return _async_io_fallback_submit(self);
+	}
+
+	size_t
+	async_io_pending(Async_IO self)
+	{
+		return self->atomic_pending.load();
+	}
+}
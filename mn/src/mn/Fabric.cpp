@@ -3,15 +3,403 @@
 #include "mn/Pool.h"
 #include "mn/Buf.h"
 #include "mn/Log.h"
+#include "mn/Map.h"
 
 #include <atomic>
 #include <chrono>
 #include <thread>
 
+#if ARCH_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 namespace mn
 {
 	constexpr static auto DEFAULT_COOP_BLOCKING_THRESHOLD = 10;
 	constexpr static auto DEFAULT_EXTR_BLOCKING_THRESHOLD = 1000;
+	// initial capacity of the worker's local job deque, it should be a power of 2
+	constexpr static int64_t JOB_DEQUE_INITIAL_CAPACITY = 64;
+	// maximum number of jobs a worker moves out of a job queue in one go
+	constexpr static size_t JOB_TRANSFER_BATCH = 32;
+	constexpr static size_t DEFAULT_TASK_SPILL_SIZE = 512;
+	constexpr static size_t DEFAULT_WORKER_TMP_RESERVE_SIZE = 1ULL * 1024ULL * 1024ULL * 1024ULL;
+	constexpr static size_t WORKER_TMP_BLOCK_SIZE = 4ULL * 1024ULL * 1024ULL;
+	// number of blocks the task pool allocates at once when it runs out of free blocks
+	constexpr static size_t TASK_POOL_CHUNK_BLOCKS = 64;
+	// bounds of the number of rounds an idle worker looks for jobs before it parks itself
+	constexpr static size_t WORKER_SPIN_MIN = 4;
+	constexpr static size_t WORKER_SPIN_MAX = 256;
+	// the first few spin rounds only pause the cpu, the rest yield the thread's time slice
+	constexpr static size_t WORKER_SPIN_PAUSE_ROUNDS = 16;
+	// compute dispatches process their ranges in chunks which take about this time, it's long enough to hide
+	// the cost of the timing and splitting, and short enough to split ranges quickly for idle workers
+	constexpr static uint64_t COMPUTE_CHUNK_TARGET_NS = 50000;
+
+	inline static void
+	_cpu_relax()
+	{
+		#if ARCH_X86 && defined(_MSC_VER)
+			_mm_pause();
+		#elif ARCH_X86
+			__builtin_ia32_pause();
+		#else
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+		#endif
+	}
+
+	// Job Deque
+	// a Chase-Lev work stealing deque, it's owned by a single worker which pushes and pops jobs at the bottom
+	// while the other workers steal jobs from the top without taking any locks
+	// based on "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al. 2013)
+	struct Job_Array
+	{
+		int64_t cap;
+		Fabric_Task* ptr;
+	};
+
+	struct Job_Deque
+	{
+		Allocator allocator;
+		std::atomic<int64_t> atomic_top;
+		// keeps the thieves end and the owner end of the deque on separate cache lines
+		char _padding[64];
+		std::atomic<int64_t> atomic_bottom;
+		std::atomic<Job_Array*> atomic_array;
+		// arrays which were replaced when the deque grew, thieves might still be reading from them
+		// so they're kept around until no one is stealing
+		Buf<Job_Array*> retired_arrays;
+	};
+
+	inline static Job_Array*
+	_job_array_new(Allocator allocator, int64_t cap)
+	{
+		auto self = (Job_Array*)alloc_from(allocator, sizeof(Job_Array) + cap * sizeof(Fabric_Task), alignof(Job_Array)).ptr;
+		self->cap = cap;
+		self->ptr = (Fabric_Task*)(self + 1);
+		return self;
+	}
+
+	inline static void
+	_job_array_free(Allocator allocator, Job_Array* self)
+	{
+		free_from(allocator, Block{ self, sizeof(Job_Array) + self->cap * sizeof(Fabric_Task) });
+	}
+
+	inline static void
+	_job_deque_init(Job_Deque& self)
+	{
+		self.allocator = allocator_top();
+		self.atomic_top = 0;
+		self.atomic_bottom = 0;
+		self.atomic_array = _job_array_new(self.allocator, JOB_DEQUE_INITIAL_CAPACITY);
+		self.retired_arrays = buf_with_allocator<Job_Array*>(self.allocator);
+	}
+
+	inline static void
+	_job_deque_reclaim(Job_Deque& self)
+	{
+		for (auto array: self.retired_arrays)
+			_job_array_free(self.allocator, array);
+		buf_clear(self.retired_arrays);
+	}
+
+	inline static void
+	_job_deque_free(Job_Deque& self)
+	{
+		auto top = self.atomic_top.load();
+		auto bottom = self.atomic_bottom.load();
+		auto array = self.atomic_array.load();
+		for (auto i = top; i < bottom; ++i)
+			fabric_task_free(array->ptr[i & (array->cap - 1)]);
+		_job_array_free(self.allocator, array);
+
+		_job_deque_reclaim(self);
+		buf_free(self.retired_arrays);
+	}
+
+	inline static int64_t
+	_job_deque_count(const Job_Deque& self)
+	{
+		auto top = self.atomic_top.load();
+		auto bottom = self.atomic_bottom.load();
+		return bottom > top ? bottom - top : 0;
+	}
+
+	// pushes a job to the bottom of the deque, only the owner worker can call this function
+	inline static void
+	_job_deque_push(Job_Deque& self, const Fabric_Task& job)
+	{
+		auto bottom = self.atomic_bottom.load(std::memory_order_relaxed);
+		auto top = self.atomic_top.load(std::memory_order_acquire);
+		auto array = self.atomic_array.load(std::memory_order_relaxed);
+		if (bottom - top > array->cap - 1)
+		{
+			auto new_array = _job_array_new(self.allocator, array->cap * 2);
+			for (auto i = top; i < bottom; ++i)
+				new_array->ptr[i & (new_array->cap - 1)] = array->ptr[i & (array->cap - 1)];
+			buf_push(self.retired_arrays, array);
+			self.atomic_array.store(new_array);
+			array = new_array;
+		}
+		array->ptr[bottom & (array->cap - 1)] = job;
+		std::atomic_thread_fence(std::memory_order_release);
+		self.atomic_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+
+	// pops a job from the bottom of the deque, only the owner worker can call this function
+	inline static bool
+	_job_deque_pop(Job_Deque& self, Fabric_Task& job)
+	{
+		auto bottom = self.atomic_bottom.load(std::memory_order_relaxed) - 1;
+		auto array = self.atomic_array.load(std::memory_order_relaxed);
+		self.atomic_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		auto top = self.atomic_top.load(std::memory_order_relaxed);
+
+		if (top > bottom)
+		{
+			self.atomic_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		job = array->ptr[bottom & (array->cap - 1)];
+		if (top == bottom)
+		{
+			// this is the last job in the deque, so we race the thieves for it
+			bool won = self.atomic_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			self.atomic_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return won;
+		}
+		return true;
+	}
+
+	// steals a job from the top of the deque, it can be called from any thread
+	inline static bool
+	_job_deque_steal(Job_Deque& self, Fabric_Task& job)
+	{
+		auto top = self.atomic_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		auto bottom = self.atomic_bottom.load(std::memory_order_acquire);
+		if (top >= bottom)
+			return false;
+
+		auto array = self.atomic_array.load();
+		// the owner might overwrite this slot if another thief took it already, in which case the cas below fails
+		// and we throw away the value we read
+		auto res = array->ptr[top & (array->cap - 1)];
+		if (self.atomic_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed) == false)
+			return false;
+
+		job = res;
+		return true;
+	}
+
+	// Task Pool
+	// allocates the closures of the tasks scheduled by a worker, the worker allocates and frees blocks locally without
+	// any synchronization, other threads which execute the tasks return the blocks to an atomic list which the worker
+	// takes in one go once it runs out of local blocks, the pool is kept alive until all of its blocks are returned
+	struct Task_Pool: memory::Interface
+	{
+		struct Node
+		{
+			Node* next;
+		};
+
+		// over aligned closures (32, 64 and 128 bytes since the alignment is a uint8_t) get blocks from chunks of
+		// their own alignment class, so the blocks of one class are only reused by the same class and the memory
+		// stays bounded by the peak count of live closures in each class
+		constexpr static size_t ALIGNED_CLASSES_COUNT = 3;
+		struct Aligned_Chunk
+		{
+			char* begin;
+			char* end;
+			size_t class_index;
+		};
+
+		Allocator meta;
+		size_t block_size;
+		Node* free_list;
+		Node* aligned_free_lists[ALIGNED_CLASSES_COUNT];
+		Buf<Aligned_Chunk> aligned_chunks;
+		Buf<Block> chunks;
+		std::atomic<Node*> atomic_remote_free_list;
+		// one reference for the owner worker, and one for each allocated block
+		std::atomic<size_t> atomic_refs;
+
+		Block
+		alloc(size_t size, uint8_t alignment) override;
+
+		void
+		free(Block block) override;
+	};
+	thread_local Task_Pool* LOCAL_TASK_POOL = nullptr;
+
+	inline static Task_Pool*
+	_task_pool_new(size_t block_size)
+	{
+		auto meta = allocator_top();
+		auto self = alloc_construct_from<Task_Pool>(meta);
+		self->meta = meta;
+		// blocks are aligned to 16 bytes like the malloc blocks, bigger alignments get their own chunks in alloc
+		self->block_size = (block_size + 15) & ~size_t(15);
+		self->free_list = nullptr;
+		for (auto& list: self->aligned_free_lists)
+			list = nullptr;
+		self->aligned_chunks = buf_with_allocator<Task_Pool::Aligned_Chunk>(meta);
+		self->chunks = buf_with_allocator<Block>(meta);
+		self->atomic_remote_free_list = nullptr;
+		self->atomic_refs = 1;
+		return self;
+	}
+
+	inline static void
+	_task_pool_unref(Task_Pool* self)
+	{
+		if (self->atomic_refs.fetch_sub(1) > 1)
+			return;
+
+		for (auto chunk: self->chunks)
+			free_from(self->meta, chunk);
+		buf_free(self->chunks);
+		buf_free(self->aligned_chunks);
+		free_destruct_from(self->meta, self);
+	}
+
+	// returns the free list which the given block belongs to, it's the owner worker's job
+	inline static Task_Pool::Node**
+	_task_pool_free_list_of(Task_Pool* self, void* ptr)
+	{
+		for (const auto& chunk: self->aligned_chunks)
+			if ((char*)ptr >= chunk.begin && (char*)ptr < chunk.end)
+				return &self->aligned_free_lists[chunk.class_index];
+		return &self->free_list;
+	}
+
+	// takes the blocks which other threads returned and puts each one back into its own free list
+	inline static void
+	_task_pool_take_remote(Task_Pool* self)
+	{
+		auto node = self->atomic_remote_free_list.exchange(nullptr, std::memory_order_acquire);
+		if (self->aligned_chunks.count == 0 && self->free_list == nullptr)
+		{
+			self->free_list = node;
+			return;
+		}
+
+		while (node)
+		{
+			auto next = node->next;
+			auto list = _task_pool_free_list_of(self, node);
+			node->next = *list;
+			*list = node;
+			node = next;
+		}
+	}
+
+	// carves a new chunk into blocks of the given alignment class and puts them into the class's free list
+	inline static void
+	_task_pool_aligned_chunk_new(Task_Pool* self, size_t class_index)
+	{
+		size_t alignment = size_t(32) << class_index;
+		auto stride = (self->block_size + alignment - 1) & ~(alignment - 1);
+
+		// the meta allocator might ignore the alignment just like clib does, so the chunk is aligned by hand
+		auto chunk = alloc_from(self->meta, stride * TASK_POOL_CHUNK_BLOCKS + alignment - 1, 16);
+		buf_push(self->chunks, chunk);
+		auto begin = (char*)(((uintptr_t)chunk.ptr + alignment - 1) & ~(uintptr_t)(alignment - 1));
+		buf_push(self->aligned_chunks, Task_Pool::Aligned_Chunk{begin, begin + stride * TASK_POOL_CHUNK_BLOCKS, class_index});
+
+		auto& list = self->aligned_free_lists[class_index];
+		for (size_t i = 0; i < TASK_POOL_CHUNK_BLOCKS; ++i)
+		{
+			auto node = (Task_Pool::Node*)(begin + i * stride);
+			node->next = list;
+			list = node;
+		}
+	}
+
+	Block
+	Task_Pool::alloc(size_t size, uint8_t alignment)
+	{
+		atomic_refs.fetch_add(1, std::memory_order_relaxed);
+
+		// big closures are allocated from the meta allocator, it might ignore the alignment just like clib does, so
+		// the block is over allocated and aligned by hand and the meta block is kept right before the closure
+		if (size > block_size)
+		{
+			size_t big_alignment = alignment > 16 ? alignment : 16;
+			auto meta_block = alloc_from(meta, sizeof(Block) + size + big_alignment - 1, 16);
+			auto ptr = ((uintptr_t)meta_block.ptr + sizeof(Block) + big_alignment - 1) & ~(uintptr_t)(big_alignment - 1);
+			::memcpy((char*)ptr - sizeof(Block), &meta_block, sizeof(Block));
+			return Block{ (void*)ptr, size };
+		}
+
+		if (alignment > 16)
+		{
+			size_t class_index = 0;
+			while ((size_t(32) << class_index) < alignment)
+				++class_index;
+
+			auto& list = aligned_free_lists[class_index];
+			if (list == nullptr)
+				_task_pool_take_remote(this);
+			if (list == nullptr)
+				_task_pool_aligned_chunk_new(this, class_index);
+
+			auto node = list;
+			list = node->next;
+			return Block{ node, size };
+		}
+
+		if (free_list == nullptr)
+			_task_pool_take_remote(this);
+
+		if (free_list == nullptr)
+		{
+			auto chunk = alloc_from(meta, block_size * TASK_POOL_CHUNK_BLOCKS, 16);
+			buf_push(chunks, chunk);
+			for (size_t i = 0; i < TASK_POOL_CHUNK_BLOCKS; ++i)
+			{
+				auto node = (Node*)((char*)chunk.ptr + i * block_size);
+				node->next = free_list;
+				free_list = node;
+			}
+		}
+
+		auto node = free_list;
+		free_list = node->next;
+		return Block{ node, size };
+	}
+
+	void
+	Task_Pool::free(Block block)
+	{
+		if (block_is_empty(block))
+			return;
+
+		if (block.size > block_size)
+		{
+			Block meta_block{};
+			::memcpy(&meta_block, (char*)block.ptr - sizeof(Block), sizeof(Block));
+			free_from(meta, meta_block);
+		}
+		else if (LOCAL_TASK_POOL == this)
+		{
+			auto node = (Node*)block.ptr;
+			auto list = _task_pool_free_list_of(this, node);
+			node->next = *list;
+			*list = node;
+		}
+		else
+		{
+			auto node = (Node*)block.ptr;
+			node->next = atomic_remote_free_list.load(std::memory_order_relaxed);
+			while (atomic_remote_free_list.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed) == false)
+				;
+		}
+
+		_task_pool_unref(this);
+	}
 
 	// Worker
 	struct IWorker
@@ -28,13 +416,33 @@ namespace mn
 		Mutex mtx;
 		Cond_Var cv;
 		Fabric fabric;
+		// jobs scheduled into this worker from other threads, it's protected by the worker mutex
 		Ring<Fabric_Task> job_q;
+		// jobs scheduled by the worker itself, idle workers of the same fabric steal from it
+		Job_Deque local_q;
+		// allocates the closures of the tasks scheduled from this worker
+		Task_Pool* task_pool;
 		Thread thread;
+		size_t next_victim;
+		std::atomic<size_t> atomic_job_q_count;
 		std::atomic<FABRIC_TASK_FLAGS> atomic_current_job_flags;
 		std::atomic<uint64_t> atomic_job_start_time_in_ms;
 		std::atomic<uint64_t> atomic_block_start_time_in_ms;
 		std::atomic<STATE> atomic_state;
 		std::atomic<bool> atomic_disable_block_timing;
+		// number of rounds the worker looks for jobs before parking, it grows when spinning finds jobs
+		size_t spin_limit;
+		// set to 1 when the worker has no jobs to do and is about to sleep on it using a futex, producers reset it
+		// to 0 and only then issue a wake syscall
+		std::atomic<int32_t> atomic_parked;
+		// the worker's tmp arena, it's backed by a reserved virtual memory region
+		memory::Arena* tmp;
+		// stats published by the worker after each job, read them using worker_stats
+		std::atomic<size_t> atomic_jobs_count;
+		std::atomic<size_t> atomic_tmp_clear_count;
+		std::atomic<size_t> atomic_tmp_readjust_count;
+		std::atomic<size_t> atomic_tmp_total_mem;
+		std::atomic<size_t> atomic_tmp_highwater_mem;
 	};
 	thread_local Worker LOCAL_WORKER = nullptr;
 
@@ -44,25 +452,317 @@ namespace mn
 		Str name;
 		Str sysmon_name;
 
-		Buf<Worker> workers;
+		// only sysmon changes the workers list (when it replaces blocking workers), the other threads read it
+		// without locks to steal jobs and to wake up parked workers
+		Buf<std::atomic<Worker>> workers;
 		Buf<Worker> sleepy_side_workers;
 		Buf<Worker> ready_side_workers;
+		Buf<Worker> dead_side_workers;
 
 		Mutex mtx;
 		Cond_Var cv;
 		bool is_running;
-		std::atomic<size_t> atomic_available_jobs;
-		size_t next_worker;
+		std::atomic<size_t> atomic_parked_workers;
+		// workers which are looking for jobs before parking, producers don't wake parked workers if someone is spinning
+		std::atomic<size_t> atomic_spinning_workers;
+		// number of threads which are looking into other workers at the moment (stealing, waking, scheduling), workers
+		// and retired deque arrays are only freed when it's zero, because they might still be holding pointers to them
+		std::atomic<size_t> atomic_stealers;
+		std::atomic<size_t> atomic_next_worker;
 		size_t worker_id_generator;
 
 		Thread sysmon;
+
+		// the io reactor and its thread are started lazily on the first io wait, the thread waits on the reactor and
+		// schedules the tasks of the ready handles into the fabric
+		Mutex io_mtx;
+		Reactor io_reactor;
+		Thread io_thread;
+		Str io_thread_name;
+		Map<int64_t, Fabric_Task> io_tasks;
+		std::atomic<bool> atomic_io_running;
 	};
 
+	inline static void
+	_worker_push_jobs(Worker self, const Fabric_Task* ptr, size_t count)
+	{
+		mutex_lock(self->mtx);
+		mn_defer(mutex_unlock(self->mtx));
+
+		ring_reserve(self->job_q, count);
+		for (size_t i = 0; i < count; ++i)
+			ring_push_back(self->job_q, ptr[i]);
+		self->atomic_job_q_count.store(self->job_q.count);
+	}
+
+	// moves jobs from the victim's job queue, the first one is returned and the rest are pushed into the
+	// local deque of the given worker, if the victim is the worker itself it takes a full batch, otherwise it takes half
+	inline static bool
+	_worker_transfer_jobs(Worker self, Worker victim, Fabric_Task& job)
+	{
+		if (victim->atomic_job_q_count.load() == 0)
+			return false;
+
+		size_t count = 0;
+		{
+			mutex_lock(victim->mtx);
+			mn_defer(mutex_unlock(victim->mtx));
+
+			count = victim->job_q.count;
+			if (count == 0)
+				return false;
+
+			if (victim != self)
+				count = (count + 1) / 2;
+			if (count > JOB_TRANSFER_BATCH)
+				count = JOB_TRANSFER_BATCH;
+
+			// push the jobs in reverse so that the owner pops them in the same order they were scheduled
+			job = ring_front(victim->job_q);
+			for (size_t i = count - 1; i > 0; --i)
+				_job_deque_push(self->local_q, victim->job_q[i]);
+			for (size_t i = 0; i < count; ++i)
+				ring_pop_front(victim->job_q);
+			victim->atomic_job_q_count.store(victim->job_q.count);
+		}
+		return true;
+	}
+
+	// unparks the given worker, and returns true if the calling thread is the one which unparked it
+	inline static bool
+	_worker_unpark(Worker self)
+	{
+		int32_t parked = 1;
+		if (self->atomic_parked.compare_exchange_strong(parked, 0) == false)
+			return false;
+
+		if (auto fabric = self->fabric)
+		{
+			// if all the workers were parked then sysmon is sleeping as well, wake it up
+			if (fabric->atomic_parked_workers.fetch_sub(1) >= fabric->workers.count)
+			{
+				mutex_lock(fabric->mtx);
+				cond_var_notify(fabric->cv);
+				mutex_unlock(fabric->mtx);
+			}
+		}
+		return true;
+	}
+
+	inline static bool
+	_worker_wake(Worker self)
+	{
+		if (_worker_unpark(self) == false)
+			return false;
+
+		futex_wake_one(self->atomic_parked);
+		return true;
+	}
+
+	// wakes up to count parked workers, starting with the preferred worker if it's parked
+	inline static void
+	_fabric_wake(Fabric self, Worker preferred, size_t count)
+	{
+		// pairs with the parking worker which announces itself before looking for jobs one last time
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (self->atomic_parked_workers.load() == 0)
+			return;
+
+		// spinning workers will pick up some of the jobs, the one which finds a job wakes up another worker
+		auto spinning = self->atomic_spinning_workers.load();
+		if (count <= spinning)
+			return;
+		count -= spinning;
+
+		self->atomic_stealers.fetch_add(1);
+		mn_defer(self->atomic_stealers.fetch_sub(1));
+
+		if (preferred && preferred->atomic_parked.load() == 1 && _worker_wake(preferred))
+			--count;
+
+		for (size_t i = 0; i < self->workers.count && count > 0; ++i)
+		{
+			auto worker = self->workers[i].load();
+			if (worker && worker->atomic_parked.load() == 1 && _worker_wake(worker))
+				--count;
+		}
+	}
+
+	// schedules jobs from outside of the fabric's workers, by pushing them into one of the workers job queue
+	inline static void
+	_fabric_inject(Fabric self, const Fabric_Task* ptr, size_t count)
+	{
+		self->atomic_stealers.fetch_add(1);
+		mn_defer(self->atomic_stealers.fetch_sub(1));
+
+		auto next_worker = self->atomic_next_worker.fetch_add(1);
+		auto worker = self->workers[next_worker % self->workers.count].load();
+		_worker_push_jobs(worker, ptr, count);
+		_fabric_wake(self, worker, count);
+	}
+
+	inline static bool
+	_worker_steal(Worker self, Fabric_Task& job)
+	{
+		auto fabric = self->fabric;
+
+		fabric->atomic_stealers.fetch_add(1);
+		mn_defer(fabric->atomic_stealers.fetch_sub(1));
+
+		auto workers_count = fabric->workers.count;
+		auto start = self->next_victim++;
+		for (size_t i = 0; i < workers_count; ++i)
+		{
+			// the workers list could be still under construction
+			auto victim = fabric->workers[(start + i) % workers_count].load();
+			if (victim == nullptr || victim == self)
+				continue;
+
+			if (_job_deque_steal(victim->local_q, job))
+				return true;
+
+			if (_worker_transfer_jobs(self, victim, job))
+				return true;
+		}
+		return false;
+	}
+
+	inline static bool
+	_worker_find_job(Worker self, Fabric_Task& job)
+	{
+		if (_job_deque_pop(self->local_q, job))
+			return true;
+
+		if (_worker_transfer_jobs(self, self, job))
+		{
+			// we might have moved a few jobs into our local deque, let a parked worker steal them
+			if (self->fabric && _job_deque_count(self->local_q) > 0)
+				_fabric_wake(self->fabric, nullptr, 1);
+			return true;
+		}
+
+		if (self->fabric && _worker_steal(self, job))
+		{
+			if (_job_deque_count(self->local_q) > 0)
+				_fabric_wake(self->fabric, nullptr, 1);
+			return true;
+		}
+
+		return false;
+	}
+
+	// looks for jobs for a while before parking, spinning workers are cheaper to wake than parked ones because
+	// producers don't issue any syscalls for them, the number of rounds adapts to how often spinning finds jobs
+	inline static bool
+	_worker_spin(Worker self, Fabric_Task& job)
+	{
+		auto fabric = self->fabric;
+		if (fabric)
+			fabric->atomic_spinning_workers.fetch_add(1);
+
+		bool found = false;
+		for (size_t i = 0; i < self->spin_limit && found == false; ++i)
+		{
+			if (i < WORKER_SPIN_PAUSE_ROUNDS)
+				_cpu_relax();
+			else
+				std::this_thread::yield();
+
+			found = _worker_find_job(self, job);
+		}
+
+		if (fabric)
+		{
+			// producers don't wake parked workers while someone is spinning, so the last spinner to find a job
+			// wakes up a replacement in case there are more jobs
+			auto spinning = fabric->atomic_spinning_workers.fetch_sub(1);
+			if (found && spinning == 1)
+				_fabric_wake(fabric, nullptr, 1);
+		}
+
+		if (found)
+		{
+			self->spin_limit *= 2;
+			if (self->spin_limit > WORKER_SPIN_MAX)
+				self->spin_limit = WORKER_SPIN_MAX;
+		}
+		else
+		{
+			self->spin_limit /= 2;
+			if (self->spin_limit < WORKER_SPIN_MIN)
+				self->spin_limit = WORKER_SPIN_MIN;
+		}
+		return found;
+	}
+
+	inline static void
+	_worker_park(Worker self)
+	{
+		while (self->atomic_parked.load() == 1 && self->atomic_state.load() == IWorker::STATE_RUNNING)
+			futex_wait(self->atomic_parked, 1);
+
+		// we might have been woken up because of a state change, in this case we unpark ourselves
+		_worker_unpark(self);
+	}
+
+	// gives the jobs scheduled into a paused worker to the rest of the fabric, so that they don't wait for it
+	inline static void
+	_worker_give_away_jobs(Worker self)
+	{
+		if (self->fabric == nullptr)
+			return;
+
+		auto jobs = buf_with_allocator<Fabric_Task>(memory::tmp());
+		mn_defer(buf_free(jobs));
+
+		Fabric_Task job{};
+		while (_job_deque_pop(self->local_q, job))
+			buf_push(jobs, job);
+
+		{
+			mutex_lock(self->mtx);
+			mn_defer(mutex_unlock(self->mtx));
+
+			while (self->job_q.count > 0)
+			{
+				buf_push(jobs, ring_front(self->job_q));
+				ring_pop_front(self->job_q);
+			}
+			self->atomic_job_q_count.store(0);
+		}
+
+		if (jobs.count > 0)
+			_fabric_inject(self->fabric, jobs.ptr, jobs.count);
+	}
+
+	// frees the deque arrays retired by the worker, when no thief can be reading from them
+	inline static void
+	_worker_reclaim(Worker self)
+	{
+		if (self->local_q.retired_arrays.count == 0)
+			return;
+
+		if (self->fabric == nullptr || self->fabric->atomic_stealers.load() == 0)
+			_job_deque_reclaim(self->local_q);
+	}
+
+	inline static void
+	_worker_publish_stats(Worker self)
+	{
+		self->atomic_jobs_count.fetch_add(1, std::memory_order_relaxed);
+		self->atomic_tmp_clear_count.store(self->tmp->clear_all_count, std::memory_order_relaxed);
+		self->atomic_tmp_readjust_count.store(self->tmp->clear_all_readjust_count, std::memory_order_relaxed);
+		self->atomic_tmp_total_mem.store(self->tmp->total_mem, std::memory_order_relaxed);
+		self->atomic_tmp_highwater_mem.store(self->tmp->highwater_mem, std::memory_order_relaxed);
+	}
+
 	static void
 	_worker_main(void* worker)
 	{
 		auto self = (Worker)worker;
 		LOCAL_WORKER = self;
+		LOCAL_TASK_POOL = self->task_pool;
+		auto old_tmp = _memory_tmp_set(self->tmp);
 
 		if (self->fabric)
 			if (self->fabric->settings.on_worker_start)
@@ -74,47 +774,46 @@ namespace mn
 			if (state == IWorker::STATE_RUNNING)
 			{
 				Fabric_Task job{};
+				if (_worker_find_job(self, job) == false && _worker_spin(self, job) == false)
 				{
-					mutex_lock(self->mtx);
-					mn_defer(mutex_unlock(self->mtx));
+					// announce that we're going to park then look for jobs one last time, this way producers
+					// either see us parked and wake us up, or we see their jobs
+					self->atomic_parked.store(1);
+					if (self->fabric)
+						self->fabric->atomic_parked_workers.fetch_add(1);
 
-					if (self->job_q.count == 0)
+					if (_worker_find_job(self, job))
 					{
-						cond_var_wait(self->cv, self->mtx, [&]{
-							return self->job_q.count > 0 ||
-								self->atomic_state.load() != IWorker::STATE_RUNNING;
-						});
-						state = self->atomic_state.load();
+						_worker_unpark(self);
 					}
-
-					if (state != IWorker::STATE_RUNNING)
+					else
+					{
+						_worker_park(self);
 						continue;
-
-					job = ring_front(self->job_q);
-					ring_pop_front(self->job_q);
+					}
 				}
 
-				if (job.task)
+				self->atomic_job_start_time_in_ms.store(time_in_millis());
+				self->atomic_disable_block_timing = false;
+				self->atomic_current_job_flags.store(job.flags);
+				job.task();
+				self->atomic_disable_block_timing = true;
+				self->atomic_job_start_time_in_ms.store(0);
+				self->atomic_current_job_flags.store(FABRIC_TASK_FLAG_NONE);
+				fabric_task_free(job);
+				self->tmp->clear_all();
+				_worker_publish_stats(self);
+				_worker_reclaim(self);
+				if (self->fabric)
 				{
-					self->atomic_job_start_time_in_ms.store(time_in_millis());
-					self->atomic_disable_block_timing = false;
-					self->atomic_current_job_flags.store(job.flags);
-					job.task();
-					self->atomic_disable_block_timing = true;
-					self->atomic_job_start_time_in_ms.store(0);
-					self->atomic_current_job_flags.store(FABRIC_TASK_FLAG_NONE);
-					fabric_task_free(job);
-					memory::tmp()->clear_all();
-					if (self->fabric)
-					{
-						if (self->fabric->settings.after_each_job)
-							self->fabric->settings.after_each_job();
-						self->fabric->atomic_available_jobs.fetch_sub(1);
-					}
+					if (self->fabric->settings.after_each_job)
+						self->fabric->settings.after_each_job();
 				}
 			}
 			else if (state == IWorker::STATE_PAUSED)
 			{
+				_worker_give_away_jobs(self);
+
 				mutex_lock(self->mtx);
 				mn_defer(mutex_unlock(self->mtx));
 
@@ -138,28 +837,40 @@ namespace mn
 		[[maybe_unused]] auto old_state = self->atomic_state.exchange(IWorker::STATE_STOP_ACKNOWLEDGED);
 		assert(old_state == IWorker::STATE_STOP_REQUEST);
 		LOCAL_WORKER = nullptr;
+		LOCAL_TASK_POOL = nullptr;
+		_memory_tmp_set(old_tmp);
 	}
 
 	inline static void
 	_worker_stop(Worker self)
 	{
-		mutex_lock(self->mtx);
-		mn_defer(mutex_unlock(self->mtx));
+		{
+			mutex_lock(self->mtx);
+			mn_defer(mutex_unlock(self->mtx));
 
-		self->atomic_state = IWorker::STATE_STOP_REQUEST;
-		cond_var_notify(self->cv);
+			self->atomic_state = IWorker::STATE_STOP_REQUEST;
+			cond_var_notify(self->cv);
+		}
+
+		// the worker might be parked on its futex
+		_worker_wake(self);
 	}
 
 	inline static void
 	_worker_pause(Worker self)
 	{
-		mutex_lock(self->mtx);
-		mn_defer(mutex_unlock(self->mtx));
+		{
+			mutex_lock(self->mtx);
+			mn_defer(mutex_unlock(self->mtx));
 
-		assert(self->atomic_state == IWorker::STATE_RUNNING);
+			assert(self->atomic_state == IWorker::STATE_RUNNING);
 
-		self->atomic_state = IWorker::STATE_PAUSED;
-		cond_var_notify(self->cv);
+			self->atomic_state = IWorker::STATE_PAUSED;
+			cond_var_notify(self->cv);
+		}
+
+		// the worker might have finished its job and parked before we paused it
+		_worker_wake(self);
 	}
 
 	inline static void
@@ -183,26 +894,45 @@ namespace mn
 		self->cv = cond_var_new();
 		self->fabric = fabric;
 		self->job_q = stolen_jobs;
+		_job_deque_init(self->local_q);
+		self->task_pool = _task_pool_new(fabric ? fabric->settings.task_spill_size : DEFAULT_TASK_SPILL_SIZE);
+		self->atomic_job_q_count = stolen_jobs.count;
 		self->atomic_state = IWorker::STATE_RUNNING;
 		self->atomic_disable_block_timing = true;
+		self->spin_limit = WORKER_SPIN_MIN;
+		self->atomic_parked = 0;
+		// tmp arenas are cleared after each job, reserving them makes the clear O(1) without returning memory
+		// to the meta allocator, if the reservation fails it works as a normal arena
+		self->tmp = alloc_construct_from<memory::Arena>(memory::clib(), WORKER_TMP_BLOCK_SIZE, memory::clib());
+		self->tmp->reserve_virtual(fabric ? fabric->settings.worker_tmp_reserve_size : DEFAULT_WORKER_TMP_RESERVE_SIZE);
 		self->thread = thread_new(_worker_main, self, self->name.ptr);
 		return self;
 	}
 
 	inline static void
-	_worker_free(Worker self)
+	_worker_join(Worker self)
 	{
 		[[maybe_unused]] auto state = self->atomic_state.load();
 		assert(state == IWorker::STATE_STOP_REQUEST ||
 			   state == IWorker::STATE_STOP_ACKNOWLEDGED);
 
 		thread_join(self->thread);
+	}
+
+	// frees the given worker, it should be joined first
+	inline static void
+	_worker_free(Worker self)
+	{
 		thread_free(self->thread);
 
 		str_free(self->name);
 		mutex_free(self->mtx);
 		cond_var_free(self->cv);
 		destruct(self->job_q);
+		_job_deque_free(self->local_q);
+		// tasks scheduled from this worker might still be alive in other queues, they keep the pool alive
+		_task_pool_unref(self->task_pool);
+		free_destruct_from(memory::clib(), self->tmp);
 
 		free(self);
 	}
@@ -214,44 +944,57 @@ namespace mn
 		size_t index;
 	};
 
-	inline static void
-	_sysmon_detect_blocking_workers(Fabric self, Buf<Blocking_Worker>& blocking_workers)
+	// takes all the jobs scheduled into the given worker, sysmon acts as a thief here because the worker
+	// might still be pushing into its local deque
+	inline static Ring<Fabric_Task>
+	_sysmon_take_jobs(Fabric self, Worker worker)
 	{
-		// detect blocking workers
-		for (size_t i = 0; i < self->workers.count; ++i)
+		Ring<Fabric_Task> job_q{};
 		{
-			auto current_job_flags = self->workers[i]->atomic_current_job_flags.load();
-			auto block_start_time = self->workers[i]->atomic_block_start_time_in_ms.load();
-			if(block_start_time != 0 && current_job_flags == FABRIC_TASK_FLAG_NONE)
-			{
-				auto block_time = time_in_millis() - block_start_time;
-				if(block_time > self->settings.coop_blocking_threshold_in_ms)
-				{
-					buf_push(blocking_workers, Blocking_Worker{ self->workers[i], i });
-				}
-			}
+			mutex_lock(worker->mtx);
+			mn_defer(mutex_unlock(worker->mtx));
+
+			job_q = worker->job_q;
+			worker->job_q = ring_new<Fabric_Task>();
+			worker->atomic_job_q_count.store(0);
 		}
 
-		// if we have some free workers then it's okay, ignore it this is normal
-		// we only care about total system blocking
-		if (blocking_workers.count < self->workers.count * self->settings.blocking_workers_threshold)
-			buf_clear(blocking_workers);
+		self->atomic_stealers.fetch_add(1);
+		mn_defer(self->atomic_stealers.fetch_sub(1));
+
+		Fabric_Task job{};
+		while (_job_deque_count(worker->local_q) > 0)
+			if (_job_deque_steal(worker->local_q, job))
+				ring_push_back(job_q, job);
+
+		return job_q;
+	}
+
+	// takes the jobs out of a worker which isn't part of the workers list and schedules them into the fabric
+	inline static void
+	_sysmon_redistribute_jobs(Fabric self, Worker worker)
+	{
+		if (_job_deque_count(worker->local_q) == 0 && worker->atomic_job_q_count.load() == 0)
+			return;
+
+		auto job_q = _sysmon_take_jobs(self, worker);
+		mn_defer(ring_free(job_q));
 
+		for (size_t i = 0; i < job_q.count; ++i)
+			_fabric_inject(self, &job_q[i], 1);
+	}
+
+	inline static void
+	_sysmon_replace_blocking_workers(Fabric self, Buf<Blocking_Worker>& blocking_workers)
+	{
 		// pause all the blocking workers
 		for (auto blocking_worker: blocking_workers)
 			_worker_pause(blocking_worker.worker);
 
 		// move the blocking workers out
-		for (auto blocking_worker: blocking_workers)
-		{
-			Ring<Fabric_Task> job_q{};
-			{
-				mutex_lock(blocking_worker.worker->mtx);
-				mn_defer(mutex_unlock(blocking_worker.worker->mtx));
-
-				job_q = blocking_worker.worker->job_q;
-				blocking_worker.worker->job_q = ring_new<Fabric_Task>();
-			}
+		for (auto blocking_worker: blocking_workers)
+		{
+			auto job_q = _sysmon_take_jobs(self, blocking_worker.worker);
 
 			{
 				mutex_lock(self->mtx);
@@ -263,10 +1006,17 @@ namespace mn
 					auto new_worker = buf_top(self->ready_side_workers);
 					buf_pop(self->ready_side_workers);
 
-					self->workers[blocking_worker.index] = new_worker;
-					ring_free(new_worker->job_q);
-					new_worker->job_q = job_q;
+					{
+						mutex_lock(new_worker->mtx);
+						mn_defer(mutex_unlock(new_worker->mtx));
 
+						for (size_t i = 0; i < job_q.count; ++i)
+							ring_push_back(new_worker->job_q, job_q[i]);
+						new_worker->atomic_job_q_count.store(new_worker->job_q.count);
+					}
+					ring_free(job_q);
+
+					self->workers[blocking_worker.index] = new_worker;
 					_worker_resume(new_worker);
 				}
 				else
@@ -292,75 +1042,52 @@ namespace mn
 	}
 
 	inline static void
-	_sysmon_detect_long_running_workers(Fabric self, Buf<Blocking_Worker>& blocking_workers)
+	_sysmon_detect_blocking_workers(Fabric self, Buf<Blocking_Worker>& blocking_workers)
 	{
 		// detect blocking workers
 		for (size_t i = 0; i < self->workers.count; ++i)
 		{
-			auto current_job_flags = self->workers[i]->atomic_current_job_flags.load();
-			auto job_start_time = self->workers[i]->atomic_job_start_time_in_ms.load();
-			if (job_start_time != 0 && current_job_flags == FABRIC_TASK_FLAG_NONE)
+			auto worker = self->workers[i].load();
+			auto current_job_flags = worker->atomic_current_job_flags.load();
+			auto block_start_time = worker->atomic_block_start_time_in_ms.load();
+			if(block_start_time != 0 && current_job_flags == FABRIC_TASK_FLAG_NONE)
 			{
-				auto job_run_time = time_in_millis() - job_start_time;
-				if(job_run_time > self->settings.external_blocking_threshold_in_ms)
+				auto block_time = time_in_millis() - block_start_time;
+				if(block_time > self->settings.coop_blocking_threshold_in_ms)
 				{
-					buf_push(blocking_workers, Blocking_Worker{ self->workers[i], i });
+					buf_push(blocking_workers, Blocking_Worker{ worker, i });
 				}
 			}
 		}
 
-		// pause all the blocking workers
-		for (auto blocking_worker: blocking_workers)
-			_worker_pause(blocking_worker.worker);
-
-		// move the blocking workers out
-		for (auto blocking_worker: blocking_workers)
-		{
-			Ring<Fabric_Task> job_q{};
-			{
-				mutex_lock(blocking_worker.worker->mtx);
-				mn_defer(mutex_unlock(blocking_worker.worker->mtx));
+		// if we have some free workers then it's okay, ignore it this is normal
+		// we only care about total system blocking
+		if (blocking_workers.count < self->workers.count * self->settings.blocking_workers_threshold)
+			buf_clear(blocking_workers);
 
-				job_q = blocking_worker.worker->job_q;
-				blocking_worker.worker->job_q = ring_new<Fabric_Task>();
-			}
+		_sysmon_replace_blocking_workers(self, blocking_workers);
+	}
 
+	inline static void
+	_sysmon_detect_long_running_workers(Fabric self, Buf<Blocking_Worker>& blocking_workers)
+	{
+		// detect blocking workers
+		for (size_t i = 0; i < self->workers.count; ++i)
+		{
+			auto worker = self->workers[i].load();
+			auto current_job_flags = worker->atomic_current_job_flags.load();
+			auto job_start_time = worker->atomic_job_start_time_in_ms.load();
+			if (job_start_time != 0 && current_job_flags == FABRIC_TASK_FLAG_NONE)
 			{
-				mutex_lock(self->mtx);
-				mn_defer(mutex_unlock(self->mtx));
-
-				// find a suitable worker
-				if (self->ready_side_workers.count > 0)
-				{
-					auto new_worker = buf_top(self->ready_side_workers);
-					buf_pop(self->ready_side_workers);
-
-					self->workers[blocking_worker.index] = new_worker;
-					ring_free(new_worker->job_q);
-					new_worker->job_q = job_q;
-
-					_worker_resume(new_worker);
-				}
-				else
+				auto job_run_time = time_in_millis() - job_start_time;
+				if(job_run_time > self->settings.external_blocking_threshold_in_ms)
 				{
-					auto new_worker = _worker_new(
-						strf("{} worker #{}", self->name, self->worker_id_generator++),
-						self,
-						job_q
-					);
-
-					self->workers[blocking_worker.index] = new_worker;
+					buf_push(blocking_workers, Blocking_Worker{ worker, i });
 				}
 			}
 		}
 
-		// now that we have replaced all the blocking workers with a newly created workers
-		// we need to store the blocking workers away to be reused later in the replacement above
-		for (auto blocking_worker: blocking_workers)
-			buf_push(self->sleepy_side_workers, blocking_worker.worker);
-
-		// clear the blocking workers list
-		buf_clear(blocking_workers);
+		_sysmon_replace_blocking_workers(self, blocking_workers);
 	}
 
 	static void
@@ -378,12 +1105,6 @@ namespace mn
 		auto long_running_workers = buf_with_capacity<Blocking_Worker>(self->workers.count);
 		mn_defer(buf_free(long_running_workers));
 
-		auto dead_workers = buf_with_capacity<Worker>(self->workers.count);
-		mn_defer(destruct(dead_workers));
-
-		auto tmp_jobs = buf_new<Fabric_Task>();
-		mn_defer(destruct(tmp_jobs));
-
 		auto timeslice = self->settings.coop_blocking_threshold_in_ms;
 		if (timeslice > self->settings.external_blocking_threshold_in_ms)
 			timeslice = self->settings.external_blocking_threshold_in_ms;
@@ -394,17 +1115,22 @@ namespace mn
 
 		while(true)
 		{
-			// dispose of dead workers before holding the mutex
-			buf_remove_if(dead_workers, [](Worker worker){
-				auto state = worker->atomic_state.load();
+			// dispose of dead workers before holding the mutex, other threads might still hold pointers to
+			// them while they're stealing so we only free them when no one is stealing
+			if (self->atomic_stealers.load() == 0)
+			{
+				buf_remove_if(self->dead_side_workers, [](Worker worker){
+					auto state = worker->atomic_state.load();
 
-				if (state == IWorker::STATE_STOP_REQUEST)
-					return false;
+					if (state == IWorker::STATE_STOP_REQUEST)
+						return false;
 
-				assert(state == IWorker::STATE_STOP_ACKNOWLEDGED);
-				_worker_free(worker);
-				return true;
-			});
+					assert(state == IWorker::STATE_STOP_ACKNOWLEDGED);
+					_worker_join(worker);
+					_worker_free(worker);
+					return true;
+				});
+			}
 
 			bool slept_on_cond_var = false;
 
@@ -412,12 +1138,13 @@ namespace mn
 				mutex_lock(self->mtx);
 				mn_defer(mutex_unlock(self->mtx));
 
-				if (self->atomic_available_jobs.load() == 0 &&
+				// all the workers are parked so there's nothing to monitor
+				if (self->atomic_parked_workers.load() >= self->workers.count &&
 					self->sleepy_side_workers.count == 0)
 				{
 					slept_on_cond_var = true;
 					cond_var_wait(self->cv, self->mtx, [&]{
-						return self->atomic_available_jobs.load() > 0 ||
+						return self->atomic_parked_workers.load() < self->workers.count ||
 							self->is_running == false ||
 							self->sleepy_side_workers.count > 0;
 					});
@@ -431,71 +1158,9 @@ namespace mn
 			if (slept_on_cond_var == false)
 				thread_sleep(timeslice);
 
-			// get the max/min jobs
-			size_t busiest_worker = 0;
-			size_t max_jobs = 0;
-			size_t idle_worker = SIZE_MAX;
-			size_t min_jobs = SIZE_MAX;
-			for (size_t i = 0; i < self->workers.count; ++i)
-			{
-				auto worker = self->workers[i];
-
-				mutex_lock(worker->mtx);
-				mn_defer(mutex_unlock(worker->mtx));
-
-				if (worker->job_q.count > max_jobs)
-				{
-					busiest_worker = i;
-					max_jobs = worker->job_q.count;
-				}
-
-				if (worker->atomic_job_start_time_in_ms.load() == 0 && worker->job_q.count < min_jobs)
-				{
-					idle_worker = i;
-					min_jobs = worker->job_q.count;
-				}
-			}
-
-			// steal from the max jobs and give to min jobs, if we have a worker that's idle
-			if (idle_worker < self->workers.count && max_jobs > min_jobs && min_jobs == 0)
-			{
-				{
-					auto max_worker = self->workers[busiest_worker];
-
-					mutex_lock(max_worker->mtx);
-					mn_defer(mutex_unlock(max_worker->mtx));
-
-					max_jobs = max_worker->job_q.count;
-					size_t job_steal_count = max_jobs;
-					if (job_steal_count > 1)
-						job_steal_count /= 2;
-
-					for (size_t i = 0; i < job_steal_count; ++i)
-					{
-						auto job = ring_back(max_worker->job_q);
-						ring_pop_back(max_worker->job_q);
-
-						buf_push(tmp_jobs, job);
-					}
-				}
-
-				{
-					auto min_worker = self->workers[idle_worker];
-
-					mutex_lock(min_worker->mtx);
-					mn_defer(mutex_unlock(min_worker->mtx));
-
-					for (auto job: tmp_jobs)
-						ring_push_back(min_worker->job_q, job);
-					buf_clear(tmp_jobs);
-
-					cond_var_notify(min_worker->cv);
-				}
-			}
-
 			// check if any sleepy worker is ready and move it either to the ready workers list
 			// or free it because we don't really need it
-			buf_remove_if(self->sleepy_side_workers, [self, &dead_workers](Worker worker) {
+			buf_remove_if(self->sleepy_side_workers, [self](Worker worker) {
 				if (worker->atomic_job_start_time_in_ms.load() == 0)
 				{
 					if (self->ready_side_workers.count < self->settings.put_aside_worker_count)
@@ -505,13 +1170,20 @@ namespace mn
 					else
 					{
 						_worker_stop(worker);
-						buf_push(dead_workers, worker);
+						buf_push(self->dead_side_workers, worker);
 					}
 					return true;
 				}
+
+				// the sleepy worker is still blocking, so give away any job it scheduled in the meantime
+				_sysmon_redistribute_jobs(self, worker);
 				return false;
 			});
 
+			// jobs could be scheduled into a worker just as it was being replaced, so we give them away
+			for (auto worker: self->ready_side_workers)
+				_sysmon_redistribute_jobs(self, worker);
+
 			_sysmon_detect_blocking_workers(self, blocking_workers);
 			_sysmon_detect_long_running_workers(self, long_running_workers);
 		}
@@ -529,29 +1201,58 @@ namespace mn
 	worker_free(Worker self)
 	{
 		_worker_stop(self);
+		_worker_join(self);
 		_worker_free(self);
 	}
 
 	void
 	worker_task_do(Worker self, const Fabric_Task& task)
 	{
-		mutex_lock(self->mtx);
-		mn_defer(mutex_unlock(self->mtx));
-
-		ring_push_back(self->job_q, task);
-		cond_var_notify(self->cv);
+		worker_task_batch_do(self, &task, 1);
 	}
 
 	void
 	worker_task_batch_do(Worker self, const Fabric_Task* ptr, size_t count)
 	{
-		mutex_lock(self->mtx);
-		mn_defer(mutex_unlock(self->mtx));
+		if (self == LOCAL_WORKER && self->atomic_state.load() == IWorker::STATE_RUNNING)
+		{
+			for (size_t i = 0; i < count; ++i)
+				_job_deque_push(self->local_q, ptr[i]);
+			if (self->fabric)
+				_fabric_wake(self->fabric, nullptr, count);
+			return;
+		}
 
-		ring_reserve(self->job_q, count);
-		for (size_t i = 0; i < count; ++i)
-			ring_push_back(self->job_q, ptr[i]);
-		cond_var_notify(self->cv);
+		_worker_push_jobs(self, ptr, count);
+		if (self->fabric)
+		{
+			_fabric_wake(self->fabric, self, count);
+		}
+		else
+		{
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			_worker_wake(self);
+		}
+	}
+
+	Allocator
+	worker_task_allocator()
+	{
+		if (LOCAL_TASK_POOL)
+			return LOCAL_TASK_POOL;
+		return allocator_top();
+	}
+
+	Worker_Stats
+	worker_stats(Worker self)
+	{
+		Worker_Stats res{};
+		res.jobs_count = self->atomic_jobs_count.load(std::memory_order_relaxed);
+		res.tmp_clear_count = self->atomic_tmp_clear_count.load(std::memory_order_relaxed);
+		res.tmp_readjust_count = self->atomic_tmp_readjust_count.load(std::memory_order_relaxed);
+		res.tmp_total_mem = self->atomic_tmp_total_mem.load(std::memory_order_relaxed);
+		res.tmp_highwater_mem = self->atomic_tmp_highwater_mem.load(std::memory_order_relaxed);
+		return res;
 	}
 
 	Worker
@@ -585,6 +1286,42 @@ namespace mn
 	}
 
 
+	// io reactor thread, it moves the tasks of the ready handles into the fabric in batches
+	inline static void
+	_fabric_io_main(void* fabric)
+	{
+		auto self = (Fabric)fabric;
+
+		constexpr size_t EVENTS_COUNT = 256;
+		Reactor_Event events[EVENTS_COUNT];
+		auto ready_tasks = buf_new<Fabric_Task>();
+		mn_defer(buf_free(ready_tasks));
+
+		while (self->atomic_io_running.load())
+		{
+			auto count = reactor_wait(self->io_reactor, events, EVENTS_COUNT, INFINITE_TIMEOUT);
+
+			buf_clear(ready_tasks);
+			{
+				mutex_lock(self->io_mtx);
+				mn_defer(mutex_unlock(self->io_mtx));
+
+				// the handle might have been cancelled or reported spuriously, in which case it has no task
+				for (size_t i = 0; i < count; ++i)
+				{
+					if (auto it = map_lookup(self->io_tasks, events[i].handle))
+					{
+						buf_push(ready_tasks, it->value);
+						map_remove(self->io_tasks, events[i].handle);
+					}
+				}
+			}
+
+			if (ready_tasks.count > 0)
+				fabric_task_batch_do(self, ready_tasks.ptr, ready_tasks.count);
+		}
+	}
+
 	// fabric
 	Fabric
 	fabric_new(Fabric_Settings settings)
@@ -602,22 +1339,32 @@ namespace mn
 			settings.put_aside_worker_count = settings.workers_count / 2;
 		if (settings.blocking_workers_threshold == 0.0f)
 			settings.blocking_workers_threshold = 0.5f;
+		if (settings.task_spill_size == 0)
+			settings.task_spill_size = DEFAULT_TASK_SPILL_SIZE;
+		if (settings.worker_tmp_reserve_size == 0)
+			settings.worker_tmp_reserve_size = DEFAULT_WORKER_TMP_RESERVE_SIZE;
 
 
 		auto self = alloc_zerod<IFabric>();
 		self->settings = settings;
 		self->name = strf("{}", settings.name);
 		self->sysmon_name = strf("{} sysmon thread", settings.name);
-		self->workers = buf_with_count<Worker>(self->settings.workers_count);
+		self->workers = buf_with_count<std::atomic<Worker>>(self->settings.workers_count);
 		self->sleepy_side_workers = buf_new<Worker>();
 		self->ready_side_workers = buf_new<Worker>();
+		self->dead_side_workers = buf_new<Worker>();
 		self->mtx = mn_mutex_new_with_srcloc(self->name.ptr);
 		self->cv = cond_var_new();
 		self->is_running = true;
-		self->atomic_available_jobs = 0;
-		self->next_worker = 0;
+		self->atomic_parked_workers = 0;
+		self->atomic_spinning_workers = 0;
+		self->atomic_stealers = 0;
+		self->atomic_next_worker = 0;
 		self->worker_id_generator = 0;
 
+		// workers start stealing as soon as they're created, so they should see empty slots for the rest of them
+		for (size_t i = 0; i < self->workers.count; ++i)
+			self->workers[i] = nullptr;
 		for (size_t i = 0; i < self->workers.count; ++i)
 		{
 			self->workers[i] = _worker_new(
@@ -628,12 +1375,29 @@ namespace mn
 
 		self->sysmon = thread_new(_sysmon_main, self, self->sysmon_name.ptr);
 
+		self->io_mtx = mutex_new("fabric io mutex");
+		self->io_thread_name = strf("{} io thread", settings.name);
+		self->io_tasks = map_new<int64_t, Fabric_Task>();
+
 		return self;
 	}
 
 	void
 	fabric_free(Fabric self)
 	{
+		// stop the io thread first so it doesn't schedule tasks into stopped workers
+		if (self->io_reactor)
+		{
+			self->atomic_io_running.store(false);
+			reactor_wake(self->io_reactor);
+			thread_join(self->io_thread);
+			thread_free(self->io_thread);
+			reactor_free(self->io_reactor);
+		}
+		destruct(self->io_tasks);
+		str_free(self->io_thread_name);
+		mutex_free(self->io_mtx);
+
 		{
 			mutex_lock(self->mtx);
 			mn_defer(mutex_unlock(self->mtx));
@@ -645,7 +1409,7 @@ namespace mn
 		thread_join(self->sysmon);
 		thread_free(self->sysmon);
 
-		for (auto worker : self->workers)
+		for (Worker worker : self->workers)
 			_worker_stop(worker);
 
 		for (auto worker : self->sleepy_side_workers)
@@ -654,7 +1418,17 @@ namespace mn
 		for (auto worker : self->ready_side_workers)
 			_worker_stop(worker);
 
-		for (auto worker : self->workers)
+		// workers might steal from each other until they stop, so we join all of them before freeing any
+		for (Worker worker : self->workers)
+			_worker_join(worker);
+		for (auto worker : self->sleepy_side_workers)
+			_worker_join(worker);
+		for (auto worker : self->ready_side_workers)
+			_worker_join(worker);
+		for (auto worker : self->dead_side_workers)
+			_worker_join(worker);
+
+		for (Worker worker : self->workers)
 			_worker_free(worker);
 		buf_free(self->workers);
 
@@ -666,6 +1440,10 @@ namespace mn
 			_worker_free(worker);
 		buf_free(self->ready_side_workers);
 
+		for (auto worker : self->dead_side_workers)
+			_worker_free(worker);
+		buf_free(self->dead_side_workers);
+
 		cond_var_free(self->cv);
 		mutex_free(self->mtx);
 		str_free(self->name);
@@ -678,33 +1456,24 @@ namespace mn
 	void
 	fabric_task_do(Fabric self, const Fabric_Task& task)
 	{
-		mutex_lock(self->mtx);
-		mn_defer(mutex_unlock(self->mtx));
-
-		auto next_worker = self->next_worker++;
-		next_worker %= self->workers.count;
-
-		auto worker = self->workers[next_worker];
-		worker_task_do(worker, task);
-
-		self->atomic_available_jobs.fetch_add(1);
-		cond_var_notify(self->cv);
+		fabric_task_batch_do(self, &task, 1);
 	}
 
 	void
 	fabric_task_batch_do(Fabric self, const Fabric_Task* ptr, size_t count)
 	{
-		mutex_lock(self->mtx);
-		mn_defer(mutex_unlock(self->mtx));
-
-		auto next_worker = self->next_worker++;
-		next_worker %= self->workers.count;
-
-		auto worker = self->workers[next_worker];
-		worker_task_batch_do(worker, ptr, count);
-
-		self->atomic_available_jobs.fetch_add(count);
-		cond_var_notify(self->cv);
+		// jobs scheduled from one of the fabric's workers go into its local deque where idle workers can steal them
+		auto worker = LOCAL_WORKER;
+		if (worker && worker->fabric == self && worker->atomic_state.load() == IWorker::STATE_RUNNING)
+		{
+			for (size_t i = 0; i < count; ++i)
+				_job_deque_push(worker->local_q, ptr[i]);
+			_fabric_wake(self, nullptr, count);
+		}
+		else
+		{
+			_fabric_inject(self, ptr, count);
+		}
 	}
 
 	Fabric
@@ -716,146 +1485,254 @@ namespace mn
 		return res;
 	}
 
+	bool
+	fabric_io_task_do(Fabric self, int64_t handle, int events, const Fabric_Task& task)
+	{
+		Reactor reactor = nullptr;
+		{
+			mutex_lock(self->io_mtx);
+			mn_defer(mutex_unlock(self->io_mtx));
+
+			if (self->io_reactor == nullptr)
+			{
+				self->io_reactor = reactor_new();
+				if (self->io_reactor == nullptr)
+				{
+					auto failed_task = task;
+					fabric_task_free(failed_task);
+					return false;
+				}
+				self->atomic_io_running.store(true);
+				self->io_thread = thread_new(_fabric_io_main, self, self->io_thread_name.ptr);
+			}
+			reactor = self->io_reactor;
+
+			// a new wait on the same handle replaces the old one
+			if (auto it = map_lookup(self->io_tasks, handle))
+				fabric_task_free(it->value);
+			map_insert(self->io_tasks, handle, task);
+		}
+
+		if (reactor_arm(reactor, handle, events))
+			return true;
+
+		mutex_lock(self->io_mtx);
+		mn_defer(mutex_unlock(self->io_mtx));
+		if (auto it = map_lookup(self->io_tasks, handle))
+		{
+			fabric_task_free(it->value);
+			map_remove(self->io_tasks, handle);
+		}
+		return false;
+	}
+
 	void
-	_multi_threaded_compute(Fabric self, Compute_Dims global, Compute_Dims local, Task<void(Compute_Args)> fn)
+	fabric_io_cancel(Fabric self, int64_t handle)
+	{
+		mutex_lock(self->io_mtx);
+		mn_defer(mutex_unlock(self->io_mtx));
+
+		if (self->io_reactor == nullptr)
+			return;
+
+		reactor_remove(self->io_reactor, handle);
+		if (auto it = map_lookup(self->io_tasks, handle))
+		{
+			fabric_task_free(it->value);
+			map_remove(self->io_tasks, handle);
+		}
+	}
+
+	// Compute
+	// shared state of a range dispatch, it lives on the dispatching thread's stack until all the ranges finish
+	struct Range_Dispatch
+	{
+		Fabric fabric;
+		Task<void(size_t, size_t)> fn;
+		Waitgroup wg;
+		// number of indices which take about COMPUTE_CHUNK_TARGET_NS to process, it's tuned as ranges execute
+		std::atomic<size_t> atomic_chunk_size;
+	};
+
+	inline static bool
+	_fabric_has_idle_workers(Fabric self)
+	{
+		return self->atomic_spinning_workers.load(std::memory_order_relaxed) > 0 ||
+			self->atomic_parked_workers.load(std::memory_order_relaxed) > 0;
+	}
+
+	static void
+	_range_dispatch_spawn(Range_Dispatch* self, size_t begin, size_t end);
+
+	// processes the given range in chunks, and splits off the back half of the range whenever there are idle
+	// workers which could steal it, in the style of tbb's auto partitioner
+	static void
+	_range_dispatch_run(Range_Dispatch* self, size_t begin, size_t end)
+	{
+		auto chunk_size = self->atomic_chunk_size.load(std::memory_order_relaxed);
+		while (begin < end)
+		{
+			if (end - begin >= 2 * chunk_size && _fabric_has_idle_workers(self->fabric))
+			{
+				auto mid = begin + (end - begin) / 2;
+				_range_dispatch_spawn(self, mid, end);
+				end = mid;
+			}
+
+			auto chunk_end = end - begin > chunk_size ? begin + chunk_size : end;
+			auto start_time = std::chrono::steady_clock::now();
+			self->fn(begin, chunk_end);
+			auto end_time = std::chrono::steady_clock::now();
+
+			// aim for chunks which take COMPUTE_CHUNK_TARGET_NS based on the measured cost of each index
+			uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count();
+			uint64_t cost = elapsed / (chunk_end - begin);
+			if (cost == 0)
+				cost = 1;
+			chunk_size = COMPUTE_CHUNK_TARGET_NS / cost;
+			if (chunk_size == 0)
+				chunk_size = 1;
+			self->atomic_chunk_size.store(chunk_size, std::memory_order_relaxed);
+
+			begin = chunk_end;
+		}
+	}
+
+	static void
+	_range_dispatch_spawn(Range_Dispatch* self, size_t begin, size_t end)
 	{
-		auto batch = buf_with_allocator<Fabric_Task>(memory::tmp());
+		waitgroup_add(self->wg, 1);
+
+		Fabric_Task entry{};
+		entry.task = Task<void()>::make([self, begin, end]{
+			_range_dispatch_run(self, begin, end);
+			waitgroup_done(self->wg);
+		});
+		entry.flags = FABRIC_TASK_FLAG_COMPUTE;
+		fabric_task_do(self->fabric, entry);
+	}
 
+	void
+	_multi_threaded_range(Fabric self, size_t count, Task<void(size_t, size_t)> fn)
+	{
 		Auto_Waitgroup wg;
-		for (size_t z = 0; z < global.z; ++z)
+
+		Range_Dispatch dispatch{};
+		dispatch.fabric = self;
+		dispatch.fn = fn;
+		dispatch.wg = wg.handle;
+		dispatch.atomic_chunk_size = 1;
+
+		// a single range per worker, they get subdivided later if some workers finish early
+		auto ranges_count = self->workers.count < count ? self->workers.count : count;
+		size_t begin = 0;
+		for (size_t i = 0; i < ranges_count; ++i)
 		{
-			for (size_t y = 0; y < global.y; ++y)
+			auto end = begin + count / ranges_count + (i < count % ranges_count ? 1 : 0);
+			_range_dispatch_spawn(&dispatch, begin, end);
+			begin = end;
+		}
+
+		wg.wait();
+		task_free(fn);
+	}
+
+	void
+	_multi_threaded_compute(Fabric self, Compute_Dims global, Compute_Dims local, Task<void(Compute_Args)> fn)
+	{
+		auto range_fn = [&](size_t begin, size_t end) {
+			auto workgroup_id = _compute_dims_from_index(global, begin);
+			for (size_t i = begin; i < end; ++i, _compute_dims_next(global, workgroup_id))
 			{
-				for (size_t x = 0; x < global.x; ++x)
+				for (size_t z = 0; z < local.z; ++z)
 				{
-					Fabric_Task entry{};
-					entry.task = Task<void()>::make([global_x = x, global_y = y, global_z = z, global, local, &wg, &fn]
+					for (size_t y = 0; y < local.y; ++y)
 					{
-						for (size_t z = 0; z < local.z; ++z)
+						for (size_t x = 0; x < local.x; ++x)
 						{
-							for (size_t y = 0; y < local.y; ++y)
-							{
-								for (size_t x = 0; x < local.x; ++x)
-								{
-									Compute_Args args;
-									args.workgroup_size = local;
-									args.workgroup_num = global;
-									args.workgroup_id = Compute_Dims{ global_x, global_y, global_z };
-									args.local_invocation_id = Compute_Dims{ x, y, z };
-									// workgroup_id * workgroup_size + local_invocation_id
-									args.global_invocation_id = Compute_Dims{
-										global_x * local.x + x,
-										global_y * local.y + y,
-										global_z * local.z + z,
-									};
-									fn(args);
-									memory::tmp()->clear_all();
-								}
-							}
+							Compute_Args args;
+							args.workgroup_size = local;
+							args.workgroup_num = global;
+							args.workgroup_id = workgroup_id;
+							args.local_invocation_id = Compute_Dims{ x, y, z };
+							// workgroup_id * workgroup_size + local_invocation_id
+							args.global_invocation_id = Compute_Dims{
+								workgroup_id.x * local.x + x,
+								workgroup_id.y * local.y + y,
+								workgroup_id.z * local.z + z,
+							};
+							fn(args);
+							memory::tmp()->clear_all();
 						}
-						wg.done();
-					});
-					entry.flags = FABRIC_TASK_FLAG_COMPUTE;
-					buf_push(batch, entry);
+					}
 				}
 			}
-		}
+		};
 
-		wg.add((int)batch.count);
-		fabric_task_batch_do(self, batch.ptr, batch.count);
-		wg.wait();
+		_multi_threaded_range(self, global.x * global.y * global.z, Task<void(size_t, size_t)>::make(range_fn));
 		task_free(fn);
 	}
 
 	void
 	_multi_threaded_compute_sized(Fabric self, Compute_Dims global, Compute_Dims size, Compute_Dims local, Task<void(Compute_Args)> fn)
 	{
-		auto batch = buf_with_allocator<Fabric_Task>(memory::tmp());
-
-		Auto_Waitgroup wg;
-		for (size_t z = 0; z < global.z; ++z)
-		{
-			for (size_t y = 0; y < global.y; ++y)
+		auto range_fn = [&](size_t begin, size_t end) {
+			auto workgroup_id = _compute_dims_from_index(global, begin);
+			for (size_t i = begin; i < end; ++i, _compute_dims_next(global, workgroup_id))
 			{
-				for (size_t x = 0; x < global.x; ++x)
+				for (size_t z = 0; z < local.z; ++z)
 				{
-					Fabric_Task entry{};
-					entry.task = Task<void()>::make([global_x = x, global_y = y, global_z = z, global, size, local, &wg, &fn]
+					for (size_t y = 0; y < local.y; ++y)
 					{
-						for (size_t z = 0; z < local.z; ++z)
+						for (size_t x = 0; x < local.x; ++x)
 						{
-							for (size_t y = 0; y < local.y; ++y)
-							{
-								for (size_t x = 0; x < local.x; ++x)
-								{
-									Compute_Args args;
-									args.workgroup_size = local;
-									args.workgroup_num = global;
-									args.workgroup_id = Compute_Dims{ global_x, global_y, global_z };
-									args.local_invocation_id = Compute_Dims{ x, y, z };
-									// workgroup_id * workgroup_size + local_invocation_id
-									args.global_invocation_id = Compute_Dims{
-										global_x * local.x + x,
-										global_y * local.y + y,
-										global_z * local.z + z,
-									};
-									if (args.global_invocation_id.x >= size.x || args.global_invocation_id.y >= size.y || args.global_invocation_id.z >= size.z)
-										continue;
-									fn(args);
-									memory::tmp()->clear_all();
-								}
-							}
+							Compute_Args args;
+							args.workgroup_size = local;
+							args.workgroup_num = global;
+							args.workgroup_id = workgroup_id;
+							args.local_invocation_id = Compute_Dims{ x, y, z };
+							// workgroup_id * workgroup_size + local_invocation_id
+							args.global_invocation_id = Compute_Dims{
+								workgroup_id.x * local.x + x,
+								workgroup_id.y * local.y + y,
+								workgroup_id.z * local.z + z,
+							};
+							if (args.global_invocation_id.x >= size.x || args.global_invocation_id.y >= size.y || args.global_invocation_id.z >= size.z)
+								continue;
+							fn(args);
+							memory::tmp()->clear_all();
 						}
-						wg.done();
-					});
-					entry.flags = FABRIC_TASK_FLAG_COMPUTE;
-					buf_push(batch, entry);
+					}
 				}
 			}
-		}
+		};
 
-		wg.add((int)batch.count);
-		fabric_task_batch_do(self, batch.ptr, batch.count);
-		wg.wait();
+		_multi_threaded_range(self, global.x * global.y * global.z, Task<void(size_t, size_t)>::make(range_fn));
 		task_free(fn);
 	}
 
 	void
 	_multi_threaded_compute_tiled(Fabric self, Compute_Dims total_size, Compute_Dims tile_size, Task<void(Compute_Args)> fn)
 	{
-		auto batch = buf_with_allocator<Fabric_Task>(memory::tmp());
-
-		Auto_Waitgroup wg;
-		for (size_t global_z = 0; global_z < total_size.z; ++global_z)
-		{
-			for (size_t global_y = 0; global_y < total_size.y; ++global_y)
+		auto range_fn = [&](size_t begin, size_t end) {
+			auto workgroup_id = _compute_dims_from_index(total_size, begin);
+			for (size_t i = begin; i < end; ++i, _compute_dims_next(total_size, workgroup_id))
 			{
-				for (size_t global_x = 0; global_x < total_size.x; ++global_x)
-				{
-					Fabric_Task entry{};
-					entry.task = Task<void()>::make([global_x, global_y, global_z, total_size, tile_size, &wg, &fn] {
-						Compute_Args args{};
-						args.workgroup_size = tile_size;
-						args.workgroup_num = total_size;
-						args.workgroup_id = Compute_Dims{ global_x, global_y, global_z };
-						// workgroup_id * workgroup_size + local_invocation_id
-						args.global_invocation_id = Compute_Dims{
-							global_x * tile_size.x,
-							global_y * tile_size.y,
-							global_z * tile_size.z
-						};
-						fn(args);
-						wg.done();
-					});
-					entry.flags = FABRIC_TASK_FLAG_COMPUTE;
-					buf_push(batch, entry);
-				}
+				Compute_Args args{};
+				args.workgroup_size = tile_size;
+				args.workgroup_num = total_size;
+				args.workgroup_id = workgroup_id;
+				// workgroup_id * workgroup_size + local_invocation_id
+				args.global_invocation_id = Compute_Dims{
+					workgroup_id.x * tile_size.x,
+					workgroup_id.y * tile_size.y,
+					workgroup_id.z * tile_size.z
+				};
+				fn(args);
 			}
-		}
+		};
 
-		wg.add((int)batch.count);
-		fabric_task_batch_do(self, batch.ptr, batch.count);
-		wg.wait();
+		_multi_threaded_range(self, total_size.x * total_size.y * total_size.z, Task<void(size_t, size_t)>::make(range_fn));
 		task_free(fn);
 	}
 
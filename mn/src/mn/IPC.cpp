@@ -0,0 +1,140 @@
+#include "mn/IPC.h"
+#include "mn/Memory.h"
+#include "mn/Buf.h"
+
+namespace mn::ipc
+{
+	struct ISputnik_Channel
+	{
+		Sputnik sputnik;
+		size_t buffer_size;
+		// queued messages, each one is {len: 8 bytes, the message}
+		Buf<uint8_t> write_buffer;
+		// read bytes which weren't consumed yet are in the range [read_begin, read_buffer.count)
+		Buf<uint8_t> read_buffer;
+		size_t read_begin;
+	};
+
+	// parses the complete messages in the read buffer, and returns their count
+	inline static size_t
+	_sputnik_channel_parse(Sputnik_Channel self, Buf<Block>& messages)
+	{
+		size_t res = 0;
+		while (self->read_buffer.count - self->read_begin >= sizeof(uint64_t))
+		{
+			uint64_t len = 0;
+			::memcpy(&len, self->read_buffer.ptr + self->read_begin, sizeof(len));
+			if (self->read_buffer.count - self->read_begin - sizeof(len) < len)
+				break;
+
+			buf_push(messages, Block{self->read_buffer.ptr + self->read_begin + sizeof(len), size_t(len)});
+			self->read_begin += sizeof(len) + len;
+			++res;
+		}
+		return res;
+	}
+
+	// API
+	Sputnik_Channel
+	sputnik_channel_new(Sputnik sputnik, size_t buffer_size)
+	{
+		if (buffer_size < 4 * sizeof(uint64_t))
+			buffer_size = 4 * sizeof(uint64_t);
+
+		auto self = alloc_zerod<ISputnik_Channel>();
+		self->sputnik = sputnik;
+		self->buffer_size = buffer_size;
+		self->write_buffer = buf_new<uint8_t>();
+		buf_reserve(self->write_buffer, buffer_size);
+		self->read_buffer = buf_new<uint8_t>();
+		buf_reserve(self->read_buffer, buffer_size);
+		return self;
+	}
+
+	void
+	sputnik_channel_free(Sputnik_Channel self)
+	{
+		sputnik_channel_flush(self);
+		buf_free(self->write_buffer);
+		buf_free(self->read_buffer);
+		free(self);
+	}
+
+	bool
+	sputnik_channel_msg_write(Sputnik_Channel self, Block data)
+	{
+		uint64_t len = data.size;
+		if (self->write_buffer.count + sizeof(len) + data.size <= self->buffer_size)
+		{
+			buf_concat(self->write_buffer, (uint8_t*)&len, (uint8_t*)&len + sizeof(len));
+			buf_concat(self->write_buffer, (uint8_t*)data.ptr, (uint8_t*)data.ptr + data.size);
+			return true;
+		}
+
+		// the message doesn't fit, so we write the queued messages and this one with a single call
+		Block blocks[] = {block_from(self->write_buffer), block_from(len), data};
+		auto size = self->write_buffer.count + sizeof(len) + data.size;
+		auto res = sputnik_writev(self->sputnik, blocks, 3);
+		buf_clear(self->write_buffer);
+		return res == size;
+	}
+
+	bool
+	sputnik_channel_flush(Sputnik_Channel self)
+	{
+		if (self->write_buffer.count == 0)
+			return true;
+
+		auto data = block_from(self->write_buffer);
+		auto res = sputnik_writev(self->sputnik, &data, 1);
+		buf_clear(self->write_buffer);
+		return res == data.size;
+	}
+
+	size_t
+	sputnik_channel_msg_read_batch(Sputnik_Channel self, Buf<Block>& messages, Timeout timeout)
+	{
+		buf_clear(messages);
+
+		// move the partial message which is left from the last read to the start of the buffer
+		auto left = self->read_buffer.count - self->read_begin;
+		if (self->read_begin > 0)
+		{
+			::memmove(self->read_buffer.ptr, self->read_buffer.ptr + self->read_begin, left);
+			buf_resize(self->read_buffer, left);
+			self->read_begin = 0;
+		}
+
+		// the last read might have read complete messages which we didn't return yet
+		if (auto res = _sputnik_channel_parse(self, messages))
+			return res;
+
+		auto t = timeout;
+		while (true)
+		{
+			// make sure that the buffer can hold the whole message which we're reading
+			auto needed = self->buffer_size;
+			if (self->read_buffer.count >= sizeof(uint64_t))
+			{
+				uint64_t len = 0;
+				::memcpy(&len, self->read_buffer.ptr, sizeof(len));
+				if (sizeof(len) + len > needed)
+					needed = sizeof(len) + len;
+			}
+			if (self->read_buffer.cap < needed)
+				buf_reserve(self->read_buffer, needed - self->read_buffer.count);
+
+			auto count = self->read_buffer.count;
+			auto read_bytes = sputnik_read(self->sputnik, Block{self->read_buffer.ptr + count, self->read_buffer.cap - count}, t);
+			if (read_bytes == 0)
+				return 0;
+			buf_resize(self->read_buffer, count + read_bytes);
+
+			if (auto res = _sputnik_channel_parse(self, messages))
+				return res;
+
+			// we've read a part of a message, so we wait for the rest of it
+			t = INFINITE_TIMEOUT;
+		}
+	}
+}
@@ -1,4 +1,29 @@
 #include "mn/Json.h"
+#include "mn/Rune.h"
+#include "mn/SIMD.h"
+#include "mn/Defer.h"
+#include "mn/Fabric.h"
+#include "mn/Thread.h"
+
+#include <errno.h>
+
+#if ARCH_X86 && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MN_JSON_SIMD 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define MN_JSON_AVX2
+#define MN_JSON_FLATTEN
+#else
+#define MN_JSON_AVX2 __attribute__((target("avx2")))
+#define MN_JSON_FLATTEN __attribute__((flatten))
+#endif
+#else
+#define MN_JSON_SIMD 0
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace mn::json
 {
@@ -61,14 +86,288 @@ namespace mn::json
 		}
 	}
 
+	// the json parser works in two stages, the first one finds the positions of the structural characters (the
+	// brackets, colons, commas, quotes and the beginning of the numbers and keywords) 64 bytes at a time with simd, the
+	// second one is the normal recursive parser with a lexer which jumps between those positions instead of walking
+	// the content one rune at a time, the approach is from Langdale and Lemire "Parsing Gigabytes of JSON per Second"
+
+	// classification bit masks of a 64 bytes block, bit i corresponds to the i-th byte
+	struct Json_Block_Masks
+	{
+		uint64_t backslash, quote, ws, op;
+	};
+
+	// the state which is carried from a block to the next one
+	struct Json_Index_State
+	{
+		// whether the first byte of the next block is escaped by a backslash at the end of this block
+		uint64_t prev_escaped;
+		// all ones if this block ends inside a string
+		uint64_t prev_in_string;
+		// whether the last byte of this block is part of a number or keyword
+		uint64_t prev_scalar;
+	};
+
+	inline static void
+	_json_classify_scalar(const char* block, Json_Block_Masks& masks)
+	{
+		masks = Json_Block_Masks{};
+		for (size_t i = 0; i < 64; ++i)
+		{
+			auto bit = uint64_t(1) << i;
+			switch (block[i])
+			{
+			case '\\': masks.backslash |= bit; break;
+			case '"': masks.quote |= bit; break;
+			case ' ': case '\t': case '\n': case '\r': masks.ws |= bit; break;
+			case '{': case '}': case '[': case ']': case ':': case ',': masks.op |= bit; break;
+			default: break;
+			}
+		}
+	}
+
+#if MN_JSON_SIMD
+	inline static uint64_t
+	_json_movemask_sse2(__m128i a, __m128i b, __m128i c, __m128i d)
+	{
+		return uint64_t(uint32_t(_mm_movemask_epi8(a))) |
+			(uint64_t(uint32_t(_mm_movemask_epi8(b))) << 16) |
+			(uint64_t(uint32_t(_mm_movemask_epi8(c))) << 32) |
+			(uint64_t(uint32_t(_mm_movemask_epi8(d))) << 48);
+	}
+
+	// classifies 16 bytes, the brackets and curly braces differ only in the 0x20 bit so they're compared together
+	inline static void
+	_json_classify_16_sse2(__m128i v, __m128i& backslash, __m128i& quote, __m128i& ws, __m128i& op)
+	{
+		auto lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+		backslash = _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'));
+		quote = _mm_cmpeq_epi8(v, _mm_set1_epi8('"'));
+		ws = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+			_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')))
+		);
+		op = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('{')), _mm_cmpeq_epi8(lower, _mm_set1_epi8('}'))),
+			_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')), _mm_cmpeq_epi8(v, _mm_set1_epi8(',')))
+		);
+	}
+
+	inline static void
+	_json_classify_sse2(const char* block, Json_Block_Masks& masks)
+	{
+		__m128i backslash[4], quote[4], ws[4], op[4];
+		for (size_t i = 0; i < 4; ++i)
+		{
+			auto v = _mm_loadu_si128((const __m128i*)(block + i * 16));
+			_json_classify_16_sse2(v, backslash[i], quote[i], ws[i], op[i]);
+		}
+		masks.backslash = _json_movemask_sse2(backslash[0], backslash[1], backslash[2], backslash[3]);
+		masks.quote = _json_movemask_sse2(quote[0], quote[1], quote[2], quote[3]);
+		masks.ws = _json_movemask_sse2(ws[0], ws[1], ws[2], ws[3]);
+		masks.op = _json_movemask_sse2(op[0], op[1], op[2], op[3]);
+	}
+
+	MN_JSON_AVX2 static void
+	_json_classify_avx2(const char* block, Json_Block_Masks& masks)
+	{
+		uint32_t backslash[2], quote[2], ws[2], op[2];
+		for (size_t i = 0; i < 2; ++i)
+		{
+			auto v = _mm256_loadu_si256((const __m256i*)(block + i * 32));
+			auto lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+			backslash[i] = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))));
+			quote[i] = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))));
+			ws[i] = uint32_t(_mm256_movemask_epi8(_mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')))
+			)));
+			op[i] = uint32_t(_mm256_movemask_epi8(_mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('}'))),
+				_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(',')))
+			)));
+		}
+		masks.backslash = uint64_t(backslash[0]) | (uint64_t(backslash[1]) << 32);
+		masks.quote = uint64_t(quote[0]) | (uint64_t(quote[1]) << 32);
+		masks.ws = uint64_t(ws[0]) | (uint64_t(ws[1]) << 32);
+		masks.op = uint64_t(op[0]) | (uint64_t(op[1]) << 32);
+	}
+
+	inline static bool
+	_json_avx2_supported()
+	{
+		static const bool supported = mn_simd_support_check().avx2_supportted;
+		return supported;
+	}
+#endif
+
+	inline static uint32_t
+	_json_lowest_bit(uint64_t mask)
+	{
+		#if defined(_MSC_VER)
+			unsigned long res = 0;
+			_BitScanForward64(&res, mask);
+			return uint32_t(res);
+		#else
+			return uint32_t(__builtin_ctzll(mask));
+		#endif
+	}
+
+	// bit i of the result is the xor of the bits [0, i] of the given mask
+	inline static uint64_t
+	_json_prefix_xor(uint64_t mask)
+	{
+		mask ^= mask << 1;
+		mask ^= mask << 2;
+		mask ^= mask << 4;
+		mask ^= mask << 8;
+		mask ^= mask << 16;
+		mask ^= mask << 32;
+		return mask;
+	}
+
+	// returns the bytes which are escaped by a backslash, a byte is escaped if it follows an odd sequence of
+	// backslashes, the odd sequences are found with a carrying add over the even bits
+	inline static uint64_t
+	_json_escaped(Json_Index_State& state, uint64_t backslash)
+	{
+		const uint64_t even_bits = 0x5555555555555555ULL;
+
+		backslash &= ~state.prev_escaped;
+		auto follows_escape = (backslash << 1) | state.prev_escaped;
+		auto odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+		auto sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+		state.prev_escaped = sequences_starting_on_even_bits < odd_sequence_starts ? 1 : 0;
+		auto invert_mask = sequences_starting_on_even_bits << 1;
+		return (even_bits ^ invert_mask) & follows_escape;
+	}
+
+	// appends the offsets of the structural characters in the given block to out and returns its new end
+	inline static uint32_t*
+	_json_index_block(Json_Index_State& state, const Json_Block_Masks& masks, uint32_t offset, uint32_t* out)
+	{
+		auto escaped = masks.backslash | state.prev_escaped ? _json_escaped(state, masks.backslash) : 0;
+		auto quote = masks.quote & ~escaped;
+		// in_string covers the opening quote and the string content but not the closing quote
+		auto in_string = _json_prefix_xor(quote) ^ state.prev_in_string;
+		state.prev_in_string = uint64_t(int64_t(in_string) >> 63);
+
+		// numbers and keywords are indexed at their first byte
+		auto scalar = ~(masks.op | masks.ws | quote | in_string);
+		auto scalar_start = scalar & ~((scalar << 1) | state.prev_scalar);
+		state.prev_scalar = scalar >> 63;
+
+		auto structurals = (masks.op & ~in_string) | quote | scalar_start;
+		while (structurals != 0)
+		{
+			*out++ = offset + _json_lowest_bit(structurals);
+			structurals &= structurals - 1;
+		}
+		return out;
+	}
+
+	// the index is built in batches of blocks while the parser consumes it so that the content is still in the cache
+	// when the parser reaches it, a block adds at most 64 positions to the batch
+	constexpr size_t JSON_INDEX_BATCH_BLOCKS = 64;
+	constexpr size_t JSON_INDEX_BATCH_CAPACITY = JSON_INDEX_BATCH_BLOCKS * 64;
+
 	struct Lexer
 	{
 		const char *it = nullptr;
 		char c = '\0';
 
 		Err err;
+
+		// when the lexer is indexed it jumps between the structural positions in the index instead of walking the
+		// content one rune at a time, it's not indexed if Parse_Settings::no_structural_index is set
+		bool indexed = false;
+		bool index_avx2 = false;
+		const char* content_end = nullptr;
+		// the next block to be indexed
+		const char* index_block = nullptr;
+		// the offsets in the current batch are relative to its first block
+		const char* index_base = nullptr;
+		Json_Index_State index_state{};
+		uint32_t* index_batch = nullptr;
+		const uint32_t* index_it = nullptr;
+		const uint32_t* index_end = nullptr;
 	};
 
+	// indexes the next batch of blocks
+	template<void (*TClassify)(const char*, Json_Block_Masks&)>
+	inline static void
+	_lexer_index_batch_with(Lexer &self)
+	{
+		self.index_base = self.index_block;
+		auto out = self.index_batch;
+		Json_Block_Masks masks{};
+		for (size_t i = 0; i < JSON_INDEX_BATCH_BLOCKS && self.index_block != self.content_end; ++i)
+		{
+			auto offset = uint32_t(self.index_block - self.index_base);
+			if (self.content_end - self.index_block >= 64)
+			{
+				TClassify(self.index_block, masks);
+				self.index_block += 64;
+			}
+			else
+			{
+				// the padding is whitespace so it doesn't add anything to the index
+				char tail[64];
+				::memset(tail, ' ', sizeof(tail));
+				::memcpy(tail, self.index_block, self.content_end - self.index_block);
+				TClassify(tail, masks);
+				self.index_block = self.content_end;
+			}
+			out = _json_index_block(self.index_state, masks, offset, out);
+		}
+		self.index_it = self.index_batch;
+		self.index_end = out;
+	}
+
+#if MN_JSON_SIMD
+	// the classification is inlined into the batch loop, which can't happen across the target boundary otherwise
+	MN_JSON_AVX2 MN_JSON_FLATTEN static void
+	_lexer_index_batch_avx2(Lexer &self)
+	{
+		_lexer_index_batch_with<_json_classify_avx2>(self);
+	}
+#endif
+
+	inline static void
+	_lexer_index_batch(Lexer &self)
+	{
+	#if MN_JSON_SIMD
+		if (self.index_avx2)
+			_lexer_index_batch_avx2(self);
+		else
+			_lexer_index_batch_with<_json_classify_sse2>(self);
+	#else
+		_lexer_index_batch_with<_json_classify_scalar>(self);
+	#endif
+	}
+
+	// indexes batches until one of them has structural positions, returns false at the end of the content
+	static bool
+	_lexer_index_refill(Lexer &self)
+	{
+		while (self.index_it == self.index_end)
+		{
+			if (self.index_block == self.content_end)
+				return false;
+			_lexer_index_batch(self);
+		}
+		return true;
+	}
+
+	// returns the next structural position in the index, or nullptr at the end of the content
+	inline static const char*
+	_lexer_index_next(Lexer &self)
+	{
+		if (self.index_it == self.index_end && _lexer_index_refill(self) == false)
+			return nullptr;
+		return self.index_base + *self.index_it++;
+	}
+
 	inline static bool
 	_lexer_eof(Lexer &self)
 	{
@@ -132,11 +431,12 @@ namespace mn::json
 	{
 		tkn.begin = self.it;
 
-		char prev = self.c;
-		// eat all runes even those escaped by \ like \"
-		while (self.c != '"' || prev == '\\')
+		// eat all runes even those escaped by \ like \" and \\, the escaped rune is skipped along with its \ so
+		// that an escaped \ doesn't escape the rune after it
+		while (self.c != '"')
 		{
-			prev = self.c;
+			if (self.c == '\\')
+				_lexer_read_rune(self);
 			if (_lexer_read_rune(self) == false)
 			{
 				self.err = Err{"unexpected end of string '{:.{}s}'", tkn.begin, self.it - tkn.begin};
@@ -148,10 +448,153 @@ namespace mn::json
 		_lexer_read_rune(self); // for the "
 	}
 
+	// exact powers of ten which can be represented in a double
+	constexpr double JSON_POW10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+	};
+
+	// parses a number like strtod does, the decimal numbers whose mantissa fits in 53 bits and whose exponent is in
+	// [-22, 22] are computed with a single exact multiplication/division which gives the same correctly rounded result
+	// (Clinger's fast path), the rest (long mantissas, big exponents, hex, inf, nan) go through strtod
+	inline static double
+	_lexer_parse_number(const char* it, char** end)
+	{
+		auto ptr = it;
+		bool negative = false;
+		if (*ptr == '-' || *ptr == '+')
+		{
+			negative = *ptr == '-';
+			++ptr;
+		}
+		if (_lexer_is_digit(*ptr) == false)
+			return ::strtod(it, end);
+
+		uint64_t mantissa = 0;
+		int digits_count = 0;
+		int exponent = 0;
+		for (; _lexer_is_digit(*ptr); ++ptr, ++digits_count)
+			mantissa = mantissa * 10 + uint64_t(*ptr - '0');
+		if (*ptr == '.')
+		{
+			++ptr;
+			if (_lexer_is_digit(*ptr) == false)
+				return ::strtod(it, end);
+			for (; _lexer_is_digit(*ptr); ++ptr, ++digits_count, --exponent)
+				mantissa = mantissa * 10 + uint64_t(*ptr - '0');
+		}
+		if (*ptr == 'e' || *ptr == 'E')
+		{
+			++ptr;
+			bool exponent_negative = false;
+			if (*ptr == '-' || *ptr == '+')
+			{
+				exponent_negative = *ptr == '-';
+				++ptr;
+			}
+			if (_lexer_is_digit(*ptr) == false)
+				return ::strtod(it, end);
+			int exponent_value = 0;
+			for (; _lexer_is_digit(*ptr); ++ptr)
+				if (exponent_value < 10000)
+					exponent_value = exponent_value * 10 + (*ptr - '0');
+			exponent += exponent_negative ? -exponent_value : exponent_value;
+		}
+
+		// anything which strtod might read further (hex digits, inf, nan) goes through it
+		if (_lexer_is_letter(*ptr) || *ptr == '.')
+			return ::strtod(it, end);
+		if (digits_count > 19 || mantissa > (uint64_t(1) << 53) || exponent < -22 || exponent > 22)
+			return ::strtod(it, end);
+
+		auto res = double(mantissa);
+		if (exponent < 0)
+			res /= JSON_POW10[-exponent];
+		else
+			res *= JSON_POW10[exponent];
+		*end = (char*)ptr;
+		return negative ? -res : res;
+	}
+
+	// moves the lexer to the next structural position in the index, the end of the index and the null terminator
+	// are the end of the content
+	inline static void
+	_lexer_seek_indexed(Lexer &self)
+	{
+		auto next = _lexer_index_next(self);
+		if (next == nullptr)
+		{
+			self.it = self.content_end;
+			self.c = '\0';
+			return;
+		}
+		self.it = next;
+		self.c = *self.it;
+	}
+
+	// in the indexed lexer the closing quote of a string is the next position in the index
+	inline static void
+	_lexer_scan_str_indexed(Lexer &self, Token &tkn)
+	{
+		tkn.begin = self.it;
+		auto end = _lexer_index_next(self);
+		if (end == nullptr)
+		{
+			self.err = Err{"unexpected end of string '{:.{}s}'", tkn.begin, self.content_end - tkn.begin};
+			tkn.end = self.content_end;
+			self.it = self.content_end;
+			self.c = '\0';
+			return;
+		}
+
+		tkn.end = end;
+		self.it = tkn.end + 1;
+		self.c = *self.it;
+	}
+
+	// whether a number or a keyword which stops at the given position ends where it should
+	inline static bool
+	_lexer_is_scalar_end(const char* it, const char* end)
+	{
+		if (it == end)
+			return true;
+		auto c = *it;
+		return c == '\0' || _lexer_is_ws(c) || c == '"' || c == ',' || c == ':' || c == '[' || c == ']' || c == '{' || c == '}';
+	}
+
+	// the index only has the first byte of the numbers and keywords so make sure they end where they should
+	inline static void
+	_lexer_check_scalar_end_indexed(Lexer &self, const Token &tkn)
+	{
+		if (self.err || _lexer_is_scalar_end(self.it, self.content_end))
+			return;
+		self.err = Err{"unexpected '{:c}' after '{:.{}s}'", self.c, tkn.begin, self.it - tkn.begin};
+	}
+
+	// switches the lexer to the structural index of the given content, the index batch memory is provided by the caller
+	inline static void
+	_lexer_index(Lexer &self, const Str& content, Buf<uint32_t>& index)
+	{
+		buf_resize(index, JSON_INDEX_BATCH_CAPACITY);
+		self.indexed = true;
+	#if MN_JSON_SIMD
+		self.index_avx2 = _json_avx2_supported();
+	#endif
+		self.content_end = content.ptr + content.count;
+		self.index_block = content.ptr;
+		self.index_base = content.ptr;
+		self.index_batch = index.ptr;
+		self.index_it = index.ptr;
+		self.index_end = index.ptr;
+	}
+
 	inline static Token
 	_lexer_lex(Lexer &self)
 	{
-		_lexer_skip_ws(self);
+		if (self.indexed)
+			_lexer_seek_indexed(self);
+		else
+			_lexer_skip_ws(self);
 
 		Token tkn{};
 
@@ -188,19 +631,33 @@ namespace mn::json
 				self.err = Err{"unidentified keyword '{:.{}s}'", tkn.begin, tkn.end - tkn.begin};
 				break;
 			}
+
+			if (self.indexed)
+				_lexer_check_scalar_end_indexed(self, tkn);
 		}
 		else if (_lexer_is_digit(self.c) || self.c == '-' || self.c == '+')
 		{
 			char *end	= nullptr;
 			tkn.kind	= Token::KIND_NUMBER;
-			tkn.val_num = ::strtod(self.it, &end);
+			errno		= 0;
+			tkn.val_num = _lexer_parse_number(self.it, &end);
 			if (errno == ERANGE)
 			{
 				self.err = Err{"number out of range '{:.{}s}'", tkn.begin, end - tkn.begin};
 			}
+			else if (end == self.it)
+			{
+				// a lone sign, skip it so that the lexer doesn't get stuck
+				++end;
+				self.err = Err{"invalid number '{:.{}s}'", tkn.begin, end - tkn.begin};
+			}
 
 			self.it = end;
 			self.c	= *self.it;
+			tkn.end = self.it;
+
+			if (self.indexed)
+				_lexer_check_scalar_end_indexed(self, tkn);
 		}
 		else
 		{
@@ -211,7 +668,10 @@ namespace mn::json
 			{
 			case '"':
 				tkn.kind = Token::KIND_STRING;
-				_lexer_scan_str(self, tkn);
+				if (self.indexed)
+					_lexer_scan_str_indexed(self, tkn);
+				else
+					_lexer_scan_str(self, tkn);
 				break;
 
 			case ':':
@@ -348,6 +808,7 @@ namespace mn::json
 				}
 				else
 				{
+					value_free(value);
 					value_free(array);
 					return Value{};
 				}
@@ -383,6 +844,7 @@ namespace mn::json
 				}
 				else
 				{
+					value_free(value);
 					value_free(object);
 					return Value{};
 				}
@@ -406,21 +868,1221 @@ namespace mn::json
 		return Value{};
 	}
 
-	// API
-	Result<Value>
-	parse(const Str& content)
+	// objects with more keys than this are hashed on their first lookup
+	constexpr size_t DOC_OBJECT_LINEAR_LOOKUP_LIMIT = 16;
+
+	inline static Doc_Node
+	_doc_node_new(Value::KIND kind)
 	{
-		Lexer lexer;
-		lexer.it = content.ptr;
-		lexer.c	= *lexer.it;
+		Doc_Node self{};
+		self.kind = kind;
+		return self;
+	}
 
-		Parser parser;
-		parser.lexer = lexer;
-		parser.current = _lexer_lex(parser.lexer);
+	// parses a value into the end of the tape, it has the same grammar as _parser_parse_value
+	inline static void
+	_doc_parser_parse_value(Parser& self, Doc& doc)
+	{
+		if (auto null_tkn = _parser_eat_kind(self, Token::KIND_NULL))
+		{
+			buf_push(doc.tape, _doc_node_new(Value::KIND_NULL));
+		}
+		else if (auto bool_tkn = _parser_eat_kind(self, Token::KIND_BOOL))
+		{
+			auto node = _doc_node_new(Value::KIND_BOOL);
+			node.as_bool = bool_tkn.val_bool;
+			buf_push(doc.tape, node);
+		}
+		else if (auto number_tkn = _parser_eat_kind(self, Token::KIND_NUMBER))
+		{
+			auto node = _doc_node_new(Value::KIND_NUMBER);
+			node.as_number = number_tkn.val_num;
+			buf_push(doc.tape, node);
+		}
+		else if (auto string_tkn = _parser_eat_kind(self, Token::KIND_STRING))
+		{
+			auto node = _doc_node_new(Value::KIND_STRING);
+			node.as_string = Doc_String{string_tkn.begin, size_t(string_tkn.end - string_tkn.begin)};
+			node.escaped = ::memchr(node.as_string.ptr, '\\', node.as_string.count) != nullptr;
+			buf_push(doc.tape, node);
+		}
+		else if (auto bracket_tkn = _parser_eat_kind(self, Token::KIND_OPEN_BRACKET))
+		{
+			auto array_index = doc.tape.count;
+			buf_push(doc.tape, _doc_node_new(Value::KIND_ARRAY));
+			uint32_t count = 0;
+			while (_parser_look_kind(self, Token::KIND_CLOSE_BRACKET) == false)
+			{
+				_doc_parser_parse_value(self, doc);
+				if (self.err)
+					return;
+				++count;
 
-		auto res = _parser_parse_value(parser);
-		if (parser.err)
-			return parser.err;
-		return res;
+				if (_parser_eat_kind(self, Token::KIND_COMMA) == false)
+					break;
+			}
+			_parser_eat_must(self, Token::KIND_CLOSE_BRACKET);
+			doc.tape[array_index].count = count;
+			doc.tape[array_index].end = doc.tape.count;
+		}
+		else if (auto open_curly_tkn = _parser_eat_kind(self, Token::KIND_OPEN_CURLY))
+		{
+			auto object_index = doc.tape.count;
+			buf_push(doc.tape, _doc_node_new(Value::KIND_OBJECT));
+			uint32_t count = 0;
+			while (_parser_look_kind(self, Token::KIND_CLOSE_CURLY) == false)
+			{
+				auto key = _parser_eat_must(self, Token::KIND_STRING);
+				_parser_eat_must(self, Token::KIND_COLON);
+				if (self.err)
+					return;
+
+				auto key_node = _doc_node_new(Value::KIND_STRING);
+				key_node.as_string = Doc_String{key.begin, size_t(key.end - key.begin)};
+				key_node.escaped = ::memchr(key_node.as_string.ptr, '\\', key_node.as_string.count) != nullptr;
+				buf_push(doc.tape, key_node);
+
+				_doc_parser_parse_value(self, doc);
+				if (self.err)
+					return;
+				++count;
+
+				if (_parser_eat_kind(self, Token::KIND_COMMA) == false)
+					break;
+			}
+			_parser_eat_must(self, Token::KIND_CLOSE_CURLY);
+			doc.tape[object_index].count = count;
+			doc.tape[object_index].end = doc.tape.count;
+		}
+		else if (auto unknown_tkn = _parser_eat(self))
+		{
+			self.err = Err{
+				"unidentified token '{:.{}s}' of kind '{}'",
+				unknown_tkn.begin,
+				unknown_tkn.end - unknown_tkn.begin,
+				_json_token_kind_str(unknown_tkn.kind)
+			};
+		}
+		else
+		{
+			self.err = Err{"unexpected end of json document"};
+		}
+	}
+
+	// an array or an object which the tape builder is inside of
+	struct Doc_Frame
+	{
+		size_t index;
+		uint32_t count;
+		bool is_object;
+	};
+
+	// builds the tape of the document directly from the structural index, it has the same grammar as
+	// _doc_parser_parse_value but instead of lexing tokens for a recursive parser it looks at the character at
+	// each structural position and it keeps the open arrays and objects in an explicit stack
+	inline static Err
+	_doc_build_tape(Lexer& lexer, Doc& doc)
+	{
+		enum STATE
+		{
+			STATE_VALUE,
+			STATE_KEY,
+			STATE_AFTER_VALUE,
+		};
+
+		auto stack = buf_with_allocator<Doc_Frame>(memory::tmp());
+		auto state = STATE_VALUE;
+		auto it = _lexer_index_next(lexer);
+		while (true)
+		{
+			switch (state)
+			{
+			case STATE_VALUE:
+			{
+				if (it == nullptr)
+					return Err{"unexpected end of json document"};
+
+				auto c = *it;
+				if (c == '{' || c == '[')
+				{
+					buf_push(stack, Doc_Frame{doc.tape.count, 0, c == '{'});
+					buf_push(doc.tape, _doc_node_new(c == '{' ? Value::KIND_OBJECT : Value::KIND_ARRAY));
+					it = _lexer_index_next(lexer);
+					if (it && *it == (c == '{' ? '}' : ']'))
+						state = STATE_AFTER_VALUE;
+					else if (c == '{')
+						state = STATE_KEY;
+					continue;
+				}
+
+				if (c == '"')
+				{
+					// the closing quote is the next structural position
+					auto end = _lexer_index_next(lexer);
+					if (end == nullptr)
+						return Err{"unexpected end of string '{:.{}s}'", it, lexer.content_end - it};
+					auto node = _doc_node_new(Value::KIND_STRING);
+					node.as_string = Doc_String{it + 1, size_t(end - it - 1)};
+					node.escaped = ::memchr(node.as_string.ptr, '\\', node.as_string.count) != nullptr;
+					buf_push(doc.tape, node);
+				}
+				else if (_lexer_is_letter(c))
+				{
+					auto node = _doc_node_new(Value::KIND_NULL);
+					size_t count = 0;
+					auto available = size_t(lexer.content_end - it);
+					if (available >= 4 && ::memcmp(it, "null", 4) == 0)
+					{
+						count = 4;
+					}
+					else if (available >= 4 && ::memcmp(it, "true", 4) == 0)
+					{
+						node.kind = Value::KIND_BOOL;
+						node.as_bool = true;
+						count = 4;
+					}
+					else if (available >= 5 && ::memcmp(it, "false", 5) == 0)
+					{
+						node.kind = Value::KIND_BOOL;
+						node.as_bool = false;
+						count = 5;
+					}
+
+					if (count == 0 || _lexer_is_scalar_end(it + count, lexer.content_end) == false)
+					{
+						auto end = it;
+						while (end != lexer.content_end && _lexer_is_letter(*end))
+							++end;
+						return Err{"unidentified keyword '{:.{}s}'", it, end - it};
+					}
+					buf_push(doc.tape, node);
+				}
+				else if (_lexer_is_digit(c) || c == '-' || c == '+')
+				{
+					char* end = nullptr;
+					errno = 0;
+					auto node = _doc_node_new(Value::KIND_NUMBER);
+					node.as_number = _lexer_parse_number(it, &end);
+					if (errno == ERANGE)
+						return Err{"number out of range '{:.{}s}'", it, end - it};
+					if (end == it)
+						return Err{"invalid number '{:.{}s}'", it, 1};
+					if (_lexer_is_scalar_end(end, lexer.content_end) == false)
+						return Err{"unexpected '{:c}' after '{:.{}s}'", *end, it, end - it};
+					buf_push(doc.tape, node);
+				}
+				else
+				{
+					return Err{"unidentified rune '{:c}'", c};
+				}
+
+				it = _lexer_index_next(lexer);
+				state = STATE_AFTER_VALUE;
+				break;
+			}
+			case STATE_KEY:
+			{
+				if (it == nullptr || *it != '"')
+					return Err{"expected '{}' but found '{:c}'", _json_token_kind_str(Token::KIND_STRING), it ? *it : ' '};
+				auto end = _lexer_index_next(lexer);
+				if (end == nullptr)
+					return Err{"unexpected end of string '{:.{}s}'", it, lexer.content_end - it};
+
+				auto key_node = _doc_node_new(Value::KIND_STRING);
+				key_node.as_string = Doc_String{it + 1, size_t(end - it - 1)};
+				key_node.escaped = ::memchr(key_node.as_string.ptr, '\\', key_node.as_string.count) != nullptr;
+				buf_push(doc.tape, key_node);
+
+				it = _lexer_index_next(lexer);
+				if (it == nullptr || *it != ':')
+					return Err{"expected '{}' but found '{:c}'", _json_token_kind_str(Token::KIND_COLON), it ? *it : ' '};
+				it = _lexer_index_next(lexer);
+				state = STATE_VALUE;
+				break;
+			}
+			case STATE_AFTER_VALUE:
+			{
+				// the content after the root value is ignored like in _doc_parser_parse_value
+				if (stack.count == 0)
+					return Err{};
+
+				auto& frame = buf_top(stack);
+				auto close = frame.is_object ? '}' : ']';
+				// the empty containers come here right away
+				if (it && *it == close && doc.tape.count == frame.index + 1)
+				{
+					doc.tape[frame.index].end = doc.tape.count;
+					buf_pop(stack);
+					it = _lexer_index_next(lexer);
+					break;
+				}
+
+				++frame.count;
+				if (it && *it == ',')
+				{
+					it = _lexer_index_next(lexer);
+					// a trailing comma is accepted like in _doc_parser_parse_value
+					if (it && *it == close)
+					{
+						doc.tape[frame.index].count = frame.count;
+						doc.tape[frame.index].end = doc.tape.count;
+						buf_pop(stack);
+						it = _lexer_index_next(lexer);
+					}
+					else
+					{
+						state = frame.is_object ? STATE_KEY : STATE_VALUE;
+					}
+				}
+				else if (it && *it == close)
+				{
+					doc.tape[frame.index].count = frame.count;
+					doc.tape[frame.index].end = doc.tape.count;
+					buf_pop(stack);
+					it = _lexer_index_next(lexer);
+				}
+				else if (it == nullptr)
+				{
+					return Err{"expected '{:c}' but found EOF", close};
+				}
+				else
+				{
+					return Err{"expected '{:c}' but found '{:c}'", close, *it};
+				}
+				break;
+			}
+			}
+		}
+	}
+
+	inline static int
+	_doc_hex_digit(char c)
+	{
+		if (c >= '0' && c <= '9')
+			return c - '0';
+		else if (c >= 'a' && c <= 'f')
+			return c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			return c - 'A' + 10;
+		return -1;
+	}
+
+	// reads the 4 hex digits of a unicode escape, returns -1 if they're invalid
+	inline static Rune
+	_doc_read_hex4(const char* it, const char* end)
+	{
+		if (end - it < 4)
+			return -1;
+		Rune res = 0;
+		for (size_t i = 0; i < 4; ++i)
+		{
+			auto digit = _doc_hex_digit(it[i]);
+			if (digit < 0)
+				return -1;
+			res = (res << 4) | digit;
+		}
+		return res;
+	}
+
+	// unescapes the given json string into out, invalid escape sequences are kept as they are
+	inline static void
+	_doc_unescape(Str& out, Doc_String str)
+	{
+		auto it = str.ptr;
+		auto end = str.ptr + str.count;
+		while (it != end)
+		{
+			auto escape = (const char*)::memchr(it, '\\', end - it);
+			if (escape == nullptr || escape + 1 == end)
+			{
+				str_block_push(out, Block{(void*)it, size_t(end - it)});
+				break;
+			}
+			str_block_push(out, Block{(void*)it, size_t(escape - it)});
+			it = escape + 2;
+
+			switch (escape[1])
+			{
+			case '"': str_push(out, '"'); break;
+			case '\\': str_push(out, '\\'); break;
+			case '/': str_push(out, '/'); break;
+			case 'b': str_push(out, '\b'); break;
+			case 'f': str_push(out, '\f'); break;
+			case 'n': str_push(out, '\n'); break;
+			case 'r': str_push(out, '\r'); break;
+			case 't': str_push(out, '\t'); break;
+			case 'u':
+			{
+				auto r = _doc_read_hex4(it, end);
+				if (r < 0)
+				{
+					str_block_push(out, Block{(void*)escape, 2});
+					break;
+				}
+				it += 4;
+
+				// utf-16 surrogate pair
+				if (r >= 0xD800 && r <= 0xDBFF && end - it >= 6 && it[0] == '\\' && it[1] == 'u')
+				{
+					auto low = _doc_read_hex4(it + 2, end);
+					if (low >= 0xDC00 && low <= 0xDFFF)
+					{
+						r = 0x10000 + ((r - 0xD800) << 10) + (low - 0xDC00);
+						it += 6;
+					}
+				}
+				str_push(out, r);
+				break;
+			}
+			default:
+				str_block_push(out, Block{(void*)escape, 2});
+				break;
+			}
+		}
+	}
+
+	// compares the raw key of the given key node with the given key without materializing it unless it's escaped
+	inline static bool
+	_doc_key_equal(Doc& self, size_t key_index, const Str& key)
+	{
+		const auto& node = self.tape[key_index];
+		if (node.escaped && node.materialized == false)
+			return doc_string(self, key_index) == key;
+		return node.as_string.count == key.count && ::memcmp(node.as_string.ptr, key.ptr, key.count) == 0;
+	}
+
+	// resets the given document (it creates its arena if it doesn't have one) and parses the given content into it
+	inline static Err
+	_doc_parse_into(Doc& self, const Str& content, Parse_Settings settings = {})
+	{
+		if (self.arena == nullptr)
+		{
+			self.arena = allocator_arena_new();
+		}
+		else
+		{
+			buf_clear(self.tape);
+			self.arena->clear_all();
+		}
+		self.object_indices = map_with_allocator<size_t, Map<Str, size_t>>(self.arena);
+
+		if (content.count == 0)
+			return Err{"unexpected end of json document"};
+
+		Lexer lexer;
+		lexer.it = content.ptr;
+		lexer.c	= *lexer.it;
+
+		if (settings.no_structural_index == false)
+		{
+			auto index = buf_new<uint32_t>();
+			mn_defer(buf_free(index));
+			_lexer_index(lexer, content, index);
+			return _doc_build_tape(lexer, self);
+		}
+
+		Parser parser;
+		parser.lexer = lexer;
+		parser.current = _lexer_lex(parser.lexer);
+		if (parser.lexer.err)
+			parser.err = parser.lexer.err;
+
+		if (!parser.err)
+			_doc_parser_parse_value(parser, self);
+		return parser.err;
+	}
+
+	// streaming parser
+	struct IEvent_Parser
+	{
+		enum STATE
+		{
+			// expects a top level value
+			STATE_DOCUMENT,
+			// expects a value after a colon, or after a comma inside an array
+			STATE_VALUE,
+			// expects the first value of an array or its end
+			STATE_ARRAY_FIRST,
+			// expects the first key of an object or its end
+			STATE_OBJECT_FIRST,
+			// expects a key after a comma inside an object
+			STATE_OBJECT_KEY,
+			// expects the colon after a key
+			STATE_COLON,
+			// expects a comma or the end of the innermost array or object
+			STATE_AFTER_VALUE,
+			// the top level value is complete and only whitespace can follow it
+			STATE_DONE,
+		};
+
+		enum STEP
+		{
+			STEP_EVENT,
+			STEP_NEED_INPUT,
+			STEP_ERROR,
+		};
+
+		Event_Parser_Settings settings;
+		Stream stream;
+		Reader reader;
+		// the unconsumed input is [pos, input.count), the consumed input is dropped when more input is added
+		Str input;
+		size_t pos;
+		// count of the input bytes which were dropped, it's used to report the offset of the errors
+		size_t dropped;
+		bool finished;
+		STATE state;
+		// '{' or '[' for each open object or array
+		Buf<char> stack;
+		// the unescaped key or string of the last event
+		Str str;
+		// how far the search for the closing quote of an incomplete string got, so that it's not searched again from
+		// the start each time input is added
+		size_t string_scan;
+		Err err;
+	};
+
+	inline static Event_Parser
+	_event_parser_new(Event_Parser_Settings settings)
+	{
+		if (settings.max_depth == 0)
+			settings.max_depth = 1024;
+		if (settings.read_size == 0)
+			settings.read_size = 64ULL * 1024ULL;
+
+		auto self = alloc_construct<IEvent_Parser>();
+		self->settings = settings;
+		self->input = str_new();
+		self->stack = buf_new<char>();
+		self->str = str_new();
+		return self;
+	}
+
+	// drops the consumed input
+	inline static void
+	_event_parser_drop_consumed(Event_Parser self)
+	{
+		if (self->pos == 0)
+			return;
+
+		auto remaining = self->input.count - self->pos;
+		::memmove(self->input.ptr, self->input.ptr + self->pos, remaining);
+		self->input.count = remaining;
+		self->input.ptr[remaining] = '\0';
+		self->dropped += self->pos;
+		self->pos = 0;
+	}
+
+	// reads the next chunk from the parser's stream or reader, and finishes the input once it reads 0 bytes
+	inline static void
+	_event_parser_fill(Event_Parser self)
+	{
+		_event_parser_drop_consumed(self);
+		buf_reserve(self->input, self->settings.read_size + 1);
+
+		auto chunk = Block{self->input.ptr + self->input.count, self->settings.read_size};
+		size_t read_size = 0;
+		if (self->stream)
+			read_size = stream_read(self->stream, chunk);
+		else if (self->reader)
+			read_size = reader_read(self->reader, chunk);
+
+		if (read_size == 0 || read_size == size_t(-1))
+		{
+			self->finished = true;
+			read_size = 0;
+		}
+		self->input.count += read_size;
+		self->input.ptr[self->input.count] = '\0';
+	}
+
+	inline static bool
+	_event_parser_is_delimiter(char c)
+	{
+		return _lexer_is_ws(c) || c == ',' || c == ':' || c == '[' || c == ']' || c == '{' || c == '}' || c == '"';
+	}
+
+	inline static IEvent_Parser::STEP
+	_event_parser_fail(Event_Parser self, Err err)
+	{
+		self->err = err;
+		return IEvent_Parser::STEP_ERROR;
+	}
+
+	// the state after a value is complete
+	inline static void
+	_event_parser_value_done(Event_Parser self)
+	{
+		if (self->stack.count > 0)
+			self->state = IEvent_Parser::STATE_AFTER_VALUE;
+		else if (self->settings.multiple_documents)
+			self->state = IEvent_Parser::STATE_DOCUMENT;
+		else
+			self->state = IEvent_Parser::STATE_DONE;
+	}
+
+	// scans the string which starts at the current position, its closing quote is the first one which isn't preceded
+	// by an odd count of backslashes
+	inline static IEvent_Parser::STEP
+	_event_parser_string(Event_Parser self, Event& event, Event::KIND kind)
+	{
+		const char* begin = self->input.ptr + self->pos + 1;
+		const char* end = self->input.ptr + self->input.count;
+		auto it = begin + self->string_scan;
+		while (true)
+		{
+			auto quote = (const char*)::memchr(it, '"', end - it);
+			auto scanned = size_t((quote ? quote : end) - begin);
+			if (self->settings.max_token_size > 0 && scanned > self->settings.max_token_size)
+				return _event_parser_fail(self, Err{"string at byte {} is bigger than the max token size", self->dropped + self->pos});
+
+			if (quote == nullptr)
+			{
+				self->string_scan = scanned;
+				if (self->finished)
+					return _event_parser_fail(self, Err{"unexpected end of string at byte {}", self->dropped + self->pos});
+				return IEvent_Parser::STEP_NEED_INPUT;
+			}
+
+			size_t backslash_count = 0;
+			for (auto prev = quote; prev != begin && prev[-1] == '\\'; --prev)
+				++backslash_count;
+			if (backslash_count % 2 == 0)
+			{
+				str_clear(self->str);
+				_doc_unescape(self->str, Doc_String{begin, size_t(quote - begin)});
+				str_null_terminate(self->str);
+
+				event.kind = kind;
+				event.depth = self->stack.count;
+				event.as_string = self->str;
+				self->pos = quote + 1 - self->input.ptr;
+				self->string_scan = 0;
+				return IEvent_Parser::STEP_EVENT;
+			}
+			it = quote + 1;
+		}
+	}
+
+	// scans the number or keyword which starts at the current position, the whole token should be in the input
+	// before it's parsed since a chunk might end in the middle of it
+	inline static IEvent_Parser::STEP
+	_event_parser_scalar(Event_Parser self, Event& event)
+	{
+		auto begin = self->input.ptr + self->pos;
+		auto end = self->input.ptr + self->input.count;
+		auto it = begin;
+		while (it != end && _event_parser_is_delimiter(*it) == false)
+			++it;
+
+		auto count = size_t(it - begin);
+		if (self->settings.max_token_size > 0 && count > self->settings.max_token_size)
+			return _event_parser_fail(self, Err{"token at byte {} is bigger than the max token size", self->dropped + self->pos});
+		if (it == end && self->finished == false)
+			return IEvent_Parser::STEP_NEED_INPUT;
+
+		event.depth = self->stack.count;
+		if (_lexer_is_letter(*begin))
+		{
+			if (count == 4 && ::strncmp(begin, "null", 4) == 0)
+			{
+				event.kind = Event::KIND_NULL;
+			}
+			else if (count == 4 && ::strncmp(begin, "true", 4) == 0)
+			{
+				event.kind = Event::KIND_BOOL;
+				event.as_bool = true;
+			}
+			else if (count == 5 && ::strncmp(begin, "false", 5) == 0)
+			{
+				event.kind = Event::KIND_BOOL;
+				event.as_bool = false;
+			}
+			else
+			{
+				return _event_parser_fail(self, Err{"unidentified keyword '{:.{}s}' at byte {}", begin, count, self->dropped + self->pos});
+			}
+		}
+		else
+		{
+			// the input is null terminated so the number parsing stops at the end of it
+			char* number_end = nullptr;
+			errno = 0;
+			event.kind = Event::KIND_NUMBER;
+			event.as_number = _lexer_parse_number(begin, &number_end);
+			if (errno == ERANGE)
+				return _event_parser_fail(self, Err{"number out of range '{:.{}s}' at byte {}", begin, count, self->dropped + self->pos});
+			if (number_end != it)
+				return _event_parser_fail(self, Err{"invalid number '{:.{}s}' at byte {}", begin, count, self->dropped + self->pos});
+		}
+
+		self->pos += count;
+		_event_parser_value_done(self);
+		return IEvent_Parser::STEP_EVENT;
+	}
+
+	inline static IEvent_Parser::STEP
+	_event_parser_value(Event_Parser self, Event& event)
+	{
+		auto c = self->input.ptr[self->pos];
+		if (c == '{' || c == '[')
+		{
+			if (self->stack.count >= self->settings.max_depth)
+				return _event_parser_fail(self, Err{"max nesting depth {} exceeded at byte {}", self->settings.max_depth, self->dropped + self->pos});
+
+			event.kind = c == '{' ? Event::KIND_BEGIN_OBJECT : Event::KIND_BEGIN_ARRAY;
+			event.depth = self->stack.count;
+			buf_push(self->stack, c);
+			self->state = c == '{' ? IEvent_Parser::STATE_OBJECT_FIRST : IEvent_Parser::STATE_ARRAY_FIRST;
+			++self->pos;
+			return IEvent_Parser::STEP_EVENT;
+		}
+		else if (c == '"')
+		{
+			auto res = _event_parser_string(self, event, Event::KIND_STRING);
+			if (res == IEvent_Parser::STEP_EVENT)
+				_event_parser_value_done(self);
+			return res;
+		}
+		else if (_lexer_is_letter(c) || _lexer_is_digit(c) || c == '-' || c == '+')
+		{
+			return _event_parser_scalar(self, event);
+		}
+		return _event_parser_fail(self, Err{"unexpected '{:c}' at byte {}", c, self->dropped + self->pos});
+	}
+
+	// closes the innermost object or array if it matches the given closing character
+	inline static IEvent_Parser::STEP
+	_event_parser_close(Event_Parser self, Event& event, char c)
+	{
+		auto open = c == '}' ? '{' : '[';
+		if (self->stack.count == 0 || buf_top(self->stack) != open)
+			return _event_parser_fail(self, Err{"unexpected '{:c}' at byte {}", c, self->dropped + self->pos});
+
+		buf_pop(self->stack);
+		event.kind = c == '}' ? Event::KIND_END_OBJECT : Event::KIND_END_ARRAY;
+		event.depth = self->stack.count;
+		++self->pos;
+		_event_parser_value_done(self);
+		return IEvent_Parser::STEP_EVENT;
+	}
+
+	// parses the buffered input until it completes an event or it needs more input
+	inline static IEvent_Parser::STEP
+	_event_parser_step(Event_Parser self, Event& event)
+	{
+		while (true)
+		{
+			while (self->pos < self->input.count && _lexer_is_ws(self->input.ptr[self->pos]))
+				++self->pos;
+
+			if (self->pos == self->input.count)
+			{
+				if (self->finished == false)
+					return IEvent_Parser::STEP_NEED_INPUT;
+
+				if (self->state == IEvent_Parser::STATE_DONE ||
+					(self->state == IEvent_Parser::STATE_DOCUMENT && self->settings.multiple_documents))
+				{
+					event.kind = Event::KIND_END;
+					event.depth = 0;
+					return IEvent_Parser::STEP_EVENT;
+				}
+				return _event_parser_fail(self, Err{"unexpected end of json document at byte {}", self->dropped + self->pos});
+			}
+
+			auto c = self->input.ptr[self->pos];
+			switch (self->state)
+			{
+			case IEvent_Parser::STATE_DOCUMENT:
+			case IEvent_Parser::STATE_VALUE:
+				return _event_parser_value(self, event);
+
+			case IEvent_Parser::STATE_ARRAY_FIRST:
+				if (c == ']')
+					return _event_parser_close(self, event, c);
+				return _event_parser_value(self, event);
+
+			case IEvent_Parser::STATE_OBJECT_FIRST:
+				if (c == '}')
+					return _event_parser_close(self, event, c);
+				// fallthrough
+			case IEvent_Parser::STATE_OBJECT_KEY:
+			{
+				if (c != '"')
+					return _event_parser_fail(self, Err{"expected a key but found '{:c}' at byte {}", c, self->dropped + self->pos});
+				auto res = _event_parser_string(self, event, Event::KIND_KEY);
+				if (res == IEvent_Parser::STEP_EVENT)
+					self->state = IEvent_Parser::STATE_COLON;
+				return res;
+			}
+
+			case IEvent_Parser::STATE_COLON:
+				if (c != ':')
+					return _event_parser_fail(self, Err{"expected ':' but found '{:c}' at byte {}", c, self->dropped + self->pos});
+				++self->pos;
+				self->state = IEvent_Parser::STATE_VALUE;
+				break;
+
+			case IEvent_Parser::STATE_AFTER_VALUE:
+				if (c == ',')
+				{
+					++self->pos;
+					self->state = buf_top(self->stack) == '{' ? IEvent_Parser::STATE_OBJECT_KEY : IEvent_Parser::STATE_VALUE;
+					break;
+				}
+				else if (c == '}' || c == ']')
+				{
+					return _event_parser_close(self, event, c);
+				}
+				return _event_parser_fail(self, Err{"expected ',' or the end of the {} but found '{:c}' at byte {}", buf_top(self->stack) == '{' ? "object" : "array", c, self->dropped + self->pos});
+
+			case IEvent_Parser::STATE_DONE:
+			default:
+				return _event_parser_fail(self, Err{"unexpected '{:c}' after the json document at byte {}", c, self->dropped + self->pos});
+			}
+		}
+	}
+
+	// reads a line from the given reader and appends it to out without the line ending, it returns the count of
+	// consumed bytes which is 0 at the end of the reader, unlike readln it copies the line in chunks so it works with
+	// readers which can't peek the whole line
+	inline static size_t
+	_ndjson_read_line(Reader reader, Str& out)
+	{
+		size_t consumed = 0;
+		while (true)
+		{
+			auto bytes = reader_peek(reader, 4096);
+			if (bytes.size == 0)
+				break;
+
+			if (auto newline = (const char*)::memchr(bytes.ptr, '\n', bytes.size))
+			{
+				auto count = size_t(newline - (const char*)bytes.ptr);
+				str_block_push(out, Block{bytes.ptr, count});
+				consumed += reader_skip(reader, count + 1);
+				break;
+			}
+
+			str_block_push(out, bytes);
+			consumed += reader_skip(reader, bytes.size);
+		}
+
+		//because of the \r\n on window
+		if (out.count > 0 && out.ptr[out.count - 1] == '\r')
+		{
+			--out.count;
+			out.ptr[out.count] = '\0';
+		}
+		return consumed;
+	}
+
+	inline static bool
+	_ndjson_is_blank(const char* it, const char* end)
+	{
+		for (; it != end; ++it)
+			if (_lexer_is_ws(*it) == false)
+				return false;
+		return true;
+	}
+
+	struct Ndjson_Line
+	{
+		size_t offset;
+		size_t count;
+		size_t number;
+	};
+
+	// a batch of lines which is parsed on one of the fabric's workers, the lines are stored back to back in content
+	// and each one of them is null terminated
+	struct Ndjson_Batch
+	{
+		Str content;
+		Buf<Ndjson_Line> lines;
+	};
+
+	inline static void
+	destruct(Ndjson_Batch& self)
+	{
+		str_free(self.content);
+		buf_free(self.lines);
+	}
+
+	struct Ndjson_Parallel_State
+	{
+		Mutex mutex;
+		Cond_Var cv;
+		Waitgroup wg;
+		size_t pending_batches;
+		Ndjson_Callback* callback;
+	};
+
+	inline static void
+	_ndjson_parse_batch(Ndjson_Parallel_State* state, Ndjson_Batch* batch)
+	{
+		mn_defer({
+			destruct(*batch);
+			free(batch);
+
+			mutex_lock(state->mutex);
+			--state->pending_batches;
+			mutex_unlock(state->mutex);
+			cond_var_notify(state->cv);
+
+			waitgroup_done(state->wg);
+		});
+
+		Doc doc{};
+		mn_defer(doc_free(doc));
+
+		for (const auto& line: batch->lines)
+		{
+			Str content{};
+			content.ptr = batch->content.ptr + line.offset;
+			content.count = line.count;
+			content.cap = line.count + 1;
+			auto err = _doc_parse_into(doc, content);
+			(*state->callback)(line.number, doc, err);
+		}
+	}
+
+	// waits until the count of pending batches is below the max then sends the given batch to the fabric
+	inline static void
+	_ndjson_dispatch_batch(Ndjson_Parallel_State* state, Fabric fabric, size_t max_batches, Ndjson_Batch* batch)
+	{
+		mutex_lock(state->mutex);
+		cond_var_wait(state->cv, state->mutex, [&]{ return state->pending_batches < max_batches; });
+		++state->pending_batches;
+		mutex_unlock(state->mutex);
+
+		waitgroup_add(state->wg, 1);
+		fabric_do(fabric, [state, batch]{
+			_ndjson_parse_batch(state, batch);
+		});
+	}
+
+	// API
+	Result<Value>
+	parse(const Str& content, Parse_Settings settings)
+	{
+		Lexer lexer;
+		lexer.it = content.ptr;
+		lexer.c	= *lexer.it;
+
+		auto index = buf_new<uint32_t>();
+		mn_defer(buf_free(index));
+		if (settings.no_structural_index == false)
+			_lexer_index(lexer, content, index);
+
+		Parser parser;
+		parser.lexer = lexer;
+		parser.current = _lexer_lex(parser.lexer);
+
+		auto res = _parser_parse_value(parser);
+		if (parser.err)
+		{
+			value_free(res);
+			return parser.err;
+		}
+		return res;
+	}
+
+	Result<Doc>
+	doc_parse(const Str& content, Parse_Settings settings)
+	{
+		Doc self{};
+		if (auto err = _doc_parse_into(self, content, settings))
+		{
+			doc_free(self);
+			return err;
+		}
+		return self;
+	}
+
+	void
+	doc_free(Doc& self)
+	{
+		buf_free(self.tape);
+		// the strings and object indices live in the arena so there's no need to walk them
+		allocator_free(self.arena);
+		self.arena = nullptr;
+		self.object_indices = {};
+	}
+
+	size_t
+	doc_array_at(const Doc& self, size_t array, size_t index)
+	{
+		const auto& node = self.tape[array];
+		assert(node.kind == Value::KIND_ARRAY);
+		if (index >= node.count)
+			return SIZE_MAX;
+
+		auto it = array + 1;
+		for (size_t i = 0; i < index; ++i)
+			it = doc_next(self, it);
+		return it;
+	}
+
+	Str
+	doc_string(Doc& self, size_t index)
+	{
+		auto& node = self.tape[index];
+		assert(node.kind == Value::KIND_STRING);
+		if (node.materialized == false)
+		{
+			// the unescaped string is never longer than the escaped one
+			auto str = str_with_allocator(self.arena);
+			str_reserve(str, node.as_string.count + 1);
+			if (node.escaped)
+				_doc_unescape(str, node.as_string);
+			else
+				str_block_push(str, Block{(void*)node.as_string.ptr, node.as_string.count});
+			str_null_terminate(str);
+			node.as_string = Doc_String{str.ptr, str.count};
+			node.materialized = true;
+		}
+
+		Str res{};
+		res.ptr = (char*)node.as_string.ptr;
+		res.count = node.as_string.count;
+		res.cap = res.count + 1;
+		res.allocator = self.arena;
+		return res;
+	}
+
+	size_t
+	doc_object_lookup(Doc& self, size_t object, const Str& key)
+	{
+		const auto& node = self.tape[object];
+		assert(node.kind == Value::KIND_OBJECT);
+
+		if (node.count <= DOC_OBJECT_LINEAR_LOOKUP_LIMIT)
+		{
+			size_t res = SIZE_MAX;
+			auto it = object + 1;
+			for (size_t i = 0; i < node.count; ++i)
+			{
+				if (_doc_key_equal(self, it, key))
+					res = it + 1;
+				it = doc_next(self, it + 1);
+			}
+			return res;
+		}
+
+		auto index = map_lookup(self.object_indices, object);
+		if (index == nullptr)
+		{
+			auto keys = map_with_allocator<Str, size_t>(self.arena);
+			map_reserve(keys, node.count);
+			auto it = object + 1;
+			for (size_t i = 0; i < node.count; ++i)
+			{
+				auto key_str = doc_string(self, it);
+				if (auto key_value = map_lookup(keys, key_str))
+					key_value->value = it + 1;
+				else
+					map_insert(keys, key_str, it + 1);
+				it = doc_next(self, it + 1);
+			}
+			index = map_insert(self.object_indices, object, keys);
+		}
+
+		if (auto key_value = map_lookup(index->value, key))
+			return key_value->value;
+		return SIZE_MAX;
+	}
+
+	Value
+	doc_to_value(Doc& self, size_t index)
+	{
+		const auto node = self.tape[index];
+		switch (node.kind)
+		{
+		case Value::KIND_NULL:
+			return Value{};
+		case Value::KIND_BOOL:
+			return value_bool_new(node.as_bool);
+		case Value::KIND_NUMBER:
+			return value_number_new(float(node.as_number));
+		case Value::KIND_STRING:
+			return value_string_new(clone(doc_string(self, index)));
+		case Value::KIND_ARRAY:
+		{
+			auto array = value_array_new();
+			buf_reserve(*array.as_array, node.count);
+			for (auto it = index + 1; it < node.end; it = doc_next(self, it))
+				value_array_push(array, doc_to_value(self, it));
+			return array;
+		}
+		case Value::KIND_OBJECT:
+		{
+			auto object = value_object_new();
+			for (auto it = index + 1; it < node.end; it = doc_next(self, it + 1))
+				value_object_insert(object, doc_string(self, it), doc_to_value(self, it + 1));
+			return object;
+		}
+		default:
+			assert(false && "unreachable");
+			return Value{};
+		}
+	}
+
+	Event_Parser
+	event_parser_new(Event_Parser_Settings settings)
+	{
+		return _event_parser_new(settings);
+	}
+
+	Event_Parser
+	event_parser_stream_new(Stream stream, Event_Parser_Settings settings)
+	{
+		auto self = _event_parser_new(settings);
+		self->stream = stream;
+		return self;
+	}
+
+	Event_Parser
+	event_parser_reader_new(Reader reader, Event_Parser_Settings settings)
+	{
+		auto self = _event_parser_new(settings);
+		self->reader = reader;
+		return self;
+	}
+
+	void
+	event_parser_free(Event_Parser self)
+	{
+		str_free(self->input);
+		buf_free(self->stack);
+		str_free(self->str);
+		free_destruct(self);
+	}
+
+	void
+	event_parser_feed(Event_Parser self, Block data)
+	{
+		assert(self->finished == false && "the input is already finished");
+		_event_parser_drop_consumed(self);
+		str_block_push(self->input, data);
+	}
+
+	void
+	event_parser_finish(Event_Parser self)
+	{
+		self->finished = true;
+	}
+
+	Result<Event>
+	event_parser_next(Event_Parser self)
+	{
+		if (self->err)
+			return self->err;
+
+		Event event{};
+		while (true)
+		{
+			switch (_event_parser_step(self, event))
+			{
+			case IEvent_Parser::STEP_EVENT:
+				return event;
+			case IEvent_Parser::STEP_ERROR:
+				return self->err;
+			case IEvent_Parser::STEP_NEED_INPUT:
+			default:
+				if (self->stream == nullptr && self->reader == nullptr)
+				{
+					event.kind = Event::KIND_NEED_INPUT;
+					return event;
+				}
+				_event_parser_fill(self);
+				break;
+			}
+		}
+	}
+
+	Result<bool>
+	ndjson_next(Reader reader, Str& line, Doc& doc)
+	{
+		while (true)
+		{
+			str_clear(line);
+			if (_ndjson_read_line(reader, line) == 0)
+				return false;
+			if (_ndjson_is_blank(line.ptr, line.ptr + line.count))
+				continue;
+
+			if (auto err = _doc_parse_into(doc, line))
+				return err;
+			return true;
+		}
+	}
+
+	size_t
+	ndjson_parse_parallel(Reader reader, Fabric fabric, Ndjson_Callback callback, Ndjson_Parallel_Settings settings)
+	{
+		mn_defer(destruct(callback));
+
+		if (settings.batch_size == 0)
+			settings.batch_size = 256ULL * 1024ULL;
+		if (settings.max_batches == 0)
+			settings.max_batches = 16;
+
+		Ndjson_Parallel_State state{};
+		state.mutex = mutex_new("ndjson_parse_parallel");
+		mn_defer(mutex_free(state.mutex));
+		state.cv = cond_var_new();
+		mn_defer(cond_var_free(state.cv));
+		state.wg = waitgroup_new();
+		mn_defer(waitgroup_free(state.wg));
+		state.callback = &callback;
+
+		size_t line_number = 0;
+		size_t lines_count = 0;
+		Ndjson_Batch* batch = nullptr;
+		while (true)
+		{
+			if (batch == nullptr)
+			{
+				batch = alloc_zerod<Ndjson_Batch>();
+				batch->content = str_new();
+				batch->lines = buf_new<Ndjson_Line>();
+			}
+
+			// the line is read directly into the batch and removed if it's blank
+			auto offset = batch->content.count;
+			if (_ndjson_read_line(reader, batch->content) == 0)
+				break;
+			++line_number;
+
+			if (_ndjson_is_blank(batch->content.ptr + offset, batch->content.ptr + batch->content.count))
+			{
+				batch->content.count = offset;
+				continue;
+			}
+
+			buf_push(batch->lines, Ndjson_Line{offset, batch->content.count - offset, line_number});
+			buf_push(batch->content, '\0');
+			++lines_count;
+
+			if (batch->content.count >= settings.batch_size)
+			{
+				_ndjson_dispatch_batch(&state, fabric, settings.max_batches, batch);
+				batch = nullptr;
+			}
+		}
+
+		if (batch && batch->lines.count > 0)
+		{
+			_ndjson_dispatch_batch(&state, fabric, settings.max_batches, batch);
+		}
+		else if (batch)
+		{
+			destruct(*batch);
+			free(batch);
+		}
+
+		waitgroup_wait(state.wg);
+		return lines_count;
 	}
 }
\ No newline at end of file
@@ -0,0 +1,293 @@
+#include "mn/Path.h"
+#include "mn/File.h"
+#include "mn/Fabric.h"
+#include "mn/Thread.h"
+#include "mn/Defer.h"
+
+#include <atomic>
+
+#if OS_WINDOWS
+#include <Windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace mn
+{
+	struct Folder_Copy_File
+	{
+		Str src;
+		Str dst;
+		int64_t size;
+	};
+
+	inline static void
+	destruct(Folder_Copy_File& self)
+	{
+		str_free(self.src);
+		str_free(self.dst);
+	}
+
+	struct Folder_Copy_State
+	{
+		Mutex mutex;
+		Waitgroup wg;
+		Folder_Copy_Progress progress;
+		Folder_Copy_Progress_Callback* callback;
+		std::atomic<bool> atomic_failed;
+	};
+
+	// identifies a folder on disk no matter which path or link leads to it
+	struct Folder_Copy_Id
+	{
+		uint64_t device;
+		uint64_t index;
+	};
+
+	// gets the identity of the folder which the given path points to after following the links
+	inline static bool
+	_folder_copy_id(const char* path, Folder_Copy_Id& id)
+	{
+		#if OS_WINDOWS
+		auto os_path = path_os_encoding(path, allocator_top());
+		mn_defer(str_free(os_path));
+		auto os_str = to_os_encoding(os_path, allocator_top());
+		mn_defer(mn::free(os_str));
+
+		auto handle = CreateFile(
+			(LPCWSTR)os_str.ptr,
+			0,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			NULL,
+			OPEN_EXISTING,
+			FILE_FLAG_BACKUP_SEMANTICS,
+			NULL
+		);
+		if (handle == INVALID_HANDLE_VALUE)
+			return false;
+		mn_defer(CloseHandle(handle));
+
+		BY_HANDLE_FILE_INFORMATION info{};
+		if (GetFileInformationByHandle(handle, &info) == FALSE)
+			return false;
+		id.device = info.dwVolumeSerialNumber;
+		id.index = (uint64_t(info.nFileIndexHigh) << 32) | uint64_t(info.nFileIndexLow);
+		#else
+		struct stat sb{};
+		if (::stat(path, &sb) != 0)
+			return false;
+		id.device = uint64_t(sb.st_dev);
+		id.index = uint64_t(sb.st_ino);
+		#endif
+		return true;
+	}
+
+	// returns the size of the file which the given link points to
+	inline static int64_t
+	_folder_copy_link_size(const char* link)
+	{
+		auto file = file_open(link, IO_MODE_READ, OPEN_MODE_OPEN_ONLY);
+		if (file == nullptr)
+			return 0;
+		mn_defer(file_close(file));
+		return file_size(file);
+	}
+
+	// creates the folders of the tree and collects the files which should be copied, returns whether it succeeded,
+	// walk_path is the root and the link targets which were followed to reach src, a link to one of them is a cycle
+	inline static bool
+	_folder_copy_walk(const char* src, const char* dst, Buf<Folder_Copy_File>& files, Buf<Folder_Copy_Id>& walk_path)
+	{
+		//create the folder no matter what
+		if (folder_make(dst) == false)
+			return false;
+
+		Path_Walk_Settings settings{};
+		settings.order = PATH_WALK_ORDER_DEPTH_FIRST;
+		settings.stat = true;
+		auto walker = path_walker_new(src, settings);
+		if (walker == nullptr)
+			return false;
+		mn_defer(path_walker_free(walker));
+
+		// the walker removes the trailing separators of the root
+		auto src_count = ::strlen(src);
+		while (src_count > 1 && (src[src_count - 1] == '/' || src[src_count - 1] == '\\'))
+			--src_count;
+
+		// the walk is depth first so the folders are created before their content
+		Path_Walk_Entry entry{};
+		while (path_walker_next(walker, entry))
+		{
+			auto entry_dst = path_join(str_from_c(dst), entry.path + src_count);
+			if (entry.kind == PATH_WALK_KIND_FOLDER)
+			{
+				mn_defer(str_free(entry_dst));
+				if (folder_make(entry_dst) == false)
+					return false;
+			}
+			else if (entry.kind == PATH_WALK_KIND_FILE)
+			{
+				buf_push(files, Folder_Copy_File{str_from_c(entry.path), entry_dst, entry.size});
+			}
+			// links are followed, the walker doesn't follow them so the folder targets are walked here and the
+			// file targets are copied with their own size instead of the link's size, broken links are skipped
+			else if (entry.kind == PATH_WALK_KIND_SYMLINK && path_is_folder(entry.path))
+			{
+				mn_defer(str_free(entry_dst));
+
+				Folder_Copy_Id id{};
+				if (_folder_copy_id(entry.path, id) == false)
+					return false;
+				for (const auto& followed: walk_path)
+					if (followed.device == id.device && followed.index == id.index)
+						return false;
+
+				buf_push(walk_path, id);
+				auto res = _folder_copy_walk(entry.path, entry_dst.ptr, files, walk_path);
+				buf_pop(walk_path);
+				if (res == false)
+					return false;
+			}
+			else if (entry.kind == PATH_WALK_KIND_SYMLINK && path_is_file(entry.path))
+			{
+				buf_push(files, Folder_Copy_File{str_from_c(entry.path), entry_dst, _folder_copy_link_size(entry.path)});
+			}
+			else
+			{
+				str_free(entry_dst);
+			}
+		}
+		return true;
+	}
+
+	inline static void
+	_folder_copy_file(Folder_Copy_State* state, const Folder_Copy_File& file)
+	{
+		mn_defer(waitgroup_done(state->wg));
+
+		// once a file fails there's no point in copying the rest
+		if (state->atomic_failed.load())
+			return;
+
+		if (file_copy(file.src, file.dst) == false)
+		{
+			state->atomic_failed.store(true);
+			return;
+		}
+
+		mutex_lock(state->mutex);
+		mn_defer(mutex_unlock(state->mutex));
+
+		++state->progress.files_copied;
+		state->progress.bytes_copied += file.size;
+		if (*state->callback)
+			(*state->callback)(state->progress);
+	}
+
+	struct Path_Walk_Parallel_State
+	{
+		Fabric fabric;
+		Waitgroup wg;
+		Path_Walk_Settings settings;
+		Path_Walk_Callback* callback;
+	};
+
+	// walks the direct children of the given folder and schedules a walk for each child folder
+	inline static void
+	_path_walk_parallel_folder(Path_Walk_Parallel_State* state, Str path, size_t depth)
+	{
+		mn_defer({
+			str_free(path);
+			waitgroup_done(state->wg);
+		});
+
+		auto settings = state->settings;
+		settings.order = PATH_WALK_ORDER_DEPTH_FIRST;
+		settings.max_depth = 1;
+		auto walker = path_walker_new(path, settings);
+		if (walker == nullptr)
+			return;
+		mn_defer(path_walker_free(walker));
+
+		Path_Walk_Entry entry{};
+		while (path_walker_next(walker, entry))
+		{
+			entry.depth += depth;
+			auto walk_folder = (*state->callback)(entry);
+			if (entry.kind != PATH_WALK_KIND_FOLDER || walk_folder == false)
+				continue;
+			if (state->settings.max_depth != 0 && entry.depth >= state->settings.max_depth)
+				continue;
+
+			waitgroup_add(state->wg, 1);
+			fabric_do(state->fabric, [state, folder_path = str_from_c(entry.path), folder_depth = entry.depth]{
+				_path_walk_parallel_folder(state, folder_path, folder_depth);
+			});
+		}
+	}
+
+	// API
+	bool
+	path_walk_parallel(const char* root, Fabric fabric, Path_Walk_Callback callback, Path_Walk_Settings settings)
+	{
+		mn_defer(destruct(callback));
+
+		if (path_is_folder(root) == false)
+			return false;
+
+		Path_Walk_Parallel_State state{};
+		state.fabric = fabric;
+		state.wg = waitgroup_new();
+		mn_defer(waitgroup_free(state.wg));
+		state.settings = settings;
+		state.callback = &callback;
+
+		waitgroup_add(state.wg, 1);
+		fabric_do(fabric, [state = &state, path = str_from_c(root)]{
+			_path_walk_parallel_folder(state, path, 0);
+		});
+		waitgroup_wait(state.wg);
+		return true;
+	}
+
+	bool
+	folder_copy(const char* src, const char* dst, Fabric fabric, Folder_Copy_Progress_Callback progress)
+	{
+		mn_defer(destruct(progress));
+
+		auto files = buf_new<Folder_Copy_File>();
+		mn_defer(destruct(files));
+
+		auto walk_path = buf_new<Folder_Copy_Id>();
+		mn_defer(buf_free(walk_path));
+		Folder_Copy_Id root_id{};
+		if (_folder_copy_id(src, root_id) == false)
+			return false;
+		buf_push(walk_path, root_id);
+
+		if (_folder_copy_walk(src, dst, files, walk_path) == false)
+			return false;
+
+		Folder_Copy_State state{};
+		state.mutex = mutex_new("folder_copy progress");
+		mn_defer(mutex_free(state.mutex));
+		state.wg = waitgroup_new();
+		mn_defer(waitgroup_free(state.wg));
+		state.callback = &progress;
+		state.progress.files_count = files.count;
+		for (const auto& file: files)
+			state.progress.bytes_count += file.size;
+
+		for (const auto& file: files)
+		{
+			waitgroup_add(state.wg, 1);
+			fabric_do(fabric, [state = &state, file = &file]{
+				_folder_copy_file(state, *file);
+			});
+		}
+		waitgroup_wait(state.wg);
+
+		return state.atomic_failed.load() == false;
+	}
+}
@@ -1,16 +1,367 @@
 #include "mn/Pool.h"
 #include "mn/Memory.h"
 #include "mn/OS.h"
+#include "mn/Defer.h"
+
+#include <atomic>
+#include <thread>
+
+#include <stdlib.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace mn
 {
+	// number of free elements a magazine can hold
+	constexpr static size_t POOL_MAGAZINE_SIZE = 32;
+	// magazines are allocated in chunks which double in size, the first chunk holds this many magazines
+	constexpr static size_t POOL_MAGAZINE_FIRST_CHUNK_SIZE = 64;
+	constexpr static size_t POOL_MAGAZINE_CHUNKS_COUNT = 24;
+	// maximum number of live concurrent pools with thread local magazines, the rest share their magazines under a lock
+	constexpr static size_t POOL_LOCAL_CACHES_COUNT = 64;
+
+	// a magazine is a fixed size stack of free elements, each thread caches two magazines per concurrent pool and
+	// exchanges whole magazines with the pool's depot, the depot refers to magazines by their 1 based index
+	struct Pool_Magazine
+	{
+		// index of the next magazine in the depot stack
+		std::atomic<uint32_t> atomic_next;
+		uint32_t index;
+		uint32_t count;
+		void* slots[POOL_MAGAZINE_SIZE];
+	};
+
+	// the two magazines cached by a thread for a concurrent pool, a loaded and a previous one as described in
+	// "Magazines and Vmem" by Jeff Bonwick and Jonathan Adams
+	struct Pool_Local_Cache
+	{
+		uint64_t pool_id;
+		Pool_Magazine* loaded;
+		Pool_Magazine* previous;
+	};
+
+	struct IPool_Concurrent
+	{
+		uint64_t id;
+		// index of the pool's thread local caches, it's POOL_LOCAL_CACHES_COUNT if it doesn't have one
+		size_t local_index;
+		// protects the arena and the magazines allocation
+		Mutex mtx;
+		// used when the pool doesn't have thread local caches, it's protected by the shared mutex
+		Mutex shared_mtx;
+		Pool_Local_Cache shared_cache;
+		// depots are lock free stacks of magazines, the top magazine index is stored in the lower 32 bits and
+		// a tag which is incremented on each operation is stored in the upper 32 bits to avoid the ABA problem
+		std::atomic<uint64_t> atomic_full_depot;
+		std::atomic<uint64_t> atomic_empty_depot;
+		uint32_t magazines_count;
+		std::atomic<Pool_Magazine*> atomic_magazine_chunks[POOL_MAGAZINE_CHUNKS_COUNT];
+	};
+
 	struct IPool
 	{
 		Allocator meta_allocator;
 		Allocator arena;
 		void* head;
 		size_t element_size;
+		// not null for pools created using pool_concurrent_new
+		IPool_Concurrent* concurrent;
+	};
+
+	// registry of the live concurrent pools which have thread local caches, it's used to check whether the pool is
+	// still alive when a thread exits, it's protected by a spin lock because it's only touched when concurrent pools
+	// are created, freed, or when threads exit
+	struct Pool_Registry
+	{
+		std::atomic_flag lock = ATOMIC_FLAG_INIT;
+		uint64_t next_id = 1;
+		IPool_Concurrent* pools[POOL_LOCAL_CACHES_COUNT];
 	};
+	static Pool_Registry POOL_REGISTRY;
+
+	inline static void
+	_pool_registry_lock()
+	{
+		while (POOL_REGISTRY.lock.test_and_set(std::memory_order_acquire))
+			std::this_thread::yield();
+	}
+
+	inline static void
+	_pool_registry_unlock()
+	{
+		POOL_REGISTRY.lock.clear(std::memory_order_release);
+	}
+
+	// only a pointer to the thread's caches is kept in the thread local storage, it's small enough for the initial
+	// exec model which makes accessing it as cheap as a normal memory load even when mn is built as a shared library
+	#if defined(_MSC_VER)
+	static thread_local Pool_Local_Cache* LOCAL_POOL_CACHES = nullptr;
+	#else
+	static thread_local Pool_Local_Cache* LOCAL_POOL_CACHES __attribute__((tls_model("initial-exec"))) = nullptr;
+	#endif
+
+	inline static size_t
+	_pool_msb(size_t v)
+	{
+	#if defined(_MSC_VER)
+		unsigned long index = 0;
+		_BitScanReverse64(&index, v);
+		return index;
+	#else
+		return sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(v);
+	#endif
+	}
+
+	inline static Pool_Magazine*
+	_pool_magazine(IPool_Concurrent* self, uint32_t index)
+	{
+		// chunk k holds POOL_MAGAZINE_FIRST_CHUNK_SIZE << k magazines
+		size_t i = size_t(index - 1) + POOL_MAGAZINE_FIRST_CHUNK_SIZE;
+		size_t chunk = _pool_msb(i) - _pool_msb(POOL_MAGAZINE_FIRST_CHUNK_SIZE);
+		size_t offset = i - (POOL_MAGAZINE_FIRST_CHUNK_SIZE << chunk);
+		return self->atomic_magazine_chunks[chunk].load(std::memory_order_acquire) + offset;
+	}
+
+	inline static void
+	_pool_depot_push(std::atomic<uint64_t>& depot, Pool_Magazine* magazine)
+	{
+		auto index = magazine->index;
+		auto head = depot.load(std::memory_order_relaxed);
+		uint64_t new_head = 0;
+		do
+		{
+			magazine->atomic_next.store(uint32_t(head), std::memory_order_relaxed);
+			new_head = (((head >> 32) + 1) << 32) | index;
+		} while (depot.compare_exchange_weak(head, new_head, std::memory_order_release, std::memory_order_relaxed) == false);
+	}
+
+	inline static Pool_Magazine*
+	_pool_depot_pop(IPool_Concurrent* self, std::atomic<uint64_t>& depot)
+	{
+		auto head = depot.load(std::memory_order_acquire);
+		while (uint32_t(head) != 0)
+		{
+			// the magazine might be popped and reused by another thread meanwhile, the tag will fail the exchange then
+			auto next = _pool_magazine(self, uint32_t(head))->atomic_next.load(std::memory_order_relaxed);
+			auto new_head = (((head >> 32) + 1) << 32) | next;
+			if (depot.compare_exchange_weak(head, new_head, std::memory_order_acquire, std::memory_order_acquire))
+				return _pool_magazine(self, uint32_t(head));
+		}
+		return nullptr;
+	}
+
+	// allocates a new magazine, it should be called while holding the pool mutex
+	inline static Pool_Magazine*
+	_pool_magazine_new(Pool self)
+	{
+		auto concurrent = self->concurrent;
+		size_t i = size_t(concurrent->magazines_count) + POOL_MAGAZINE_FIRST_CHUNK_SIZE;
+		size_t chunk = _pool_msb(i) - _pool_msb(POOL_MAGAZINE_FIRST_CHUNK_SIZE);
+		if (chunk >= POOL_MAGAZINE_CHUNKS_COUNT)
+			panic("pool magazines limit reached");
+
+		if (concurrent->atomic_magazine_chunks[chunk].load(std::memory_order_relaxed) == nullptr)
+		{
+			auto chunk_size = POOL_MAGAZINE_FIRST_CHUNK_SIZE << chunk;
+			auto magazines = (Pool_Magazine*)alloc_from(self->meta_allocator, chunk_size * sizeof(Pool_Magazine), alignof(Pool_Magazine)).ptr;
+			for (size_t j = 0; j < chunk_size; ++j)
+				::new (magazines + j) Pool_Magazine{};
+			concurrent->atomic_magazine_chunks[chunk].store(magazines, std::memory_order_release);
+		}
+
+		auto magazine = _pool_magazine(concurrent, ++concurrent->magazines_count);
+		magazine->index = concurrent->magazines_count;
+		return magazine;
+	}
+
+	// allocates a new magazine which is full of new elements from the arena
+	inline static Pool_Magazine*
+	_pool_magazine_new_full(Pool self)
+	{
+		mutex_lock(self->concurrent->mtx);
+		mn_defer(mutex_unlock(self->concurrent->mtx));
+
+		auto magazine = _pool_magazine_new(self);
+		auto block = alloc_from(self->arena, self->element_size * POOL_MAGAZINE_SIZE, alignof(char));
+		for (size_t i = 0; i < POOL_MAGAZINE_SIZE; ++i)
+			magazine->slots[i] = (char*)block.ptr + i * self->element_size;
+		magazine->count = POOL_MAGAZINE_SIZE;
+		return magazine;
+	}
+
+	inline static Pool_Magazine*
+	_pool_magazine_new_empty(Pool self)
+	{
+		mutex_lock(self->concurrent->mtx);
+		mn_defer(mutex_unlock(self->concurrent->mtx));
+
+		auto magazine = _pool_magazine_new(self);
+		magazine->count = 0;
+		return magazine;
+	}
+
+	inline static void
+	_pool_local_cache_release(IPool_Concurrent* self, Pool_Local_Cache& cache)
+	{
+		for (auto magazine: {cache.loaded, cache.previous})
+		{
+			if (magazine == nullptr)
+				continue;
+
+			if (magazine->count > 0)
+				_pool_depot_push(self->atomic_full_depot, magazine);
+			else
+				_pool_depot_push(self->atomic_empty_depot, magazine);
+		}
+		cache = Pool_Local_Cache{};
+	}
+
+	// gives the magazines cached by an exiting thread back to their pools
+	struct Pool_Local_Caches_Guard
+	{
+		bool registered;
+
+		~Pool_Local_Caches_Guard()
+		{
+			if (LOCAL_POOL_CACHES == nullptr)
+				return;
+
+			_pool_registry_lock();
+			for (size_t i = 0; i < POOL_LOCAL_CACHES_COUNT; ++i)
+			{
+				auto& cache = LOCAL_POOL_CACHES[i];
+				auto pool = POOL_REGISTRY.pools[i];
+				if (pool && cache.pool_id == pool->id)
+					_pool_local_cache_release(pool, cache);
+			}
+			_pool_registry_unlock();
+
+			::free(LOCAL_POOL_CACHES);
+			LOCAL_POOL_CACHES = nullptr;
+		}
+	};
+	static thread_local Pool_Local_Caches_Guard LOCAL_POOL_CACHES_GUARD;
+
+	inline static Pool_Local_Cache&
+	_pool_local_cache(Pool self)
+	{
+		auto caches = LOCAL_POOL_CACHES;
+		if (caches == nullptr)
+		{
+			caches = (Pool_Local_Cache*)::calloc(POOL_LOCAL_CACHES_COUNT, sizeof(Pool_Local_Cache));
+			if (caches == nullptr)
+				panic("system out of memory");
+			LOCAL_POOL_CACHES = caches;
+			// touching the guard registers its destructor, which releases the caches on thread exit
+			LOCAL_POOL_CACHES_GUARD.registered = true;
+		}
+
+		auto concurrent = self->concurrent;
+		auto& cache = caches[concurrent->local_index];
+		if (cache.pool_id != concurrent->id)
+		{
+			// the cache belonged to a freed pool, its magazines were freed with it
+			cache.pool_id = concurrent->id;
+			cache.loaded = nullptr;
+			cache.previous = nullptr;
+		}
+		return cache;
+	}
+
+	inline static void*
+	_pool_cache_get(Pool self, Pool_Local_Cache& cache)
+	{
+		auto concurrent = self->concurrent;
+		while (true)
+		{
+			if (cache.loaded && cache.loaded->count > 0)
+				return cache.loaded->slots[--cache.loaded->count];
+
+			if (cache.previous && cache.previous->count > 0)
+			{
+				std::swap(cache.loaded, cache.previous);
+				continue;
+			}
+
+			// both magazines are empty, exchange the previous one with a full one from the depot
+			auto full = _pool_depot_pop(concurrent, concurrent->atomic_full_depot);
+			if (full == nullptr)
+				full = _pool_magazine_new_full(self);
+
+			if (cache.previous)
+				_pool_depot_push(concurrent->atomic_empty_depot, cache.previous);
+			cache.previous = cache.loaded;
+			cache.loaded = full;
+		}
+	}
+
+	inline static void
+	_pool_cache_put(Pool self, Pool_Local_Cache& cache, void* ptr)
+	{
+		auto concurrent = self->concurrent;
+		while (true)
+		{
+			if (cache.loaded && cache.loaded->count < POOL_MAGAZINE_SIZE)
+			{
+				cache.loaded->slots[cache.loaded->count++] = ptr;
+				return;
+			}
+
+			if (cache.previous && cache.previous->count < POOL_MAGAZINE_SIZE)
+			{
+				std::swap(cache.loaded, cache.previous);
+				continue;
+			}
+
+			// both magazines are full, exchange the previous one with an empty one from the depot
+			auto empty = _pool_depot_pop(concurrent, concurrent->atomic_empty_depot);
+			if (empty == nullptr)
+				empty = _pool_magazine_new_empty(self);
+
+			if (cache.previous)
+				_pool_depot_push(concurrent->atomic_full_depot, cache.previous);
+			cache.previous = cache.loaded;
+			cache.loaded = empty;
+		}
+	}
+
+	inline static void
+	_pool_concurrent_get_n(Pool self, void** ptrs, size_t count)
+	{
+		if (self->concurrent->local_index < POOL_LOCAL_CACHES_COUNT)
+		{
+			auto& cache = _pool_local_cache(self);
+			for (size_t i = 0; i < count; ++i)
+				ptrs[i] = _pool_cache_get(self, cache);
+		}
+		else
+		{
+			mutex_lock(self->concurrent->shared_mtx);
+			mn_defer(mutex_unlock(self->concurrent->shared_mtx));
+			for (size_t i = 0; i < count; ++i)
+				ptrs[i] = _pool_cache_get(self, self->concurrent->shared_cache);
+		}
+	}
+
+	inline static void
+	_pool_concurrent_put_n(Pool self, void** ptrs, size_t count)
+	{
+		if (self->concurrent->local_index < POOL_LOCAL_CACHES_COUNT)
+		{
+			auto& cache = _pool_local_cache(self);
+			for (size_t i = 0; i < count; ++i)
+				_pool_cache_put(self, cache, ptrs[i]);
+		}
+		else
+		{
+			mutex_lock(self->concurrent->shared_mtx);
+			mn_defer(mutex_unlock(self->concurrent->shared_mtx));
+			for (size_t i = 0; i < count; ++i)
+				_pool_cache_put(self, self->concurrent->shared_cache, ptrs[i]);
+		}
+	}
 
 	Pool
 	pool_new(size_t element_size, size_t bucket_size, Allocator meta_allocator)
@@ -24,6 +375,37 @@ namespace mn
 		self->arena = allocator_arena_new(element_size * bucket_size, meta_allocator);
 		self->head = nullptr;
 		self->element_size = element_size;
+		self->concurrent = nullptr;
+		return self;
+	}
+
+	Pool
+	pool_concurrent_new(size_t element_size, size_t bucket_size, Allocator meta_allocator)
+	{
+		if (bucket_size < POOL_MAGAZINE_SIZE)
+			bucket_size = POOL_MAGAZINE_SIZE;
+
+		auto self = pool_new(element_size, bucket_size, meta_allocator);
+		auto concurrent = alloc_from<IPool_Concurrent>(meta_allocator);
+		::new (concurrent) IPool_Concurrent{};
+		concurrent->mtx = mutex_new("concurrent pool");
+		concurrent->shared_mtx = mutex_new("concurrent pool shared cache");
+		concurrent->local_index = POOL_LOCAL_CACHES_COUNT;
+
+		_pool_registry_lock();
+		concurrent->id = POOL_REGISTRY.next_id++;
+		for (size_t i = 0; i < POOL_LOCAL_CACHES_COUNT; ++i)
+		{
+			if (POOL_REGISTRY.pools[i] == nullptr)
+			{
+				POOL_REGISTRY.pools[i] = concurrent;
+				concurrent->local_index = i;
+				break;
+			}
+		}
+		_pool_registry_unlock();
+
+		self->concurrent = concurrent;
 		return self;
 	}
 
@@ -32,6 +414,28 @@ namespace mn
 	{
 		if (self == nullptr)
 			return;
+
+		if (auto concurrent = self->concurrent)
+		{
+			if (concurrent->local_index < POOL_LOCAL_CACHES_COUNT)
+			{
+				_pool_registry_lock();
+				POOL_REGISTRY.pools[concurrent->local_index] = nullptr;
+				_pool_registry_unlock();
+			}
+
+			for (size_t i = 0; i < POOL_MAGAZINE_CHUNKS_COUNT; ++i)
+			{
+				auto chunk_size = POOL_MAGAZINE_FIRST_CHUNK_SIZE << i;
+				if (auto magazines = concurrent->atomic_magazine_chunks[i].load())
+					free_from(self->meta_allocator, Block{ magazines, chunk_size * sizeof(Pool_Magazine) });
+			}
+			mutex_free(concurrent->mtx);
+			mutex_free(concurrent->shared_mtx);
+			concurrent->~IPool_Concurrent();
+			free_from(self->meta_allocator, concurrent);
+		}
+
 		allocator_free(self->arena);
 		free_from(self->meta_allocator, self);
 	}
@@ -39,6 +443,13 @@ namespace mn
 	void*
 	pool_get(Pool self)
 	{
+		if (self->concurrent)
+		{
+			void* result = nullptr;
+			_pool_concurrent_get_n(self, &result, 1);
+			return result;
+		}
+
 		if(self->head != nullptr)
 		{
 			void* result = self->head;
@@ -52,6 +463,12 @@ namespace mn
 	void
 	pool_put(Pool self, void* ptr)
 	{
+		if (self->concurrent)
+		{
+			_pool_concurrent_put_n(self, &ptr, 1);
+			return;
+		}
+
 		#ifdef DEBUG
 		auto arena = (memory::Arena*) self->arena;
 		assert(arena->owns(ptr) && "pool does not own this pointer, you can only call pool_put on pointers returned by this instance's pool_get");
@@ -74,4 +491,30 @@ namespace mn
 		*sptr = (uintptr_t)self->head;
 		self->head = ptr;
 	}
-}
\ No newline at end of file
+
+	void
+	pool_get_n(Pool self, void** ptrs, size_t count)
+	{
+		if (self->concurrent)
+		{
+			_pool_concurrent_get_n(self, ptrs, count);
+			return;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+			ptrs[i] = pool_get(self);
+	}
+
+	void
+	pool_put_n(Pool self, void** ptrs, size_t count)
+	{
+		if (self->concurrent)
+		{
+			_pool_concurrent_put_n(self, ptrs, count);
+			return;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+			pool_put(self, ptrs[i]);
+	}
+}
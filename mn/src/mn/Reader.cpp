@@ -3,6 +3,8 @@
 #include "mn/Memory_Stream.h"
 #include "mn/File.h"
 #include "mn/Pool.h"
+#include "mn/Defer.h"
+#include "mn/Virtual_Memory.h"
 
 #include <assert.h>
 
@@ -14,8 +16,78 @@ namespace mn
 		Stream stream;
 		IMemory_Stream buffer;
 		size_t consumed_bytes;
+		// the mapped file which the reader reads from directly without copying it into the buffer
+		Mapped_File* mapped;
+		bool owns_mapped;
+		// the unconsumed part of the mapped file, the last byte is held back from peeks because the parsing functions
+		// (strtoull, etc..) might scan past the end of the peeked data looking for the end of a token, once a peek
+		// needs it the rest of the file is copied into the buffer which is null terminated
+		Block mapped_view;
+		// the fixed capacity ring buffer, the unconsumed data is in the range [ring_head, ring_tail) of the buffer, in a
+		// mirrored ring the head is kept below the capacity and the tail can go into the mirrored pages, one byte is
+		// always kept free to null terminate the data
+		Block ring;
+		bool ring_mirrored;
+		size_t ring_refill_watermark;
+		uint64_t ring_head;
+		uint64_t ring_tail;
 	};
 
+	inline static char*
+	_reader_ring_ptr(Reader self, uint64_t position)
+	{
+		return (char*)self->ring.ptr + position;
+	}
+
+	// reads as much as the ring's free space allows from the stream, and returns the read size
+	inline static size_t
+	_reader_ring_refill(Reader self)
+	{
+		if (self->stream == nullptr)
+			return 0;
+
+		auto available_size = self->ring_tail - self->ring_head;
+		if (self->ring_mirrored == false)
+		{
+			// move the data to the start of the buffer when it's empty or less than half of the free space is after it
+			auto total_free_size = self->ring.size - 1 - available_size;
+			if (self->ring_head > 0 && (available_size == 0 || self->ring.size - 1 - self->ring_tail < total_free_size / 2))
+			{
+				::memmove(self->ring.ptr, _reader_ring_ptr(self, self->ring_head), available_size);
+				self->ring_head = 0;
+				self->ring_tail = available_size;
+				*_reader_ring_ptr(self, self->ring_tail) = '\0';
+			}
+		}
+
+		size_t free_size = 0;
+		if (self->ring_mirrored)
+			free_size = self->ring.size - 1 - available_size;
+		else
+			free_size = self->ring.size - 1 - self->ring_tail;
+		if (free_size == 0)
+			return 0;
+
+		// in a mirrored ring the free space is contiguous even if it wraps around
+		auto read_size = stream_read(self->stream, Block{_reader_ring_ptr(self, self->ring_tail), free_size});
+		if (read_size == size_t(-1))
+			return 0;
+		self->ring_tail += read_size;
+		*_reader_ring_ptr(self, self->ring_tail) = '\0';
+		return read_size;
+	}
+
+	// copies the rest of the mapped file into the buffer
+	inline static void
+	_reader_mapped_view_to_buffer(Reader self)
+	{
+		memory_stream_clear(&self->buffer);
+		memory_stream_write(&self->buffer, self->mapped_view);
+		str_null_terminate(self->buffer.str);
+		memory_stream_cursor_to_start(&self->buffer);
+		self->mapped_view = Block{};
+	}
+
 	struct Stdin_Reader_Wrapper
 	{
 		IReader self;
@@ -50,6 +122,11 @@ namespace mn
 		self->buffer.str = str_with_allocator(allocator);
 		self->buffer.cursor = 0;
 		self->consumed_bytes = 0;
+		self->mapped = nullptr;
+		self->owns_mapped = false;
+		self->mapped_view = Block{};
+		self->ring = Block{};
+		self->ring_mirrored = false;
 		return self;
 	}
 
@@ -62,6 +139,32 @@ namespace mn
 		self->buffer.str = str_with_allocator(allocator);
 		self->buffer.cursor = 0;
 		self->consumed_bytes = 0;
+		self->mapped = nullptr;
+		self->owns_mapped = false;
+		self->mapped_view = Block{};
+		self->ring = Block{};
+		self->ring_mirrored = false;
+		return self;
+	}
+
+	Reader
+	reader_ring_new(Stream stream, Reader_Ring_Settings settings, Allocator allocator)
+	{
+		if (settings.capacity == 0)
+			settings.capacity = 64ULL * 1024ULL;
+
+		Reader self = reader_new(stream, allocator);
+		self->ring_refill_watermark = settings.refill_watermark;
+		if (settings.disable_mirroring == false)
+		{
+			self->ring = virtual_alloc_mirrored(settings.capacity);
+			self->ring_mirrored = self->ring.ptr != nullptr;
+		}
+		if (self->ring_mirrored == false)
+			self->ring = alloc_from(allocator, settings.capacity, alignof(char));
+		self->ring_head = 0;
+		self->ring_tail = 0;
+		*_reader_ring_ptr(self, 0) = '\0';
 		return self;
 	}
 
@@ -75,11 +178,56 @@ namespace mn
 		self->buffer.str = str_with_allocator(allocator);
 		self->buffer.cursor = 0;
 		self->consumed_bytes = 0;
+		self->mapped = nullptr;
+		self->owns_mapped = false;
+		self->mapped_view = Block{};
+		self->ring = Block{};
+		self->ring_mirrored = false;
 		memory_stream_write(&self->buffer, Block{ str.ptr, str.count });
 		memory_stream_cursor_to_start(&self->buffer);
 		return self;
 	}
 
+	Reader
+	reader_mapped(Mapped_File* file, Allocator allocator)
+	{
+		Reader self = alloc_from<IReader>(allocator);
+		self->allocator = allocator;
+		self->stream = nullptr;
+		self->buffer.str = str_with_allocator(allocator);
+		self->buffer.cursor = 0;
+		self->consumed_bytes = 0;
+		self->mapped = file;
+		self->owns_mapped = false;
+		self->mapped_view = file ? file->data : Block{};
+		self->ring = Block{};
+		self->ring_mirrored = false;
+		return self;
+	}
+
+	Reader
+	reader_mapped(const char* filename, Allocator allocator)
+	{
+		auto file = file_open(filename, IO_MODE_READ, OPEN_MODE_OPEN_ONLY);
+		if (file == nullptr)
+			return nullptr;
+		mn_defer(file_close(file));
+
+		// empty files can't be mapped
+		auto size = file_size(file);
+		if (size <= 0)
+			return reader_mapped((Mapped_File*)nullptr, allocator);
+
+		auto mapped = file_mmap(file, 0, 0, IO_MODE_READ);
+		if (mapped == nullptr)
+			return nullptr;
+		file_mmap_hint(mapped, MAPPED_FILE_HINT_SEQUENTIAL | MAPPED_FILE_HINT_HUGE_PAGES);
+
+		auto self = reader_mapped(mapped, allocator);
+		self->owns_mapped = true;
+		return self;
+	}
+
 	Reader
 	reader_wrap_str(Reader self, const Str& str)
 	{
@@ -97,6 +245,12 @@ namespace mn
 	void
 	reader_free(Reader self)
 	{
+		if (self->owns_mapped)
+			file_unmap(self->mapped);
+		if (self->ring_mirrored)
+			virtual_free_mirrored(self->ring);
+		else if (self->ring.ptr)
+			free_from(self->allocator, self->ring);
 		str_free(self->buffer.str);
 		free_from(self->allocator, self);
 	}
@@ -104,6 +258,29 @@ namespace mn
 	Block
 	reader_peek(Reader self, size_t size)
 	{
+		if (self->mapped_view.size > 0)
+		{
+			auto available_size = self->mapped_view.size - 1;
+			if (available_size > 0 && size <= available_size)
+				return Block{self->mapped_view.ptr, available_size};
+			_reader_mapped_view_to_buffer(self);
+		}
+
+		if (self->ring.ptr)
+		{
+			if (size > self->ring.size - 1)
+				size = self->ring.size - 1;
+			auto available_size = self->ring_tail - self->ring_head;
+			if (size > 0 && (available_size < size || available_size < self->ring_refill_watermark))
+				available_size += _reader_ring_refill(self);
+			return Block{_reader_ring_ptr(self, self->ring_head), available_size};
+		}
+
+		//reset the consumed buffer here instead of in reader_skip because readln_view might be pointing to it, this
+		//also null terminates it so the parsing functions don't see the stale data on an empty peek
+		if(self->buffer.cursor > 0 && self->buffer.str.count - self->buffer.cursor == 0)
+			memory_stream_clear(&self->buffer);
+
 		//get the available data in the buffer
 		size_t available_size = self->buffer.str.count - self->buffer.cursor;
 
@@ -119,6 +296,7 @@ namespace mn
 			memory_stream_cursor_to_end(&self->buffer);
 			if(self->stream)
 				available_size += memory_stream_pipe(&self->buffer, self->stream, diff);
+			str_null_terminate(self->buffer.str);
 			self->buffer.cursor = old_cursor;
 		}
 		return memory_stream_block_ahead(&self->buffer, available_size);
@@ -127,13 +305,36 @@ namespace mn
 	size_t
 	reader_skip(Reader self, size_t size)
 	{
+		if (self->mapped_view.size > 0)
+		{
+			size_t result = self->mapped_view.size < size ? self->mapped_view.size : size;
+			self->mapped_view = self->mapped_view + result;
+			self->consumed_bytes += result;
+			return result;
+		}
+
+		if (self->ring.ptr)
+		{
+			auto available_size = self->ring_tail - self->ring_head;
+			size_t result = available_size < size ? available_size : size;
+			self->ring_head += result;
+			// the consumed data is kept as is because readln_view might be pointing to it, the refill moves the
+			// positions back to the start of the buffer
+			if (self->ring_head >= self->ring.size)
+			{
+				// the head went into the mirrored pages so we wrap both positions back
+				self->ring_head -= self->ring.size;
+				self->ring_tail -= self->ring.size;
+			}
+			self->consumed_bytes += result;
+			return result;
+		}
+
 		//get the available data in the buffer
 		size_t available_size = self->buffer.str.count - self->buffer.cursor;
 
 		size_t result = available_size < size ? available_size : size;
 		memory_stream_cursor_move(&self->buffer, result);
-		if(self->buffer.str.count - self->buffer.cursor == 0)
-			memory_stream_clear(&self->buffer);
 		self->consumed_bytes += result;
 		return result;
 	}
@@ -145,6 +346,34 @@ namespace mn
 		if(data.size == 0)
 			return 0;
 
+		if (self->mapped_view.size > 0)
+		{
+			size_t result = self->mapped_view.size < data.size ? self->mapped_view.size : data.size;
+			::memcpy(data.ptr, self->mapped_view.ptr, result);
+			self->mapped_view = self->mapped_view + result;
+			self->consumed_bytes += result;
+			return result;
+		}
+
+		if (self->ring.ptr)
+		{
+			auto available_size = self->ring_tail - self->ring_head;
+			size_t read_size = available_size < data.size ? available_size : data.size;
+			::memcpy(data.ptr, _reader_ring_ptr(self, self->ring_head), read_size);
+			reader_skip(self, read_size);
+			// big reads skip the ring buffer and go directly to the stream
+			if (read_size < data.size && self->stream)
+			{
+				auto stream_read_size = stream_read(self->stream, data + read_size);
+				if (stream_read_size != size_t(-1))
+				{
+					read_size += stream_read_size;
+					self->consumed_bytes += stream_read_size;
+				}
+			}
+			return read_size;
+		}
+
 		size_t request_size = data.size;
 		size_t read_size = 0;
 		//get the available data in the buffer
@@ -178,6 +407,11 @@ namespace mn
 	float
 	reader_progress(Reader reader)
 	{
+		if (reader->mapped && reader->mapped->data.size > 0)
+			return float(reader->consumed_bytes) / float(reader->mapped->data.size);
+		if (reader->stream == nullptr)
+			return 0.0f;
+
 		int64_t size = stream_size(reader->stream);
 		if (size == 0)
 			return 0.0f;
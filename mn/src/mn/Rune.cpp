@@ -1,21 +1,528 @@
 #include "mn/Rune.h"
+#include "mn/SIMD.h"
 
 #include "utf8proc/utf8proc.h"
 
 #include <assert.h>
+#include <string.h>
+
+#if ARCH_X86 && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MN_RUNE_SIMD 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define MN_RUNE_SSSE3
+#define MN_RUNE_AVX2
+#else
+#define MN_RUNE_SSSE3 __attribute__((target("ssse3")))
+#define MN_RUNE_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define MN_RUNE_SIMD 0
+#endif
 
 namespace mn
 {
-	size_t
-	rune_count(const char* str)
+	inline static size_t
+	_rune_count_scalar(const char* str, size_t count)
 	{
 		size_t result = 0;
-		while(str != nullptr && *str != '\0')
+		for (size_t i = 0; i < count; ++i)
+			result += ((str[i] & 0xC0) != 0x80);
+		return result;
+	}
+
+	inline static size_t
+	_rune_ascii_prefix_scalar(const char* str, size_t count)
+	{
+		size_t i = 0;
+		while (i < count && uint8_t(str[i]) < 0x80)
+			++i;
+		return i;
+	}
+
+	inline static size_t
+	_rune_ascii_map_scalar(char* dst, const char* src, size_t count, char first, char last)
+	{
+		size_t i = 0;
+		for (; i < count && uint8_t(src[i]) < 0x80; ++i)
 		{
-			result += ((*str & 0xC0) != 0x80);
-			++str;
+			auto c = src[i];
+			dst[i] = (c >= first && c <= last) ? char(c ^ 0x20) : c;
 		}
-		return result;
+		return i;
+	}
+
+	// validates utf-8 one sequence at a time according to the well-formed byte sequences table of the unicode standard
+	inline static bool
+	_rune_utf8_valid_scalar(const uint8_t* str, size_t count)
+	{
+		size_t i = 0;
+		while (i < count)
+		{
+			auto c = str[i];
+			if (c < 0x80)
+			{
+				++i;
+				continue;
+			}
+
+			size_t continuation_count = 0;
+			uint8_t low = 0x80, high = 0xBF;
+			if (c >= 0xC2 && c <= 0xDF)
+			{
+				continuation_count = 1;
+			}
+			else if (c >= 0xE0 && c <= 0xEF)
+			{
+				continuation_count = 2;
+				if (c == 0xE0)
+					low = 0xA0;
+				else if (c == 0xED)
+					high = 0x9F;
+			}
+			else if (c >= 0xF0 && c <= 0xF4)
+			{
+				continuation_count = 3;
+				if (c == 0xF0)
+					low = 0x90;
+				else if (c == 0xF4)
+					high = 0x8F;
+			}
+			else
+			{
+				return false;
+			}
+
+			if (count - i - 1 < continuation_count)
+				return false;
+			if (str[i + 1] < low || str[i + 1] > high)
+				return false;
+			for (size_t j = 2; j <= continuation_count; ++j)
+				if ((str[i + j] & 0xC0) != 0x80)
+					return false;
+			i += continuation_count + 1;
+		}
+		return true;
+	}
+
+#if MN_RUNE_SIMD
+	inline static bool
+	_rune_avx2_supported()
+	{
+		static const bool supported = mn_simd_support_check().avx2_supportted;
+		return supported;
+	}
+
+	inline static bool
+	_rune_ssse3_supported()
+	{
+		static const bool supported = mn_simd_support_check().ssse3_supportted;
+		return supported;
+	}
+
+	// counts the bytes which aren't continuation bytes (0x80-0xBF which are < -64 as signed bytes), the per byte
+	// counters are summed every 255 blocks before they overflow
+	inline static size_t
+	_rune_count_sse2(const char* str, size_t count)
+	{
+		const auto continuation_limit = _mm_set1_epi8(-65);
+		size_t result = 0;
+		size_t i = 0;
+		while (i + 16 <= count)
+		{
+			auto counters = _mm_setzero_si128();
+			auto blocks_count = (count - i) / 16;
+			if (blocks_count > 255)
+				blocks_count = 255;
+			for (size_t j = 0; j < blocks_count; ++j, i += 16)
+			{
+				auto block = _mm_loadu_si128((const __m128i*)(str + i));
+				counters = _mm_sub_epi8(counters, _mm_cmpgt_epi8(block, continuation_limit));
+			}
+			auto sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+			result += size_t(_mm_extract_epi16(sums, 0)) + size_t(_mm_extract_epi16(sums, 4));
+		}
+		return result + _rune_count_scalar(str + i, count - i);
+	}
+
+	MN_RUNE_AVX2 static size_t
+	_rune_count_avx2(const char* str, size_t count)
+	{
+		const auto continuation_limit = _mm256_set1_epi8(-65);
+		size_t result = 0;
+		size_t i = 0;
+		while (i + 32 <= count)
+		{
+			auto counters = _mm256_setzero_si256();
+			auto blocks_count = (count - i) / 32;
+			if (blocks_count > 255)
+				blocks_count = 255;
+			for (size_t j = 0; j < blocks_count; ++j, i += 32)
+			{
+				auto block = _mm256_loadu_si256((const __m256i*)(str + i));
+				counters = _mm256_sub_epi8(counters, _mm256_cmpgt_epi8(block, continuation_limit));
+			}
+			auto sums = _mm256_sad_epu8(counters, _mm256_setzero_si256());
+			result += size_t(_mm256_extract_epi16(sums, 0)) + size_t(_mm256_extract_epi16(sums, 4)) +
+				size_t(_mm256_extract_epi16(sums, 8)) + size_t(_mm256_extract_epi16(sums, 12));
+		}
+		return result + _rune_count_scalar(str + i, count - i);
+	}
+
+	// returns the count of leading ascii bytes
+	inline static size_t
+	_rune_ascii_prefix_sse2(const char* str, size_t count)
+	{
+		size_t i = 0;
+		for (; i + 64 <= count; i += 64)
+		{
+			auto a = _mm_loadu_si128((const __m128i*)(str + i));
+			auto b = _mm_loadu_si128((const __m128i*)(str + i + 16));
+			auto c = _mm_loadu_si128((const __m128i*)(str + i + 32));
+			auto d = _mm_loadu_si128((const __m128i*)(str + i + 48));
+			if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d))) != 0)
+				break;
+		}
+		for (; i + 16 <= count; i += 16)
+			if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(str + i))) != 0)
+				break;
+		return i + _rune_ascii_prefix_scalar(str + i, count - i);
+	}
+
+	MN_RUNE_AVX2 static size_t
+	_rune_ascii_prefix_avx2(const char* str, size_t count)
+	{
+		size_t i = 0;
+		for (; i + 128 <= count; i += 128)
+		{
+			auto a = _mm256_loadu_si256((const __m256i*)(str + i));
+			auto b = _mm256_loadu_si256((const __m256i*)(str + i + 32));
+			auto c = _mm256_loadu_si256((const __m256i*)(str + i + 64));
+			auto d = _mm256_loadu_si256((const __m256i*)(str + i + 96));
+			if (_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d))) != 0)
+				break;
+		}
+		for (; i + 32 <= count; i += 32)
+			if (_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)(str + i))) != 0)
+				break;
+		return i + _rune_ascii_prefix_scalar(str + i, count - i);
+	}
+
+	// flips the case bit of the bytes in [first, last], the blocks are ascii so the signed compares are fine
+	inline static size_t
+	_rune_ascii_map_sse2(char* dst, const char* src, size_t count, char first, char last)
+	{
+		const auto before_first = _mm_set1_epi8(char(first - 1));
+		const auto after_last = _mm_set1_epi8(char(last + 1));
+		const auto case_bit = _mm_set1_epi8(0x20);
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			auto block = _mm_loadu_si128((const __m128i*)(src + i));
+			if (_mm_movemask_epi8(block) != 0)
+				break;
+			auto in_range = _mm_and_si128(_mm_cmpgt_epi8(block, before_first), _mm_cmpgt_epi8(after_last, block));
+			_mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(block, _mm_and_si128(in_range, case_bit)));
+		}
+		return i + _rune_ascii_map_scalar(dst + i, src + i, count - i, first, last);
+	}
+
+	MN_RUNE_AVX2 static size_t
+	_rune_ascii_map_avx2(char* dst, const char* src, size_t count, char first, char last)
+	{
+		const auto before_first = _mm256_set1_epi8(char(first - 1));
+		const auto after_last = _mm256_set1_epi8(char(last + 1));
+		const auto case_bit = _mm256_set1_epi8(0x20);
+		size_t i = 0;
+		for (; i + 32 <= count; i += 32)
+		{
+			auto block = _mm256_loadu_si256((const __m256i*)(src + i));
+			if (_mm256_movemask_epi8(block) != 0)
+				break;
+			auto in_range = _mm256_and_si256(_mm256_cmpgt_epi8(block, before_first), _mm256_cmpgt_epi8(after_last, block));
+			_mm256_storeu_si256((__m256i*)(dst + i), _mm256_xor_si256(block, _mm256_and_si256(in_range, case_bit)));
+		}
+		return i + _rune_ascii_map_scalar(dst + i, src + i, count - i, first, last);
+	}
+
+	// the utf-8 validation is the lookup algorithm of Keiser and Lemire ("Validating UTF-8 In Less Than One
+	// Instruction Per Byte"), each byte and the one before it are classified with 3 nibble lookups, the AND of the 3
+	// classes is non zero only for invalid 2 byte combinations, the 3rd and 4th bytes of the sequences are checked by
+	// comparing the expected continuation bytes with the TWO_CONTS error class
+	enum RUNE_UTF8_ERROR: uint8_t
+	{
+		RUNE_UTF8_ERROR_TOO_SHORT = 1 << 0,
+		RUNE_UTF8_ERROR_TOO_LONG = 1 << 1,
+		RUNE_UTF8_ERROR_OVERLONG_3 = 1 << 2,
+		RUNE_UTF8_ERROR_TOO_LARGE = 1 << 3,
+		RUNE_UTF8_ERROR_SURROGATE = 1 << 4,
+		RUNE_UTF8_ERROR_OVERLONG_2 = 1 << 5,
+		RUNE_UTF8_ERROR_TOO_LARGE_1000 = 1 << 6,
+		RUNE_UTF8_ERROR_OVERLONG_4 = 1 << 6,
+		RUNE_UTF8_ERROR_TWO_CONTS = 1 << 7,
+		RUNE_UTF8_ERROR_CARRY = RUNE_UTF8_ERROR_TOO_SHORT | RUNE_UTF8_ERROR_TOO_LONG | RUNE_UTF8_ERROR_TWO_CONTS,
+	};
+
+	// indexed by the high nibble of the first byte
+	alignas(16) static const uint8_t RUNE_UTF8_BYTE_1_HIGH[16] = {
+		// 0_______ ascii
+		RUNE_UTF8_ERROR_TOO_LONG, RUNE_UTF8_ERROR_TOO_LONG, RUNE_UTF8_ERROR_TOO_LONG, RUNE_UTF8_ERROR_TOO_LONG,
+		RUNE_UTF8_ERROR_TOO_LONG, RUNE_UTF8_ERROR_TOO_LONG, RUNE_UTF8_ERROR_TOO_LONG, RUNE_UTF8_ERROR_TOO_LONG,
+		// 10______ continuation
+		RUNE_UTF8_ERROR_TWO_CONTS, RUNE_UTF8_ERROR_TWO_CONTS, RUNE_UTF8_ERROR_TWO_CONTS, RUNE_UTF8_ERROR_TWO_CONTS,
+		// 1100____ 2 bytes lead
+		RUNE_UTF8_ERROR_TOO_SHORT | RUNE_UTF8_ERROR_OVERLONG_2,
+		// 1101____ 2 bytes lead
+		RUNE_UTF8_ERROR_TOO_SHORT,
+		// 1110____ 3 bytes lead
+		RUNE_UTF8_ERROR_TOO_SHORT | RUNE_UTF8_ERROR_OVERLONG_3 | RUNE_UTF8_ERROR_SURROGATE,
+		// 1111____ 4 bytes lead
+		RUNE_UTF8_ERROR_TOO_SHORT | RUNE_UTF8_ERROR_TOO_LARGE | RUNE_UTF8_ERROR_TOO_LARGE_1000 | RUNE_UTF8_ERROR_OVERLONG_4,
+	};
+
+	// indexed by the low nibble of the first byte
+	alignas(16) static const uint8_t RUNE_UTF8_BYTE_1_LOW[16] = {
+		// ____0000
+		RUNE_UTF8_ERROR_CARRY | RUNE_UTF8_ERROR_OVERLONG_3 | RUNE_UTF8_ERROR_OVERLONG_2 | RUNE_UTF8_ERROR_OVERLONG_4,
+		// ____0001
+		RUNE_UTF8_ERROR_CARRY | RUNE_UTF8_ERROR_OVERLONG_2,
+		// ____001_
+		RUNE_UTF8_ERROR_CARRY,
+		RUNE_UTF8_ERROR_CARRY,
+		// ____0100
+		RUNE_UTF8_ERROR_CARRY | RUNE_UTF8_ERROR_TOO_LARGE,
+		// ____0101
+		RUNE_UTF8_ERROR_CARRY | RUNE_UTF8_ERROR_TOO_LARGE | RUNE_UTF8_ERROR_TOO_LARGE_1000,
+		// ____011_
+		RUNE_UTF8_ERROR_CARRY | RUNE_UTF8_ERROR_TOO_LARGE | RUNE_UTF8_ERROR_TOO_LARGE_1000,
+		RUNE_UTF8_ERROR_CARRY | RUNE_UTF8_ERROR_TOO_LARGE | RUNE_UTF8_ERROR_TOO_LARGE_1000,
+		// ____1___
+		RUNE_UTF8_ERROR_CARRY | RUNE_UTF8_ERROR_TOO_LARGE | RUNE_UTF8_ERROR_TOO_LARGE_1000,
+		RUNE_UTF8_ERROR_CARRY | RUNE_UTF8_ERROR_TOO_LARGE | RUNE_UTF8_ERROR_TOO_LARGE_1000,
+		RUNE_UTF8_ERROR_CARRY | RUNE_UTF8_ERROR_TOO_LARGE | RUNE_UTF8_ERROR_TOO_LARGE_1000,
+		RUNE_UTF8_ERROR_CARRY | RUNE_UTF8_ERROR_TOO_LARGE | RUNE_UTF8_ERROR_TOO_LARGE_1000,
+		RUNE_UTF8_ERROR_CARRY | RUNE_UTF8_ERROR_TOO_LARGE | RUNE_UTF8_ERROR_TOO_LARGE_1000,
+		// ____1101
+		RUNE_UTF8_ERROR_CARRY | RUNE_UTF8_ERROR_TOO_LARGE | RUNE_UTF8_ERROR_TOO_LARGE_1000 | RUNE_UTF8_ERROR_SURROGATE,
+		RUNE_UTF8_ERROR_CARRY | RUNE_UTF8_ERROR_TOO_LARGE | RUNE_UTF8_ERROR_TOO_LARGE_1000,
+		RUNE_UTF8_ERROR_CARRY | RUNE_UTF8_ERROR_TOO_LARGE | RUNE_UTF8_ERROR_TOO_LARGE_1000,
+	};
+
+	// indexed by the high nibble of the second byte
+	alignas(16) static const uint8_t RUNE_UTF8_BYTE_2_HIGH[16] = {
+		// 0_______ ascii
+		RUNE_UTF8_ERROR_TOO_SHORT, RUNE_UTF8_ERROR_TOO_SHORT, RUNE_UTF8_ERROR_TOO_SHORT, RUNE_UTF8_ERROR_TOO_SHORT,
+		RUNE_UTF8_ERROR_TOO_SHORT, RUNE_UTF8_ERROR_TOO_SHORT, RUNE_UTF8_ERROR_TOO_SHORT, RUNE_UTF8_ERROR_TOO_SHORT,
+		// 1000____
+		RUNE_UTF8_ERROR_TOO_LONG | RUNE_UTF8_ERROR_OVERLONG_2 | RUNE_UTF8_ERROR_TWO_CONTS | RUNE_UTF8_ERROR_OVERLONG_3 |
+			RUNE_UTF8_ERROR_TOO_LARGE_1000 | RUNE_UTF8_ERROR_OVERLONG_4,
+		// 1001____
+		RUNE_UTF8_ERROR_TOO_LONG | RUNE_UTF8_ERROR_OVERLONG_2 | RUNE_UTF8_ERROR_TWO_CONTS | RUNE_UTF8_ERROR_OVERLONG_3 |
+			RUNE_UTF8_ERROR_TOO_LARGE,
+		// 101_____
+		RUNE_UTF8_ERROR_TOO_LONG | RUNE_UTF8_ERROR_OVERLONG_2 | RUNE_UTF8_ERROR_TWO_CONTS | RUNE_UTF8_ERROR_SURROGATE |
+			RUNE_UTF8_ERROR_TOO_LARGE,
+		RUNE_UTF8_ERROR_TOO_LONG | RUNE_UTF8_ERROR_OVERLONG_2 | RUNE_UTF8_ERROR_TWO_CONTS | RUNE_UTF8_ERROR_SURROGATE |
+			RUNE_UTF8_ERROR_TOO_LARGE,
+		// 11______ lead
+		RUNE_UTF8_ERROR_TOO_SHORT, RUNE_UTF8_ERROR_TOO_SHORT, RUNE_UTF8_ERROR_TOO_SHORT, RUNE_UTF8_ERROR_TOO_SHORT,
+	};
+
+	// a block which ends with an unfinished sequence has one of its last 3 bytes above these values
+	static const uint8_t RUNE_UTF8_INCOMPLETE_MAX[32] = {
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1,
+	};
+
+	struct Rune_UTF8_State_SSSE3
+	{
+		__m128i error, prev_input, prev_incomplete;
+	};
+
+	MN_RUNE_SSSE3 static void
+	_rune_utf8_check_ssse3(Rune_UTF8_State_SSSE3& self, __m128i input)
+	{
+		// ascii blocks can't have errors unless the previous block ended with an unfinished sequence
+		if (_mm_movemask_epi8(input) == 0)
+		{
+			self.error = _mm_or_si128(self.error, self.prev_incomplete);
+			return;
+		}
+
+		const auto nibble_mask = _mm_set1_epi8(0x0F);
+		auto prev1 = _mm_alignr_epi8(input, self.prev_input, 15);
+		auto byte_1_high = _mm_shuffle_epi8(
+			_mm_load_si128((const __m128i*)RUNE_UTF8_BYTE_1_HIGH),
+			_mm_and_si128(_mm_srli_epi16(prev1, 4), nibble_mask)
+		);
+		auto byte_1_low = _mm_shuffle_epi8(
+			_mm_load_si128((const __m128i*)RUNE_UTF8_BYTE_1_LOW),
+			_mm_and_si128(prev1, nibble_mask)
+		);
+		auto byte_2_high = _mm_shuffle_epi8(
+			_mm_load_si128((const __m128i*)RUNE_UTF8_BYTE_2_HIGH),
+			_mm_and_si128(_mm_srli_epi16(input, 4), nibble_mask)
+		);
+		auto special_cases = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+
+		auto prev2 = _mm_alignr_epi8(input, self.prev_input, 14);
+		auto prev3 = _mm_alignr_epi8(input, self.prev_input, 13);
+		auto is_third_byte = _mm_subs_epu8(prev2, _mm_set1_epi8(char(0xE0 - 0x80)));
+		auto is_fourth_byte = _mm_subs_epu8(prev3, _mm_set1_epi8(char(0xF0 - 0x80)));
+		auto must_be_continuation = _mm_and_si128(_mm_or_si128(is_third_byte, is_fourth_byte), _mm_set1_epi8(char(0x80)));
+
+		self.error = _mm_or_si128(self.error, _mm_xor_si128(must_be_continuation, special_cases));
+		self.prev_incomplete = _mm_subs_epu8(input, _mm_loadu_si128((const __m128i*)(RUNE_UTF8_INCOMPLETE_MAX + 16)));
+		self.prev_input = input;
+	}
+
+	MN_RUNE_SSSE3 static bool
+	_rune_utf8_valid_ssse3(const char* str, size_t count)
+	{
+		Rune_UTF8_State_SSSE3 state{_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128()};
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16)
+			_rune_utf8_check_ssse3(state, _mm_loadu_si128((const __m128i*)(str + i)));
+		if (i < count)
+		{
+			// the zero padding is ascii so it catches a sequence which is cut by the end of the input
+			alignas(16) char tail[16] = {};
+			::memcpy(tail, str + i, count - i);
+			_rune_utf8_check_ssse3(state, _mm_load_si128((const __m128i*)tail));
+		}
+		auto error = _mm_or_si128(state.error, state.prev_incomplete);
+		return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+	}
+
+	struct Rune_UTF8_State_AVX2
+	{
+		__m256i error, prev_input, prev_incomplete;
+	};
+
+	MN_RUNE_AVX2 static void
+	_rune_utf8_check_avx2(Rune_UTF8_State_AVX2& self, __m256i input)
+	{
+		if (_mm256_movemask_epi8(input) == 0)
+		{
+			self.error = _mm256_or_si256(self.error, self.prev_incomplete);
+			return;
+		}
+
+		// _mm256_alignr_epi8 works on each 128-bit lane so the lane which precedes each lane is put in place first
+		auto prev_lanes = _mm256_permute2x128_si256(self.prev_input, input, 0x21);
+		auto prev1 = _mm256_alignr_epi8(input, prev_lanes, 15);
+		auto prev2 = _mm256_alignr_epi8(input, prev_lanes, 14);
+		auto prev3 = _mm256_alignr_epi8(input, prev_lanes, 13);
+
+		const auto nibble_mask = _mm256_set1_epi8(0x0F);
+		auto byte_1_high = _mm256_shuffle_epi8(
+			_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)RUNE_UTF8_BYTE_1_HIGH)),
+			_mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble_mask)
+		);
+		auto byte_1_low = _mm256_shuffle_epi8(
+			_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)RUNE_UTF8_BYTE_1_LOW)),
+			_mm256_and_si256(prev1, nibble_mask)
+		);
+		auto byte_2_high = _mm256_shuffle_epi8(
+			_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)RUNE_UTF8_BYTE_2_HIGH)),
+			_mm256_and_si256(_mm256_srli_epi16(input, 4), nibble_mask)
+		);
+		auto special_cases = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+		auto is_third_byte = _mm256_subs_epu8(prev2, _mm256_set1_epi8(char(0xE0 - 0x80)));
+		auto is_fourth_byte = _mm256_subs_epu8(prev3, _mm256_set1_epi8(char(0xF0 - 0x80)));
+		auto must_be_continuation = _mm256_and_si256(_mm256_or_si256(is_third_byte, is_fourth_byte), _mm256_set1_epi8(char(0x80)));
+
+		self.error = _mm256_or_si256(self.error, _mm256_xor_si256(must_be_continuation, special_cases));
+		self.prev_incomplete = _mm256_subs_epu8(input, _mm256_loadu_si256((const __m256i*)RUNE_UTF8_INCOMPLETE_MAX));
+		self.prev_input = input;
+	}
+
+	MN_RUNE_AVX2 static bool
+	_rune_utf8_valid_avx2(const char* str, size_t count)
+	{
+		Rune_UTF8_State_AVX2 state{_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+		size_t i = 0;
+		for (; i + 32 <= count; i += 32)
+			_rune_utf8_check_avx2(state, _mm256_loadu_si256((const __m256i*)(str + i)));
+		if (i < count)
+		{
+			alignas(32) char tail[32] = {};
+			::memcpy(tail, str + i, count - i);
+			_rune_utf8_check_avx2(state, _mm256_load_si256((const __m256i*)tail));
+		}
+		auto error = _mm256_or_si256(state.error, state.prev_incomplete);
+		return _mm256_testz_si256(error, error) != 0;
+	}
+#endif
+
+	size_t
+	rune_count(const char* str)
+	{
+		if (str == nullptr)
+			return 0;
+		return rune_count(str, ::strlen(str));
+	}
+
+	size_t
+	rune_count(const char* str, size_t count)
+	{
+	#if MN_RUNE_SIMD
+		if (_rune_avx2_supported())
+			return _rune_count_avx2(str, count);
+		return _rune_count_sse2(str, count);
+	#else
+		return _rune_count_scalar(str, count);
+	#endif
+	}
+
+	bool
+	rune_all_ascii(const char* str, size_t count)
+	{
+	#if MN_RUNE_SIMD
+		if (_rune_avx2_supported())
+			return _rune_ascii_prefix_avx2(str, count) == count;
+		return _rune_ascii_prefix_sse2(str, count) == count;
+	#else
+		return _rune_ascii_prefix_scalar(str, count) == count;
+	#endif
+	}
+
+	bool
+	rune_utf8_valid(const char* str, size_t count)
+	{
+	#if MN_RUNE_SIMD
+		if (_rune_avx2_supported())
+			return _rune_utf8_valid_avx2(str, count);
+		else if (_rune_ssse3_supported())
+			return _rune_utf8_valid_ssse3(str, count);
+	#endif
+		return _rune_utf8_valid_scalar((const uint8_t*)str, count);
+	}
+
+	size_t
+	rune_ascii_lower(char* dst, const char* src, size_t count)
+	{
+	#if MN_RUNE_SIMD
+		if (_rune_avx2_supported())
+			return _rune_ascii_map_avx2(dst, src, count, 'A', 'Z');
+		return _rune_ascii_map_sse2(dst, src, count, 'A', 'Z');
+	#else
+		return _rune_ascii_map_scalar(dst, src, count, 'A', 'Z');
+	#endif
+	}
+
+	size_t
+	rune_ascii_upper(char* dst, const char* src, size_t count)
+	{
+	#if MN_RUNE_SIMD
+		if (_rune_avx2_supported())
+			return _rune_ascii_map_avx2(dst, src, count, 'a', 'z');
+		return _rune_ascii_map_sse2(dst, src, count, 'a', 'z');
+	#else
+		return _rune_ascii_map_scalar(dst, src, count, 'a', 'z');
+	#endif
 	}
 
 	Rune
@@ -87,6 +594,10 @@ namespace mn
 		if(*c == 0)
 			return 0;
 
+		// ascii doesn't need to go through utf8proc
+		if(uint8_t(*c) < 0x80)
+			return *c;
+
 		size_t str_count = 1;
 		for(size_t i = 1; i < 4; ++i)
 		{
@@ -7,19 +7,21 @@
 #include <intrin.h>
 #endif
 
+// the helpers are file local so that they don't clash with the intrinsics headers in unity builds
 #ifdef __GNUC__
-void __cpuid(int* cpuinfo, int info)
+inline static void
+_mn_cpuid(int* cpuinfo, int info, int subinfo = 0)
 {
+	// ebx is written directly, the 32-bit xchg trick used to zero the upper half of rbx on x64
 	__asm__ __volatile__(
-		"xchg %%ebx, %%edi;"
 		"cpuid;"
-		"xchg %%ebx, %%edi;"
-		:"=a" (cpuinfo[0]), "=D" (cpuinfo[1]), "=c" (cpuinfo[2]), "=d" (cpuinfo[3])
-		:"0" (info)
+		:"=a" (cpuinfo[0]), "=b" (cpuinfo[1]), "=c" (cpuinfo[2]), "=d" (cpuinfo[3])
+		:"0" (info), "2" (subinfo)
 	);
 }
 
-unsigned long long _xgetbv(unsigned int index)
+inline static unsigned long long
+_mn_xgetbv(unsigned int index)
 {
 	unsigned int eax, edx;
 	__asm__ __volatile__(
@@ -29,6 +31,18 @@ unsigned long long _xgetbv(unsigned int index)
 	);
 	return ((unsigned long long)edx << 32) | eax;
 }
+#else
+inline static void
+_mn_cpuid(int* cpuinfo, int info, int subinfo = 0)
+{
+	__cpuidex(cpuinfo, info, subinfo);
+}
+
+inline static unsigned long long
+_mn_xgetbv(unsigned int index)
+{
+	return _xgetbv(index);
+}
 #endif
 
 inline static mn_simd_support
@@ -37,7 +51,9 @@ _mn_simd_check()
 	mn_simd_support res{};
 
 	int cpuinfo[4];
-	__cpuid(cpuinfo, 1);
+	_mn_cpuid(cpuinfo, 0);
+	int numIds = cpuinfo[0];
+	_mn_cpuid(cpuinfo, 1);
 
 	res.sse_supportted = cpuinfo[3] & (1 << 25) || false;
 	res.sse2_supportted = cpuinfo[3] & (1 << 26) || false;
@@ -56,18 +72,29 @@ _mn_simd_check()
 	if (osxsaveSupported && res.avx_supportted)
 	{
 		// _XCR_XFEATURE_ENABLED_MASK = 0
-		unsigned long long xcrFeatureMask = _xgetbv(0);
+		unsigned long long xcrFeatureMask = _mn_xgetbv(0);
 		res.avx_supportted = (xcrFeatureMask & 0x6) == 0x6;
 	}
+	else
+	{
+		res.avx_supportted = false;
+	}
+
+	// Check AVX2 support, it's in the extended features leaf (7, sub leaf 0) and it needs the same os support as AVX
+	if (numIds >= 7 && res.avx_supportted)
+	{
+		_mn_cpuid(cpuinfo, 7, 0);
+		res.avx2_supportted = cpuinfo[1] & (1 << 5) || false;
+	}
 
 	// Check SSE4a and SSE5 support
 
 	// Get the number of valid extended IDs
-	__cpuid(cpuinfo, 0x80000000);
+	_mn_cpuid(cpuinfo, 0x80000000);
 	int numExtendedIds = cpuinfo[0];
 	if (numExtendedIds >= (int)0x80000001)
 	{
-		__cpuid(cpuinfo, 0x80000001);
+		_mn_cpuid(cpuinfo, 0x80000001);
 		res.sse4a_supportted = cpuinfo[2] & (1 << 6) || false;
 		res.sse5_supportted = cpuinfo[2] & (1 << 11) || false;
 	}
@@ -1,4 +1,18 @@
 #include "mn/Str.h"
+#include "mn/SIMD.h"
+
+#if ARCH_X86 && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MN_STR_SIMD 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define MN_STR_AVX2
+#else
+#define MN_STR_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define MN_STR_SIMD 0
+#endif
 
 namespace mn
 {
@@ -161,6 +175,259 @@ namespace mn
 		self.ptr[self.count] = '\0';
 	}
 
+	// scalar rabin-karp search, it's the fallback of the simd search, target.count should be in range (1, self.count)
+	inline static size_t
+	_str_find_rabin_karp(const Str& self, const Str& target)
+	{
+		auto [hash, pow] = _hash_str_rabin_karp(target);
+
+		uint32_t h{};
+		for (size_t i = 0; i < target.count; ++i)
+		{
+			h = h * PRIME_RABIN_KARP + uint32_t(self.ptr[i]);
+		}
+
+		if (h == hash && ::memcmp(self.ptr, target.ptr, target.count) == 0)
+		{
+			return 0;
+		}
+
+		for (size_t i = target.count; i < self.count;)
+		{
+			h *= PRIME_RABIN_KARP;
+			h += uint32_t(self.ptr[i]);
+			h -= pow * uint32_t(self.ptr[i - target.count]);
+			i += 1;
+			if (h == hash && ::memcmp(self.ptr + i - target.count, target.ptr, target.count) == 0)
+			{
+				return i - target.count;
+			}
+		}
+		return size_t(-1);
+	}
+
+	// reverse scalar rabin-karp search, target.count should be in range (1, self.count)
+	inline static size_t
+	_str_find_last_rabin_karp(const Str& self, const Str& target)
+	{
+		auto [hash, pow] = _hash_str_rabin_karp_reverse(target);
+		auto last = self.count - target.count;
+
+		uint32_t h{};
+		for (size_t i = self.count - 1; i >= last; --i)
+			h = h * PRIME_RABIN_KARP + uint32_t(self.ptr[i]);
+		if (h == hash && ::memcmp(self.ptr + last, target.ptr, target.count) == 0)
+			return last;
+
+		for (size_t i = 0; i < last; i++)
+		{
+			auto rev_i = last - i - 1;
+			h *= PRIME_RABIN_KARP;
+			h += uint32_t(self.ptr[rev_i]);
+			h -= pow * uint32_t(self.ptr[rev_i + target.count]);
+			if (h == hash && ::memcmp(self.ptr + rev_i, target.ptr, target.count) == 0)
+				return rev_i;
+		}
+		return size_t(-1);
+	}
+
+#if MN_STR_SIMD
+	// returns the index of the lowest set bit in the given mask, mask must not be zero
+	inline static uint32_t
+	_str_mask_lowest(uint32_t mask)
+	{
+		#if defined(_MSC_VER)
+			unsigned long res = 0;
+			_BitScanForward(&res, mask);
+			return uint32_t(res);
+		#else
+			return uint32_t(__builtin_ctz(mask));
+		#endif
+	}
+
+	// returns the index of the highest set bit in the given mask, mask must not be zero
+	inline static uint32_t
+	_str_mask_highest(uint32_t mask)
+	{
+		#if defined(_MSC_VER)
+			unsigned long res = 0;
+			_BitScanReverse(&res, mask);
+			return uint32_t(res);
+		#else
+			return uint32_t(31 - __builtin_clz(mask));
+		#endif
+	}
+
+	// simd substring search, it compares the first and last bytes of the target with 16 positions at once and only
+	// calls memcmp on the positions where both match, it stops when the next block doesn't fit and stores the index
+	// of the first position it didn't check in the scanned argument
+	inline static size_t
+	_str_find_sse2(const Str& self, const Str& target, size_t& scanned)
+	{
+		const auto first = _mm_set1_epi8(target.ptr[0]);
+		const auto last = _mm_set1_epi8(target.ptr[target.count - 1]);
+
+		size_t i = 0;
+		for (; i + target.count - 1 + 16 <= self.count; i += 16)
+		{
+			auto block_first = _mm_loadu_si128((const __m128i*)(self.ptr + i));
+			auto block_last = _mm_loadu_si128((const __m128i*)(self.ptr + i + target.count - 1));
+			auto eq = _mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last));
+			auto mask = uint32_t(_mm_movemask_epi8(eq));
+			while (mask != 0)
+			{
+				auto j = i + _str_mask_lowest(mask);
+				if (::memcmp(self.ptr + j + 1, target.ptr + 1, target.count - 2) == 0)
+					return j;
+				mask &= mask - 1;
+			}
+		}
+		scanned = i;
+		return size_t(-1);
+	}
+
+	// reverse simd substring search, it scans the blocks from the end and stores the count of the positions it
+	// didn't check (they're at the start of the string) in the remaining argument
+	inline static size_t
+	_str_find_last_sse2(const Str& self, const Str& target, size_t& remaining)
+	{
+		const auto first = _mm_set1_epi8(target.ptr[0]);
+		const auto last = _mm_set1_epi8(target.ptr[target.count - 1]);
+
+		size_t i = self.count - target.count + 1;
+		for (; i >= 16; i -= 16)
+		{
+			auto block_first = _mm_loadu_si128((const __m128i*)(self.ptr + i - 16));
+			auto block_last = _mm_loadu_si128((const __m128i*)(self.ptr + i - 16 + target.count - 1));
+			auto eq = _mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last));
+			auto mask = uint32_t(_mm_movemask_epi8(eq));
+			while (mask != 0)
+			{
+				auto bit = _str_mask_highest(mask);
+				auto j = i - 16 + bit;
+				if (::memcmp(self.ptr + j + 1, target.ptr + 1, target.count - 2) == 0)
+					return j;
+				mask &= ~(1u << bit);
+			}
+		}
+		remaining = i;
+		return size_t(-1);
+	}
+
+	// same as _str_find_sse2 but with 32 positions at once, it's only called when the cpu supports avx2
+	MN_STR_AVX2 static size_t
+	_str_find_avx2(const Str& self, const Str& target, size_t& scanned)
+	{
+		const auto first = _mm256_set1_epi8(target.ptr[0]);
+		const auto last = _mm256_set1_epi8(target.ptr[target.count - 1]);
+
+		size_t i = 0;
+		for (; i + target.count - 1 + 32 <= self.count; i += 32)
+		{
+			auto block_first = _mm256_loadu_si256((const __m256i*)(self.ptr + i));
+			auto block_last = _mm256_loadu_si256((const __m256i*)(self.ptr + i + target.count - 1));
+			auto eq = _mm256_and_si256(_mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last));
+			auto mask = uint32_t(_mm256_movemask_epi8(eq));
+			while (mask != 0)
+			{
+				auto j = i + _str_mask_lowest(mask);
+				if (::memcmp(self.ptr + j + 1, target.ptr + 1, target.count - 2) == 0)
+					return j;
+				mask &= mask - 1;
+			}
+		}
+		scanned = i;
+		return size_t(-1);
+	}
+
+	// same as _str_find_last_sse2 but with 32 positions at once, it's only called when the cpu supports avx2
+	MN_STR_AVX2 static size_t
+	_str_find_last_avx2(const Str& self, const Str& target, size_t& remaining)
+	{
+		const auto first = _mm256_set1_epi8(target.ptr[0]);
+		const auto last = _mm256_set1_epi8(target.ptr[target.count - 1]);
+
+		size_t i = self.count - target.count + 1;
+		for (; i >= 32; i -= 32)
+		{
+			auto block_first = _mm256_loadu_si256((const __m256i*)(self.ptr + i - 32));
+			auto block_last = _mm256_loadu_si256((const __m256i*)(self.ptr + i - 32 + target.count - 1));
+			auto eq = _mm256_and_si256(_mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last));
+			auto mask = uint32_t(_mm256_movemask_epi8(eq));
+			while (mask != 0)
+			{
+				auto bit = _str_mask_highest(mask);
+				auto j = i - 32 + bit;
+				if (::memcmp(self.ptr + j + 1, target.ptr + 1, target.count - 2) == 0)
+					return j;
+				mask &= ~(1u << bit);
+			}
+		}
+		remaining = i;
+		return size_t(-1);
+	}
+
+	inline static bool
+	_str_avx2_supported()
+	{
+		static const bool supported = mn_simd_support_check().avx2_supportted;
+		return supported;
+	}
+#endif
+
+	// picks the simd search which the cpu supports and finishes the tail, which doesn't fill a whole block, with
+	// the scalar search, target.count should be in range (1, self.count)
+	inline static size_t
+	_str_find_dispatch(const Str& self, const Str& target)
+	{
+	#if MN_STR_SIMD
+		size_t scanned = 0;
+		auto res = _str_avx2_supported() ?
+			_str_find_avx2(self, target, scanned) :
+			_str_find_sse2(self, target, scanned);
+		if (res != size_t(-1))
+			return res;
+
+		// the positions after the scanned ones don't fill a whole block so they're checked with the scalar search
+		auto tail = self;
+		tail.ptr += scanned;
+		tail.count -= scanned;
+		if (tail.count < target.count)
+			return size_t(-1);
+		else if (tail.count == target.count)
+			return ::memcmp(tail.ptr, target.ptr, target.count) == 0 ? scanned : size_t(-1);
+		res = _str_find_rabin_karp(tail, target);
+		return res == size_t(-1) ? res : res + scanned;
+	#else
+		return _str_find_rabin_karp(self, target);
+	#endif
+	}
+
+	// same as _str_find_dispatch but for the reverse search
+	inline static size_t
+	_str_find_last_dispatch(const Str& self, const Str& target)
+	{
+	#if MN_STR_SIMD
+		size_t remaining = self.count - target.count + 1;
+		auto res = _str_avx2_supported() ?
+			_str_find_last_avx2(self, target, remaining) :
+			_str_find_last_sse2(self, target, remaining);
+		if (res != size_t(-1))
+			return res;
+		if (remaining == 0)
+			return size_t(-1);
+
+		// the remaining positions are at the start, so the head covers them and the target bytes which follow them
+		auto head = self;
+		head.count = remaining + target.count - 1;
+		if (head.count == target.count)
+			return ::memcmp(head.ptr, target.ptr, target.count) == 0 ? 0 : size_t(-1);
+		return _str_find_last_rabin_karp(head, target);
+	#else
+		return _str_find_last_rabin_karp(self, target);
+	#endif
+	}
+
 	size_t
 	str_find(const Str& input, const Str& target, size_t start)
 	{
@@ -180,10 +447,10 @@ namespace mn
 		}
 		else if (target.count == 1)
 		{
-			for (size_t i = 0; i < self.count; ++i)
-				if (self.ptr[i] == target.ptr[0])
-					return i + start;
-			return size_t(-1);
+			auto ptr = (const char*)::memchr(self.ptr, target.ptr[0], self.count);
+			if (ptr == nullptr)
+				return size_t(-1);
+			return ptr - self.ptr + start;
 		}
 		else if (target.count == self.count)
 		{
@@ -196,31 +463,10 @@ namespace mn
 			return size_t(-1);
 		}
 
-		auto [hash, pow] = _hash_str_rabin_karp(target);
-
-		uint32_t h{};
-		for (size_t i = 0; i < target.count; ++i)
-		{
-			h = h * PRIME_RABIN_KARP + uint32_t(self.ptr[i]);
-		}
-
-		if (h == hash && ::memcmp(self.ptr, target.ptr, target.count) == 0)
-		{
-			return 0 + start;
-		}
-
-		for (size_t i = target.count; i < self.count;)
-		{
-			h *= PRIME_RABIN_KARP;
-			h += uint32_t(self.ptr[i]);
-			h -= pow * uint32_t(self.ptr[i - target.count]);
-			i += 1;
-			if (h == hash && ::memcmp(self.ptr + i - target.count, target.ptr, target.count) == 0)
-			{
-				return i - target.count + start;
-			}
-		}
-		return size_t(-1);
+		auto res = _str_find_dispatch(self, target);
+		if (res == size_t(-1))
+			return res;
+		return res + start;
 	}
 
 	size_t
@@ -259,25 +505,7 @@ namespace mn
 			return size_t(-1);
 		}
 
-		auto [hash, pow] = _hash_str_rabin_karp_reverse(target);
-		auto last = self.count - target.count;
-
-		uint32_t h{};
-		for (size_t i = self.count - 1; i >= last; --i)
-			h = h * PRIME_RABIN_KARP + uint32_t(self.ptr[i]);
-		if (h == hash && ::memcmp(self.ptr + last, target.ptr, target.count) == 0)
-			return last;
-
-		for (size_t i = 0; i < last; i++)
-		{
-			auto rev_i = last - i - 1;
-			h *= PRIME_RABIN_KARP;
-			h += uint32_t(self.ptr[rev_i]);
-			h -= pow * uint32_t(self.ptr[rev_i + target.count]);
-			if (h == hash && ::memcmp(self.ptr + rev_i, target.ptr, target.count) == 0)
-				return rev_i;
-		}
-		return size_t(-1);
+		return _str_find_last_dispatch(self, target);
 	}
 
 	size_t
@@ -425,25 +653,39 @@ namespace mn
 		return self;
 	}
 
-	void
-	str_lower(Str& self)
+	// maps the runes of the given string to a new string, the ascii runs are mapped in bulk by the given function and
+	// only the non ascii runes go through utf8proc
+	inline static void
+	_str_map_case(Str& self, size_t (*map_ascii)(char*, const char*, size_t), Rune (*map_rune)(Rune))
 	{
 		auto new_str = str_with_allocator(self.allocator);
 		str_reserve(new_str, self.count);
 		for(const char* it = begin(self); it != end(self); it = rune_next(it))
-			str_push(new_str, rune_lower(rune_read(it)));
+		{
+			// the mapped non ascii runes might change size so make sure the rest of the ascii run fits
+			size_t rest_count = end(self) - it;
+			buf_reserve(new_str, rest_count + 1);
+			auto ascii_count = map_ascii(new_str.ptr + new_str.count, it, rest_count);
+			new_str.count += ascii_count;
+			it += ascii_count;
+			if(it == end(self))
+				break;
+			str_push(new_str, map_rune(rune_read(it)));
+		}
+		str_null_terminate(new_str);
 		str_free(self);
 		self = new_str;
 	}
 
+	void
+	str_lower(Str& self)
+	{
+		_str_map_case(self, rune_ascii_lower, rune_lower);
+	}
+
 	void
 	str_upper(Str& self)
 	{
-		auto new_str = str_with_allocator(self.allocator);
-		str_reserve(new_str, self.count);
-		for(const char* it = begin(self); it != end(self); it = rune_next(it))
-			str_push(new_str, rune_upper(rune_read(it)));
-		str_free(self);
-		self = new_str;
+		_str_map_case(self, rune_ascii_upper, rune_upper);
 	}
 }
@@ -9,9 +9,17 @@
 #include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <assert.h>
 #include <poll.h>
+#include <pthread.h>
+#include <linux/futex.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+
+#include <atomic>
 
 namespace mn::ipc
 {
@@ -83,6 +91,449 @@ namespace mn::ipc
 	}
 
 
+	// a single direction of the shm transport, it lives in the shared memory
+	struct Sputnik_Ring
+	{
+		// total count of bytes which were written/read, the ring's data is the range [read, write)
+		alignas(64) std::atomic<uint64_t> atomic_write;
+		alignas(64) std::atomic<uint64_t> atomic_read;
+		// futex words, the reader waits on data futex and the writers wait on space futex, the waiting flags let the
+		// other side skip the wake syscall when nobody is waiting
+		alignas(64) std::atomic<uint32_t> atomic_data_futex;
+		std::atomic<uint32_t> atomic_reader_waiting;
+		std::atomic<uint32_t> atomic_space_futex;
+		std::atomic<uint32_t> atomic_writer_waiting;
+		// robust process shared mutex which serializes the writers, if a writer dies while holding it the next
+		// writer gets it back instead of waiting forever
+		pthread_mutex_t writers_lock;
+		// set when one of the sides is freed
+		std::atomic<uint32_t> atomic_closed;
+	};
+
+	constexpr static uint64_t SPUTNIK_SHM_MAGIC = 0x4B494E5450555053; // "SPUTNIK"
+	constexpr static size_t SPUTNIK_SHM_DEFAULT_RING_SIZE = 1024 * 1024;
+	// max time we sleep on a futex before checking whether the other process is still alive
+	constexpr static int SPUTNIK_SHM_WAIT_SLICE_IN_MS = 100;
+	constexpr static uint64_t SPUTNIK_SHM_DEFAULT_HANDSHAKE_TIMEOUT_IN_MS = 5000;
+
+	// the shared memory layout, followed by the data of the two rings
+	struct Sputnik_Shm_Header
+	{
+		uint64_t magic;
+		uint64_t ring_size;
+		// rings[0] is from the server to the client, and rings[1] is from the client to the server
+		Sputnik_Ring rings[2];
+	};
+
+	struct ISputnik_Shm
+	{
+		Block mapping;
+		uint64_t ring_mask;
+		Sputnik_Ring* read_ring;
+		uint8_t* read_data;
+		Sputnik_Ring* write_ring;
+		uint8_t* write_data;
+	};
+
+	inline static void
+	_sputnik_futex_wait(std::atomic<uint32_t>& futex, uint32_t value, int milliseconds)
+	{
+		timespec ts{};
+		ts.tv_sec = milliseconds / 1000;
+		ts.tv_nsec = (milliseconds % 1000) * 1000000;
+		// it's a shared memory futex, so we can't use the private futex ops
+		::syscall(SYS_futex, (uint32_t*)&futex, FUTEX_WAIT, value, &ts, nullptr, 0);
+	}
+
+	inline static void
+	_sputnik_futex_wake(std::atomic<uint32_t>& futex, int count)
+	{
+		::syscall(SYS_futex, (uint32_t*)&futex, FUTEX_WAKE, count, nullptr, nullptr, 0);
+	}
+
+	inline static void
+	_sputnik_futex_signal(std::atomic<uint32_t>& futex)
+	{
+		futex.fetch_add(1);
+		_sputnik_futex_wake(futex, INT_MAX);
+	}
+
+	inline static bool
+	_sputnik_writers_lock_init(Sputnik_Ring* ring)
+	{
+		pthread_mutexattr_t attr{};
+		if (::pthread_mutexattr_init(&attr) != 0)
+			return false;
+		mn_defer(::pthread_mutexattr_destroy(&attr));
+		if (::pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED) != 0)
+			return false;
+		if (::pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST) != 0)
+			return false;
+		return ::pthread_mutex_init(&ring->writers_lock, &attr) == 0;
+	}
+
+	// locks the writers mutex and returns whether it succeeded
+	inline static bool
+	_sputnik_writers_lock(Sputnik_Ring* ring)
+	{
+		auto res = ::pthread_mutex_trylock(&ring->writers_lock);
+		if (res == EBUSY)
+		{
+			worker_block_ahead();
+			res = ::pthread_mutex_lock(&ring->writers_lock);
+			worker_block_clear();
+		}
+
+		// the previous owner died while holding the lock, the ring's positions are still valid because they're only
+		// published after the data is copied, but the dead writer's last message might be partial
+		if (res == EOWNERDEAD)
+			res = ::pthread_mutex_consistent(&ring->writers_lock);
+		return res == 0;
+	}
+
+	inline static void
+	_sputnik_writers_unlock(Sputnik_Ring* ring)
+	{
+		::pthread_mutex_unlock(&ring->writers_lock);
+	}
+
+	// checks whether the process on the other side of the socket is still alive
+	inline static bool
+	_sputnik_shm_peer_alive(Sputnik self)
+	{
+		pollfd pfd{};
+		pfd.fd = self->linux_domain_socket;
+		pfd.events = POLLRDHUP;
+		if (::poll(&pfd, 1, 0) <= 0)
+			return true;
+		return (pfd.revents & (POLLRDHUP | POLLHUP | POLLERR)) == 0;
+	}
+
+	inline static ISputnik_Shm*
+	_sputnik_shm_map(int memfd, bool server)
+	{
+		struct stat info{};
+		if (::fstat(memfd, &info) == -1 || size_t(info.st_size) < sizeof(Sputnik_Shm_Header))
+			return nullptr;
+
+		auto ptr = ::mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+		if (ptr == MAP_FAILED)
+			return nullptr;
+
+		auto header = (Sputnik_Shm_Header*)ptr;
+		if (header->magic != SPUTNIK_SHM_MAGIC || sizeof(Sputnik_Shm_Header) + 2 * header->ring_size != size_t(info.st_size))
+		{
+			::munmap(ptr, info.st_size);
+			return nullptr;
+		}
+
+		auto data = (uint8_t*)(header + 1);
+		auto self = alloc_zerod<ISputnik_Shm>();
+		self->mapping = Block{ptr, size_t(info.st_size)};
+		self->ring_mask = header->ring_size - 1;
+		self->read_ring = &header->rings[server ? 1 : 0];
+		self->read_data = data + (server ? header->ring_size : 0);
+		self->write_ring = &header->rings[server ? 0 : 1];
+		self->write_data = data + (server ? 0 : header->ring_size);
+		return self;
+	}
+
+	// creates the shared memory of a new connection, it returns the memfd or -1 if it fails
+	inline static int
+	_sputnik_shm_create(size_t ring_size)
+	{
+		if (ring_size == 0)
+			ring_size = SPUTNIK_SHM_DEFAULT_RING_SIZE;
+		size_t rounded_ring_size = 4096;
+		while (rounded_ring_size < ring_size)
+			rounded_ring_size *= 2;
+
+		auto memfd = ::memfd_create("mn-sputnik", MFD_CLOEXEC);
+		if (memfd == -1)
+			return -1;
+
+		auto size = sizeof(Sputnik_Shm_Header) + 2 * rounded_ring_size;
+		if (::ftruncate(memfd, size) == -1)
+		{
+			::close(memfd);
+			return -1;
+		}
+
+		auto ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+		if (ptr == MAP_FAILED)
+		{
+			::close(memfd);
+			return -1;
+		}
+		auto header = ::new (ptr) Sputnik_Shm_Header{};
+		header->magic = SPUTNIK_SHM_MAGIC;
+		header->ring_size = rounded_ring_size;
+		bool locks_ok = _sputnik_writers_lock_init(&header->rings[0]) && _sputnik_writers_lock_init(&header->rings[1]);
+		::munmap(ptr, size);
+		if (locks_ok == false)
+		{
+			::close(memfd);
+			return -1;
+		}
+		return memfd;
+	}
+
+	inline static void
+	_sputnik_shm_free(ISputnik_Shm* self)
+	{
+		// wake up the other side so that it notices that we're gone
+		self->write_ring->atomic_closed.store(1);
+		_sputnik_futex_signal(self->write_ring->atomic_data_futex);
+		self->read_ring->atomic_closed.store(1);
+		_sputnik_futex_signal(self->read_ring->atomic_space_futex);
+
+		::munmap(self->mapping.ptr, self->mapping.size);
+		free(self);
+	}
+
+	// waits for the socket to be readable within the given handshake timeout, returns whether it's readable
+	inline static bool
+	_sputnik_shm_handshake_wait(int socket, Timeout timeout)
+	{
+		pollfd pfd{};
+		pfd.fd = socket;
+		pfd.events = POLLIN;
+
+		int milliseconds = 0;
+		if (timeout == INFINITE_TIMEOUT)
+			milliseconds = -1;
+		else if (timeout == NO_TIMEOUT)
+			milliseconds = int(SPUTNIK_SHM_DEFAULT_HANDSHAKE_TIMEOUT_IN_MS);
+		else
+			milliseconds = int(timeout.milliseconds);
+
+		worker_block_ahead();
+		auto ready = ::poll(&pfd, 1, milliseconds);
+		worker_block_clear();
+		return ready > 0 && (pfd.revents & POLLIN);
+	}
+
+	// sends the shared memory of a new connection to the client over the socket along with the magic, so that a
+	// socket transport client doesn't mistake it for data
+	inline static bool
+	_sputnik_shm_send(int socket, int memfd)
+	{
+		uint64_t magic = SPUTNIK_SHM_MAGIC;
+		iovec iov{&magic, sizeof(magic)};
+		alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+		msghdr msg{};
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		auto cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		::memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+		return ::sendmsg(socket, &msg, MSG_NOSIGNAL) == sizeof(magic);
+	}
+
+	// receives the shared memory of the connection from the server, it returns the memfd or -1 if it fails, it
+	// fails instead of blocking forever if the server uses the socket transport and never sends it
+	inline static int
+	_sputnik_shm_recv(int socket, Timeout timeout)
+	{
+		if (_sputnik_shm_handshake_wait(socket, timeout) == false)
+			return -1;
+
+		uint64_t magic = 0;
+		iovec iov{&magic, sizeof(magic)};
+		alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+		msghdr msg{};
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		worker_block_ahead();
+		auto res = ::recvmsg(socket, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+		worker_block_clear();
+
+		int memfd = -1;
+		for (auto cmsg = CMSG_FIRSTHDR(&msg); res > 0 && cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+		{
+			if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+				::memcpy(&memfd, CMSG_DATA(cmsg), sizeof(int));
+		}
+
+		if (res != sizeof(magic) || magic != SPUTNIK_SHM_MAGIC)
+		{
+			if (memfd != -1)
+				::close(memfd);
+			return -1;
+		}
+		return memfd;
+	}
+
+	// the client acknowledges the shared memory so that the server knows that the client uses the shm transport too
+	inline static bool
+	_sputnik_shm_ack_send(int socket)
+	{
+		uint64_t magic = SPUTNIK_SHM_MAGIC;
+		return ::send(socket, &magic, sizeof(magic), MSG_NOSIGNAL) == sizeof(magic);
+	}
+
+	// waits for the client's acknowledgement, it fails if the client uses the socket transport
+	inline static bool
+	_sputnik_shm_ack_recv(int socket, Timeout timeout)
+	{
+		if (_sputnik_shm_handshake_wait(socket, timeout) == false)
+			return false;
+
+		uint64_t magic = 0;
+		worker_block_ahead();
+		auto res = ::recv(socket, &magic, sizeof(magic), MSG_WAITALL);
+		worker_block_clear();
+		return res == sizeof(magic) && magic == SPUTNIK_SHM_MAGIC;
+	}
+
+	inline static void
+	_sputnik_shm_copy_from(ISputnik_Shm* self, const uint8_t* data, uint64_t read, uint8_t* out, size_t size)
+	{
+		auto offset = read & self->ring_mask;
+		auto first = self->ring_mask + 1 - offset;
+		if (first > size)
+			first = size;
+		::memcpy(out, data + offset, first);
+		::memcpy(out + first, data, size - first);
+	}
+
+	inline static void
+	_sputnik_shm_copy_to(ISputnik_Shm* self, uint8_t* data, uint64_t write, const uint8_t* in, size_t size)
+	{
+		auto offset = write & self->ring_mask;
+		auto first = self->ring_mask + 1 - offset;
+		if (first > size)
+			first = size;
+		::memcpy(data + offset, in, first);
+		::memcpy(data, in + first, size - first);
+	}
+
+	inline static size_t
+	_sputnik_shm_read(Sputnik self, Block data, Timeout timeout)
+	{
+		auto shm = self->shm;
+		auto ring = shm->read_ring;
+
+		// there's a single reader so we own the read cursor
+		auto read = ring->atomic_read.load(std::memory_order_relaxed);
+		auto write = ring->atomic_write.load(std::memory_order_acquire);
+		if (write == read && timeout != NO_TIMEOUT)
+		{
+			auto start = time_in_millis();
+			worker_block_ahead();
+			while (true)
+			{
+				auto seq = ring->atomic_data_futex.load();
+				ring->atomic_reader_waiting.store(1);
+				write = ring->atomic_write.load();
+				if (write != read || ring->atomic_closed.load())
+					break;
+
+				int milliseconds = SPUTNIK_SHM_WAIT_SLICE_IN_MS;
+				if (timeout != INFINITE_TIMEOUT)
+				{
+					auto elapsed = time_in_millis() - start;
+					if (elapsed >= timeout.milliseconds)
+						break;
+					if (timeout.milliseconds - elapsed < uint64_t(milliseconds))
+						milliseconds = int(timeout.milliseconds - elapsed);
+				}
+
+				_sputnik_futex_wait(ring->atomic_data_futex, seq, milliseconds);
+				if (_sputnik_shm_peer_alive(self) == false)
+				{
+					write = ring->atomic_write.load();
+					break;
+				}
+			}
+			ring->atomic_reader_waiting.store(0);
+			worker_block_clear();
+		}
+
+		if (write == read)
+			return 0;
+
+		auto size = write - read;
+		if (size > data.size)
+			size = data.size;
+		_sputnik_shm_copy_from(shm, shm->read_data, read, (uint8_t*)data.ptr, size);
+		ring->atomic_read.store(read + size);
+
+		if (ring->atomic_writer_waiting.load())
+			_sputnik_futex_signal(ring->atomic_space_futex);
+		return size;
+	}
+
+	inline static void
+	_sputnik_shm_publish(Sputnik_Ring* ring, uint64_t write)
+	{
+		ring->atomic_write.store(write);
+		if (ring->atomic_reader_waiting.load())
+			_sputnik_futex_signal(ring->atomic_data_futex);
+	}
+
+	inline static size_t
+	_sputnik_shm_writev(Sputnik self, const Block* blocks, size_t count)
+	{
+		auto shm = self->shm;
+		auto ring = shm->write_ring;
+		auto ring_size = shm->ring_mask + 1;
+
+		if (_sputnik_writers_lock(ring) == false)
+			return 0;
+		mn_defer(_sputnik_writers_unlock(ring));
+
+		size_t res = 0;
+		auto write = ring->atomic_write.load(std::memory_order_relaxed);
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto ptr = (const uint8_t*)blocks[i].ptr;
+			auto size = blocks[i].size;
+			while (size > 0)
+			{
+				auto read = ring->atomic_read.load(std::memory_order_acquire);
+				auto space = ring_size - (write - read);
+				if (space == 0)
+				{
+					// the ring is full, publish what we have so far then wait for the reader to consume it
+					_sputnik_shm_publish(ring, write);
+
+					worker_block_ahead();
+					auto seq = ring->atomic_space_futex.load();
+					ring->atomic_writer_waiting.store(1);
+					bool closed = ring->atomic_closed.load() != 0;
+					if (ring->atomic_read.load() == read && closed == false)
+					{
+						_sputnik_futex_wait(ring->atomic_space_futex, seq, SPUTNIK_SHM_WAIT_SLICE_IN_MS);
+						closed = _sputnik_shm_peer_alive(self) == false;
+					}
+					ring->atomic_writer_waiting.store(0);
+					worker_block_clear();
+
+					if (closed)
+						return res;
+					continue;
+				}
+
+				auto chunk = size < space ? size : space;
+				_sputnik_shm_copy_to(shm, shm->write_data, write, ptr, chunk);
+				write += chunk;
+				ptr += chunk;
+				size -= chunk;
+				res += chunk;
+			}
+		}
+
+		_sputnik_shm_publish(ring, write);
+		return res;
+	}
+
 	void
 	ISputnik::dispose()
 	{
@@ -108,7 +559,7 @@ namespace mn::ipc
 	}
 
 	Sputnik
-	sputnik_new(const mn::Str& name)
+	sputnik_new(const mn::Str& name, Sputnik_Settings settings)
 	{
 		sockaddr_un addr{};
 		addr.sun_family = AF_LOCAL;
@@ -130,13 +581,14 @@ namespace mn::ipc
 			return nullptr;
 		}
 		auto self = mn::alloc_construct<ISputnik>();
+		self->settings = settings;
 		self->linux_domain_socket = handle;
 		self->name = mn::str_from_substr(name.ptr, name.ptr + name_length);
 		return self;
 	}
 
 	Sputnik
-	sputnik_connect(const mn::Str& name)
+	sputnik_connect(const mn::Str& name, Sputnik_Settings settings)
 	{
 		sockaddr_un addr{};
 		addr.sun_family = AF_LOCAL;
@@ -158,7 +610,32 @@ namespace mn::ipc
 		}
 		worker_block_clear();
 
+		ISputnik_Shm* shm = nullptr;
+		if (settings.transport == SPUTNIK_TRANSPORT_SHM)
+		{
+			auto memfd = _sputnik_shm_recv(handle, settings.handshake_timeout);
+			if (memfd != -1)
+			{
+				shm = _sputnik_shm_map(memfd, false);
+				::close(memfd);
+			}
+
+			if (shm && _sputnik_shm_ack_send(handle) == false)
+			{
+				_sputnik_shm_free(shm);
+				shm = nullptr;
+			}
+
+			if (shm == nullptr)
+			{
+				::close(handle);
+				return nullptr;
+			}
+		}
+
 		auto self = mn::alloc_construct<ISputnik>();
+		self->settings = settings;
+		self->shm = shm;
 		self->linux_domain_socket = handle;
 		self->name = mn::str_from_substr(name.ptr, name.ptr + name_length);
 		return self;
@@ -167,6 +644,8 @@ namespace mn::ipc
 	void
 	sputnik_free(Sputnik self)
 	{
+		if (self->shm)
+			_sputnik_shm_free(self->shm);
 		::close(self->linux_domain_socket);
 		mn::str_free(self->name);
 		mn::free_destruct(self);
@@ -209,7 +688,34 @@ namespace mn::ipc
 		auto handle = ::accept(self->linux_domain_socket, 0, 0);
 		if(handle == -1)
 			return nullptr;
+
+		ISputnik_Shm* shm = nullptr;
+		if (self->settings.transport == SPUTNIK_TRANSPORT_SHM)
+		{
+			auto memfd = _sputnik_shm_create(self->settings.ring_size);
+			if (memfd != -1)
+			{
+				if (_sputnik_shm_send(handle, memfd))
+					shm = _sputnik_shm_map(memfd, true);
+				::close(memfd);
+			}
+
+			if (shm && _sputnik_shm_ack_recv(handle, self->settings.handshake_timeout) == false)
+			{
+				_sputnik_shm_free(shm);
+				shm = nullptr;
+			}
+
+			if (shm == nullptr)
+			{
+				::close(handle);
+				return nullptr;
+			}
+		}
+
 		auto other = mn::alloc_construct<ISputnik>();
+		other->settings = self->settings;
+		other->shm = shm;
 		other->linux_domain_socket = handle;
 		other->name = clone(self->name);
 		return other;
@@ -218,6 +724,9 @@ namespace mn::ipc
 	size_t
 	sputnik_read(Sputnik self, Block data, Timeout timeout)
 	{
+		if (self->shm)
+			return _sputnik_shm_read(self, data, timeout);
+
 		pollfd pfd_read{};
 		pfd_read.fd = self->linux_domain_socket;
 		pfd_read.events = POLLIN;
@@ -244,12 +753,51 @@ namespace mn::ipc
 	size_t
 	sputnik_write(Sputnik self, Block data)
 	{
+		if (self->shm)
+			return _sputnik_shm_writev(self, &data, 1);
+
 		worker_block_ahead();
 		auto res = ::write(self->linux_domain_socket, data.ptr, data.size);
 		worker_block_clear();
 		return res;
 	}
 
+	size_t
+	sputnik_writev(Sputnik self, const Block* blocks, size_t count)
+	{
+		if (self->shm)
+			return _sputnik_shm_writev(self, blocks, count);
+
+		constexpr size_t IOVECS_COUNT = 64;
+
+		size_t res = 0;
+		worker_block_ahead();
+		while (count > 0)
+		{
+			iovec iovecs[IOVECS_COUNT];
+			size_t iovecs_count = count < IOVECS_COUNT ? count : IOVECS_COUNT;
+			size_t iovecs_size = 0;
+			for (size_t i = 0; i < iovecs_count; ++i)
+			{
+				iovecs[i].iov_base = blocks[i].ptr;
+				iovecs[i].iov_len = blocks[i].size;
+				iovecs_size += blocks[i].size;
+			}
+
+			auto written = ::writev(self->linux_domain_socket, iovecs, int(iovecs_count));
+			if (written == -1)
+				break;
+			res += written;
+			if (size_t(written) < iovecs_size)
+				break;
+
+			blocks += iovecs_count;
+			count -= iovecs_count;
+		}
+		worker_block_clear();
+		return res;
+	}
+
 	bool
 	sputnik_disconnect(Sputnik self)
 	{
@@ -260,8 +808,8 @@ namespace mn::ipc
 	sputnik_msg_write(Sputnik self, Block data)
 	{
 		uint64_t len = data.size;
-		auto res = sputnik_write(self, block_from(len));
-		res += sputnik_write(self, data);
+		Block blocks[] = {block_from(len), data};
+		auto res = sputnik_writev(self, blocks, 2);
 		return res == (data.size + sizeof(len));
 	}
 
@@ -2,10 +2,16 @@
 #include "mn/OS.h"
 #include "mn/IO.h"
 #include "mn/Defer.h"
+#include "mn/Fabric.h"
+#include "mn/Ring.h"
 
 #define _LARGEFILE64_SOURCE 1
 #include <sys/sysinfo.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
 #include <fcntl.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -208,6 +214,254 @@ namespace mn
 		return res;
 	}
 
+	// an open folder in the walk
+	struct Path_Walker_Level
+	{
+		int fd;
+		size_t depth;
+		// count of the folder's path in the walker's path
+		size_t path_count;
+		Block buffer;
+		size_t buffer_offset;
+		size_t buffer_count;
+	};
+
+	// a folder which is waiting to be walked in breadth first order
+	struct Path_Walker_Pending
+	{
+		Str path;
+		size_t depth;
+	};
+
+	inline static void
+	destruct(Path_Walker_Pending& self)
+	{
+		str_free(self.path);
+	}
+
+	struct IPath_Walker
+	{
+		Path_Walk_Settings settings;
+		Str path;
+		// the open folders stack, in breadth first order it only has one level, levels after levels_count are not
+		// open and their buffers are kept around to be reused
+		Buf<Path_Walker_Level> levels;
+		size_t levels_count;
+		Ring<Path_Walker_Pending> pending;
+		// the last reported folder, it's opened in the next call to path_walker_next unless it's skipped
+		bool descend;
+		const char* descend_name;
+		size_t descend_depth;
+	};
+
+	constexpr static size_t PATH_WALKER_BUFFER_SIZE = 32ULL * 1024ULL;
+
+	inline static bool
+	_path_walker_push_level(Path_Walker self, int fd, size_t depth)
+	{
+		if (fd < 0)
+			return false;
+
+		if (self->levels_count == self->levels.count)
+		{
+			Path_Walker_Level level{};
+			level.buffer = alloc(PATH_WALKER_BUFFER_SIZE, alignof(dirent64));
+			buf_push(self->levels, level);
+		}
+
+		auto& level = self->levels[self->levels_count++];
+		level.fd = fd;
+		level.depth = depth;
+		level.path_count = self->path.count;
+		level.buffer_offset = 0;
+		level.buffer_count = 0;
+		return true;
+	}
+
+	inline static void
+	_path_walker_pop_level(Path_Walker self)
+	{
+		::close(self->levels[--self->levels_count].fd);
+	}
+
+	// returns the next record of the given level, getdents64 fills the buffer with dirent64 records or nullptr if the folder has no more entries
+	inline static dirent64*
+	_path_walker_level_next(Path_Walker_Level& level)
+	{
+		if (level.buffer_offset >= level.buffer_count)
+		{
+			worker_block_ahead();
+			auto res = ::syscall(SYS_getdents64, level.fd, level.buffer.ptr, level.buffer.size);
+			worker_block_clear();
+			if (res <= 0)
+				return nullptr;
+			level.buffer_offset = 0;
+			level.buffer_count = size_t(res);
+		}
+
+		auto record = (dirent64*)((char*)level.buffer.ptr + level.buffer_offset);
+		level.buffer_offset += record->d_reclen;
+		return record;
+	}
+
+	inline static PATH_WALK_KIND
+	_path_walk_kind_from_mode(mode_t mode)
+	{
+		if (S_ISREG(mode))
+			return PATH_WALK_KIND_FILE;
+		else if (S_ISDIR(mode))
+			return PATH_WALK_KIND_FOLDER;
+		else if (S_ISLNK(mode))
+			return PATH_WALK_KIND_SYMLINK;
+		else
+			return PATH_WALK_KIND_OTHER;
+	}
+
+	// stats the given entry relative to its folder which saves the kernel the path lookup, only the fields which
+	// we need are requested so that network filesystems don't have to fetch the rest
+	inline static bool
+	_path_walker_stat(int folder_fd, const char* name, Path_Walk_Entry& entry)
+	{
+		struct statx sb{};
+		worker_block_ahead();
+		auto res = ::statx(folder_fd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, STATX_TYPE | STATX_SIZE | STATX_MTIME, &sb);
+		worker_block_clear();
+		if (res != 0)
+			return false;
+
+		entry.kind = _path_walk_kind_from_mode(sb.stx_mode);
+		entry.has_stat = true;
+		entry.size = int64_t(sb.stx_size);
+		entry.last_write_time = int64_t(sb.stx_mtime.tv_sec);
+		return true;
+	}
+
+	// API
+	Path_Walker
+	path_walker_new(const char* root, Path_Walk_Settings settings)
+	{
+		auto fd = ::open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (fd < 0)
+			return nullptr;
+
+		auto self = alloc_zerod<IPath_Walker>();
+		self->settings = settings;
+		self->path = str_from_c(root);
+		// remove the trailing separators so that we can join the names with a single '/'
+		while (self->path.count > 1 && self->path[self->path.count - 1] == '/')
+			str_resize(self->path, self->path.count - 1);
+		self->levels = buf_new<Path_Walker_Level>();
+		self->pending = ring_new<Path_Walker_Pending>();
+		_path_walker_push_level(self, fd, 0);
+		return self;
+	}
+
+	void
+	path_walker_free(Path_Walker self)
+	{
+		while (self->levels_count > 0)
+			_path_walker_pop_level(self);
+		for (auto& level: self->levels)
+			free(level.buffer);
+		buf_free(self->levels);
+		destruct(self->pending);
+		str_free(self->path);
+		free(self);
+	}
+
+	bool
+	path_walker_next(Path_Walker self, Path_Walk_Entry& entry)
+	{
+		if (self->descend)
+		{
+			self->descend = false;
+			if (self->settings.order == PATH_WALK_ORDER_DEPTH_FIRST)
+			{
+				// the walker's path is still the path of the last reported folder
+				auto& level = self->levels[self->levels_count - 1];
+				worker_block_ahead();
+				auto fd = ::openat(level.fd, self->descend_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+				worker_block_clear();
+				_path_walker_push_level(self, fd, self->descend_depth);
+			}
+			else
+			{
+				ring_push_back(self->pending, Path_Walker_Pending{str_from_c(self->path.ptr), self->descend_depth});
+			}
+		}
+
+		while (true)
+		{
+			if (self->levels_count == 0)
+			{
+				if (ring_empty(self->pending))
+					return false;
+
+				auto pending = ring_front(self->pending);
+				ring_pop_front(self->pending);
+				mn_defer(destruct(pending));
+
+				str_clear(self->path);
+				str_push(self->path, pending.path);
+				worker_block_ahead();
+				auto fd = ::open(self->path.ptr, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+				worker_block_clear();
+				_path_walker_push_level(self, fd, pending.depth);
+				continue;
+			}
+
+			auto& level = self->levels[self->levels_count - 1];
+			auto record = _path_walker_level_next(level);
+			if (record == nullptr)
+			{
+				_path_walker_pop_level(self);
+				continue;
+			}
+
+			if (::strcmp(record->d_name, ".") == 0 || ::strcmp(record->d_name, "..") == 0)
+				continue;
+
+			entry = Path_Walk_Entry{};
+			entry.depth = level.depth + 1;
+			switch (record->d_type)
+			{
+			case DT_REG: entry.kind = PATH_WALK_KIND_FILE; break;
+			case DT_DIR: entry.kind = PATH_WALK_KIND_FOLDER; break;
+			case DT_LNK: entry.kind = PATH_WALK_KIND_SYMLINK; break;
+			default: entry.kind = PATH_WALK_KIND_OTHER; break;
+			}
+
+			// some filesystems don't report the kind with the folder content so we stat them
+			if (self->settings.stat || record->d_type == DT_UNKNOWN)
+			{
+				if (_path_walker_stat(level.fd, record->d_name, entry) == false)
+					continue;
+			}
+
+			str_resize(self->path, level.path_count);
+			if (self->path.count == 0 || self->path[self->path.count - 1] != '/')
+				str_push(self->path, "/");
+			str_push(self->path, record->d_name);
+
+			entry.name = record->d_name;
+			entry.path = self->path.ptr;
+
+			if (entry.kind == PATH_WALK_KIND_FOLDER && (self->settings.max_depth == 0 || entry.depth < self->settings.max_depth))
+			{
+				self->descend = true;
+				self->descend_name = record->d_name;
+				self->descend_depth = entry.depth;
+			}
+			return true;
+		}
+	}
+
+	void
+	path_walker_skip(Path_Walker self)
+	{
+		self->descend = false;
+	}
+
 	Str
 	path_executable(Allocator allocator)
 	{
@@ -235,43 +489,138 @@ namespace mn
 		return int64_t(sb.st_mtime);
 	}
 
-	bool
-	file_copy(const char* src, const char* dst)
+	// copies the rest of the source file into the destination file using a big buffer, returns whether it succeeded
+	inline static bool
+	_file_copy_buffered(int fd_src, int fd_dst)
 	{
-		char buf[4096];
-		ssize_t nread = -1;
-		int fd_src = ::open(src, O_RDONLY);
-		if(fd_src < 0)
-			return false;
+		constexpr size_t BUFFER_SIZE = 1ULL * 1024ULL * 1024ULL;
+		auto buf = alloc(BUFFER_SIZE, alignof(char));
+		mn_defer(free(buf));
 
-		int fd_dst = ::open(dst, O_WRONLY | O_CREAT | O_EXCL, 0666);
-		if(fd_dst < 0)
-			goto FAILURE;
-
-		while(nread = ::read(fd_src, buf, sizeof(buf)), nread > 0)
+		while (true)
 		{
-			char *out_ptr = buf;
-			ssize_t nwritten = 0;
-			do
+			auto nread = ::read(fd_src, buf.ptr, buf.size);
+			if (nread == 0)
+				return true;
+			if (nread < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				return false;
+			}
+
+			auto out_ptr = (char*)buf.ptr;
+			while (nread > 0)
 			{
-				nwritten = ::write(fd_dst, out_ptr, nread);
-				if(nwritten >= 0)
+				auto nwritten = ::write(fd_dst, out_ptr, nread);
+				if (nwritten >= 0)
 				{
 					nread -= nwritten;
 					out_ptr += nwritten;
 				}
-				else if(errno != EINTR)
+				else if (errno != EINTR)
 				{
-					goto FAILURE;
+					return false;
 				}
-			} while(nread > 0);
+			}
+		}
+	}
+
+	// copies the given size using the kernel's copy_file_range, then sendfile, then a big buffer loop, each
+	// one is used if the previous one isn't supported for the given files (cross filesystem copies on old kernels,
+	// special files, etc..), returns whether it succeeded
+	inline static bool
+	_file_copy_content(int fd_src, int fd_dst, int64_t size)
+	{
+		bool use_copy_file_range = true;
+		while (size > 0 && use_copy_file_range)
+		{
+			auto res = ::copy_file_range(fd_src, nullptr, fd_dst, nullptr, size_t(size), 0);
+			if (res > 0)
+			{
+				size -= res;
+			}
+			else if (res == 0)
+			{
+				// the file was truncated while we're copying it
+				return true;
+			}
+			else if (errno == EINTR)
+			{
+				continue;
+			}
+			else if (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP || errno == EBADF)
+			{
+				use_copy_file_range = false;
+			}
+			else
+			{
+				return false;
+			}
 		}
 
-	FAILURE:
-		::close(fd_src);
-		if(fd_dst >= 0)
-			::close(fd_dst);
-		return nread == 0;
+		bool use_sendfile = true;
+		while (size > 0 && use_sendfile)
+		{
+			auto res = ::sendfile(fd_dst, fd_src, nullptr, size_t(size));
+			if (res > 0)
+			{
+				size -= res;
+			}
+			else if (res == 0)
+			{
+				return true;
+			}
+			else if (errno == EINTR)
+			{
+				continue;
+			}
+			else if (errno == ENOSYS || errno == EINVAL)
+			{
+				use_sendfile = false;
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		if (size <= 0)
+			return true;
+
+		return _file_copy_buffered(fd_src, fd_dst);
+	}
+
+	bool
+	file_copy(const char* src, const char* dst)
+	{
+		int fd_src = ::open(src, O_RDONLY | O_CLOEXEC);
+		if(fd_src < 0)
+			return false;
+		mn_defer(::close(fd_src));
+
+		struct stat sb{};
+		if (::fstat(fd_src, &sb) != 0)
+			return false;
+
+		int fd_dst = ::open(dst, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+		if(fd_dst < 0)
+			return false;
+		mn_defer(::close(fd_dst));
+
+		worker_block_ahead();
+		mn_defer(worker_block_clear());
+
+		// filesystems which support reflinks (btrfs, xfs, ...) can share the extents of the source file without
+		// copying any data, the content is copied only when one of the files is modified
+		if (S_ISREG(sb.st_mode) && ::ioctl(fd_dst, FICLONE, fd_src) == 0)
+			return true;
+
+		// special files (procfs, sysfs, etc..) might report zero size even if they have content so we just copy
+		// them with the read/write loop
+		if (S_ISREG(sb.st_mode) == false || sb.st_size == 0)
+			return _file_copy_buffered(fd_src, fd_dst);
+		return _file_copy_content(fd_src, fd_dst, int64_t(sb.st_size));
 	}
 
 	bool
@@ -0,0 +1,148 @@
+#include "mn/Reactor.h"
+#include "mn/Memory.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+
+namespace mn
+{
+	struct IReactor
+	{
+		int epoll;
+		// eventfd used to wake up the waiting thread, it's registered with an invalid handle so it can't clash with
+		// user handles
+		int wake;
+	};
+
+	constexpr static uint64_t REACTOR_WAKE_HANDLE = ~0ULL;
+
+	inline static uint32_t
+	_reactor_events_to_os(int events)
+	{
+		uint32_t res = EPOLLONESHOT;
+		if (events & REACTOR_EVENT_READ)
+			res |= EPOLLIN | EPOLLRDHUP;
+		if (events & REACTOR_EVENT_WRITE)
+			res |= EPOLLOUT;
+		return res;
+	}
+
+	inline static int
+	_reactor_events_from_os(uint32_t events)
+	{
+		int res = REACTOR_EVENT_NONE;
+		if (events & EPOLLIN)
+			res |= REACTOR_EVENT_READ;
+		if (events & EPOLLOUT)
+			res |= REACTOR_EVENT_WRITE;
+		if (events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+			res |= REACTOR_EVENT_ERROR;
+		return res;
+	}
+
+	// API
+	Reactor
+	reactor_new()
+	{
+		auto epoll = ::epoll_create1(EPOLL_CLOEXEC);
+		if (epoll == -1)
+			return nullptr;
+
+		auto wake = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (wake == -1)
+		{
+			::close(epoll);
+			return nullptr;
+		}
+
+		epoll_event event{};
+		event.events = EPOLLIN;
+		event.data.u64 = REACTOR_WAKE_HANDLE;
+		if (::epoll_ctl(epoll, EPOLL_CTL_ADD, wake, &event) == -1)
+		{
+			::close(wake);
+			::close(epoll);
+			return nullptr;
+		}
+
+		auto self = alloc_zerod<IReactor>();
+		self->epoll = epoll;
+		self->wake = wake;
+		return self;
+	}
+
+	void
+	reactor_free(Reactor self)
+	{
+		::close(self->wake);
+		::close(self->epoll);
+		free(self);
+	}
+
+	bool
+	reactor_arm(Reactor self, int64_t handle, int events)
+	{
+		epoll_event event{};
+		event.events = _reactor_events_to_os(events);
+		event.data.u64 = uint64_t(handle);
+
+		// one shot handles stay in the interest list after they fire, so re-arming is a modify, the first arm is an add
+		if (::epoll_ctl(self->epoll, EPOLL_CTL_MOD, int(handle), &event) == 0)
+			return true;
+		if (errno != ENOENT)
+			return false;
+		return ::epoll_ctl(self->epoll, EPOLL_CTL_ADD, int(handle), &event) == 0;
+	}
+
+	void
+	reactor_remove(Reactor self, int64_t handle)
+	{
+		::epoll_ctl(self->epoll, EPOLL_CTL_DEL, int(handle), nullptr);
+	}
+
+	size_t
+	reactor_wait(Reactor self, Reactor_Event* events, size_t events_count, Timeout timeout)
+	{
+		constexpr size_t OS_EVENTS_COUNT = 256;
+		epoll_event os_events[OS_EVENTS_COUNT];
+		if (events_count > OS_EVENTS_COUNT)
+			events_count = OS_EVENTS_COUNT;
+
+		int milliseconds = 0;
+		if (timeout == INFINITE_TIMEOUT)
+			milliseconds = -1;
+		else if (timeout == NO_TIMEOUT)
+			milliseconds = 0;
+		else
+			milliseconds = int(timeout.milliseconds);
+
+		auto ready = ::epoll_wait(self->epoll, os_events, int(events_count), milliseconds);
+		if (ready <= 0)
+			return 0;
+
+		size_t count = 0;
+		for (int i = 0; i < ready; ++i)
+		{
+			if (os_events[i].data.u64 == REACTOR_WAKE_HANDLE)
+			{
+				uint64_t value = 0;
+				[[maybe_unused]] auto res = ::read(self->wake, &value, sizeof(value));
+				continue;
+			}
+
+			events[count].handle = int64_t(os_events[i].data.u64);
+			events[count].events = _reactor_events_from_os(os_events[i].events);
+			++count;
+		}
+		return count;
+	}
+
+	void
+	reactor_wake(Reactor self)
+	{
+		uint64_t value = 1;
+		[[maybe_unused]] auto res = ::write(self->wake, &value, sizeof(value));
+	}
+}
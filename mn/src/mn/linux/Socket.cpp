@@ -7,6 +7,20 @@
 #include <fcntl.h>
 #include <netdb.h>
 #include <poll.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <netinet/udp.h>
+#include <linux/errqueue.h>
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
 
 namespace mn
 {
@@ -65,6 +79,47 @@ namespace mn
 		}
 	}
 
+	inline static int
+	_socket_timeout_to_os(Timeout timeout)
+	{
+		if(timeout == INFINITE_TIMEOUT)
+			return -1;
+		else if(timeout == NO_TIMEOUT)
+			return 0;
+		else
+			return int(timeout.milliseconds);
+	}
+
+	// waits until the given socket is readable within the given timeout window, with NO_TIMEOUT it returns immediately
+	// and the caller's non blocking call reports whether there's something to read
+	inline static MN_SOCKET_ERROR
+	_socket_wait_readable(Socket self, Timeout timeout)
+	{
+		if (timeout == NO_TIMEOUT)
+			return MN_SOCKET_ERROR_OK;
+
+		pollfd pfd_read{};
+		pfd_read.fd = self->handle;
+		pfd_read.events = POLLIN;
+
+		worker_block_ahead();
+		int ready = ::poll(&pfd_read, 1, _socket_timeout_to_os(timeout));
+		worker_block_clear();
+		if (ready == -1)
+			return _socket_error_from_os(errno);
+		else if (ready == 0)
+			return MN_SOCKET_ERROR_TIMEOUT;
+		return MN_SOCKET_ERROR_OK;
+	}
+
+	inline static MN_SOCKET_ERROR
+	_socket_nonblocking_error_from_os(int error)
+	{
+		if (error == EAGAIN || error == EWOULDBLOCK)
+			return MN_SOCKET_ERROR_TIMEOUT;
+		return _socket_error_from_os(error);
+	}
+
 
 	// API
 	void
@@ -220,6 +275,20 @@ namespace mn
 	Result<size_t, MN_SOCKET_ERROR>
 	socket_read(Socket self, Block data, Timeout timeout)
 	{
+		// with no timeout we read without waiting, which is the case for reads driven by the fabric's reactor, so we
+		// skip the poll syscall and the worker blocking notifications
+		if (timeout == NO_TIMEOUT)
+		{
+			auto res = ::recv(self->handle, data.ptr, data.size, MSG_DONTWAIT);
+			if (res == -1)
+			{
+				if (errno == EAGAIN || errno == EWOULDBLOCK)
+					return MN_SOCKET_ERROR_TIMEOUT;
+				return _socket_error_from_os(errno);
+			}
+			return res;
+		}
+
 		pollfd pfd_read{};
 		pfd_read.fd = self->handle;
 		pfd_read.events = POLLIN;
@@ -265,6 +334,416 @@ namespace mn
 		return res;
 	}
 
+	size_t
+	socket_writev(Socket self, const Block* blocks, size_t count)
+	{
+		constexpr size_t IOVECS_COUNT = 64;
+
+		size_t res = 0;
+		worker_block_ahead();
+		mn_defer(worker_block_clear());
+		while (count > 0)
+		{
+			iovec iovecs[IOVECS_COUNT];
+			size_t iovecs_count = count < IOVECS_COUNT ? count : IOVECS_COUNT;
+			size_t iovecs_size = 0;
+			for (size_t i = 0; i < iovecs_count; ++i)
+			{
+				iovecs[i].iov_base = blocks[i].ptr;
+				iovecs[i].iov_len = blocks[i].size;
+				iovecs_size += blocks[i].size;
+			}
+
+			msghdr msg{};
+			msg.msg_iov = iovecs;
+			msg.msg_iovlen = iovecs_count;
+			auto sent = ::sendmsg(self->handle, &msg, 0);
+			if (sent == -1)
+				break;
+			res += sent;
+			if (size_t(sent) < iovecs_size)
+				break;
+
+			blocks += iovecs_count;
+			count -= iovecs_count;
+		}
+		return res;
+	}
+
+	size_t
+	socket_sendfile(Socket self, File file, int64_t offset, size_t size)
+	{
+		size_t res = 0;
+		off_t os_offset = offset;
+		worker_block_ahead();
+		mn_defer(worker_block_clear());
+		while (res < size)
+		{
+			auto sent = ::sendfile(self->handle, file->linux_handle, &os_offset, size - res);
+			if (sent == -1 && errno == EINTR)
+				continue;
+			if (sent <= 0)
+				break;
+			res += sent;
+		}
+		return res;
+	}
+
+	bool
+	socket_zerocopy_enable(Socket self)
+	{
+		int enable = 1;
+		if (::setsockopt(self->handle, SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable)) == -1)
+			return false;
+		self->zerocopy = true;
+		return true;
+	}
+
+	size_t
+	socket_write_zerocopy(Socket self, Block data)
+	{
+		if (self->zerocopy == false)
+			return socket_write(self, data);
+
+		worker_block_ahead();
+		auto res = ::send(self->handle, data.ptr, data.size, MSG_ZEROCOPY);
+		worker_block_clear();
+		if (res == -1)
+		{
+			// the os couldn't pin the pages (locked memory limit), so we copy them instead
+			if (errno == ENOBUFS)
+				return socket_write(self, data);
+			return 0;
+		}
+
+		// each successful zerocopy send gets a sequence number, the os reports completed ranges of sequence numbers
+		++self->zerocopy_sent;
+		return res;
+	}
+
+	size_t
+	socket_zerocopy_reap(Socket self, Timeout timeout)
+	{
+		int milliseconds = _socket_timeout_to_os(timeout);
+
+		while (self->zerocopy_completed != self->zerocopy_sent)
+		{
+			// drain the notifications from the socket's error queue
+			while (true)
+			{
+				char control[128];
+				msghdr msg{};
+				msg.msg_control = control;
+				msg.msg_controllen = sizeof(control);
+				if (::recvmsg(self->handle, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1)
+					break;
+
+				for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+				{
+					bool is_error = (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+									(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR);
+					if (is_error == false)
+						continue;
+
+					auto err = (sock_extended_err*)CMSG_DATA(cmsg);
+					if (err->ee_errno != 0 || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+						continue;
+
+					// [ee_info, ee_data] is the inclusive range of completed sequence numbers
+					uint32_t completed = err->ee_data + 1;
+					if (int32_t(completed - self->zerocopy_completed) > 0)
+						self->zerocopy_completed = completed;
+				}
+			}
+
+			if (self->zerocopy_completed == self->zerocopy_sent || milliseconds == 0)
+				break;
+
+			// the error queue wakes up poll with POLLERR even if we don't ask for any event
+			pollfd pfd{};
+			pfd.fd = self->handle;
+			worker_block_ahead();
+			int ready = ::poll(&pfd, 1, milliseconds);
+			worker_block_clear();
+			if (ready <= 0)
+				break;
+		}
+		return self->zerocopy_sent - self->zerocopy_completed;
+	}
+
+	bool
+	socket_address_from(SOCKET_FAMILY family, const Str& address, const Str& port, Socket_Address& res)
+	{
+		addrinfo hints{}, *info;
+
+		hints.ai_family = _socket_family_to_os(family);
+		_socket_type_to_os(SOCKET_TYPE_UDP, hints.ai_socktype, hints.ai_protocol);
+
+		worker_block_ahead();
+		mn_defer(worker_block_clear());
+		if (::getaddrinfo(address.ptr, port.ptr, &hints, &info) != 0)
+			return false;
+		mn_defer(::freeaddrinfo(info));
+
+		if (info->ai_addrlen > sizeof(res.storage))
+			return false;
+		::memcpy(res.storage, info->ai_addr, info->ai_addrlen);
+		res.size = uint32_t(info->ai_addrlen);
+		return true;
+	}
+
+	Str
+	socket_address_str(const Socket_Address& self, Allocator allocator)
+	{
+		char host[NI_MAXHOST];
+		char service[NI_MAXSERV];
+		auto addr = (const sockaddr*)self.storage;
+		auto res = str_with_allocator(allocator);
+		if (::getnameinfo(addr, self.size, host, sizeof(host), service, sizeof(service), NI_NUMERICHOST | NI_NUMERICSERV) != 0)
+			return res;
+
+		if (addr->sa_family == AF_INET6)
+		{
+			str_push(res, "[");
+			str_push(res, host);
+			str_push(res, "]");
+		}
+		else
+		{
+			str_push(res, host);
+		}
+		str_push(res, ":");
+		str_push(res, service);
+		return res;
+	}
+
+	Result<size_t, MN_SOCKET_ERROR>
+	socket_recv_from(Socket self, Block data, Socket_Address& address, Timeout timeout)
+	{
+		if (auto err = _socket_wait_readable(self, timeout))
+			return err;
+
+		socklen_t address_size = sizeof(address.storage);
+		auto res = ::recvfrom(self->handle, data.ptr, data.size, MSG_DONTWAIT, (sockaddr*)address.storage, &address_size);
+		if (res == -1)
+			return _socket_nonblocking_error_from_os(errno);
+		address.size = address_size;
+		return size_t(res);
+	}
+
+	size_t
+	socket_send_to(Socket self, Block data, const Socket_Address& address)
+	{
+		worker_block_ahead();
+		auto res = ::sendto(self->handle, data.ptr, data.size, 0, (const sockaddr*)address.storage, address.size);
+		worker_block_clear();
+		if (res == -1)
+			return 0;
+		return res;
+	}
+
+	Result<size_t, MN_SOCKET_ERROR>
+	socket_recv_many(Socket self, Socket_Datagram* datagrams, size_t count, Timeout timeout)
+	{
+		constexpr size_t MSGS_COUNT = 64;
+
+		if (auto err = _socket_wait_readable(self, timeout))
+			return err;
+
+		size_t res = 0;
+		while (res < count)
+		{
+			mmsghdr msgs[MSGS_COUNT];
+			iovec iovecs[MSGS_COUNT];
+			size_t msgs_count = count - res < MSGS_COUNT ? count - res : MSGS_COUNT;
+			for (size_t i = 0; i < msgs_count; ++i)
+			{
+				auto& datagram = datagrams[res + i];
+				iovecs[i].iov_base = datagram.data.ptr;
+				iovecs[i].iov_len = datagram.data.size;
+				msgs[i] = mmsghdr{};
+				msgs[i].msg_hdr.msg_iov = &iovecs[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
+				msgs[i].msg_hdr.msg_name = datagram.address.storage;
+				msgs[i].msg_hdr.msg_namelen = sizeof(datagram.address.storage);
+			}
+
+			auto received = ::recvmmsg(self->handle, msgs, unsigned(msgs_count), MSG_DONTWAIT, nullptr);
+			if (received == -1)
+			{
+				if (res == 0)
+					return _socket_nonblocking_error_from_os(errno);
+				break;
+			}
+
+			for (int i = 0; i < received; ++i)
+			{
+				auto& datagram = datagrams[res + i];
+				datagram.data.size = msgs[i].msg_len;
+				datagram.address.size = msgs[i].msg_hdr.msg_namelen;
+			}
+			res += size_t(received);
+			if (size_t(received) < msgs_count)
+				break;
+		}
+		return res;
+	}
+
+	size_t
+	socket_send_many(Socket self, const Socket_Datagram* datagrams, size_t count)
+	{
+		constexpr size_t MSGS_COUNT = 64;
+
+		size_t res = 0;
+		worker_block_ahead();
+		mn_defer(worker_block_clear());
+		while (res < count)
+		{
+			mmsghdr msgs[MSGS_COUNT];
+			iovec iovecs[MSGS_COUNT];
+			size_t msgs_count = count - res < MSGS_COUNT ? count - res : MSGS_COUNT;
+			for (size_t i = 0; i < msgs_count; ++i)
+			{
+				auto& datagram = datagrams[res + i];
+				iovecs[i].iov_base = datagram.data.ptr;
+				iovecs[i].iov_len = datagram.data.size;
+				msgs[i] = mmsghdr{};
+				msgs[i].msg_hdr.msg_iov = &iovecs[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
+				msgs[i].msg_hdr.msg_name = (void*)datagram.address.storage;
+				msgs[i].msg_hdr.msg_namelen = datagram.address.size;
+			}
+
+			auto sent = ::sendmmsg(self->handle, msgs, unsigned(msgs_count), 0);
+			if (sent == -1)
+				break;
+			res += size_t(sent);
+			if (size_t(sent) < msgs_count)
+				break;
+		}
+		return res;
+	}
+
+	size_t
+	socket_send_segmented(Socket self, Block data, size_t segment_size, const Socket_Address& address)
+	{
+		// the kernel limits a single gso call to 64 segments and a 64KB udp payload
+		constexpr size_t GSO_MAX_SEGMENTS = 64;
+		constexpr size_t GSO_MAX_SIZE = 65000;
+
+		if (segment_size == 0 || data.size <= segment_size)
+			return socket_send_to(self, data, address);
+
+		auto segments_per_call = GSO_MAX_SIZE / segment_size;
+		if (segments_per_call > GSO_MAX_SEGMENTS)
+			segments_per_call = GSO_MAX_SEGMENTS;
+		auto call_size = segments_per_call * segment_size;
+
+		size_t res = 0;
+		bool gso = segments_per_call > 1;
+		while (gso && res < data.size)
+		{
+			auto size = data.size - res < call_size ? data.size - res : call_size;
+			iovec iov{(char*)data.ptr + res, size};
+
+			alignas(cmsghdr) char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+			msghdr msg{};
+			msg.msg_iov = &iov;
+			msg.msg_iovlen = 1;
+			msg.msg_name = (void*)address.storage;
+			msg.msg_namelen = address.size;
+			msg.msg_control = control;
+			msg.msg_controllen = sizeof(control);
+			auto cmsg = CMSG_FIRSTHDR(&msg);
+			cmsg->cmsg_level = SOL_UDP;
+			cmsg->cmsg_type = UDP_SEGMENT;
+			cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+			auto gso_size = uint16_t(segment_size);
+			::memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+
+			worker_block_ahead();
+			auto sent = ::sendmsg(self->handle, &msg, 0);
+			worker_block_clear();
+			if (sent == -1)
+			{
+				// old kernels and devices without checksum offload don't support gso, send the rest one by one
+				if (errno == EINVAL || errno == EIO || errno == ENOPROTOOPT || errno == EOPNOTSUPP)
+				{
+					gso = false;
+					break;
+				}
+				return res;
+			}
+			res += size_t(sent);
+		}
+
+		while (res < data.size)
+		{
+			constexpr size_t DATAGRAMS_COUNT = 64;
+			Socket_Datagram datagrams[DATAGRAMS_COUNT];
+			size_t datagrams_count = 0;
+			size_t batch_size = 0;
+			for (; datagrams_count < DATAGRAMS_COUNT && res + batch_size < data.size; ++datagrams_count)
+			{
+				auto offset = res + batch_size;
+				auto size = data.size - offset < segment_size ? data.size - offset : segment_size;
+				datagrams[datagrams_count].data = Block{(char*)data.ptr + offset, size};
+				datagrams[datagrams_count].address = address;
+				batch_size += size;
+			}
+
+			auto sent = socket_send_many(self, datagrams, datagrams_count);
+			for (size_t i = 0; i < sent; ++i)
+				res += datagrams[i].data.size;
+			if (sent < datagrams_count)
+				break;
+		}
+		return res;
+	}
+
+	bool
+	socket_gro_enable(Socket self)
+	{
+		int enable = 1;
+		return ::setsockopt(self->handle, SOL_UDP, UDP_GRO, &enable, sizeof(enable)) == 0;
+	}
+
+	Result<size_t, MN_SOCKET_ERROR>
+	socket_recv_segmented(Socket self, Block data, Socket_Address& address, size_t& segment_size, Timeout timeout)
+	{
+		if (auto err = _socket_wait_readable(self, timeout))
+			return err;
+
+		iovec iov{data.ptr, data.size};
+		alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+		msghdr msg{};
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_name = address.storage;
+		msg.msg_namelen = sizeof(address.storage);
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		auto res = ::recvmsg(self->handle, &msg, MSG_DONTWAIT);
+		if (res == -1)
+			return _socket_nonblocking_error_from_os(errno);
+		address.size = msg.msg_namelen;
+
+		// without a gro control message it's a single datagram
+		segment_size = size_t(res);
+		for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+		{
+			if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+			{
+				int gso_size = 0;
+				::memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+				if (gso_size > 0)
+					segment_size = size_t(gso_size);
+			}
+		}
+		return size_t(res);
+	}
+
 	int64_t
 	socket_fd(Socket self)
 	{
@@ -10,6 +10,8 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 #include <assert.h>
 #include <chrono>
@@ -694,6 +696,29 @@ namespace mn
 		pthread_cond_broadcast(&self->cv);
 	}
 
+	// Futex
+	static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t), "futex needs a lock free 32-bit atomic");
+
+	void
+	futex_wait(std::atomic<int32_t>& value, int32_t expected)
+	{
+		worker_block_ahead();
+		syscall(SYS_futex, &value, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+		worker_block_clear();
+	}
+
+	void
+	futex_wake_one(std::atomic<int32_t>& value)
+	{
+		syscall(SYS_futex, &value, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+	}
+
+	void
+	futex_wake_all(std::atomic<int32_t>& value)
+	{
+		syscall(SYS_futex, &value, FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+	}
+
 	// Waitgroup
 	struct IWaitgroup
 	{
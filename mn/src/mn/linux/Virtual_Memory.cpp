@@ -1,6 +1,8 @@
 #include "mn/Virtual_Memory.h"
+#include "mn/Defer.h"
 
 #include <sys/mman.h>
+#include <unistd.h>
 
 namespace mn
 {
@@ -19,4 +21,67 @@ namespace mn
 	{
 		munmap(block.ptr, block.size);
 	}
+
+	Block
+	virtual_reserve(void* address_hint, size_t size)
+	{
+		Block result{};
+		auto ptr = mmap(address_hint, size, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+		if (ptr != MAP_FAILED)
+		{
+			result.ptr = ptr;
+			result.size = size;
+		}
+		return result;
+	}
+
+	bool
+	virtual_commit(Block block)
+	{
+		return mprotect(block.ptr, block.size, PROT_READ|PROT_WRITE) == 0;
+	}
+
+	void
+	virtual_decommit(Block block)
+	{
+		madvise(block.ptr, block.size, MADV_DONTNEED);
+		mprotect(block.ptr, block.size, PROT_NONE);
+	}
+
+	Block
+	virtual_alloc_mirrored(size_t size)
+	{
+		auto page_size = size_t(sysconf(_SC_PAGESIZE));
+		size = (size + page_size - 1) / page_size * page_size;
+		if (size == 0)
+			return Block{};
+
+		// the memfd is the shared pages which are mapped twice, the mappings keep it alive after it's closed
+		auto fd = memfd_create("mn-mirrored", MFD_CLOEXEC);
+		if (fd == -1)
+			return Block{};
+		mn_defer(close(fd));
+
+		if (ftruncate(fd, off_t(size)) != 0)
+			return Block{};
+
+		auto reserved = virtual_reserve(nullptr, size * 2);
+		if (reserved.ptr == nullptr)
+			return Block{};
+
+		auto first = mmap(reserved.ptr, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_FIXED, fd, 0);
+		auto second = mmap((char*)reserved.ptr + size, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_FIXED, fd, 0);
+		if (first == MAP_FAILED || second == MAP_FAILED)
+		{
+			virtual_free(reserved);
+			return Block{};
+		}
+		return Block{reserved.ptr, size};
+	}
+
+	void
+	virtual_free_mirrored(Block block)
+	{
+		munmap(block.ptr, block.size * 2);
+	}
 }
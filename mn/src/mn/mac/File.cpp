@@ -393,7 +393,7 @@ namespace mn
 			offset
 		);
 
-		if (ptr == nullptr)
+		if (ptr == MAP_FAILED)
 			return nullptr;
 
 		auto self = alloc_zerod<IMapped_File>();
@@ -421,6 +421,25 @@ namespace mn
 		return res;
 	}
 
+	bool
+	file_mmap_hint(Mapped_File* self, int hints)
+	{
+		if (self->data.size == 0)
+			return true;
+
+		bool res = true;
+		if (hints & MAPPED_FILE_HINT_SEQUENTIAL)
+			res &= ::madvise(self->data.ptr, self->data.size, MADV_SEQUENTIAL) == 0;
+		if (hints & MAPPED_FILE_HINT_RANDOM)
+			res &= ::madvise(self->data.ptr, self->data.size, MADV_RANDOM) == 0;
+		if (hints & MAPPED_FILE_HINT_WILL_NEED)
+			res &= ::madvise(self->data.ptr, self->data.size, MADV_WILLNEED) == 0;
+		// macos doesn't have huge pages for file mappings
+		if (hints & MAPPED_FILE_HINT_HUGE_PAGES)
+			res = false;
+		return res;
+	}
+
 	bool
 	file_unmap(Mapped_File* ptr)
 	{
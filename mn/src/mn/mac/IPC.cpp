@@ -9,6 +9,7 @@
 #include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <assert.h>
 #include <poll.h>
@@ -107,8 +108,11 @@ namespace mn::ipc
 	}
 
 	Sputnik
-	sputnik_new(const mn::Str& name)
+	sputnik_new(const mn::Str& name, Sputnik_Settings settings)
 	{
+		// the shm transport is only supported on linux
+		settings.transport = SPUTNIK_TRANSPORT_SOCKET;
+
 		sockaddr_un addr{};
 		addr.sun_family = AF_LOCAL;
 		assert(name.count < sizeof(addr.sun_path) && "name is too long");
@@ -129,14 +133,17 @@ namespace mn::ipc
 			return nullptr;
 		}
 		auto self = mn::alloc_construct<ISputnik>();
+		self->settings = settings;
 		self->linux_domain_socket = handle;
 		self->name = mn::str_from_substr(name.ptr, name.ptr + name_length);
 		return self;
 	}
 
 	Sputnik
-	sputnik_connect(const mn::Str& name)
+	sputnik_connect(const mn::Str& name, Sputnik_Settings settings)
 	{
+		settings.transport = SPUTNIK_TRANSPORT_SOCKET;
+
 		sockaddr_un addr{};
 		addr.sun_family = AF_LOCAL;
 		assert(name.count < sizeof(addr.sun_path) && "name is too long");
@@ -158,6 +165,7 @@ namespace mn::ipc
 		worker_block_clear();
 
 		auto self = mn::alloc_construct<ISputnik>();
+		self->settings = settings;
 		self->linux_domain_socket = handle;
 		self->name = mn::str_from_substr(name.ptr, name.ptr + name_length);
 		return self;
@@ -209,6 +217,7 @@ namespace mn::ipc
 		if(handle == -1)
 			return nullptr;
 		auto other = mn::alloc_construct<ISputnik>();
+		other->settings = self->settings;
 		other->linux_domain_socket = handle;
 		other->name = clone(self->name);
 		return other;
@@ -249,6 +258,39 @@ namespace mn::ipc
 		return res;
 	}
 
+	size_t
+	sputnik_writev(Sputnik self, const Block* blocks, size_t count)
+	{
+		constexpr size_t IOVECS_COUNT = 64;
+
+		size_t res = 0;
+		worker_block_ahead();
+		while (count > 0)
+		{
+			iovec iovecs[IOVECS_COUNT];
+			size_t iovecs_count = count < IOVECS_COUNT ? count : IOVECS_COUNT;
+			size_t iovecs_size = 0;
+			for (size_t i = 0; i < iovecs_count; ++i)
+			{
+				iovecs[i].iov_base = blocks[i].ptr;
+				iovecs[i].iov_len = blocks[i].size;
+				iovecs_size += blocks[i].size;
+			}
+
+			auto written = ::writev(self->linux_domain_socket, iovecs, int(iovecs_count));
+			if (written == -1)
+				break;
+			res += written;
+			if (size_t(written) < iovecs_size)
+				break;
+
+			blocks += iovecs_count;
+			count -= iovecs_count;
+		}
+		worker_block_clear();
+		return res;
+	}
+
 	bool
 	sputnik_disconnect(Sputnik self)
 	{
@@ -259,8 +301,8 @@ namespace mn::ipc
 	sputnik_msg_write(Sputnik self, Block data)
 	{
 		uint64_t len = data.size;
-		auto res = sputnik_write(self, block_from(len));
-		res += sputnik_write(self, data);
+		Block blocks[] = {block_from(len), data};
+		auto res = sputnik_writev(self, blocks, 2);
 		return res == (data.size + sizeof(len));
 	}
 
@@ -2,6 +2,8 @@
 #include "mn/OS.h"
 #include "mn/IO.h"
 #include "mn/Defer.h"
+#include "mn/Fabric.h"
+#include "mn/Ring.h"
 
 #define _LARGEFILE64_SOURCE 1
 #include <sys/stat.h>
@@ -15,6 +17,7 @@
 #include <libgen.h>
 
 #include <mach-o/dyld.h>
+#include <copyfile.h>
 
 #include <assert.h>
 
@@ -209,6 +212,229 @@ namespace mn
 		return res;
 	}
 
+	// an open folder in the walk, readdir reads the folder content in big batches into the DIR's own buffer
+	struct Path_Walker_Level
+	{
+		DIR* dir;
+		size_t depth;
+		// count of the folder's path in the walker's path
+		size_t path_count;
+	};
+
+	// a folder which is waiting to be walked in breadth first order
+	struct Path_Walker_Pending
+	{
+		Str path;
+		size_t depth;
+	};
+
+	inline static void
+	destruct(Path_Walker_Pending& self)
+	{
+		str_free(self.path);
+	}
+
+	struct IPath_Walker
+	{
+		Path_Walk_Settings settings;
+		Str path;
+		// the open folders stack, in breadth first order it only has one level
+		Buf<Path_Walker_Level> levels;
+		Ring<Path_Walker_Pending> pending;
+		// the last reported folder, it's opened in the next call to path_walker_next unless it's skipped
+		bool descend;
+		const char* descend_name;
+		size_t descend_depth;
+	};
+
+	inline static bool
+	_path_walker_push_level(Path_Walker self, int fd, size_t depth)
+	{
+		if (fd < 0)
+			return false;
+
+		auto dir = ::fdopendir(fd);
+		if (dir == nullptr)
+		{
+			::close(fd);
+			return false;
+		}
+
+		Path_Walker_Level level{};
+		level.dir = dir;
+		level.depth = depth;
+		level.path_count = self->path.count;
+		buf_push(self->levels, level);
+		return true;
+	}
+
+	inline static void
+	_path_walker_pop_level(Path_Walker self)
+	{
+		::closedir(buf_top(self->levels).dir);
+		buf_pop(self->levels);
+	}
+
+	inline static PATH_WALK_KIND
+	_path_walk_kind_from_mode(mode_t mode)
+	{
+		if (S_ISREG(mode))
+			return PATH_WALK_KIND_FILE;
+		else if (S_ISDIR(mode))
+			return PATH_WALK_KIND_FOLDER;
+		else if (S_ISLNK(mode))
+			return PATH_WALK_KIND_SYMLINK;
+		else
+			return PATH_WALK_KIND_OTHER;
+	}
+
+	// stats the given entry relative to its folder which saves the kernel the path lookup
+	inline static bool
+	_path_walker_stat(int folder_fd, const char* name, Path_Walk_Entry& entry)
+	{
+		struct stat sb{};
+		worker_block_ahead();
+		auto res = ::fstatat(folder_fd, name, &sb, AT_SYMLINK_NOFOLLOW);
+		worker_block_clear();
+		if (res != 0)
+			return false;
+
+		entry.kind = _path_walk_kind_from_mode(sb.st_mode);
+		entry.has_stat = true;
+		entry.size = int64_t(sb.st_size);
+		entry.last_write_time = int64_t(sb.st_mtime);
+		return true;
+	}
+
+	// API
+	Path_Walker
+	path_walker_new(const char* root, Path_Walk_Settings settings)
+	{
+		auto fd = ::open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (fd < 0)
+			return nullptr;
+
+		auto self = alloc_zerod<IPath_Walker>();
+		self->settings = settings;
+		self->path = str_from_c(root);
+		// remove the trailing separators so that we can join the names with a single '/'
+		while (self->path.count > 1 && self->path[self->path.count - 1] == '/')
+			str_resize(self->path, self->path.count - 1);
+		self->levels = buf_new<Path_Walker_Level>();
+		self->pending = ring_new<Path_Walker_Pending>();
+		if (_path_walker_push_level(self, fd, 0) == false)
+		{
+			path_walker_free(self);
+			return nullptr;
+		}
+		return self;
+	}
+
+	void
+	path_walker_free(Path_Walker self)
+	{
+		while (self->levels.count > 0)
+			_path_walker_pop_level(self);
+		buf_free(self->levels);
+		destruct(self->pending);
+		str_free(self->path);
+		free(self);
+	}
+
+	bool
+	path_walker_next(Path_Walker self, Path_Walk_Entry& entry)
+	{
+		if (self->descend)
+		{
+			self->descend = false;
+			if (self->settings.order == PATH_WALK_ORDER_DEPTH_FIRST)
+			{
+				// the walker's path is still the path of the last reported folder
+				worker_block_ahead();
+				auto fd = ::openat(::dirfd(buf_top(self->levels).dir), self->descend_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+				worker_block_clear();
+				_path_walker_push_level(self, fd, self->descend_depth);
+			}
+			else
+			{
+				ring_push_back(self->pending, Path_Walker_Pending{str_from_c(self->path.ptr), self->descend_depth});
+			}
+		}
+
+		while (true)
+		{
+			if (self->levels.count == 0)
+			{
+				if (ring_empty(self->pending))
+					return false;
+
+				auto pending = ring_front(self->pending);
+				ring_pop_front(self->pending);
+				mn_defer(destruct(pending));
+
+				str_clear(self->path);
+				str_push(self->path, pending.path);
+				worker_block_ahead();
+				auto fd = ::open(self->path.ptr, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+				worker_block_clear();
+				_path_walker_push_level(self, fd, pending.depth);
+				continue;
+			}
+
+			auto& level = buf_top(self->levels);
+			worker_block_ahead();
+			auto record = ::readdir(level.dir);
+			worker_block_clear();
+			if (record == nullptr)
+			{
+				_path_walker_pop_level(self);
+				continue;
+			}
+
+			if (::strcmp(record->d_name, ".") == 0 || ::strcmp(record->d_name, "..") == 0)
+				continue;
+
+			entry = Path_Walk_Entry{};
+			entry.depth = level.depth + 1;
+			switch (record->d_type)
+			{
+			case DT_REG: entry.kind = PATH_WALK_KIND_FILE; break;
+			case DT_DIR: entry.kind = PATH_WALK_KIND_FOLDER; break;
+			case DT_LNK: entry.kind = PATH_WALK_KIND_SYMLINK; break;
+			default: entry.kind = PATH_WALK_KIND_OTHER; break;
+			}
+
+			// some filesystems don't report the kind with the folder content so we stat them
+			if (self->settings.stat || record->d_type == DT_UNKNOWN)
+			{
+				if (_path_walker_stat(::dirfd(level.dir), record->d_name, entry) == false)
+					continue;
+			}
+
+			str_resize(self->path, level.path_count);
+			if (self->path.count == 0 || self->path[self->path.count - 1] != '/')
+				str_push(self->path, "/");
+			str_push(self->path, record->d_name);
+
+			entry.name = record->d_name;
+			entry.path = self->path.ptr;
+
+			if (entry.kind == PATH_WALK_KIND_FOLDER && (self->settings.max_depth == 0 || entry.depth < self->settings.max_depth))
+			{
+				self->descend = true;
+				self->descend_name = record->d_name;
+				self->descend_depth = entry.depth;
+			}
+			return true;
+		}
+	}
+
+	void
+	path_walker_skip(Path_Walker self)
+	{
+		self->descend = false;
+	}
+
 	Str
 	path_executable(Allocator allocator)
 	{
@@ -240,40 +466,12 @@ namespace mn
 	bool
 	file_copy(const char* src, const char* dst)
 	{
-		char buf[4096];
-		ssize_t nread = -1;
-		int fd_src = ::open(src, O_RDONLY);
-		if(fd_src < 0)
-			return false;
-
-		int fd_dst = ::open(dst, O_WRONLY | O_CREAT | O_EXCL, 0666);
-		if(fd_dst < 0)
-			goto FAILURE;
-
-		while(nread = ::read(fd_src, buf, sizeof(buf)), nread > 0)
-		{
-			char *out_ptr = buf;
-			ssize_t nwritten = 0;
-			do
-			{
-				nwritten = ::write(fd_dst, out_ptr, nread);
-				if(nwritten >= 0)
-				{
-					nread -= nwritten;
-					out_ptr += nwritten;
-				}
-				else if(errno != EINTR)
-				{
-					goto FAILURE;
-				}
-			} while(nread > 0);
-		}
+		worker_block_ahead();
+		mn_defer(worker_block_clear());
 
-	FAILURE:
-		::close(fd_src);
-		if(fd_dst >= 0)
-			::close(fd_dst);
-		return nread == 0;
+		// clones the file on apfs and falls back to a kernel side data copy on other filesystems, clone also implies
+		// exclusive creation of the destination file
+		return ::copyfile(src, dst, nullptr, COPYFILE_DATA | COPYFILE_CLONE | COPYFILE_EXCL) == 0;
 	}
 
 	bool
@@ -0,0 +1,123 @@
+#include "mn/Reactor.h"
+#include "mn/Memory.h"
+
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace mn
+{
+	struct IReactor
+	{
+		int kqueue;
+	};
+
+	// the user event used to wake up the waiting thread, it uses an invalid handle so it can't clash with user handles
+	constexpr static uintptr_t REACTOR_WAKE_IDENT = ~uintptr_t(0);
+
+	// API
+	Reactor
+	reactor_new()
+	{
+		auto queue = ::kqueue();
+		if (queue == -1)
+			return nullptr;
+
+		struct kevent event{};
+		EV_SET(&event, REACTOR_WAKE_IDENT, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, nullptr);
+		if (::kevent(queue, &event, 1, nullptr, 0, nullptr) == -1)
+		{
+			::close(queue);
+			return nullptr;
+		}
+
+		auto self = alloc_zerod<IReactor>();
+		self->kqueue = queue;
+		return self;
+	}
+
+	void
+	reactor_free(Reactor self)
+	{
+		::close(self->kqueue);
+		free(self);
+	}
+
+	bool
+	reactor_arm(Reactor self, int64_t handle, int events)
+	{
+		// read and write are separate filters in kqueue, if both are armed the one which doesn't fire stays armed and
+		// might report the handle again later, which is fine since handles can be reported spuriously
+		struct kevent changes[2];
+		int count = 0;
+		if (events & REACTOR_EVENT_READ)
+			EV_SET(&changes[count++], uintptr_t(handle), EVFILT_READ, EV_ADD | EV_ENABLE | EV_ONESHOT, 0, 0, nullptr);
+		if (events & REACTOR_EVENT_WRITE)
+			EV_SET(&changes[count++], uintptr_t(handle), EVFILT_WRITE, EV_ADD | EV_ENABLE | EV_ONESHOT, 0, 0, nullptr);
+		if (count == 0)
+			return true;
+		return ::kevent(self->kqueue, changes, count, nullptr, 0, nullptr) != -1;
+	}
+
+	void
+	reactor_remove(Reactor self, int64_t handle)
+	{
+		// each filter is deleted on its own because deleting a filter which isn't registered fails
+		struct kevent change{};
+		EV_SET(&change, uintptr_t(handle), EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+		::kevent(self->kqueue, &change, 1, nullptr, 0, nullptr);
+		EV_SET(&change, uintptr_t(handle), EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+		::kevent(self->kqueue, &change, 1, nullptr, 0, nullptr);
+	}
+
+	size_t
+	reactor_wait(Reactor self, Reactor_Event* events, size_t events_count, Timeout timeout)
+	{
+		constexpr size_t OS_EVENTS_COUNT = 256;
+		struct kevent os_events[OS_EVENTS_COUNT];
+		if (events_count > OS_EVENTS_COUNT)
+			events_count = OS_EVENTS_COUNT;
+
+		timespec ts{};
+		timespec* ts_ptr = nullptr;
+		if (timeout != INFINITE_TIMEOUT)
+		{
+			ts.tv_sec = timeout.milliseconds / 1000;
+			ts.tv_nsec = (timeout.milliseconds % 1000) * 1000000;
+			ts_ptr = &ts;
+		}
+
+		auto ready = ::kevent(self->kqueue, nullptr, 0, os_events, int(events_count), ts_ptr);
+		if (ready <= 0)
+			return 0;
+
+		size_t count = 0;
+		for (int i = 0; i < ready; ++i)
+		{
+			if (os_events[i].filter == EVFILT_USER)
+				continue;
+
+			int res = REACTOR_EVENT_NONE;
+			if (os_events[i].filter == EVFILT_READ)
+				res |= REACTOR_EVENT_READ;
+			else if (os_events[i].filter == EVFILT_WRITE)
+				res |= REACTOR_EVENT_WRITE;
+			if (os_events[i].flags & (EV_EOF | EV_ERROR))
+				res |= REACTOR_EVENT_ERROR;
+
+			events[count].handle = int64_t(os_events[i].ident);
+			events[count].events = res;
+			++count;
+		}
+		return count;
+	}
+
+	void
+	reactor_wake(Reactor self)
+	{
+		struct kevent event{};
+		EV_SET(&event, REACTOR_WAKE_IDENT, EVFILT_USER, 0, NOTE_TRIGGER, 0, nullptr);
+		::kevent(self->kqueue, &event, 1, nullptr, 0, nullptr);
+	}
+}
@@ -7,6 +7,8 @@
 #include <fcntl.h>
 #include <netdb.h>
 #include <poll.h>
+#include <errno.h>
+#include <sys/uio.h>
 
 namespace mn
 {
@@ -220,6 +222,20 @@ namespace mn
 	Result<size_t, MN_SOCKET_ERROR>
 	socket_read(Socket self, Block data, Timeout timeout)
 	{
+		// with no timeout we read without waiting, which is the case for reads driven by the fabric's reactor, so we
+		// skip the poll syscall and the worker blocking notifications
+		if (timeout == NO_TIMEOUT)
+		{
+			auto res = ::recv(self->handle, data.ptr, data.size, MSG_DONTWAIT);
+			if (res == -1)
+			{
+				if (errno == EAGAIN || errno == EWOULDBLOCK)
+					return MN_SOCKET_ERROR_TIMEOUT;
+				return _socket_error_from_os(errno);
+			}
+			return res;
+		}
+
 		pollfd pfd_read{};
 		pfd_read.fd = self->handle;
 		pfd_read.events = POLLIN;
@@ -265,6 +281,240 @@ namespace mn
 		return res;
 	}
 
+	size_t
+	socket_writev(Socket self, const Block* blocks, size_t count)
+	{
+		constexpr size_t IOVECS_COUNT = 64;
+
+		size_t res = 0;
+		worker_block_ahead();
+		mn_defer(worker_block_clear());
+		while (count > 0)
+		{
+			iovec iovecs[IOVECS_COUNT];
+			size_t iovecs_count = count < IOVECS_COUNT ? count : IOVECS_COUNT;
+			size_t iovecs_size = 0;
+			for (size_t i = 0; i < iovecs_count; ++i)
+			{
+				iovecs[i].iov_base = blocks[i].ptr;
+				iovecs[i].iov_len = blocks[i].size;
+				iovecs_size += blocks[i].size;
+			}
+
+			msghdr msg{};
+			msg.msg_iov = iovecs;
+			msg.msg_iovlen = int(iovecs_count);
+			auto sent = ::sendmsg(self->handle, &msg, 0);
+			if (sent == -1)
+				break;
+			res += sent;
+			if (size_t(sent) < iovecs_size)
+				break;
+
+			blocks += iovecs_count;
+			count -= iovecs_count;
+		}
+		return res;
+	}
+
+	size_t
+	socket_sendfile(Socket self, File file, int64_t offset, size_t size)
+	{
+		size_t res = 0;
+		worker_block_ahead();
+		mn_defer(worker_block_clear());
+		while (res < size)
+		{
+			// on input len is the count of bytes to send, on output it's the count of sent bytes even on failure
+			off_t len = off_t(size - res);
+			auto status = ::sendfile(file->macos_handle, int(self->handle), off_t(offset + res), &len, nullptr, 0);
+			res += size_t(len);
+			if (status == -1 && errno != EINTR && errno != EAGAIN)
+				break;
+			if (len == 0)
+				break;
+		}
+		return res;
+	}
+
+	bool
+	socket_zerocopy_enable(Socket)
+	{
+		return false;
+	}
+
+	size_t
+	socket_write_zerocopy(Socket self, Block data)
+	{
+		return socket_write(self, data);
+	}
+
+	size_t
+	socket_zerocopy_reap(Socket, Timeout)
+	{
+		return 0;
+	}
+
+	bool
+	socket_address_from(SOCKET_FAMILY family, const Str& address, const Str& port, Socket_Address& res)
+	{
+		addrinfo hints{}, *info;
+
+		hints.ai_family = _socket_family_to_os(family);
+		_socket_type_to_os(SOCKET_TYPE_UDP, hints.ai_socktype, hints.ai_protocol);
+
+		worker_block_ahead();
+		mn_defer(worker_block_clear());
+		if (::getaddrinfo(address.ptr, port.ptr, &hints, &info) != 0)
+			return false;
+		mn_defer(::freeaddrinfo(info));
+
+		if (info->ai_addrlen > sizeof(res.storage))
+			return false;
+		::memcpy(res.storage, info->ai_addr, info->ai_addrlen);
+		res.size = uint32_t(info->ai_addrlen);
+		return true;
+	}
+
+	Str
+	socket_address_str(const Socket_Address& self, Allocator allocator)
+	{
+		char host[NI_MAXHOST];
+		char service[NI_MAXSERV];
+		auto addr = (const sockaddr*)self.storage;
+		auto res = str_with_allocator(allocator);
+		if (::getnameinfo(addr, self.size, host, sizeof(host), service, sizeof(service), NI_NUMERICHOST | NI_NUMERICSERV) != 0)
+			return res;
+
+		if (addr->sa_family == AF_INET6)
+		{
+			str_push(res, "[");
+			str_push(res, host);
+			str_push(res, "]");
+		}
+		else
+		{
+			str_push(res, host);
+		}
+		str_push(res, ":");
+		str_push(res, service);
+		return res;
+	}
+
+	Result<size_t, MN_SOCKET_ERROR>
+	socket_recv_from(Socket self, Block data, Socket_Address& address, Timeout timeout)
+	{
+		if (timeout != NO_TIMEOUT)
+		{
+			pollfd pfd_read{};
+			pfd_read.fd = int(self->handle);
+			pfd_read.events = POLLIN;
+
+			int milliseconds = 0;
+			if(timeout == INFINITE_TIMEOUT)
+				milliseconds = -1;
+			else
+				milliseconds = int(timeout.milliseconds);
+
+			worker_block_ahead();
+			int ready = ::poll(&pfd_read, 1, milliseconds);
+			worker_block_clear();
+			if (ready == -1)
+				return _socket_error_from_os(errno);
+			else if (ready == 0)
+				return MN_SOCKET_ERROR_TIMEOUT;
+		}
+
+		socklen_t address_size = sizeof(address.storage);
+		auto res = ::recvfrom(self->handle, data.ptr, data.size, MSG_DONTWAIT, (sockaddr*)address.storage, &address_size);
+		if (res == -1)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return MN_SOCKET_ERROR_TIMEOUT;
+			return _socket_error_from_os(errno);
+		}
+		address.size = address_size;
+		return size_t(res);
+	}
+
+	size_t
+	socket_send_to(Socket self, Block data, const Socket_Address& address)
+	{
+		worker_block_ahead();
+		auto res = ::sendto(self->handle, data.ptr, data.size, 0, (const sockaddr*)address.storage, address.size);
+		worker_block_clear();
+		if (res == -1)
+			return 0;
+		return res;
+	}
+
+	Result<size_t, MN_SOCKET_ERROR>
+	socket_recv_many(Socket self, Socket_Datagram* datagrams, size_t count, Timeout timeout)
+	{
+		// there's no batched receive call, so we wait for the first datagram then take the ready ones
+		size_t res = 0;
+		for (; res < count; ++res)
+		{
+			auto [received, err] = socket_recv_from(self, datagrams[res].data, datagrams[res].address, res == 0 ? timeout : NO_TIMEOUT);
+			if (err)
+			{
+				if (res == 0)
+					return err;
+				break;
+			}
+			datagrams[res].data.size = received;
+		}
+		return res;
+	}
+
+	size_t
+	socket_send_many(Socket self, const Socket_Datagram* datagrams, size_t count)
+	{
+		size_t res = 0;
+		for (; res < count; ++res)
+		{
+			auto sent = socket_send_to(self, datagrams[res].data, datagrams[res].address);
+			if (sent != datagrams[res].data.size)
+				break;
+		}
+		return res;
+	}
+
+	size_t
+	socket_send_segmented(Socket self, Block data, size_t segment_size, const Socket_Address& address)
+	{
+		// there's no udp segmentation offload, so we send the segments one by one
+		if (segment_size == 0)
+			return socket_send_to(self, data, address);
+
+		size_t res = 0;
+		while (res < data.size)
+		{
+			auto size = data.size - res < segment_size ? data.size - res : segment_size;
+			auto sent = socket_send_to(self, Block{(char*)data.ptr + res, size}, address);
+			res += sent;
+			if (sent != size)
+				break;
+		}
+		return res;
+	}
+
+	bool
+	socket_gro_enable(Socket)
+	{
+		return false;
+	}
+
+	Result<size_t, MN_SOCKET_ERROR>
+	socket_recv_segmented(Socket self, Block data, Socket_Address& address, size_t& segment_size, Timeout timeout)
+	{
+		auto [res, err] = socket_recv_from(self, data, address, timeout);
+		if (err)
+			return err;
+		segment_size = res;
+		return res;
+	}
+
 	int64_t
 	socket_fd(Socket self)
 	{
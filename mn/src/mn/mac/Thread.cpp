@@ -11,6 +11,12 @@
 #include <unistd.h>
 #include <sys/types.h>
 
+// darwin's private futex like api, it's the one libc++ uses to implement std::atomic::wait
+extern "C" int __ulock_wait(uint32_t operation, void* addr, uint64_t value, uint32_t timeout);
+extern "C" int __ulock_wake(uint32_t operation, void* addr, uint64_t wake_value);
+constexpr static uint32_t UL_COMPARE_AND_WAIT = 1;
+constexpr static uint32_t ULF_WAKE_ALL = 0x00000100;
+
 #include <assert.h>
 #include <chrono>
 
@@ -696,6 +702,29 @@ namespace mn
 		pthread_cond_broadcast(&self->cv);
 	}
 
+	// Futex
+	static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t), "futex needs a lock free 32-bit atomic");
+
+	void
+	futex_wait(std::atomic<int32_t>& value, int32_t expected)
+	{
+		worker_block_ahead();
+		__ulock_wait(UL_COMPARE_AND_WAIT, &value, (uint32_t)expected, 0);
+		worker_block_clear();
+	}
+
+	void
+	futex_wake_one(std::atomic<int32_t>& value)
+	{
+		__ulock_wake(UL_COMPARE_AND_WAIT, &value, 0);
+	}
+
+	void
+	futex_wake_all(std::atomic<int32_t>& value)
+	{
+		__ulock_wake(UL_COMPARE_AND_WAIT | ULF_WAKE_ALL, &value, 0);
+	}
+
 	// Waitgroup
 	struct IWaitgroup
 	{
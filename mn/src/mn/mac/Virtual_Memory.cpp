@@ -1,6 +1,7 @@
 #include "mn/Virtual_Memory.h"
 
 #include <sys/mman.h>
+#include <mach/mach.h>
 
 namespace mn
 {
@@ -19,4 +20,71 @@ namespace mn
 	{
 		munmap(block.ptr, block.size);
 	}
+
+	Block
+	virtual_reserve(void* address_hint, size_t size)
+	{
+		Block result{};
+		auto ptr = mmap(address_hint, size, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+		if (ptr != MAP_FAILED)
+		{
+			result.ptr = ptr;
+			result.size = size;
+		}
+		return result;
+	}
+
+	bool
+	virtual_commit(Block block)
+	{
+		return mprotect(block.ptr, block.size, PROT_READ|PROT_WRITE) == 0;
+	}
+
+	void
+	virtual_decommit(Block block)
+	{
+		// madvise doesn't release the pages immediately on macos, so we map fresh pages over the block instead
+		mmap(block.ptr, block.size, PROT_NONE, MAP_FIXED|MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	}
+
+	Block
+	virtual_alloc_mirrored(size_t size)
+	{
+		size = (size + vm_page_size - 1) / vm_page_size * vm_page_size;
+		if (size == 0)
+			return Block{};
+
+		vm_address_t address = 0;
+		if (vm_allocate(mach_task_self(), &address, size * 2, VM_FLAGS_ANYWHERE) != KERN_SUCCESS)
+			return Block{};
+
+		// replace the second half with a mapping of the first half's pages
+		vm_address_t mirror = address + size;
+		vm_prot_t cur_protection = 0, max_protection = 0;
+		auto res = vm_remap(
+			mach_task_self(),
+			&mirror,
+			size,
+			0,
+			VM_FLAGS_FIXED | VM_FLAGS_OVERWRITE,
+			mach_task_self(),
+			address,
+			false,
+			&cur_protection,
+			&max_protection,
+			VM_INHERIT_DEFAULT
+		);
+		if (res != KERN_SUCCESS || mirror != address + size)
+		{
+			vm_deallocate(mach_task_self(), address, size * 2);
+			return Block{};
+		}
+		return Block{(void*)address, size};
+	}
+
+	void
+	virtual_free_mirrored(Block block)
+	{
+		vm_deallocate(mach_task_self(), vm_address_t(block.ptr), block.size * 2);
+	}
 }
@@ -0,0 +1,52 @@
+#include "mn/memory/Aligned.h"
+
+#include <assert.h>
+#include <string.h>
+
+namespace mn::memory
+{
+	// stored right before the aligned pointer, it's used to find the parent block when it's freed
+	struct Aligned_Header
+	{
+		uint16_t offset;
+		uint16_t alignment;
+	};
+
+	Aligned::Aligned(Interface* parent, size_t alignment)
+	{
+		assert(alignment != 0 && (alignment & (alignment - 1)) == 0 && "alignment should be a power of 2");
+		assert(alignment <= 4096 && "alignment should be less than or equal to the page size");
+		this->parent = parent;
+		this->alignment = alignment;
+	}
+
+	Block
+	Aligned::alloc(size_t size, uint8_t alignment)
+	{
+		size_t align = this->alignment > alignment ? this->alignment : alignment;
+
+		auto block = this->parent->alloc(size + align + sizeof(Aligned_Header) - 1, alignof(Aligned_Header));
+		if (block.ptr == nullptr)
+			return Block{};
+
+		auto base = (uintptr_t)block.ptr + sizeof(Aligned_Header);
+		auto ptr = (uint8_t*)((base + align - 1) & ~(uintptr_t)(align - 1));
+
+		Aligned_Header header{};
+		header.offset = uint16_t(ptr - (uint8_t*)block.ptr);
+		header.alignment = uint16_t(align);
+		::memcpy(ptr - sizeof(header), &header, sizeof(header));
+		return Block{ ptr, size };
+	}
+
+	void
+	Aligned::free(Block block)
+	{
+		if (block.ptr == nullptr)
+			return;
+
+		Aligned_Header header{};
+		::memcpy(&header, (uint8_t*)block.ptr - sizeof(header), sizeof(header));
+		this->parent->free(Block{ (uint8_t*)block.ptr - header.offset, block.size + header.alignment + sizeof(Aligned_Header) - 1 });
+	}
+}
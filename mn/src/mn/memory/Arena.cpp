@@ -1,9 +1,41 @@
 #include "mn/memory/Arena.h"
 #include "mn/IO.h"
+#include "mn/Virtual_Memory.h"
 #include <assert.h>
 
 namespace mn::memory
 {
+	// virtual arenas commit and decommit their memory in multiples of this size
+	constexpr static size_t ARENA_COMMIT_GRANULARITY = 64ULL * 1024ULL;
+	// virtual arenas check for unused committed memory once every this number of clear_all calls
+	constexpr static size_t ARENA_DECOMMIT_PERIOD = 64;
+	// maximum alignment supported by arena allocations
+	constexpr static size_t ARENA_MAX_ALIGNMENT = 4096;
+
+	inline static size_t
+	_arena_commit_size(size_t size)
+	{
+		return (size + ARENA_COMMIT_GRANULARITY - 1) & ~(ARENA_COMMIT_GRANULARITY - 1);
+	}
+
+	inline static bool
+	_arena_in_reserved(Arena* self)
+	{
+		return self->reserved.ptr != nullptr && self->root == nullptr;
+	}
+
+	inline static void
+	_arena_decommit(Arena* self, size_t keep_size)
+	{
+		keep_size = _arena_commit_size(keep_size);
+		if (keep_size >= self->reserved_committed_mem)
+			return;
+
+		virtual_decommit(Block{ (uint8_t*)self->reserved.ptr + keep_size, self->reserved_committed_mem - keep_size });
+		self->total_mem -= self->reserved_committed_mem - keep_size;
+		self->reserved_committed_mem = keep_size;
+	}
+
 	Arena::Arena(size_t block_size, Interface* meta)
 	{
 		assert(block_size != 0);
@@ -16,21 +48,76 @@ namespace mn::memory
 		this->clear_all_readjust_threshold = 4ULL * 1024ULL * 1024ULL;
 		this->clear_all_current_highwater = 0;
 		this->clear_all_previous_highwater = 0;
+		this->clear_all_count = 0;
+		this->clear_all_readjust_count = 0;
+		this->reserved = Block{};
+		this->reserved_committed_mem = 0;
+		this->reserved_alloc_head = nullptr;
 	}
 
 	Arena::~Arena()
 	{
 		free_all();
+		if (this->reserved.ptr)
+			virtual_free(this->reserved);
+	}
+
+	// bumps the given head to fit an allocation of the given size and alignment before the end pointer, returns nullptr
+	// if it doesn't fit
+	inline static uint8_t*
+	_arena_bump(uint8_t*& head, uint8_t* end, size_t size, size_t alignment)
+	{
+		auto ptr = (uint8_t*)(((uintptr_t)head + alignment - 1) & ~(uintptr_t)(alignment - 1));
+		if (ptr > end || size_t(end - ptr) < size)
+			return nullptr;
+		head = ptr + size;
+		return ptr;
+	}
+
+	inline static uint8_t*
+	_arena_try_alloc(Arena* self, size_t size, size_t alignment, size_t& used_size)
+	{
+		uint8_t* ptr = nullptr;
+		if (_arena_in_reserved(self))
+		{
+			auto head = self->reserved_alloc_head;
+			ptr = _arena_bump(self->reserved_alloc_head, (uint8_t*)self->reserved.ptr + self->reserved_committed_mem, size, alignment);
+			used_size = self->reserved_alloc_head - head;
+		}
+		else if (self->root)
+		{
+			auto head = self->root->alloc_head;
+			ptr = _arena_bump(self->root->alloc_head, (uint8_t*)self->root->mem.ptr + self->root->mem.size, size, alignment);
+			used_size = self->root->alloc_head - head;
+		}
+		return ptr;
 	}
 
 	Block
-	Arena::alloc(size_t size, uint8_t)
+	Arena::alloc(size_t size, uint8_t alignment)
 	{
-		grow(size);
+		return alloc_aligned(size, alignment);
+	}
+
+	Block
+	Arena::alloc_aligned(size_t size, size_t alignment)
+	{
+		if (alignment == 0)
+			alignment = 1;
+		assert((alignment & (alignment - 1)) == 0 && "alignment should be a power of 2");
+		assert(alignment <= ARENA_MAX_ALIGNMENT && "alignment should be less than or equal to the page size");
+
+		size_t used_size = 0;
+		auto ptr = _arena_try_alloc(this, size, alignment, used_size);
+		if (ptr == nullptr)
+		{
+			// account for the worst case padding, new blocks are aligned to at least alignof(int)
+			grow(size + alignment - 1);
+			ptr = _arena_try_alloc(this, size, alignment, used_size);
+			assert(ptr != nullptr);
+		}
 
-		uint8_t* ptr = this->root->alloc_head;
-		this->root->alloc_head += size;
-		this->used_mem += size;
+		this->used_mem += used_size;
 		this->highwater_mem = this->highwater_mem > this->used_mem ? this->highwater_mem : this->used_mem;
 		this->clear_all_current_highwater = this->clear_all_current_highwater > this->used_mem ? this->clear_all_current_highwater : this->used_mem;
 
@@ -45,6 +132,30 @@ namespace mn::memory
 	void
 	Arena::grow(size_t size)
 	{
+		if (_arena_in_reserved(this))
+		{
+			size_t region_used_mem = this->reserved_alloc_head - (uint8_t*)this->reserved.ptr;
+			if (this->reserved.size - region_used_mem >= size)
+			{
+				size_t required_mem = region_used_mem + size;
+				if (required_mem <= this->reserved_committed_mem)
+					return;
+
+				auto commit_size = _arena_commit_size(required_mem);
+				if (commit_size > this->reserved.size)
+					commit_size = this->reserved.size;
+
+				auto commit_block = Block{ (uint8_t*)this->reserved.ptr + this->reserved_committed_mem, commit_size - this->reserved_committed_mem };
+				if (virtual_commit(commit_block))
+				{
+					this->total_mem += commit_block.size;
+					this->reserved_committed_mem = commit_size;
+					return;
+				}
+			}
+			// the reserved region is full, so we fall back to allocating blocks from the meta allocator
+		}
+
 		if (this->root != nullptr)
 		{
 			size_t node_used_mem = this->root->alloc_head - (uint8_t*)this->root->mem.ptr;
@@ -66,6 +177,17 @@ namespace mn::memory
 		this->root = new_node;
 	}
 
+	bool
+	Arena::reserve_virtual(size_t reserve_size)
+	{
+		assert(this->root == nullptr && this->reserved.ptr == nullptr);
+
+		this->reserved = virtual_reserve(nullptr, _arena_commit_size(reserve_size));
+		this->reserved_committed_mem = 0;
+		this->reserved_alloc_head = (uint8_t*)this->reserved.ptr;
+		return this->reserved.ptr != nullptr;
+	}
+
 	void
 	Arena::free_all()
 	{
@@ -78,11 +200,61 @@ namespace mn::memory
 		this->root = nullptr;
 		this->total_mem = 0;
 		this->used_mem = 0;
+
+		if (this->reserved.ptr)
+		{
+			if (this->reserved_committed_mem > 0)
+				virtual_decommit(Block{ this->reserved.ptr, this->reserved_committed_mem });
+			this->reserved_committed_mem = 0;
+			this->reserved_alloc_head = (uint8_t*)this->reserved.ptr;
+		}
 	}
 
 	void
 	Arena::clear_all()
 	{
+		++this->clear_all_count;
+
+		if (this->reserved.ptr)
+		{
+			bool readjust = false;
+
+			// the reserved region overflowed into blocks, free them and go back to the region
+			if (this->root)
+			{
+				while (this->root)
+				{
+					Node* next = this->root->next;
+					this->total_mem -= this->root->mem.size;
+					meta->free(Block{ this->root, this->root->mem.size + sizeof(Node) });
+					this->root = next;
+				}
+				readjust = true;
+			}
+
+			// in virtual mode the previous highwater is the highwater of the current decommit period
+			if (this->clear_all_current_highwater > this->clear_all_previous_highwater)
+				this->clear_all_previous_highwater = this->clear_all_current_highwater;
+
+			if (this->clear_all_count % ARENA_DECOMMIT_PERIOD == 0)
+			{
+				if (this->reserved_committed_mem >= this->clear_all_previous_highwater + this->clear_all_readjust_threshold)
+				{
+					_arena_decommit(this, this->clear_all_previous_highwater);
+					readjust = true;
+				}
+				this->clear_all_previous_highwater = 0;
+			}
+
+			if (readjust)
+				++this->clear_all_readjust_count;
+
+			this->reserved_alloc_head = (uint8_t*)this->reserved.ptr;
+			this->used_mem = 0;
+			this->clear_all_current_highwater = 0;
+			return;
+		}
+
 		size_t delta = 0;
 		if (this->clear_all_current_highwater > this->clear_all_previous_highwater)
 			delta = this->clear_all_current_highwater - this->clear_all_previous_highwater;
@@ -97,6 +269,7 @@ namespace mn::memory
 			this->grow(this->clear_all_current_highwater);
 			this->clear_all_previous_highwater = this->clear_all_current_highwater;
 			this->clear_all_current_highwater = 0;
+			++this->clear_all_readjust_count;
 		}
 		else if (this->root && this->root->next == nullptr)
 		{
@@ -109,6 +282,13 @@ namespace mn::memory
 	bool
 	Arena::owns(void* ptr)
 	{
+		if (this->reserved.ptr)
+		{
+			auto begin_ptr = (uint8_t*)this->reserved.ptr;
+			if (ptr >= begin_ptr && ptr < this->reserved_alloc_head)
+				return true;
+		}
+
 		for (auto it = this->root; it != nullptr; it = it->next)
 		{
 			auto begin_ptr = (char*)it->mem.ptr;
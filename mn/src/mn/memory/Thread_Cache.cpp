@@ -0,0 +1,508 @@
+#include "mn/memory/Thread_Cache.h"
+#include "mn/Context.h"
+#include "mn/Thread.h"
+#include "mn/Virtual_Memory.h"
+#include "mn/OS.h"
+
+#include <atomic>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+
+namespace mn::memory
+{
+	// blocks bigger than this size are allocated from malloc directly
+	constexpr static size_t THREAD_CACHE_MAX_SMALL_SIZE = 32ULL * 1024ULL;
+	// 8 classes with 16 bytes steps up to 128 bytes, then 4 classes per power of 2 up to 32KB
+	constexpr static size_t THREAD_CACHE_CLASS_COUNT = 40;
+	// size of the chunks which the central page heap requests from the os
+	constexpr static size_t THREAD_CACHE_CHUNK_SIZE = 4ULL * 1024ULL * 1024ULL;
+	// minimum amount of memory carved from the page heap when a size class runs out of blocks
+	constexpr static size_t THREAD_CACHE_SPAN_SIZE = 64ULL * 1024ULL;
+	// a thread's cache of a size class can hold this many batches before it releases a batch to the central cache
+	constexpr static uint32_t THREAD_CACHE_MAX_BATCHES = 4;
+
+	inline static size_t
+	_thread_cache_msb(size_t v)
+	{
+	#if defined(_MSC_VER)
+		unsigned long index = 0;
+		_BitScanReverse64(&index, v);
+		return index;
+	#else
+		return sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(v);
+	#endif
+	}
+
+	inline static size_t
+	_thread_cache_class(size_t size)
+	{
+		if (size <= 128)
+			return size == 0 ? 0 : (size - 1) / 16;
+
+		auto s = size - 1;
+		auto b = _thread_cache_msb(s);
+		return 8 + (b - 7) * 4 + ((s >> (b - 2)) & 3);
+	}
+
+	constexpr static size_t
+	_thread_cache_class_size_calc(size_t cls)
+	{
+		if (cls < 8)
+			return (cls + 1) * 16;
+
+		auto k = cls - 8;
+		auto b = 7 + k / 4;
+		return (1ULL << b) + (k % 4 + 1) * (1ULL << (b - 2));
+	}
+
+	// number of blocks moved between the thread cache and the central cache at once
+	constexpr static uint32_t
+	_thread_cache_batch_size_calc(size_t cls)
+	{
+		auto count = THREAD_CACHE_SPAN_SIZE / _thread_cache_class_size_calc(cls);
+		if (count < 2)
+			count = 2;
+		if (count > 32)
+			count = 32;
+		return uint32_t(count);
+	}
+
+	struct Thread_Cache_Class_Info
+	{
+		uint32_t size;
+		uint32_t batch_size;
+	};
+
+	struct Thread_Cache_Class_Table
+	{
+		Thread_Cache_Class_Info classes[THREAD_CACHE_CLASS_COUNT];
+
+		constexpr Thread_Cache_Class_Table()
+			: classes{}
+		{
+			for (size_t i = 0; i < THREAD_CACHE_CLASS_COUNT; ++i)
+			{
+				classes[i].size = uint32_t(_thread_cache_class_size_calc(i));
+				classes[i].batch_size = _thread_cache_batch_size_calc(i);
+			}
+		}
+	};
+	constexpr static Thread_Cache_Class_Table THREAD_CACHE_CLASSES{};
+	static_assert(_thread_cache_class_size_calc(THREAD_CACHE_CLASS_COUNT - 1) == THREAD_CACHE_MAX_SMALL_SIZE);
+
+	inline static size_t
+	_thread_cache_class_size(size_t cls)
+	{
+		return THREAD_CACHE_CLASSES.classes[cls].size;
+	}
+
+	inline static uint32_t
+	_thread_cache_batch_size(size_t cls)
+	{
+		return THREAD_CACHE_CLASSES.classes[cls].batch_size;
+	}
+
+	// a tiny futex based lock, we can't use mn::Mutex here because creating it allocates memory, which might recurse
+	// into this allocator
+	struct Thread_Cache_Lock
+	{
+		// 0: unlocked, 1: locked, 2: locked with waiters
+		std::atomic<int32_t> atomic_state;
+	};
+
+	inline static void
+	_thread_cache_lock(Thread_Cache_Lock& self)
+	{
+		int32_t state = 0;
+		if (self.atomic_state.compare_exchange_strong(state, 1, std::memory_order_acquire))
+			return;
+
+		if (state != 2)
+			state = self.atomic_state.exchange(2, std::memory_order_acquire);
+		while (state != 0)
+		{
+			futex_wait(self.atomic_state, 2);
+			state = self.atomic_state.exchange(2, std::memory_order_acquire);
+		}
+	}
+
+	inline static void
+	_thread_cache_unlock(Thread_Cache_Lock& self)
+	{
+		if (self.atomic_state.exchange(0, std::memory_order_release) == 2)
+			futex_wake_one(self.atomic_state);
+	}
+
+	// free blocks are linked through their first word, batches in the central cache are linked through
+	// the second word of their first block
+	struct Thread_Cache_Free_Block
+	{
+		Thread_Cache_Free_Block* next;
+		Thread_Cache_Free_Block* next_batch;
+	};
+
+	// the central transfer cache of a size class, it holds full batches which are moved in O(1) and loose blocks
+	// which are released by exiting threads
+	struct Thread_Cache_Central
+	{
+		Thread_Cache_Lock lock;
+		Thread_Cache_Free_Block* batches;
+		Thread_Cache_Free_Block* loose;
+		size_t loose_count;
+	};
+
+	// the page heap bump allocates the memory of the size classes from big chunks of os memory, the memory is never
+	// returned to the os, it's cached in the central caches instead
+	struct Thread_Cache_Page_Heap
+	{
+		Thread_Cache_Lock lock;
+		uint8_t* head;
+		uint8_t* end;
+	};
+
+	static Thread_Cache_Central THREAD_CACHE_CENTRAL[THREAD_CACHE_CLASS_COUNT];
+	static Thread_Cache_Page_Heap THREAD_CACHE_PAGE_HEAP;
+
+	struct Thread_Cache_Bin
+	{
+		Thread_Cache_Free_Block* head;
+		uint32_t count;
+	};
+
+	struct Thread_Cache_Local
+	{
+		Thread_Cache_Bin bins[THREAD_CACHE_CLASS_COUNT];
+		// set when the thread is exiting and its cache was released, blocks go through the central cache directly
+		bool dead;
+	};
+
+	// exiting threads point to this cache, its bins are always empty
+	static Thread_Cache_Local THREAD_CACHE_DEAD_LOCAL{ {}, true };
+
+	// only a pointer to the local cache is kept in the thread local storage, it's small enough for the initial exec
+	// model which makes accessing it as cheap as a normal memory load even when mn is built as a shared library
+	#if defined(_MSC_VER)
+	static thread_local Thread_Cache_Local* LOCAL_THREAD_CACHE = nullptr;
+	#else
+	static thread_local Thread_Cache_Local* LOCAL_THREAD_CACHE __attribute__((tls_model("initial-exec"))) = nullptr;
+	#endif
+
+	static void
+	_thread_cache_release_local(Thread_Cache_Local* local);
+
+	// releases the local cache on thread exit, it's only touched once per thread when the local cache is created
+	struct Thread_Cache_Local_Guard
+	{
+		~Thread_Cache_Local_Guard()
+		{
+			if (LOCAL_THREAD_CACHE == nullptr || LOCAL_THREAD_CACHE->dead)
+				return;
+
+			auto local = LOCAL_THREAD_CACHE;
+			LOCAL_THREAD_CACHE = &THREAD_CACHE_DEAD_LOCAL;
+			_thread_cache_release_local(local);
+			::free(local);
+		}
+	};
+	static thread_local Thread_Cache_Local_Guard LOCAL_THREAD_CACHE_GUARD;
+
+	// carves a list of blocks of the given size class out of the page heap
+	inline static Thread_Cache_Free_Block*
+	_thread_cache_carve(size_t cls, uint32_t& count)
+	{
+		auto class_size = _thread_cache_class_size(cls);
+		auto span_size = THREAD_CACHE_SPAN_SIZE;
+		if (span_size < class_size * _thread_cache_batch_size(cls))
+			span_size = class_size * _thread_cache_batch_size(cls);
+
+		uint8_t* span = nullptr;
+		{
+			auto& heap = THREAD_CACHE_PAGE_HEAP;
+			_thread_cache_lock(heap.lock);
+			if (heap.head == nullptr || size_t(heap.end - heap.head) < span_size)
+			{
+				// the rest of the current chunk is wasted, it's less than a span
+				auto chunk = virtual_alloc(nullptr, THREAD_CACHE_CHUNK_SIZE);
+				if (chunk.ptr == nullptr)
+				{
+					_thread_cache_unlock(heap.lock);
+					mn::panic("system out of memory");
+				}
+				heap.head = (uint8_t*)chunk.ptr;
+				heap.end = heap.head + chunk.size;
+			}
+			span = heap.head;
+			heap.head += span_size;
+			_thread_cache_unlock(heap.lock);
+		}
+
+		count = uint32_t(span_size / class_size);
+		for (uint32_t i = 0; i + 1 < count; ++i)
+			((Thread_Cache_Free_Block*)(span + i * class_size))->next = (Thread_Cache_Free_Block*)(span + (i + 1) * class_size);
+		((Thread_Cache_Free_Block*)(span + (count - 1) * class_size))->next = nullptr;
+		return (Thread_Cache_Free_Block*)span;
+	}
+
+	// splits the first batch out of the given list, returns nullptr if the list is shorter than a batch
+	inline static Thread_Cache_Free_Block*
+	_thread_cache_split_batch(Thread_Cache_Free_Block*& list, uint32_t batch_size)
+	{
+		auto tail = list;
+		for (uint32_t i = 1; i < batch_size; ++i)
+		{
+			if (tail == nullptr)
+				return nullptr;
+			tail = tail->next;
+		}
+		if (tail == nullptr)
+			return nullptr;
+
+		auto batch = list;
+		list = tail->next;
+		tail->next = nullptr;
+		return batch;
+	}
+
+	// removes a list of blocks of the given size class from the central cache, it carves new blocks if it's empty
+	inline static Thread_Cache_Free_Block*
+	_thread_cache_central_remove(size_t cls, uint32_t& count)
+	{
+		auto& central = THREAD_CACHE_CENTRAL[cls];
+		auto batch_size = _thread_cache_batch_size(cls);
+
+		_thread_cache_lock(central.lock);
+		if (central.batches)
+		{
+			auto res = central.batches;
+			central.batches = res->next_batch;
+			_thread_cache_unlock(central.lock);
+			count = batch_size;
+			return res;
+		}
+		else if (central.loose)
+		{
+			auto res = central.loose;
+			auto tail = res;
+			count = 1;
+			while (count < batch_size && tail->next)
+			{
+				tail = tail->next;
+				++count;
+			}
+			central.loose = tail->next;
+			central.loose_count -= count;
+			tail->next = nullptr;
+			_thread_cache_unlock(central.lock);
+			return res;
+		}
+		_thread_cache_unlock(central.lock);
+
+		// keep the first batch and give the rest of the carved blocks to the central cache
+		uint32_t carved_count = 0;
+		auto list = _thread_cache_carve(cls, carved_count);
+		auto res = _thread_cache_split_batch(list, batch_size);
+		count = batch_size;
+		carved_count -= batch_size;
+
+		_thread_cache_lock(central.lock);
+		while (carved_count >= batch_size)
+		{
+			auto batch = _thread_cache_split_batch(list, batch_size);
+			batch->next_batch = central.batches;
+			central.batches = batch;
+			carved_count -= batch_size;
+		}
+		if (list)
+		{
+			auto tail = list;
+			while (tail->next)
+				tail = tail->next;
+			tail->next = central.loose;
+			central.loose = list;
+			central.loose_count += carved_count;
+		}
+		_thread_cache_unlock(central.lock);
+		return res;
+	}
+
+	// inserts a full batch into the central cache
+	inline static void
+	_thread_cache_central_insert_batch(size_t cls, Thread_Cache_Free_Block* batch)
+	{
+		auto& central = THREAD_CACHE_CENTRAL[cls];
+		_thread_cache_lock(central.lock);
+		batch->next_batch = central.batches;
+		central.batches = batch;
+		_thread_cache_unlock(central.lock);
+	}
+
+	// inserts a list of blocks into the central cache loose list
+	inline static void
+	_thread_cache_central_insert_loose(size_t cls, Thread_Cache_Free_Block* head, Thread_Cache_Free_Block* tail, uint32_t count)
+	{
+		auto& central = THREAD_CACHE_CENTRAL[cls];
+		_thread_cache_lock(central.lock);
+		tail->next = central.loose;
+		central.loose = head;
+		central.loose_count += count;
+		_thread_cache_unlock(central.lock);
+	}
+
+	static void
+	_thread_cache_release_local(Thread_Cache_Local* local)
+	{
+		for (size_t cls = 0; cls < THREAD_CACHE_CLASS_COUNT; ++cls)
+		{
+			auto& bin = local->bins[cls];
+			auto batch_size = _thread_cache_batch_size(cls);
+			while (bin.count >= batch_size)
+			{
+				auto batch = _thread_cache_split_batch(bin.head, batch_size);
+				_thread_cache_central_insert_batch(cls, batch);
+				bin.count -= batch_size;
+			}
+
+			if (bin.count > 0)
+			{
+				auto tail = bin.head;
+				while (tail->next)
+					tail = tail->next;
+				_thread_cache_central_insert_loose(cls, bin.head, tail, bin.count);
+			}
+
+			bin.head = nullptr;
+			bin.count = 0;
+		}
+	}
+
+	inline static Thread_Cache_Local*
+	_thread_cache_local()
+	{
+		if (auto local = LOCAL_THREAD_CACHE)
+			return local;
+
+		auto local = (Thread_Cache_Local*)::calloc(1, sizeof(Thread_Cache_Local));
+		if (local == nullptr)
+			mn::panic("system out of memory");
+
+		// touching the guard registers its destructor, which releases the cache on thread exit
+		[[maybe_unused]] volatile auto guard = &LOCAL_THREAD_CACHE_GUARD;
+		LOCAL_THREAD_CACHE = local;
+		return local;
+	}
+
+	inline static void*
+	_thread_cache_alloc_small(size_t cls)
+	{
+		auto local = _thread_cache_local();
+		auto& bin = local->bins[cls];
+		if (bin.head)
+		{
+			auto res = bin.head;
+			bin.head = res->next;
+			--bin.count;
+			return res;
+		}
+
+		uint32_t count = 0;
+		auto list = _thread_cache_central_remove(cls, count);
+		auto res = list;
+		if (local->dead)
+		{
+			// the thread is exiting, return the rest of the list to the central cache
+			if (count > 1)
+			{
+				auto tail = list->next;
+				while (tail->next)
+					tail = tail->next;
+				_thread_cache_central_insert_loose(cls, list->next, tail, count - 1);
+			}
+			return res;
+		}
+
+		bin.head = list->next;
+		bin.count = count - 1;
+		return res;
+	}
+
+	inline static void
+	_thread_cache_free_small(size_t cls, void* ptr)
+	{
+		auto local = _thread_cache_local();
+		auto block = (Thread_Cache_Free_Block*)ptr;
+
+		if (local->dead)
+		{
+			block->next = nullptr;
+			_thread_cache_central_insert_loose(cls, block, block, 1);
+			return;
+		}
+
+		auto& bin = local->bins[cls];
+		block->next = bin.head;
+		bin.head = block;
+		++bin.count;
+
+		auto batch_size = _thread_cache_batch_size(cls);
+		if (bin.count >= batch_size * THREAD_CACHE_MAX_BATCHES)
+		{
+			auto batch = _thread_cache_split_batch(bin.head, batch_size);
+			bin.count -= batch_size;
+			_thread_cache_central_insert_batch(cls, batch);
+		}
+	}
+
+	Block
+	Thread_Cache::alloc(size_t size, uint8_t)
+	{
+		if (size == 0)
+			return Block{};
+
+		Block res{};
+		if (size <= THREAD_CACHE_MAX_SMALL_SIZE)
+		{
+			res.ptr = _thread_cache_alloc_small(_thread_cache_class(size));
+		}
+		else
+		{
+			res.ptr = ::malloc(size);
+			if (res.ptr == nullptr)
+				mn::panic("system out of memory");
+		}
+		res.size = size;
+		_memory_profile_alloc(res.ptr, res.size);
+		return res;
+	}
+
+	void
+	Thread_Cache::free(Block block)
+	{
+		if (block_is_empty(block))
+			return;
+
+		_memory_profile_free(block.ptr, block.size);
+		if (block.size <= THREAD_CACHE_MAX_SMALL_SIZE)
+			_thread_cache_free_small(_thread_cache_class(block.size), block.ptr);
+		else
+			::free(block.ptr);
+	}
+
+	Thread_Cache*
+	thread_cache()
+	{
+		static Thread_Cache _thread_cache_allocator;
+		return &_thread_cache_allocator;
+	}
+
+	void
+	thread_cache_flush()
+	{
+		if (LOCAL_THREAD_CACHE && LOCAL_THREAD_CACHE->dead == false)
+			_thread_cache_release_local(LOCAL_THREAD_CACHE);
+	}
+}
@@ -582,6 +582,26 @@ namespace mn
 		return res;
 	}
 
+	bool
+	file_mmap_hint(Mapped_File* self, int hints)
+	{
+		if (self->data.size == 0)
+			return true;
+
+		// windows only supports prefetching the mapped region, the other hints are ignored
+		bool res = true;
+		if (hints & (MAPPED_FILE_HINT_SEQUENTIAL | MAPPED_FILE_HINT_WILL_NEED))
+		{
+			WIN32_MEMORY_RANGE_ENTRY range{};
+			range.VirtualAddress = self->data.ptr;
+			range.NumberOfBytes = self->data.size;
+			res &= PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0) != FALSE;
+		}
+		if (hints & (MAPPED_FILE_HINT_RANDOM | MAPPED_FILE_HINT_HUGE_PAGES))
+			res = false;
+		return res;
+	}
+
 	bool
 	file_unmap(Mapped_File* ptr)
 	{
@@ -91,8 +91,11 @@ namespace mn::ipc
 	}
 
 	Sputnik
-	sputnik_new(const mn::Str& name)
+	sputnik_new(const mn::Str& name, Sputnik_Settings settings)
 	{
+		// the shm transport is only supported on linux
+		settings.transport = SPUTNIK_TRANSPORT_SOCKET;
+
 		auto pipename = to_os_encoding(mn::str_tmpf("\\\\.\\pipe\\{}", name));
 		auto handle = CreateNamedPipe(
 			(LPCWSTR)pipename.ptr,
@@ -107,6 +110,7 @@ namespace mn::ipc
 		if (handle == INVALID_HANDLE_VALUE)
 			return nullptr;
 		auto self = mn::alloc_construct<ISputnik>();
+		self->settings = settings;
 		self->winos_named_pipe = handle;
 		self->name = clone(name);
 		self->read_msg_size = 0;
@@ -114,8 +118,10 @@ namespace mn::ipc
 	}
 
 	Sputnik
-	sputnik_connect(const mn::Str& name)
+	sputnik_connect(const mn::Str& name, Sputnik_Settings settings)
 	{
+		settings.transport = SPUTNIK_TRANSPORT_SOCKET;
+
 		auto pipename = to_os_encoding(mn::str_tmpf("\\\\.\\pipe\\{}", name));
 		auto handle = CreateFile(
 			(LPCWSTR)pipename.ptr,
@@ -130,6 +136,7 @@ namespace mn::ipc
 			return nullptr;
 
 		auto self = mn::alloc_construct<ISputnik>();
+		self->settings = settings;
 		self->winos_named_pipe = handle;
 		self->name = clone(name);
 		self->read_msg_size = 0;
@@ -198,6 +205,7 @@ namespace mn::ipc
 		if (handle == INVALID_HANDLE_VALUE)
 			return nullptr;
 		auto other = mn::alloc_construct<ISputnik>();
+		other->settings = self->settings;
 		other->winos_named_pipe = self->winos_named_pipe;
 		other->name = clone(self->name);
 		other->read_msg_size = 0;
@@ -253,6 +261,21 @@ namespace mn::ipc
 		return bytes_written;
 	}
 
+	size_t
+	sputnik_writev(Sputnik self, const Block* blocks, size_t count)
+	{
+		// named pipes don't support gather writes
+		size_t res = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto written = sputnik_write(self, blocks[i]);
+			res += written;
+			if (written < blocks[i].size)
+				break;
+		}
+		return res;
+	}
+
 	bool
 	sputnik_disconnect(Sputnik self)
 	{
@@ -267,8 +290,8 @@ namespace mn::ipc
 	sputnik_msg_write(Sputnik self, Block data)
 	{
 		uint64_t len = data.size;
-		auto res = sputnik_write(self, block_from(len));
-		res += sputnik_write(self, data);
+		Block blocks[] = {block_from(len), data};
+		auto res = sputnik_writev(self, blocks, 2);
 		return res == (data.size + sizeof(len));
 	}
 
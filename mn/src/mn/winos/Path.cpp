@@ -12,6 +12,8 @@
 #include "mn/Thread.h"
 #include "mn/OS.h"
 #include "mn/Defer.h"
+#include "mn/Fabric.h"
+#include "mn/Ring.h"
 
 #include <chrono>
 
@@ -275,6 +277,199 @@ namespace mn
 		return res;
 	}
 
+	// an open folder in the walk, FindFirstFileEx reports the first entry when it opens the folder
+	struct Path_Walker_Level
+	{
+		HANDLE search;
+		WIN32_FIND_DATAW data;
+		bool has_data;
+		size_t depth;
+		// count of the folder's path in the walker's path
+		size_t path_count;
+	};
+
+	// a folder which is waiting to be walked in breadth first order
+	struct Path_Walker_Pending
+	{
+		Str path;
+		size_t depth;
+	};
+
+	inline static void
+	destruct(Path_Walker_Pending& self)
+	{
+		str_free(self.path);
+	}
+
+	struct IPath_Walker
+	{
+		Path_Walk_Settings settings;
+		Str path;
+		// the utf-8 name of the last reported entry
+		Str name;
+		// the open folders stack, in breadth first order it only has one level
+		Buf<Path_Walker_Level> levels;
+		Ring<Path_Walker_Pending> pending;
+		// the last reported folder, it's opened in the next call to path_walker_next unless it's skipped
+		bool descend;
+		size_t descend_depth;
+	};
+
+	// opens the folder which is in the walker's path
+	inline static bool
+	_path_walker_push_level(Path_Walker self, size_t depth)
+	{
+		auto search_path = str_tmpf("{}/*", self->path);
+		auto os_str = to_os_encoding(path_os_encoding(search_path));
+
+		Path_Walker_Level level{};
+		level.depth = depth;
+		level.path_count = self->path.count;
+		// large fetch asks the os to return the folder content in bigger batches
+		worker_block_ahead();
+		level.search = FindFirstFileExW((LPCWSTR)os_str.ptr, FindExInfoBasic, &level.data, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+		worker_block_clear();
+		if (level.search == INVALID_HANDLE_VALUE)
+			return false;
+		level.has_data = true;
+		buf_push(self->levels, level);
+		return true;
+	}
+
+	inline static void
+	_path_walker_pop_level(Path_Walker self)
+	{
+		FindClose(buf_top(self->levels).search);
+		buf_pop(self->levels);
+	}
+
+	// API
+	Path_Walker
+	path_walker_new(const char* root, Path_Walk_Settings settings)
+	{
+		auto self = alloc_zerod<IPath_Walker>();
+		self->settings = settings;
+		self->path = str_from_c(root);
+		self->path = path_normalize(self->path);
+		// remove the trailing separators so that we can join the names with a single '/'
+		while (self->path.count > 1 && self->path[self->path.count - 1] == '/')
+			str_resize(self->path, self->path.count - 1);
+		self->name = str_new();
+		self->levels = buf_new<Path_Walker_Level>();
+		self->pending = ring_new<Path_Walker_Pending>();
+		if (_path_walker_push_level(self, 0) == false)
+		{
+			path_walker_free(self);
+			return nullptr;
+		}
+		return self;
+	}
+
+	void
+	path_walker_free(Path_Walker self)
+	{
+		while (self->levels.count > 0)
+			_path_walker_pop_level(self);
+		buf_free(self->levels);
+		destruct(self->pending);
+		str_free(self->name);
+		str_free(self->path);
+		free(self);
+	}
+
+	bool
+	path_walker_next(Path_Walker self, Path_Walk_Entry& entry)
+	{
+		if (self->descend)
+		{
+			self->descend = false;
+			// the walker's path is still the path of the last reported folder
+			if (self->settings.order == PATH_WALK_ORDER_DEPTH_FIRST)
+				_path_walker_push_level(self, self->descend_depth);
+			else
+				ring_push_back(self->pending, Path_Walker_Pending{str_from_c(self->path.ptr), self->descend_depth});
+		}
+
+		while (true)
+		{
+			if (self->levels.count == 0)
+			{
+				if (ring_empty(self->pending))
+					return false;
+
+				auto pending = ring_front(self->pending);
+				ring_pop_front(self->pending);
+				mn_defer(destruct(pending));
+
+				str_clear(self->path);
+				str_push(self->path, pending.path);
+				_path_walker_push_level(self, pending.depth);
+				continue;
+			}
+
+			auto& level = buf_top(self->levels);
+			if (level.has_data == false)
+			{
+				worker_block_ahead();
+				level.has_data = FindNextFileW(level.search, &level.data);
+				worker_block_clear();
+				if (level.has_data == false)
+				{
+					_path_walker_pop_level(self);
+					continue;
+				}
+			}
+			level.has_data = false;
+
+			const auto& data = level.data;
+			if (::wcscmp(data.cFileName, L".") == 0 || ::wcscmp(data.cFileName, L"..") == 0)
+				continue;
+
+			entry = Path_Walk_Entry{};
+			entry.depth = level.depth + 1;
+			if (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+				entry.kind = PATH_WALK_KIND_SYMLINK;
+			else if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+				entry.kind = PATH_WALK_KIND_FOLDER;
+			else if (data.dwFileAttributes & FILE_ATTRIBUTE_DEVICE)
+				entry.kind = PATH_WALK_KIND_OTHER;
+			else
+				entry.kind = PATH_WALK_KIND_FILE;
+
+			// the folder content already has the stat data so we always fill it
+			entry.has_stat = true;
+			entry.size = (int64_t(data.nFileSizeHigh) << 32) | int64_t(data.nFileSizeLow);
+			entry.last_write_time = (int64_t(data.ftLastWriteTime.dwHighDateTime) << 32) | int64_t(data.ftLastWriteTime.dwLowDateTime);
+
+			auto name_size = WideCharToMultiByte(CP_UTF8, 0, data.cFileName, -1, NULL, 0, NULL, NULL);
+			if (name_size <= 0)
+				continue;
+			str_resize(self->name, size_t(name_size - 1));
+			WideCharToMultiByte(CP_UTF8, 0, data.cFileName, -1, self->name.ptr, name_size, NULL, NULL);
+
+			str_resize(self->path, level.path_count);
+			if (self->path.count == 0 || self->path[self->path.count - 1] != '/')
+				str_push(self->path, "/");
+			str_push(self->path, self->name);
+
+			entry.name = self->name.ptr;
+			entry.path = self->path.ptr;
+
+			if (entry.kind == PATH_WALK_KIND_FOLDER && (self->settings.max_depth == 0 || entry.depth < self->settings.max_depth))
+			{
+				self->descend = true;
+				self->descend_depth = entry.depth;
+			}
+			return true;
+		}
+	}
+
+	void
+	path_walker_skip(Path_Walker self)
+	{
+		self->descend = false;
+	}
+
 	Str
 	path_executable(Allocator allocator)
 	{
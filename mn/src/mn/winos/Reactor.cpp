@@ -0,0 +1,141 @@
+#include "mn/Reactor.h"
+#include "mn/Memory.h"
+#include "mn/Map.h"
+#include "mn/Buf.h"
+#include "mn/Thread.h"
+#include "mn/Defer.h"
+
+#include <WinSock2.h>
+
+#include <atomic>
+#include <chrono>
+
+namespace mn
+{
+	// windows doesn't have a readiness api which can be woken up from another thread (like epoll), so we emulate it
+	// using WSAPoll in short slices, which lets reactor_wait notice newly armed handles and wake ups
+	struct IReactor
+	{
+		Mutex mtx;
+		// armed handles and their events
+		Map<int64_t, int> armed;
+		std::atomic<bool> atomic_woken;
+	};
+
+	constexpr static int REACTOR_POLL_SLICE_IN_MS = 10;
+
+	// API
+	Reactor
+	reactor_new()
+	{
+		auto self = alloc_zerod<IReactor>();
+		self->mtx = mutex_new("reactor mutex");
+		self->armed = map_new<int64_t, int>();
+		self->atomic_woken = false;
+		return self;
+	}
+
+	void
+	reactor_free(Reactor self)
+	{
+		map_free(self->armed);
+		mutex_free(self->mtx);
+		free(self);
+	}
+
+	bool
+	reactor_arm(Reactor self, int64_t handle, int events)
+	{
+		mutex_lock(self->mtx);
+		mn_defer(mutex_unlock(self->mtx));
+		map_insert(self->armed, handle, events);
+		return true;
+	}
+
+	void
+	reactor_remove(Reactor self, int64_t handle)
+	{
+		mutex_lock(self->mtx);
+		mn_defer(mutex_unlock(self->mtx));
+		map_remove(self->armed, handle);
+	}
+
+	size_t
+	reactor_wait(Reactor self, Reactor_Event* events, size_t events_count, Timeout timeout)
+	{
+		auto fds = buf_new<WSAPOLLFD>();
+		mn_defer(buf_free(fds));
+
+		auto start = std::chrono::steady_clock::now();
+		while (self->atomic_woken.exchange(false) == false)
+		{
+			buf_clear(fds);
+			{
+				mutex_lock(self->mtx);
+				mn_defer(mutex_unlock(self->mtx));
+				for (const auto& [handle, handle_events]: self->armed)
+				{
+					WSAPOLLFD fd{};
+					fd.fd = SOCKET(handle);
+					if (handle_events & REACTOR_EVENT_READ)
+						fd.events |= POLLRDNORM;
+					if (handle_events & REACTOR_EVENT_WRITE)
+						fd.events |= POLLWRNORM;
+					buf_push(fds, fd);
+				}
+			}
+
+			int ready = 0;
+			if (fds.count > 0)
+				ready = ::WSAPoll(fds.ptr, ULONG(fds.count), timeout == NO_TIMEOUT ? 0 : REACTOR_POLL_SLICE_IN_MS);
+			else if (timeout != NO_TIMEOUT)
+				thread_sleep(REACTOR_POLL_SLICE_IN_MS);
+
+			if (ready > 0)
+			{
+				mutex_lock(self->mtx);
+				mn_defer(mutex_unlock(self->mtx));
+
+				size_t count = 0;
+				for (const auto& fd: fds)
+				{
+					if (fd.revents == 0 || count == events_count)
+						continue;
+
+					// the handle might have been removed while we were polling
+					if (map_remove(self->armed, int64_t(fd.fd)) == false)
+						continue;
+
+					int res = REACTOR_EVENT_NONE;
+					if (fd.revents & POLLRDNORM)
+						res |= REACTOR_EVENT_READ;
+					if (fd.revents & POLLWRNORM)
+						res |= REACTOR_EVENT_WRITE;
+					if (fd.revents & (POLLERR | POLLHUP | POLLNVAL))
+						res |= REACTOR_EVENT_ERROR;
+					events[count].handle = int64_t(fd.fd);
+					events[count].events = res;
+					++count;
+				}
+				if (count > 0)
+					return count;
+			}
+
+			if (timeout == NO_TIMEOUT)
+				break;
+			if (timeout != INFINITE_TIMEOUT)
+			{
+				auto elapsed = std::chrono::steady_clock::now() - start;
+				if (uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()) >= timeout.milliseconds)
+					break;
+			}
+		}
+		return 0;
+	}
+
+	void
+	reactor_wake(Reactor self)
+	{
+		self->atomic_woken.store(true);
+	}
+}
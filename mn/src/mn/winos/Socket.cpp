@@ -3,6 +3,7 @@
 
 #include <WinSock2.h>
 #include <WS2tcpip.h>
+#include <MSWSock.h>
 
 namespace mn
 {
@@ -325,6 +326,248 @@ namespace mn
 		return 0;
 	}
 
+	size_t
+	socket_writev(Socket self, const Block* blocks, size_t count)
+	{
+		constexpr size_t BUFFERS_COUNT = 64;
+
+		size_t res = 0;
+		worker_block_ahead();
+		mn_defer(worker_block_clear());
+		while (count > 0)
+		{
+			WSABUF buffers[BUFFERS_COUNT];
+			size_t buffers_count = count < BUFFERS_COUNT ? count : BUFFERS_COUNT;
+			size_t buffers_size = 0;
+			for (size_t i = 0; i < buffers_count; ++i)
+			{
+				buffers[i].len = ULONG(blocks[i].size);
+				buffers[i].buf = (char*)blocks[i].ptr;
+				buffers_size += blocks[i].size;
+			}
+
+			DWORD sent_bytes = 0;
+			int status = ::WSASend(
+				self->handle,
+				buffers,
+				DWORD(buffers_count),
+				&sent_bytes,
+				0,
+				NULL,
+				NULL
+			);
+			if (status != 0)
+				break;
+			res += sent_bytes;
+			if (size_t(sent_bytes) < buffers_size)
+				break;
+
+			blocks += buffers_count;
+			count -= buffers_count;
+		}
+		return res;
+	}
+
+	size_t
+	socket_sendfile(Socket self, File file, int64_t offset, size_t size)
+	{
+		// TransmitFile can't send more than 2GB - 1 in a single call
+		constexpr size_t MAX_TRANSMIT_SIZE = 0x7FFFFFFE;
+
+		size_t res = 0;
+		worker_block_ahead();
+		mn_defer(worker_block_clear());
+		while (res < size)
+		{
+			// without an overlapped structure TransmitFile starts from the file's cursor
+			LARGE_INTEGER position{};
+			position.QuadPart = offset + res;
+			if (::SetFilePointerEx(file->winos_handle, position, NULL, FILE_BEGIN) == FALSE)
+				break;
+
+			auto chunk = size - res;
+			if (chunk > MAX_TRANSMIT_SIZE)
+				chunk = MAX_TRANSMIT_SIZE;
+			if (::TransmitFile(self->handle, file->winos_handle, DWORD(chunk), 0, NULL, NULL, 0) == FALSE)
+				break;
+			res += chunk;
+		}
+		return res;
+	}
+
+	bool
+	socket_zerocopy_enable(Socket)
+	{
+		return false;
+	}
+
+	size_t
+	socket_write_zerocopy(Socket self, Block data)
+	{
+		return socket_write(self, data);
+	}
+
+	size_t
+	socket_zerocopy_reap(Socket, Timeout)
+	{
+		return 0;
+	}
+
+	bool
+	socket_address_from(SOCKET_FAMILY family, const Str& address, const Str& port, Socket_Address& res)
+	{
+		addrinfo hints{}, *info;
+
+		hints.ai_family = _socket_family_to_os(family);
+		_socket_type_to_os(SOCKET_TYPE_UDP, hints.ai_socktype, hints.ai_protocol);
+
+		worker_block_ahead();
+		mn_defer(worker_block_clear());
+		if (::getaddrinfo(address.ptr, port.ptr, &hints, &info) != 0)
+			return false;
+		mn_defer(::freeaddrinfo(info));
+
+		if (info->ai_addrlen > sizeof(res.storage))
+			return false;
+		::memcpy(res.storage, info->ai_addr, info->ai_addrlen);
+		res.size = uint32_t(info->ai_addrlen);
+		return true;
+	}
+
+	Str
+	socket_address_str(const Socket_Address& self, Allocator allocator)
+	{
+		char host[NI_MAXHOST];
+		char service[NI_MAXSERV];
+		auto addr = (const sockaddr*)self.storage;
+		auto res = str_with_allocator(allocator);
+		if (::getnameinfo(addr, int(self.size), host, sizeof(host), service, sizeof(service), NI_NUMERICHOST | NI_NUMERICSERV) != 0)
+			return res;
+
+		if (addr->sa_family == AF_INET6)
+		{
+			str_push(res, "[");
+			str_push(res, host);
+			str_push(res, "]");
+		}
+		else
+		{
+			str_push(res, host);
+		}
+		str_push(res, ":");
+		str_push(res, service);
+		return res;
+	}
+
+	Result<size_t, MN_SOCKET_ERROR>
+	socket_recv_from(Socket self, Block data, Socket_Address& address, Timeout timeout)
+	{
+		pollfd pfd_read{};
+		pfd_read.fd = self->handle;
+		pfd_read.events = POLLIN;
+
+		INT milliseconds = 0;
+		if (timeout == INFINITE_TIMEOUT)
+			milliseconds = INFINITE;
+		else if (timeout == NO_TIMEOUT)
+			milliseconds = 0;
+		else
+			milliseconds = INT(timeout.milliseconds);
+
+		worker_block_ahead();
+		mn_defer(worker_block_clear());
+		int ready = ::WSAPoll(&pfd_read, 1, milliseconds);
+		if (ready == SOCKET_ERROR)
+			return _socket_error_from_os(WSAGetLastError());
+		else if (ready == 0)
+			return MN_SOCKET_ERROR_TIMEOUT;
+
+		int address_size = sizeof(address.storage);
+		auto res = ::recvfrom(self->handle, (char*)data.ptr, int(data.size), 0, (sockaddr*)address.storage, &address_size);
+		if (res == SOCKET_ERROR)
+			return _socket_error_from_os(WSAGetLastError());
+		address.size = uint32_t(address_size);
+		return size_t(res);
+	}
+
+	size_t
+	socket_send_to(Socket self, Block data, const Socket_Address& address)
+	{
+		worker_block_ahead();
+		auto res = ::sendto(self->handle, (const char*)data.ptr, int(data.size), 0, (const sockaddr*)address.storage, int(address.size));
+		worker_block_clear();
+		if (res == SOCKET_ERROR)
+			return 0;
+		return size_t(res);
+	}
+
+	Result<size_t, MN_SOCKET_ERROR>
+	socket_recv_many(Socket self, Socket_Datagram* datagrams, size_t count, Timeout timeout)
+	{
+		// there's no batched receive call, so we wait for the first datagram then take the ready ones
+		size_t res = 0;
+		for (; res < count; ++res)
+		{
+			auto [received, err] = socket_recv_from(self, datagrams[res].data, datagrams[res].address, res == 0 ? timeout : NO_TIMEOUT);
+			if (err)
+			{
+				if (res == 0)
+					return err;
+				break;
+			}
+			datagrams[res].data.size = received;
+		}
+		return res;
+	}
+
+	size_t
+	socket_send_many(Socket self, const Socket_Datagram* datagrams, size_t count)
+	{
+		size_t res = 0;
+		for (; res < count; ++res)
+		{
+			auto sent = socket_send_to(self, datagrams[res].data, datagrams[res].address);
+			if (sent != datagrams[res].data.size)
+				break;
+		}
+		return res;
+	}
+
+	size_t
+	socket_send_segmented(Socket self, Block data, size_t segment_size, const Socket_Address& address)
+	{
+		// there's no udp segmentation offload, so we send the segments one by one
+		if (segment_size == 0)
+			return socket_send_to(self, data, address);
+
+		size_t res = 0;
+		while (res < data.size)
+		{
+			auto size = data.size - res < segment_size ? data.size - res : segment_size;
+			auto sent = socket_send_to(self, Block{(char*)data.ptr + res, size}, address);
+			res += sent;
+			if (sent != size)
+				break;
+		}
+		return res;
+	}
+
+	bool
+	socket_gro_enable(Socket)
+	{
+		return false;
+	}
+
+	Result<size_t, MN_SOCKET_ERROR>
+	socket_recv_segmented(Socket self, Block data, Socket_Address& address, size_t& segment_size, Timeout timeout)
+	{
+		auto [res, err] = socket_recv_from(self, data, address, timeout);
+		if (err)
+			return err;
+		segment_size = res;
+		return res;
+	}
+
 	int64_t
 	socket_fd(Socket self)
 	{
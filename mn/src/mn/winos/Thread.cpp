@@ -729,6 +729,29 @@ namespace mn
 		WakeAllConditionVariable(&self->cv);
 	}
 
+	// Futex
+	static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t), "futex needs a lock free 32-bit atomic");
+
+	void
+	futex_wait(std::atomic<int32_t>& value, int32_t expected)
+	{
+		worker_block_ahead();
+		WaitOnAddress(&value, &expected, sizeof(expected), INFINITE);
+		worker_block_clear();
+	}
+
+	void
+	futex_wake_one(std::atomic<int32_t>& value)
+	{
+		WakeByAddressSingle(&value);
+	}
+
+	void
+	futex_wake_all(std::atomic<int32_t>& value)
+	{
+		WakeByAddressAll(&value);
+	}
+
 	// Waitgroup
 	struct IWaitgroup
 	{
@@ -1,5 +1,6 @@
 #include "mn/Virtual_Memory.h"
 #include "mn/Memory.h"
+#include "mn/Defer.h"
 
 #define NOMINMAX
 #define WIN32_LEAN_AND_MEAN
@@ -25,4 +26,73 @@ namespace mn
 		[[maybe_unused]] auto result = VirtualFree(block.ptr, 0, MEM_RELEASE);
 		assert(result != NULL);
 	}
+
+	Block
+	virtual_reserve(void* address_hint, size_t size)
+	{
+		Block result{};
+		result.ptr = VirtualAlloc(address_hint, size, MEM_RESERVE, PAGE_NOACCESS);
+		if(result.ptr)
+			result.size = size;
+		return result;
+	}
+
+	bool
+	virtual_commit(Block block)
+	{
+		return VirtualAlloc(block.ptr, block.size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+	}
+
+	void
+	virtual_decommit(Block block)
+	{
+		[[maybe_unused]] auto result = VirtualFree(block.ptr, block.size, MEM_DECOMMIT);
+		assert(result != NULL);
+	}
+
+	Block
+	virtual_alloc_mirrored(size_t size)
+	{
+		SYSTEM_INFO info{};
+		GetSystemInfo(&info);
+		size_t granularity = info.dwAllocationGranularity;
+		size = (size + granularity - 1) / granularity * granularity;
+		if (size == 0)
+			return Block{};
+
+		auto mapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, DWORD(uint64_t(size) >> 32), DWORD(size & 0xFFFFFFFF), NULL);
+		if (mapping == NULL)
+			return Block{};
+		mn_defer(CloseHandle(mapping));
+
+		// find a free address range then map the views into it, another thread might take the range between the
+		// two steps so we retry a few times
+		for (int i = 0; i < 16; ++i)
+		{
+			auto address = (char*)VirtualAlloc(NULL, size * 2, MEM_RESERVE, PAGE_NOACCESS);
+			if (address == nullptr)
+				return Block{};
+			VirtualFree(address, 0, MEM_RELEASE);
+
+			auto first = MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size, address);
+			if (first == nullptr)
+				continue;
+
+			auto second = MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size, address + size);
+			if (second == nullptr)
+			{
+				UnmapViewOfFile(first);
+				continue;
+			}
+			return Block{address, size};
+		}
+		return Block{};
+	}
+
+	void
+	virtual_free_mirrored(Block block)
+	{
+		UnmapViewOfFile(block.ptr);
+		UnmapViewOfFile((char*)block.ptr + block.size);
+	}
 }
@@ -4,6 +4,7 @@
 #include <mn/Buf.h>
 #include <mn/Str.h>
 #include <mn/Map.h>
+#include <mn/CMap.h>
 #include <mn/Pool.h>
 #include <mn/Memory_Stream.h>
 #include <mn/Virtual_Memory.h>
@@ -12,6 +13,8 @@
 #include <mn/Ring.h>
 #include <mn/OS.h>
 #include <mn/memory/Leak.h>
+#include <mn/memory/Fast_Leak.h>
+#include <mn/memory/Thread_Cache.h>
 #include <mn/Task.h>
 #include <mn/Path.h>
 #include <mn/Fmt.h>
@@ -19,6 +22,9 @@
 #include <mn/Deque.h>
 #include <mn/Result.h>
 #include <mn/Fabric.h>
+#include <mn/Socket.h>
+#include <mn/Async_IO.h>
+#include <mn/IPC.h>
 #include <mn/Block_Stream.h>
 #include <mn/Handle_Table.h>
 #include <mn/UUID.h>
@@ -27,9 +33,20 @@
 #include <mn/Regex.h>
 #include <mn/Log.h>
 
+#include <algorithm>
 #include <chrono>
 #include <iostream>
+#include <random>
 #include <sstream>
+#include <thread>
+
+#if ARCH_X86
+#include <immintrin.h>
+#endif
+
+#if OS_LINUX
+#include <unistd.h>
+#endif
 
 #define ANKERL_NANOBENCH_IMPLEMENT 1
 #include <nanobench.h>
@@ -73,6 +90,136 @@ TEST_CASE("arena allocator")
 	mn::allocator_free(arena);
 }
 
+TEST_CASE("virtual arena allocator")
+{
+	auto arena = mn::allocator_arena_virtual_new(16ULL * 1024ULL * 1024ULL);
+	mn_defer(mn::allocator_free(arena));
+	REQUIRE(arena->reserved.ptr != nullptr);
+
+	// a reset of a virtual arena never goes back to the meta allocator
+	for (int i = 0; i < 1000; ++i)
+	{
+		auto nums = (int*)mn::alloc_from(arena, 100 * sizeof(int), alignof(int)).ptr;
+		for (int j = 0; j < 100; ++j)
+			nums[j] = j;
+		CHECK(arena->owns(nums));
+		arena->clear_all();
+	}
+	CHECK(arena->clear_all_count == 1000);
+	CHECK(arena->clear_all_readjust_count == 0);
+	CHECK(arena->root == nullptr);
+	CHECK(arena->used_mem == 0);
+
+	// spikes get decommitted periodically
+	arena->clear_all_readjust_threshold = 1ULL * 1024ULL * 1024ULL;
+	auto big = mn::alloc_from(arena, 8ULL * 1024ULL * 1024ULL, alignof(int));
+	::memset(big.ptr, 1, big.size);
+	CHECK(arena->total_mem >= big.size);
+	for (int i = 0; i < 128; ++i)
+		arena->clear_all();
+	CHECK(arena->clear_all_readjust_count == 1);
+	CHECK(arena->total_mem < 1ULL * 1024ULL * 1024ULL);
+
+	// once the region is full the arena falls back to blocks and goes back to the region on the next reset
+	auto overflow = mn::alloc_from(arena, 32ULL * 1024ULL * 1024ULL, alignof(int));
+	::memset(overflow.ptr, 1, overflow.size);
+	CHECK(arena->root != nullptr);
+	CHECK(arena->owns(overflow.ptr));
+	arena->clear_all();
+	CHECK(arena->root == nullptr);
+	CHECK(arena->clear_all_readjust_count == 2);
+
+	auto num = mn::alloc_from<int>(arena);
+	*num = 1;
+	CHECK(arena->owns(num));
+}
+
+TEST_CASE("arena aligned allocation")
+{
+	auto arena = mn::allocator_arena_new(4096);
+	mn_defer(mn::allocator_free(arena));
+
+	for (size_t alignment = 1; alignment <= 4096; alignment *= 2)
+	{
+		mn::alloc_from(arena, 3, 1);
+		auto block = arena->alloc_aligned(100, alignment);
+		CHECK((uintptr_t)block.ptr % alignment == 0);
+		CHECK(arena->owns(block.ptr));
+	}
+
+	// alignment padding shouldn't waste the whole block
+	arena->clear_all();
+	auto first = mn::alloc_from(arena, 1, 1);
+	auto second = mn::alloc_from(arena, 64, 64);
+	CHECK((uintptr_t)second.ptr % 64 == 0);
+	CHECK((uint8_t*)second.ptr - (uint8_t*)first.ptr <= 64);
+
+	auto virtual_arena = mn::allocator_arena_virtual_new(16ULL * 1024ULL * 1024ULL);
+	mn_defer(mn::allocator_free(virtual_arena));
+	for (size_t alignment = 1; alignment <= 4096; alignment *= 2)
+	{
+		mn::alloc_from(virtual_arena, 3, 1);
+		auto block = virtual_arena->alloc_aligned(100, alignment);
+		CHECK((uintptr_t)block.ptr % alignment == 0);
+	}
+}
+
+TEST_CASE("aligned allocator")
+{
+	mn::memory::Aligned aligned_tmp{mn::memory::tmp(), 64};
+	mn::memory::Aligned aligned_clib{mn::memory::clib(), 32};
+
+	auto nums = mn::buf_with_allocator<float>(&aligned_tmp);
+	mn_defer(mn::buf_free(nums));
+	auto str = mn::str_with_allocator(&aligned_clib);
+	mn_defer(mn::str_free(str));
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		mn::alloc_from(mn::memory::tmp(), 3, 1);
+		mn::buf_push(nums, float(i));
+		CHECK((uintptr_t)nums.ptr % 64 == 0);
+
+		mn::str_push(str, "a");
+		CHECK((uintptr_t)str.ptr % 32 == 0);
+	}
+	CHECK(nums[999] == 999.0f);
+	CHECK(str.count == 1000);
+
+	mn::memory::tmp()->clear_all();
+}
+
+#if ARCH_X86
+TEST_CASE("aligned loads benchmark")
+{
+	static constexpr size_t COUNT = 4096;
+	mn::memory::Aligned aligned_tmp{mn::memory::tmp(), 64};
+	auto nums = mn::buf_with_allocator<float>(&aligned_tmp);
+	mn::buf_resize_fill(nums, COUNT + 4, 1.0f);
+	mn_defer(mn::buf_free(nums));
+
+	auto sum = [](const float* ptr, size_t count, auto load) {
+		auto res = _mm_setzero_ps();
+		for (size_t i = 0; i < count; i += 4)
+			res = _mm_add_ps(res, load(ptr + i));
+		float out[4];
+		_mm_storeu_ps(out, res);
+		return out[0] + out[1] + out[2] + out[3];
+	};
+
+	ankerl::nanobench::Bench().minEpochIterations(233).run("tmp aligned loads", [&]{
+		auto res = sum(nums.ptr, COUNT, [](const float* p) { return _mm_load_ps(p); });
+		ankerl::nanobench::doNotOptimizeAway(res);
+	});
+	ankerl::nanobench::Bench().minEpochIterations(233).run("tmp unaligned loads", [&]{
+		auto res = sum(nums.ptr + 1, COUNT, [](const float* p) { return _mm_loadu_ps(p); });
+		ankerl::nanobench::doNotOptimizeAway(res);
+	});
+
+	mn::memory::tmp()->clear_all();
+}
+#endif
+
 TEST_CASE("tmp allocator")
 {
 	{
@@ -230,6 +377,103 @@ TEST_CASE("str find last benchmark")
 	});
 }
 
+inline static size_t
+naive_str_find(const mn::Str& self, const mn::Str& target, size_t start)
+{
+	for (size_t i = start; i + target.count <= self.count; ++i)
+		if (::memcmp(self.ptr + i, target.ptr, target.count) == 0)
+			return i;
+	return SIZE_MAX;
+}
+
+inline static size_t
+naive_str_find_last(const mn::Str& self, const mn::Str& target)
+{
+	for (size_t i = self.count - target.count + 1; i > 0; --i)
+		if (::memcmp(self.ptr + i - 1, target.ptr, target.count) == 0)
+			return i - 1;
+	return SIZE_MAX;
+}
+
+TEST_CASE("str find simd")
+{
+	// small alphabet so that the first/last byte filter has a lot of false positives
+	std::mt19937 rng(42);
+	auto source = mn::str_new();
+	mn_defer(mn::str_free(source));
+	for (size_t i = 0; i < 1000; ++i)
+		mn::str_push(source, char('a' + rng() % 3));
+
+	for (size_t target_count = 2; target_count < 80; ++target_count)
+	{
+		for (size_t i = 0; i < 20; ++i)
+		{
+			auto start = (rng() % (source.count - target_count));
+			auto target = mn::str_from_substr(source.ptr + start, source.ptr + start + target_count, mn::memory::tmp());
+			// flip a byte sometimes to search for things that might not exist
+			if (i % 4 == 0)
+				target.ptr[(rng() % (target_count))] = 'z';
+
+			for (size_t offset: {size_t(0), size_t(1), size_t(17), size_t(333), size_t(start)})
+				CHECK(mn::str_find(source, target, offset) == naive_str_find(source, target, offset));
+
+			for (size_t count: {source.count, size_t(31), size_t(100), size_t(start + target_count)})
+			{
+				auto prefix = source;
+				prefix.count = count;
+				auto expected = count >= target_count ? naive_str_find_last(prefix, target) : SIZE_MAX;
+				CHECK(mn::str_find_last(source, target, count - 1) == expected);
+			}
+		}
+	}
+
+	CHECK(mn::str_find(source, "z", 0) == SIZE_MAX);
+	CHECK(mn::str_find(source, mn::str_lit("zz"), 0) == SIZE_MAX);
+	CHECK(mn::str_find_last(source, mn::str_lit("zz"), source.count) == SIZE_MAX);
+}
+
+TEST_CASE("str find simd benchmark")
+{
+	std::mt19937 rng(42);
+	auto source = mn::str_new();
+	mn_defer(mn::str_free(source));
+	while (source.count < 1024 * 1024)
+	{
+		mn::str_push(source, "the quick brown fox jumps over the lazy dog ");
+		mn::str_push(source, mn::str_tmpf("{}\n", rng() % 1000000));
+	}
+
+	// none of the targets exist in the source so the whole range is scanned, their first/last bytes still match often
+	const char* targets[] = {
+		"o\n",
+		"ox jumps under",
+		"the lazy dog 1234567 the",
+		"the quick brown fox jumps over the lazy dog and the quick brown fox jumps over the lazy cat",
+	};
+
+	ankerl::nanobench::Bench bench;
+	bench.batch(source.count).unit("byte").minEpochIterations(5);
+	for (auto target: targets)
+	{
+		auto needle = mn::str_lit(target);
+		bench.run(mn::str_tmpf("str_find {} byte needle 1MB", needle.count).ptr, [&]{
+			auto res = mn::str_find(source, needle, 0);
+			ankerl::nanobench::doNotOptimizeAway(res);
+		});
+		bench.run(mn::str_tmpf("str_find_last {} byte needle 1MB", needle.count).ptr, [&]{
+			auto res = mn::str_find_last(source, needle, source.count);
+			ankerl::nanobench::doNotOptimizeAway(res);
+		});
+	}
+
+	bench.batch(1).unit("split");
+	bench.run("str_split lines 1MB", [&]{
+		auto lines = mn::str_split(source, "\n", true);
+		ankerl::nanobench::doNotOptimizeAway(lines.count);
+		mn::destruct(lines);
+	});
+}
+
 TEST_CASE("str split")
 {
 	auto res = mn::str_split(",A,B,C,", ",", true);
@@ -416,175 +660,2439 @@ TEST_CASE("map general cases")
 	mn::map_free(num);
 }
 
-TEST_CASE("Pool general case")
+TEST_CASE("map random insert and remove")
 {
-	auto pool = mn::pool_new(sizeof(int), 1024);
-	int* ptr = (int*)mn::pool_get(pool);
-	CHECK(ptr != nullptr);
-	*ptr = 234;
-	mn::pool_put(pool, ptr);
-	int* new_ptr = (int*)mn::pool_get(pool);
-	CHECK(new_ptr == ptr);
+	constexpr size_t KEYS_COUNT = 2048;
+	bool exists[KEYS_COUNT] = {};
+	size_t exists_count = 0;
 
-	int* new_ptr2 = (int*)mn::pool_get(pool);
-	mn::pool_put(pool, new_ptr2);
+	auto map = mn::map_new<int, int>();
+	mn_defer(mn::map_free(map));
 
-	mn::pool_put(pool, new_ptr);
-	mn::pool_free(pool);
+	uint32_t state = 1337;
+	for (size_t i = 0; i < 100000; ++i)
+	{
+		state = state * 1664525u + 1013904223u;
+		auto key = int((state >> 8) % KEYS_COUNT);
+		// bias towards insertion in the first half and removal in the second to exercise both growth and shrinking
+		bool insert = ((state >> 4) & 3) != 0;
+		if (i >= 50000)
+			insert = !insert;
+
+		if (insert)
+		{
+			mn::map_insert(map, key, key * 2);
+			if (exists[key] == false)
+				++exists_count;
+			exists[key] = true;
+		}
+		else
+		{
+			CHECK(mn::map_remove(map, key) == exists[key]);
+			if (exists[key])
+				--exists_count;
+			exists[key] = false;
+		}
+	}
+
+	CHECK(map.count == exists_count);
+	for (int key = 0; key < int(KEYS_COUNT); ++key)
+	{
+		auto it = mn::map_lookup(map, key);
+		CHECK((it != nullptr) == exists[key]);
+		if (it)
+			CHECK(it->value == key * 2);
+	}
+
+	size_t iterated_count = 0;
+	for (const auto& [key, value]: map)
+	{
+		CHECK(exists[key]);
+		CHECK(value == key * 2);
+		++iterated_count;
+	}
+	CHECK(iterated_count == exists_count);
+
+	mn::map_reserve(map, 10000);
+	CHECK(mn::map_capacity(map) >= 10000 + exists_count);
+	for (int key = 0; key < int(KEYS_COUNT); ++key)
+		CHECK((mn::map_lookup(map, key) != nullptr) == exists[key]);
+
+	mn::map_clear(map);
+	CHECK(map.count == 0);
+	for (int key = 0; key < int(KEYS_COUNT); ++key)
+		CHECK(mn::map_lookup(map, key) == nullptr);
 }
 
-TEST_CASE("Memory_Stream general case")
+TEST_CASE("map benchmark")
 {
-	auto mem = mn::memory_stream_new();
-	CHECK(mn::memory_stream_size(mem) == 0);
-	CHECK(mn::memory_stream_cursor_pos(mem) == 0);
-	mn::memory_stream_write(mem, mn::block_lit("Mostafa"));
-	CHECK(mn::memory_stream_size(mem) == 7);
-	CHECK(mn::memory_stream_cursor_pos(mem) == 7);
+	auto key_at = [](uint64_t i) {
+		// splitmix64 to get unique random looking keys
+		uint64_t z = i + 0x9e3779b97f4a7c15ULL;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	};
 
-	char name[8] = { 0 };
-	CHECK(mn::memory_stream_read(mem, mn::block_from(name)) == 0);
-	CHECK(mn::memory_stream_cursor_pos(mem) == 7);
+	for (size_t count: {1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL})
+	{
+		auto bench = ankerl::nanobench::Bench().epochs(1).epochIterations(1).batch(count).unit("op");
 
-	mn::memory_stream_cursor_to_start(mem);
-	CHECK(mn::memory_stream_cursor_pos(mem) == 0);
+		auto map = mn::map_new<uint64_t, uint64_t>();
+		mn_defer(mn::map_free(map));
 
-	CHECK(mn::memory_stream_read(mem, mn::block_from(name)) == 7);
-	CHECK(mn::memory_stream_cursor_pos(mem) == 7);
+		bench.run(mn::str_tmpf("map insert {}", count).ptr, [&]{
+			for (size_t i = 0; i < count; ++i)
+				mn::map_insert(map, key_at(i), uint64_t(i));
+		});
+		REQUIRE(map.count == count);
 
-	CHECK(::strcmp(name, "Mostafa") == 0);
-	mn::memory_stream_free(mem);
-}
+		size_t hits = 0;
+		bench.run(mn::str_tmpf("map lookup hit {}", count).ptr, [&]{
+			hits = 0;
+			for (size_t i = 0; i < count; ++i)
+				hits += mn::map_lookup(map, key_at(i)) != nullptr;
+		});
+		CHECK(hits == count);
 
-TEST_CASE("virtual memory allocation")
-{
-	size_t size = 1ULL * 1024ULL * 1024ULL * 1024ULL;
-	auto block = mn::virtual_alloc(nullptr, size);
-	CHECK(block.ptr != nullptr);
-	CHECK(block.size == size);
-	mn::virtual_free(block);
-}
+		size_t misses = 0;
+		bench.run(mn::str_tmpf("map lookup miss {}", count).ptr, [&]{
+			misses = 0;
+			for (size_t i = count; i < 2 * count; ++i)
+				misses += mn::map_lookup(map, key_at(i)) == nullptr;
+		});
+		CHECK(misses == count);
 
-TEST_CASE("reads")
-{
-	int a, b;
-	float c, d;
-	auto e = mn::str_new();
-	size_t read_count = mn::reads("-123 20 1.23 0.123 Mostafa ", a, b, c, d, e);
-	CHECK(read_count == 5);
-	CHECK(a == -123);
-	CHECK(b == 20);
-	CHECK(c == 1.23f);
-	CHECK(d == 0.123f);
-	CHECK(e == "Mostafa");
-	mn::str_free(e);
+		size_t removed = 0;
+		bench.run(mn::str_tmpf("map erase {}", count).ptr, [&]{
+			removed = 0;
+			for (size_t i = 0; i < count; ++i)
+				removed += mn::map_remove(map, key_at(i));
+		});
+		CHECK(removed == count);
+		CHECK(map.count == 0);
+	}
 }
 
-TEST_CASE("reader")
+TEST_CASE("cmap general case")
 {
-	auto reader = mn::reader_wrap_str(nullptr, mn::str_lit("Mostafa Saad"));
-	auto str = mn::str_new();
-	size_t read_count = mn::readln(reader, str);
-	CHECK(read_count == 12);
-	CHECK(str == "Mostafa Saad");
+	auto map = mn::cmap_new<mn::Str, mn::Str>(8);
+	mn_defer(mn::cmap_free(map));
+
+	CHECK(mn::cmap_insert_or_assign(map, mn::str_from_c("name"), mn::str_from_c("mn")));
+	CHECK(mn::cmap_insert_or_assign(map, mn::str_from_c("lang"), mn::str_from_c("c")));
+	CHECK(mn::cmap_insert_or_assign(map, mn::str_from_c("lang"), mn::str_from_c("c++")) == false);
+	CHECK(mn::cmap_count(map) == 2);
+
+	auto value = mn::str_new();
+	mn_defer(mn::str_free(value));
+	CHECK(mn::cmap_lookup(map, mn::str_lit("lang"), value));
+	CHECK(value == "c++");
+	CHECK(mn::cmap_lookup(map, mn::str_lit("version"), value) == false);
+
+	size_t name_len = 0;
+	CHECK(mn::cmap_lookup_with(map, mn::str_lit("name"), [&](const auto& kv) { name_len = kv.value.count; }));
+	CHECK(name_len == 2);
+
+	size_t visited = 0;
+	mn::cmap_for_each(map, [&](const auto& kv) {
+		CHECK((kv.key == "name" || kv.key == "lang"));
+		++visited;
+	});
+	CHECK(visited == 2);
 
-	mn::str_free(str);
-	mn::reader_free(reader);
+	CHECK(mn::cmap_remove(map, mn::str_lit("name")));
+	CHECK(mn::cmap_remove(map, mn::str_lit("name")) == false);
+	CHECK(mn::cmap_count(map) == 1);
 }
 
-TEST_CASE("reader with empty newline")
+TEST_CASE("cmap multiple threads")
 {
-	auto text = R"""(my name is mostafa
-
-mostafa is 26 years old)""";
-	auto reader = mn::reader_wrap_str(nullptr, text);
-	auto str = mn::str_new();
-
-	size_t read_count = mn::readln(reader, str);
-	CHECK(read_count == 19);
-	CHECK(str == "my name is mostafa");
+	constexpr int THREADS_COUNT = 4;
+	constexpr int KEYS_COUNT = 10000;
 
-	read_count = mn::readln(reader, str);
-	CHECK(read_count == 1);
-	CHECK(str == "");
+	auto map = mn::cmap_new<int, int>();
+	mn_defer(mn::cmap_free(map));
 
-	read_count = mn::readln(reader, str);
-	CHECK(read_count == 23);
-	CHECK(str == "mostafa is 26 years old");
+	std::atomic<size_t> wrong_values = 0;
+	std::thread threads[THREADS_COUNT];
+	for (int t = 0; t < THREADS_COUNT; ++t)
+	{
+		threads[t] = std::thread([&map, &wrong_values, t]{
+			for (int i = t; i < KEYS_COUNT; i += THREADS_COUNT)
+				mn::cmap_insert_or_assign(map, i, i * 2);
+			// read the keys inserted by the other threads
+			for (int i = 0; i < KEYS_COUNT; ++i)
+			{
+				int value = 0;
+				if (mn::cmap_lookup(map, i, value) && value != i * 2)
+					wrong_values.fetch_add(1);
+			}
+			for (int i = t; i < KEYS_COUNT; i += THREADS_COUNT)
+				if (i % 2)
+					mn::cmap_remove(map, i);
+		});
+	}
+	for (auto& thread: threads)
+		thread.join();
 
-	mn::str_free(str);
-	mn::reader_free(reader);
+	CHECK(wrong_values == 0);
+	CHECK(mn::cmap_count(map) == KEYS_COUNT / 2);
+	for (int i = 0; i < KEYS_COUNT; ++i)
+	{
+		int value = 0;
+		CHECK(mn::cmap_lookup(map, i, value) == (i % 2 == 0));
+	}
 }
 
-TEST_CASE("path windows os encoding")
+TEST_CASE("cmap read benchmark")
 {
-	auto os_path = mn::path_os_encoding("C:/bin/my_file.exe");
+	static constexpr size_t KEYS_COUNT = 100000;
+	static constexpr size_t OPS_COUNT = 1000000;
+
+	auto run = [](const char* name, size_t threads_count, auto&& lookup) {
+		auto bench = ankerl::nanobench::Bench().epochs(3).epochIterations(1).batch(threads_count * OPS_COUNT).unit("lookup");
+		bench.run(name, [&]{
+			std::thread threads[8];
+			for (size_t t = 0; t < threads_count; ++t)
+			{
+				threads[t] = std::thread([&, t]{
+					size_t found = 0;
+					for (size_t i = 0; i < OPS_COUNT; ++i)
+						found += lookup(int((i * 7919 + t) % KEYS_COUNT));
+					ankerl::nanobench::doNotOptimizeAway(found);
+				});
+			}
+			for (size_t t = 0; t < threads_count; ++t)
+				threads[t].join();
+		});
+	};
 
-	#if OS_WINDOWS
-		CHECK(os_path == "C:\\bin\\my_file.exe");
-	#endif
+	auto map = mn::map_new<int, int>();
+	mn_defer(mn::map_free(map));
+	auto cmap = mn::cmap_new<int, int>();
+	mn_defer(mn::cmap_free(cmap));
+	for (int i = 0; i < int(KEYS_COUNT); ++i)
+	{
+		mn::map_insert(map, i, i);
+		mn::cmap_insert_or_assign(cmap, i, i);
+	}
 
-	mn::str_free(os_path);
+	auto mtx = mn::mutex_rw_new("cmap benchmark");
+	mn_defer(mn::mutex_rw_free(mtx));
+	auto map_lookup = [&](int key) {
+		mn::mutex_read_lock(mtx);
+		mn_defer(mn::mutex_read_unlock(mtx));
+		auto it = mn::map_lookup(map, key);
+		return it ? it->value : 0;
+	};
+	auto cmap_lookup = [&](int key) {
+		int value = 0;
+		mn::cmap_lookup(cmap, key, value);
+		return value;
+	};
+
+	for (size_t threads_count: {1, 2, 4, 8})
+	{
+		run(mn::str_tmpf("Mutex_RW map {} threads", threads_count).ptr, threads_count, map_lookup);
+		run(mn::str_tmpf("cmap {} threads", threads_count).ptr, threads_count, cmap_lookup);
+	}
 }
 
-TEST_CASE("Str_Intern general case")
+TEST_CASE("Pool general case")
 {
-	auto intern = mn::str_intern_new();
-
-	const char* is = mn::str_intern(intern, "Mostafa");
-	CHECK(is != nullptr);
-	CHECK(is == mn::str_intern(intern, "Mostafa"));
+	auto pool = mn::pool_new(sizeof(int), 1024);
+	int* ptr = (int*)mn::pool_get(pool);
+	CHECK(ptr != nullptr);
+	*ptr = 234;
+	mn::pool_put(pool, ptr);
+	int* new_ptr = (int*)mn::pool_get(pool);
+	CHECK(new_ptr == ptr);
 
-	const char* big_str = "my name is Mostafa";
-	const char* begin = big_str + 11;
-	const char* end = begin + 7;
-	CHECK(is == mn::str_intern(intern, begin, end));
+	int* new_ptr2 = (int*)mn::pool_get(pool);
+	mn::pool_put(pool, new_ptr2);
 
-	mn::str_intern_free(intern);
+	mn::pool_put(pool, new_ptr);
+	mn::pool_free(pool);
 }
 
-TEST_CASE("simple data ring case")
+TEST_CASE("Pool bulk get and put")
 {
-	mn::allocator_push(mn::memory::leak());
+	auto pool = mn::pool_new(sizeof(int), 1024);
+	mn_defer(mn::pool_free(pool));
 
-	auto r = mn::ring_new<int>();
+	void* ptrs[100];
+	mn::pool_get_n(pool, ptrs, 100);
+	for (auto ptr: ptrs)
+		*(int*)ptr = 1;
+	mn::pool_put_n(pool, ptrs, 100);
 
-	for (int i = 0; i < 10; ++i)
-		mn::ring_push_back(r, i);
+	void* ptr = mn::pool_get(pool);
+	CHECK(ptr == ptrs[99]);
+	mn::pool_put(pool, ptr);
+}
 
-	for (size_t i = 0; i < r.count; ++i)
-		CHECK(r[i] == i);
+TEST_CASE("concurrent pool")
+{
+	static constexpr size_t THREADS_COUNT = 4;
+	static constexpr size_t ITEMS_COUNT = 10000;
 
-	for (int i = 0; i < 10; ++i)
-		mn::ring_push_front(r, i);
+	auto pool = mn::pool_concurrent_new(sizeof(size_t), 1024);
+	mn_defer(mn::pool_free(pool));
 
-	for (int i = 9; i >= 0; --i)
+	// each thread gets elements and passes them to the next thread to put them back
+	auto items = mn::buf_with_count<mn::Buf<size_t*>>(THREADS_COUNT);
+	mn_defer(mn::destruct(items));
+	for (auto& buf: items)
+		buf = mn::buf_new<size_t*>();
+
+	std::thread threads[THREADS_COUNT];
+	for (size_t i = 0; i < THREADS_COUNT; ++i)
 	{
-		CHECK(mn::ring_back(r) == i);
-		mn::ring_pop_back(r);
+		threads[i] = std::thread([&items, pool, i]{
+			for (size_t j = 0; j < ITEMS_COUNT; ++j)
+			{
+				auto ptr = (size_t*)mn::pool_get(pool);
+				*ptr = i * ITEMS_COUNT + j;
+				mn::buf_push(items[i], ptr);
+			}
+		});
+	}
+	for (auto& thread: threads)
+		thread.join();
+
+	// all the elements should be distinct
+	auto seen = mn::buf_with_count<bool>(THREADS_COUNT * ITEMS_COUNT);
+	mn_defer(mn::buf_free(seen));
+	mn::buf_fill(seen, false);
+	for (size_t i = 0; i < THREADS_COUNT; ++i)
+	{
+		for (size_t j = 0; j < ITEMS_COUNT; ++j)
+		{
+			auto value = *items[i][j];
+			CHECK(value == i * ITEMS_COUNT + j);
+			seen[value] = true;
+		}
 	}
+	CHECK(std::all_of(seen.ptr, seen.ptr + seen.count, [](bool v) { return v; }));
 
-	for (int i = 9; i >= 0; --i)
+	for (size_t i = 0; i < THREADS_COUNT; ++i)
 	{
-		CHECK(mn::ring_front(r) == i);
-		mn::ring_pop_front(r);
+		threads[i] = std::thread([&items, pool, i]{
+			auto& buf = items[(i + 1) % THREADS_COUNT];
+			mn::pool_put_n(pool, (void**)buf.ptr, buf.count);
+			// and get them back from the depot
+			mn::pool_get_n(pool, (void**)buf.ptr, buf.count);
+		});
 	}
+	for (auto& thread: threads)
+		thread.join();
+
+	// no element should be handed out twice
+	auto ptrs = mn::buf_new<size_t*>();
+	mn_defer(mn::buf_free(ptrs));
+	for (const auto& buf: items)
+		mn::buf_concat(ptrs, buf);
+	std::sort(ptrs.ptr, ptrs.ptr + ptrs.count);
+	CHECK(std::adjacent_find(ptrs.ptr, ptrs.ptr + ptrs.count) == ptrs.ptr + ptrs.count);
+}
 
-	mn::ring_free(r);
+TEST_CASE("concurrent pool benchmark")
+{
+	static constexpr size_t THREADS_COUNT = 4;
+	static constexpr size_t OPS_COUNT = 100000;
+	static constexpr size_t LIVE_COUNT = 64;
+
+	auto bench = ankerl::nanobench::Bench().epochs(3).epochIterations(1).batch(THREADS_COUNT * OPS_COUNT).unit("op");
+
+	auto run = [&](const char* name, auto&& get, auto&& put) {
+		bench.run(name, [&]{
+			std::thread threads[THREADS_COUNT];
+			for (auto& thread: threads)
+			{
+				thread = std::thread([&]{
+					void* live[LIVE_COUNT] = {};
+					for (size_t j = 0; j < OPS_COUNT; ++j)
+					{
+						auto& ptr = live[j % LIVE_COUNT];
+						if (ptr)
+							put(ptr);
+						ptr = get();
+					}
+					for (auto ptr: live)
+						put(ptr);
+				});
+			}
+			for (auto& thread: threads)
+				thread.join();
+		});
+	};
 
-	mn::allocator_pop();
+	auto pool = mn::pool_new(64, 1024);
+	mn_defer(mn::pool_free(pool));
+	auto mtx = mn::mutex_new("pool benchmark");
+	mn_defer(mn::mutex_free(mtx));
+	run("mutex pool 4 threads get/put",
+		[&]{ mn::mutex_lock(mtx); auto res = mn::pool_get(pool); mn::mutex_unlock(mtx); return res; },
+		[&](void* ptr){ mn::mutex_lock(mtx); mn::pool_put(pool, ptr); mn::mutex_unlock(mtx); }
+	);
+
+	auto concurrent_pool = mn::pool_concurrent_new(64, 1024);
+	mn_defer(mn::pool_free(concurrent_pool));
+	run("concurrent pool 4 threads get/put",
+		[&]{ return mn::pool_get(concurrent_pool); },
+		[&](void* ptr){ mn::pool_put(concurrent_pool, ptr); }
+	);
 }
 
-TEST_CASE("complex data ring case")
+struct Echo_Server
 {
-	mn::allocator_push(mn::memory::leak());
-	auto r = mn::ring_new<mn::Str>();
+	mn::Fabric fabric;
+	mn::Socket listener;
+	std::atomic<size_t> accepted;
+	std::atomic<size_t> closed;
+};
 
-	for (int i = 0; i < 10; ++i)
-		mn::ring_push_back(r, mn::str_from_c("Mostafa"));
+struct Echo_Connection
+{
+	Echo_Server* server;
+	mn::Socket socket;
+};
 
-	for (int i = 0; i < 10; ++i)
-		mn::ring_push_front(r, mn::str_from_c("Saad"));
+static void
+echo_connection_serve(Echo_Connection* self)
+{
+	char buffer[256];
+	while (true)
+	{
+		auto [read_bytes, err] = mn::socket_read(self->socket, mn::block_from(buffer), mn::NO_TIMEOUT);
+		if (err == mn::MN_SOCKET_ERROR_TIMEOUT)
+		{
+			mn::fabric_io_do(self->server->fabric, mn::socket_fd(self->socket), mn::REACTOR_EVENT_READ, [self]{
+				echo_connection_serve(self);
+			});
+			return;
+		}
+
+		if (err || read_bytes == 0)
+		{
+			mn::fabric_io_cancel(self->server->fabric, mn::socket_fd(self->socket));
+			mn::socket_close(self->socket);
+			self->server->closed.fetch_add(1);
+			mn::free(self);
+			return;
+		}
+
+		mn::socket_write(self->socket, mn::Block{buffer, read_bytes});
+	}
+}
+
+static void
+echo_server_accept(Echo_Server* self)
+{
+	while (auto socket = mn::socket_accept(self->listener, mn::NO_TIMEOUT))
+	{
+		auto connection = mn::alloc<Echo_Connection>();
+		connection->server = self;
+		connection->socket = socket;
+		self->accepted.fetch_add(1);
+		echo_connection_serve(connection);
+	}
+
+	mn::fabric_io_do(self->fabric, mn::socket_fd(self->listener), mn::REACTOR_EVENT_READ, [self]{
+		echo_server_accept(self);
+	});
+}
+
+TEST_CASE("fabric io echo with many idle connections")
+{
+	constexpr size_t CONNECTIONS_COUNT = 5000;
+
+	mn::Fabric_Settings settings{};
+	settings.workers_count = 2;
+	auto f = mn::fabric_new(settings);
+	mn_defer(mn::fabric_free(f));
+
+	Echo_Server server{};
+	server.fabric = f;
+	server.listener = mn::socket_open(mn::SOCKET_FAMILY_IPV4, mn::SOCKET_TYPE_TCP);
+	REQUIRE(server.listener != nullptr);
+	REQUIRE(mn::socket_bind(server.listener, "4817"));
+	REQUIRE(mn::socket_listen(server.listener));
+	mn::fabric_do(f, [&server]{ echo_server_accept(&server); });
+
+	auto clients = mn::buf_new<mn::Socket>();
+	mn_defer(mn::buf_free(clients));
+	for (size_t i = 0; i < CONNECTIONS_COUNT; ++i)
+	{
+		auto client = mn::socket_open(mn::SOCKET_FAMILY_IPV4, mn::SOCKET_TYPE_TCP);
+		if (client == nullptr)
+			break;
+		if (mn::socket_connect(client, "localhost", "4817") == false)
+		{
+			mn::socket_close(client);
+			break;
+		}
+		mn::buf_push(clients, client);
+	}
+	CHECK(clients.count == CONNECTIONS_COUNT);
+
+	mn::worker_block_on_with_timeout({10000}, [&]{ return server.accepted.load() == clients.count; });
+	CHECK(server.accepted.load() == clients.count);
+
+	// every connection echoes a message while all the others are idle, with only 2 workers
+	size_t echoed = 0;
+	ankerl::nanobench::Bench().epochs(3).epochIterations(1).batch(clients.count).unit("echo").run(
+		mn::str_tmpf("fabric io echo {} connections 2 workers", clients.count).ptr, [&]{
+			for (auto client: clients)
+				mn::socket_write(client, mn::block_lit("mostafa"));
+			for (auto client: clients)
+			{
+				char buffer[8] = {};
+				size_t read_bytes = 0;
+				while (read_bytes < 7)
+				{
+					auto [count, err] = mn::socket_read(client, mn::Block{buffer + read_bytes, 7 - read_bytes}, {10000});
+					if (err || count == 0)
+						break;
+					read_bytes += count;
+				}
+				echoed += read_bytes == 7 && ::strcmp(buffer, "mostafa") == 0;
+			}
+		}
+	);
+	CHECK(echoed == 3 * clients.count);
+
+	for (auto client: clients)
+		mn::socket_close(client);
+	mn::worker_block_on_with_timeout({10000}, [&]{ return server.closed.load() == server.accepted.load(); });
+	CHECK(server.closed.load() == server.accepted.load());
+
+	mn::fabric_io_cancel(f, mn::socket_fd(server.listener));
+	mn::socket_close(server.listener);
+}
+
+static void
+socket_read_exact(mn::Socket socket, mn::Block data)
+{
+	size_t read_bytes = 0;
+	while (read_bytes < data.size)
+	{
+		auto [count, err] = mn::socket_read(socket, mn::Block{(char*)data.ptr + read_bytes, data.size - read_bytes}, {10000});
+		if (err || count == 0)
+			break;
+		read_bytes += count;
+	}
+}
+
+TEST_CASE("socket writev sendfile and zerocopy")
+{
+	auto listener = mn::socket_open(mn::SOCKET_FAMILY_IPV4, mn::SOCKET_TYPE_TCP);
+	REQUIRE(listener != nullptr);
+	mn_defer(mn::socket_close(listener));
+	REQUIRE(mn::socket_bind(listener, "4820"));
+	REQUIRE(mn::socket_listen(listener));
+
+	auto client = mn::socket_open(mn::SOCKET_FAMILY_IPV4, mn::SOCKET_TYPE_TCP);
+	REQUIRE(client != nullptr);
+	mn_defer(mn::socket_close(client));
+	REQUIRE(mn::socket_connect(client, "localhost", "4820"));
+
+	auto server = mn::socket_accept(listener, {10000});
+	REQUIRE(server != nullptr);
+	mn_defer(mn::socket_close(server));
+
+	// framed message with a length prefix in a single write
+	{
+		uint64_t len = 7;
+		mn::Block blocks[] = {mn::block_from(len), mn::block_lit("mostafa")};
+		CHECK(mn::socket_writev(client, blocks, 2) == sizeof(len) + 7);
+
+		char buffer[sizeof(len) + 8] = {};
+		socket_read_exact(server, mn::Block{buffer, sizeof(len) + 7});
+		CHECK(::memcmp(buffer, &len, sizeof(len)) == 0);
+		CHECK(::strcmp(buffer + sizeof(len), "mostafa") == 0);
+	}
+
+	// more blocks than a single os call can take
+	{
+		auto blocks = mn::buf_new<mn::Block>();
+		mn_defer(mn::buf_free(blocks));
+		char letters[200];
+		for (size_t i = 0; i < 200; ++i)
+		{
+			letters[i] = char('a' + i % 26);
+			mn::buf_push(blocks, mn::Block{letters + i, 1});
+		}
+		CHECK(mn::socket_writev(client, blocks.ptr, blocks.count) == 200);
+
+		char buffer[200] = {};
+		socket_read_exact(server, mn::block_from(buffer));
+		CHECK(::memcmp(buffer, letters, 200) == 0);
+	}
+
+	// sendfile a range of a file
+	{
+		auto filename = mn::file_tmp(mn::str_lit(""), mn::str_lit("bin"), mn::memory::tmp());
+		auto file = mn::file_open(filename.ptr, mn::IO_MODE_READ_WRITE, mn::OPEN_MODE_CREATE_OVERWRITE);
+		REQUIRE(file != nullptr);
+		mn_defer({
+			mn::file_close(file);
+			mn::file_remove(filename);
+		});
+
+		auto data = mn::buf_with_count<uint8_t>(1024 * 1024);
+		mn_defer(mn::buf_free(data));
+		for (size_t i = 0; i < data.count; ++i)
+			data[i] = uint8_t(i * 13 + i / 4096);
+		REQUIRE(mn::file_write(file, mn::Block{data.ptr, data.count}) == data.count);
+
+		auto received = mn::buf_with_count<uint8_t>(data.count - 100);
+		mn_defer(mn::buf_free(received));
+		std::thread reader([&]{ socket_read_exact(server, mn::Block{received.ptr, received.count}); });
+		CHECK(mn::socket_sendfile(client, file, 100, received.count) == received.count);
+		reader.join();
+		CHECK(::memcmp(received.ptr, data.ptr + 100, received.count) == 0);
+	}
+
+	// zerocopy writes, the buffer is used by the os until the peer reads the data on loopback
+	{
+		bool zerocopy = mn::socket_zerocopy_enable(client);
+		auto data = mn::buf_with_count<uint8_t>(64 * 1024);
+		mn_defer(mn::buf_free(data));
+		for (size_t i = 0; i < data.count; ++i)
+			data[i] = uint8_t(i * 3);
+
+		auto received = mn::buf_with_count<uint8_t>(data.count * 4);
+		mn_defer(mn::buf_free(received));
+		std::thread reader([&]{ socket_read_exact(server, mn::Block{received.ptr, received.count}); });
+		for (size_t i = 0; i < 4; ++i)
+			CHECK(mn::socket_write_zerocopy(client, mn::Block{data.ptr, data.count}) == data.count);
+		reader.join();
+		CHECK(mn::socket_zerocopy_reap(client, {10000}) == 0);
+		if (zerocopy)
+			CHECK(client->zerocopy_completed == 4);
+		for (size_t i = 0; i < 4; ++i)
+			CHECK(::memcmp(received.ptr + i * data.count, data.ptr, data.count) == 0);
+	}
+}
+
+TEST_CASE("socket sendfile benchmark")
+{
+	constexpr size_t FILE_SIZE = 8 * 1024 * 1024;
+
+	auto listener = mn::socket_open(mn::SOCKET_FAMILY_IPV4, mn::SOCKET_TYPE_TCP);
+	REQUIRE(listener != nullptr);
+	mn_defer(mn::socket_close(listener));
+	REQUIRE(mn::socket_bind(listener, "4821"));
+	REQUIRE(mn::socket_listen(listener));
+
+	auto client = mn::socket_open(mn::SOCKET_FAMILY_IPV4, mn::SOCKET_TYPE_TCP);
+	REQUIRE(client != nullptr);
+	mn_defer(mn::socket_close(client));
+	REQUIRE(mn::socket_connect(client, "localhost", "4821"));
+
+	auto server = mn::socket_accept(listener, {10000});
+	REQUIRE(server != nullptr);
+	mn_defer(mn::socket_close(server));
+
+	auto filename = mn::file_tmp(mn::str_lit(""), mn::str_lit("bin"), mn::memory::tmp());
+	auto file = mn::file_open(filename.ptr, mn::IO_MODE_READ_WRITE, mn::OPEN_MODE_CREATE_OVERWRITE);
+	REQUIRE(file != nullptr);
+	mn_defer({
+		mn::file_close(file);
+		mn::file_remove(filename);
+	});
+
+	auto data = mn::buf_with_count<uint8_t>(FILE_SIZE);
+	mn_defer(mn::buf_free(data));
+	mn::buf_fill(data, uint8_t(42));
+	REQUIRE(mn::file_write(file, mn::Block{data.ptr, data.count}) == data.count);
+
+	// the receiving side drains everything into the same buffer
+	std::atomic<bool> done = false;
+	std::thread reader([&]{
+		char buffer[64 * 1024];
+		while (done == false)
+			mn::socket_read(server, mn::block_from(buffer), {100});
+	});
+
+	ankerl::nanobench::Bench bench;
+	bench.batch(FILE_SIZE).unit("byte");
+
+	size_t sent = 0;
+	bench.run("file_read + socket_write 8MB", [&]{
+		char buffer[64 * 1024];
+		mn::file_cursor_set(file, 0);
+		sent = 0;
+		while (sent < FILE_SIZE)
+		{
+			auto read_bytes = mn::file_read(file, mn::block_from(buffer));
+			if (read_bytes == 0)
+				break;
+			sent += mn::socket_write(client, mn::Block{buffer, read_bytes});
+		}
+	});
+	CHECK(sent == FILE_SIZE);
+
+	bench.run("socket_sendfile 8MB", [&]{
+		sent = mn::socket_sendfile(client, file, 0, FILE_SIZE);
+	});
+	CHECK(sent == FILE_SIZE);
+
+	done = true;
+	reader.join();
+}
+
+TEST_CASE("socket datagrams")
+{
+	auto receiver = mn::socket_open(mn::SOCKET_FAMILY_IPV4, mn::SOCKET_TYPE_UDP);
+	REQUIRE(receiver != nullptr);
+	mn_defer(mn::socket_close(receiver));
+	REQUIRE(mn::socket_bind(receiver, "4822"));
+
+	auto sender = mn::socket_open(mn::SOCKET_FAMILY_IPV4, mn::SOCKET_TYPE_UDP);
+	REQUIRE(sender != nullptr);
+	mn_defer(mn::socket_close(sender));
+
+	mn::Socket_Address address{};
+	REQUIRE(mn::socket_address_from(mn::SOCKET_FAMILY_IPV4, "127.0.0.1", "4822", address));
+	CHECK(mn::socket_address_str(address, mn::memory::tmp()) == "127.0.0.1:4822");
+
+	// single datagram
+	{
+		CHECK(mn::socket_send_to(sender, mn::block_lit("mostafa"), address) == 7);
+		char buffer[16] = {};
+		mn::Socket_Address from{};
+		auto [received, err] = mn::socket_recv_from(receiver, mn::block_from(buffer), from, {1000});
+		CHECK(err == mn::MN_SOCKET_ERROR_OK);
+		CHECK(received == 7);
+		CHECK(::strcmp(buffer, "mostafa") == 0);
+		CHECK(mn::str_prefix(mn::socket_address_str(from, mn::memory::tmp()), "127.0.0.1:"));
+
+		auto [_, timeout_err] = mn::socket_recv_from(receiver, mn::block_from(buffer), from, mn::NO_TIMEOUT);
+		CHECK(timeout_err == mn::MN_SOCKET_ERROR_TIMEOUT);
+	}
+
+	// batches
+	{
+		constexpr size_t DATAGRAMS_COUNT = 100;
+		uint32_t values[DATAGRAMS_COUNT];
+		mn::Socket_Datagram datagrams[DATAGRAMS_COUNT];
+		for (uint32_t i = 0; i < DATAGRAMS_COUNT; ++i)
+		{
+			values[i] = i;
+			datagrams[i].data = mn::block_from(values[i]);
+			datagrams[i].address = address;
+		}
+		CHECK(mn::socket_send_many(sender, datagrams, DATAGRAMS_COUNT) == DATAGRAMS_COUNT);
+
+		uint32_t received_values[DATAGRAMS_COUNT] = {};
+		size_t received_count = 0;
+		while (received_count < DATAGRAMS_COUNT)
+		{
+			for (size_t i = received_count; i < DATAGRAMS_COUNT; ++i)
+				datagrams[i].data = mn::block_from(received_values[i]);
+			auto [count, err] = mn::socket_recv_many(receiver, datagrams + received_count, DATAGRAMS_COUNT - received_count, {1000});
+			if (err)
+				break;
+			for (size_t i = received_count; i < received_count + count; ++i)
+				CHECK(datagrams[i].data.size == sizeof(uint32_t));
+			received_count += count;
+		}
+		CHECK(received_count == DATAGRAMS_COUNT);
+		for (uint32_t i = 0; i < DATAGRAMS_COUNT; ++i)
+			CHECK(received_values[i] == i);
+	}
+
+	// segmented send, the receiver sees separate datagrams
+	{
+		constexpr size_t SEGMENT_SIZE = 1000;
+		auto data = mn::buf_with_count<uint8_t>(SEGMENT_SIZE * 10 + 500);
+		mn_defer(mn::buf_free(data));
+		for (size_t i = 0; i < data.count; ++i)
+			data[i] = uint8_t(i / SEGMENT_SIZE);
+		CHECK(mn::socket_send_segmented(sender, mn::Block{data.ptr, data.count}, SEGMENT_SIZE, address) == data.count);
+
+		size_t datagrams_count = 0;
+		size_t received_bytes = 0;
+		bool ordered = true;
+		while (received_bytes < data.count)
+		{
+			uint8_t buffer[2 * SEGMENT_SIZE];
+			mn::Socket_Address from{};
+			auto [received, err] = mn::socket_recv_from(receiver, mn::block_from(buffer), from, {1000});
+			if (err)
+				break;
+			ordered &= received <= SEGMENT_SIZE && buffer[0] == datagrams_count;
+			received_bytes += received;
+			++datagrams_count;
+		}
+		CHECK(datagrams_count == 11);
+		CHECK(received_bytes == data.count);
+		CHECK(ordered);
+	}
+}
+
+TEST_CASE("socket datagrams receive coalescing")
+{
+	auto receiver = mn::socket_open(mn::SOCKET_FAMILY_IPV4, mn::SOCKET_TYPE_UDP);
+	REQUIRE(receiver != nullptr);
+	mn_defer(mn::socket_close(receiver));
+	REQUIRE(mn::socket_bind(receiver, "4823"));
+	mn::socket_gro_enable(receiver);
+
+	auto sender = mn::socket_open(mn::SOCKET_FAMILY_IPV4, mn::SOCKET_TYPE_UDP);
+	REQUIRE(sender != nullptr);
+	mn_defer(mn::socket_close(sender));
+
+	mn::Socket_Address address{};
+	REQUIRE(mn::socket_address_from(mn::SOCKET_FAMILY_IPV4, "127.0.0.1", "4823", address));
+
+	constexpr size_t SEGMENT_SIZE = 1200;
+	auto data = mn::buf_with_count<uint8_t>(SEGMENT_SIZE * 20);
+	mn_defer(mn::buf_free(data));
+	for (size_t i = 0; i < data.count; ++i)
+		data[i] = uint8_t(i * 11);
+	CHECK(mn::socket_send_segmented(sender, mn::Block{data.ptr, data.count}, SEGMENT_SIZE, address) == data.count);
+
+	// whether the os coalesces the datagrams or not, the segment size splits them back
+	auto received = mn::buf_with_count<uint8_t>(data.count);
+	mn_defer(mn::buf_free(received));
+	size_t received_bytes = 0;
+	bool segments_ok = true;
+	while (received_bytes < data.count)
+	{
+		uint8_t buffer[64 * 1024];
+		mn::Socket_Address from{};
+		size_t segment_size = 0;
+		auto [count, err] = mn::socket_recv_segmented(receiver, mn::block_from(buffer), from, segment_size, {1000});
+		if (err || received_bytes + count > data.count)
+			break;
+		segments_ok &= segment_size == SEGMENT_SIZE;
+		::memcpy(received.ptr + received_bytes, buffer, count);
+		received_bytes += count;
+	}
+	CHECK(received_bytes == data.count);
+	CHECK(segments_ok);
+	CHECK(::memcmp(received.ptr, data.ptr, data.count) == 0);
+}
+
+TEST_CASE("socket datagrams benchmark")
+{
+	constexpr size_t BATCH_SIZE = 64;
+	constexpr size_t DATAGRAM_SIZE = 64;
+
+	auto receiver = mn::socket_open(mn::SOCKET_FAMILY_IPV4, mn::SOCKET_TYPE_UDP);
+	REQUIRE(receiver != nullptr);
+	mn_defer(mn::socket_close(receiver));
+	REQUIRE(mn::socket_bind(receiver, "4824"));
+
+	auto sender = mn::socket_open(mn::SOCKET_FAMILY_IPV4, mn::SOCKET_TYPE_UDP);
+	REQUIRE(sender != nullptr);
+	mn_defer(mn::socket_close(sender));
+
+	mn::Socket_Address address{};
+	REQUIRE(mn::socket_address_from(mn::SOCKET_FAMILY_IPV4, "127.0.0.1", "4824", address));
+
+	uint8_t payload[BATCH_SIZE * DATAGRAM_SIZE] = {};
+	uint8_t buffers[BATCH_SIZE * DATAGRAM_SIZE] = {};
+	mn::Socket_Datagram datagrams[BATCH_SIZE];
+
+	// receives a whole batch, datagrams might still be in flight on loopback so we wait a little for them
+	auto receive_batch = [&]{
+		size_t received = 0;
+		while (received < BATCH_SIZE)
+		{
+			for (size_t i = received; i < BATCH_SIZE; ++i)
+				datagrams[i].data = mn::Block{buffers + i * DATAGRAM_SIZE, DATAGRAM_SIZE};
+			auto [count, err] = mn::socket_recv_many(receiver, datagrams + received, BATCH_SIZE - received, {1000});
+			if (err)
+				break;
+			received += count;
+		}
+		return received;
+	};
+
+	ankerl::nanobench::Bench bench;
+	bench.batch(BATCH_SIZE).unit("datagram");
+
+	size_t received = 0;
+	bench.run("udp send_to/recv_from 64B datagrams", [&]{
+		received = 0;
+		for (size_t i = 0; i < BATCH_SIZE; ++i)
+			mn::socket_send_to(sender, mn::Block{payload + i * DATAGRAM_SIZE, DATAGRAM_SIZE}, address);
+		for (size_t i = 0; i < BATCH_SIZE; ++i)
+		{
+			mn::Socket_Address from{};
+			auto [count, err] = mn::socket_recv_from(receiver, mn::Block{buffers + i * DATAGRAM_SIZE, DATAGRAM_SIZE}, from, {1000});
+			received += err == mn::MN_SOCKET_ERROR_OK;
+		}
+	});
+	CHECK(received == BATCH_SIZE);
+
+	bench.run("udp send_many/recv_many 64B datagrams", [&]{
+		for (size_t i = 0; i < BATCH_SIZE; ++i)
+		{
+			datagrams[i].data = mn::Block{payload + i * DATAGRAM_SIZE, DATAGRAM_SIZE};
+			datagrams[i].address = address;
+		}
+		mn::socket_send_many(sender, datagrams, BATCH_SIZE);
+		received = receive_batch();
+	});
+	CHECK(received == BATCH_SIZE);
+
+	bench.run("udp send_segmented/recv_many 64B datagrams", [&]{
+		mn::socket_send_segmented(sender, mn::block_from(payload), DATAGRAM_SIZE, address);
+		received = receive_batch();
+	});
+	CHECK(received == BATCH_SIZE);
+}
+
+// echoes the messages it receives until it receives an empty message or the client disconnects
+static void
+sputnik_echo_serve(mn::ipc::Sputnik server)
+{
+	auto connection = mn::ipc::sputnik_accept(server, {10000});
+	if (connection == nullptr)
+		return;
+	mn_defer(mn::ipc::sputnik_free(connection));
+
+	while (true)
+	{
+		auto msg = mn::ipc::sputnik_msg_read_alloc(connection, {10000});
+		mn_defer(mn::str_free(msg));
+		if (msg.count == 0 || msg[0] == 'q')
+			break;
+		// stream messages don't need a reply
+		if (msg[0] == 's')
+			continue;
+		mn::ipc::sputnik_msg_write(connection, mn::block_from(msg));
+	}
+}
+
+TEST_CASE("sputnik transports")
+{
+	for (auto transport: {mn::ipc::SPUTNIK_TRANSPORT_SOCKET, mn::ipc::SPUTNIK_TRANSPORT_SHM})
+	{
+		mn::ipc::Sputnik_Settings settings{};
+		settings.transport = transport;
+		// a small ring so that messages wrap around and writers wait for the reader
+		settings.ring_size = 4096;
+
+		auto name = mn::file_tmp(mn::str_lit(""), mn::str_lit("sock"), mn::memory::tmp());
+		auto server = mn::ipc::sputnik_new(name, settings);
+		REQUIRE(server != nullptr);
+		mn_defer({
+			mn::ipc::sputnik_disconnect(server);
+			mn::ipc::sputnik_free(server);
+		});
+		REQUIRE(mn::ipc::sputnik_listen(server));
+
+		std::thread echo([server]{ sputnik_echo_serve(server); });
+
+		auto client = mn::ipc::sputnik_connect(name, settings);
+		REQUIRE(client != nullptr);
+		CHECK((client->shm != nullptr) == (OS_LINUX && transport == mn::ipc::SPUTNIK_TRANSPORT_SHM));
+
+		constexpr size_t MESSAGES_COUNT = 500;
+		size_t echoed = 0;
+		auto msg = mn::str_new();
+		mn_defer(mn::str_free(msg));
+		for (size_t i = 0; i < MESSAGES_COUNT; ++i)
+		{
+			mn::str_resize(msg, 1 + (i * 37) % 10000);
+			msg[0] = 'e';
+			for (size_t j = 1; j < msg.count; ++j)
+				msg[j] = char('a' + (i + j) % 26);
+			mn::ipc::sputnik_msg_write(client, mn::block_from(msg));
+
+			auto reply = mn::ipc::sputnik_msg_read_alloc(client, {10000});
+			echoed += reply == msg;
+			mn::str_free(reply);
+		}
+		CHECK(echoed == MESSAGES_COUNT);
+
+		mn::ipc::sputnik_msg_write(client, mn::block_lit("q"));
+		echo.join();
+
+		// the server side is gone so reading doesn't block
+		char buffer[8];
+		CHECK(mn::ipc::sputnik_read(client, mn::block_from(buffer), {10000}) == 0);
+		mn::ipc::sputnik_free(client);
+	}
+}
+
+#if OS_LINUX
+TEST_CASE("sputnik transports mismatch")
+{
+	mn::ipc::Sputnik_Settings socket_settings{};
+	socket_settings.transport = mn::ipc::SPUTNIK_TRANSPORT_SOCKET;
+	mn::ipc::Sputnik_Settings shm_settings{};
+	shm_settings.transport = mn::ipc::SPUTNIK_TRANSPORT_SHM;
+	shm_settings.handshake_timeout = {200};
+
+	// a shm client fails instead of waiting forever for a socket server to send the shared memory
+	{
+		auto name = mn::file_tmp(mn::str_lit(""), mn::str_lit("sock"), mn::memory::tmp());
+		auto server = mn::ipc::sputnik_new(name, socket_settings);
+		REQUIRE(server != nullptr);
+		mn_defer({
+			mn::ipc::sputnik_disconnect(server);
+			mn::ipc::sputnik_free(server);
+		});
+		REQUIRE(mn::ipc::sputnik_listen(server));
+
+		auto client = mn::ipc::sputnik_connect(name, shm_settings);
+		CHECK(client == nullptr);
+	}
+
+	// a shm server fails to accept a socket client which never acknowledges the shared memory
+	{
+		auto name = mn::file_tmp(mn::str_lit(""), mn::str_lit("sock"), mn::memory::tmp());
+		auto server = mn::ipc::sputnik_new(name, shm_settings);
+		REQUIRE(server != nullptr);
+		mn_defer({
+			mn::ipc::sputnik_disconnect(server);
+			mn::ipc::sputnik_free(server);
+		});
+		REQUIRE(mn::ipc::sputnik_listen(server));
+
+		auto client = mn::ipc::sputnik_connect(name, socket_settings);
+		REQUIRE(client != nullptr);
+		mn_defer(mn::ipc::sputnik_free(client));
+
+		CHECK(mn::ipc::sputnik_accept(server, {10000}) == nullptr);
+	}
+}
+#endif
+
+TEST_CASE("sputnik transports benchmark")
+{
+	constexpr size_t STREAM_COUNT = 1000;
+
+	ankerl::nanobench::Bench bench;
+	for (auto transport: {mn::ipc::SPUTNIK_TRANSPORT_SOCKET, mn::ipc::SPUTNIK_TRANSPORT_SHM})
+	{
+		mn::ipc::Sputnik_Settings settings{};
+		settings.transport = transport;
+		auto transport_name = transport == mn::ipc::SPUTNIK_TRANSPORT_SHM ? "shm" : "socket";
+
+		auto name = mn::file_tmp(mn::str_lit(""), mn::str_lit("sock"), mn::memory::tmp());
+		auto server = mn::ipc::sputnik_new(name, settings);
+		REQUIRE(server != nullptr);
+		mn_defer({
+			mn::ipc::sputnik_disconnect(server);
+			mn::ipc::sputnik_free(server);
+		});
+		REQUIRE(mn::ipc::sputnik_listen(server));
+
+		std::thread echo([server]{ sputnik_echo_serve(server); });
+
+		auto client = mn::ipc::sputnik_connect(name, settings);
+		REQUIRE(client != nullptr);
+		mn_defer(mn::ipc::sputnik_free(client));
+
+		char ping[64] = "p";
+		char stream[64] = "s";
+		char reply[64];
+		bool ok = true;
+
+		bench.batch(1).unit("round trip").run(mn::str_tmpf("sputnik {} 64B ping pong", transport_name).ptr, [&]{
+			mn::ipc::sputnik_msg_write(client, mn::block_from(ping));
+			auto [consumed, remaining] = mn::ipc::sputnik_msg_read(client, mn::block_from(reply), {10000});
+			ok &= consumed == sizeof(reply) && remaining == 0;
+		});
+
+		bench.batch(STREAM_COUNT).unit("msg").run(mn::str_tmpf("sputnik {} 64B messages stream", transport_name).ptr, [&]{
+			for (size_t i = 0; i < STREAM_COUNT; ++i)
+				mn::ipc::sputnik_msg_write(client, mn::block_from(stream));
+			mn::ipc::sputnik_msg_write(client, mn::block_from(ping));
+			auto [consumed, remaining] = mn::ipc::sputnik_msg_read(client, mn::block_from(reply), {10000});
+			ok &= consumed == sizeof(reply) && remaining == 0;
+		});
+		CHECK(ok);
+
+		mn::ipc::sputnik_msg_write(client, mn::block_lit("q"));
+		echo.join();
+	}
+}
+
+// channel based version of sputnik_echo_serve, replies are flushed once per batch
+static void
+sputnik_channel_echo_serve(mn::ipc::Sputnik server)
+{
+	auto connection = mn::ipc::sputnik_accept(server, {10000});
+	if (connection == nullptr)
+		return;
+	mn_defer(mn::ipc::sputnik_free(connection));
+
+	auto channel = mn::ipc::sputnik_channel_new(connection);
+	mn_defer(mn::ipc::sputnik_channel_free(channel));
+
+	auto messages = mn::buf_new<mn::Block>();
+	mn_defer(mn::buf_free(messages));
+	while (mn::ipc::sputnik_channel_msg_read_batch(channel, messages, {10000}) > 0)
+	{
+		for (auto msg: messages)
+		{
+			auto tag = msg.size > 0 ? ((char*)msg.ptr)[0] : 'q';
+			if (tag == 'q')
+				return;
+			if (tag != 's')
+				mn::ipc::sputnik_channel_msg_write(channel, msg);
+		}
+		mn::ipc::sputnik_channel_flush(channel);
+	}
+}
+
+TEST_CASE("sputnik channel")
+{
+	for (auto transport: {mn::ipc::SPUTNIK_TRANSPORT_SOCKET, mn::ipc::SPUTNIK_TRANSPORT_SHM})
+	{
+		mn::ipc::Sputnik_Settings settings{};
+		settings.transport = transport;
+
+		auto name = mn::file_tmp(mn::str_lit(""), mn::str_lit("sock"), mn::memory::tmp());
+		auto server = mn::ipc::sputnik_new(name, settings);
+		REQUIRE(server != nullptr);
+		mn_defer({
+			mn::ipc::sputnik_disconnect(server);
+			mn::ipc::sputnik_free(server);
+		});
+		REQUIRE(mn::ipc::sputnik_listen(server));
+
+		std::thread echo([server]{ sputnik_channel_echo_serve(server); });
+
+		auto client = mn::ipc::sputnik_connect(name, settings);
+		REQUIRE(client != nullptr);
+		mn_defer(mn::ipc::sputnik_free(client));
+		auto channel = mn::ipc::sputnik_channel_new(client, 4096);
+		mn_defer(mn::ipc::sputnik_channel_free(channel));
+
+		// small messages are coalesced, and the large ones are bigger than both sides' buffers
+		constexpr size_t MESSAGES_COUNT = 2000;
+		auto sent = mn::buf_new<mn::Str>();
+		mn_defer(destruct(sent));
+		for (size_t i = 0; i < MESSAGES_COUNT; ++i)
+		{
+			auto msg = mn::str_new();
+			mn::str_resize(msg, i % 500 == 0 ? 100 * 1024 : 1 + (i * 13) % 200);
+			msg[0] = 'e';
+			for (size_t j = 1; j < msg.count; ++j)
+				msg[j] = char('a' + (i + j) % 26);
+			mn::buf_push(sent, msg);
+		}
+
+		size_t echoed = 0;
+		size_t batches = 0;
+		auto messages = mn::buf_new<mn::Block>();
+		mn_defer(mn::buf_free(messages));
+		std::thread writer([&]{
+			for (const auto& msg: sent)
+				mn::ipc::sputnik_channel_msg_write(channel, mn::block_from(msg));
+			mn::ipc::sputnik_channel_flush(channel);
+		});
+		while (echoed < MESSAGES_COUNT)
+		{
+			if (mn::ipc::sputnik_channel_msg_read_batch(channel, messages, {10000}) == 0)
+				break;
+			++batches;
+			for (auto msg: messages)
+			{
+				if (echoed < MESSAGES_COUNT && msg.size == sent[echoed].count && ::memcmp(msg.ptr, sent[echoed].ptr, msg.size) == 0)
+					++echoed;
+			}
+		}
+		writer.join();
+		CHECK(echoed == MESSAGES_COUNT);
+		CHECK(batches < MESSAGES_COUNT);
+
+		// the other side can use the normal message functions
+		mn::ipc::sputnik_msg_write(client, mn::block_lit("mostafa"));
+		auto reply = mn::ipc::sputnik_msg_read_alloc(client, {10000});
+		CHECK(reply == "mostafa");
+		mn::str_free(reply);
+
+		mn::ipc::sputnik_msg_write(client, mn::block_lit("q"));
+		echo.join();
+	}
+}
+
+TEST_CASE("sputnik channel benchmark")
+{
+	constexpr size_t STREAM_COUNT = 1000;
+
+	auto name = mn::file_tmp(mn::str_lit(""), mn::str_lit("sock"), mn::memory::tmp());
+	auto server = mn::ipc::sputnik_new(name);
+	REQUIRE(server != nullptr);
+	mn_defer({
+		mn::ipc::sputnik_disconnect(server);
+		mn::ipc::sputnik_free(server);
+	});
+	REQUIRE(mn::ipc::sputnik_listen(server));
+
+	ankerl::nanobench::Bench bench;
+	bench.batch(STREAM_COUNT).unit("msg");
+
+	char stream[64] = "s";
+	char ping[64] = "p";
+	char reply[64];
+	bool ok = true;
+
+	{
+		std::thread echo([server]{ sputnik_echo_serve(server); });
+		auto client = mn::ipc::sputnik_connect(name);
+		REQUIRE(client != nullptr);
+		mn_defer(mn::ipc::sputnik_free(client));
+
+		bench.run("sputnik msg_write/msg_read 64B messages", [&]{
+			for (size_t i = 0; i < STREAM_COUNT; ++i)
+				mn::ipc::sputnik_msg_write(client, mn::block_from(stream));
+			mn::ipc::sputnik_msg_write(client, mn::block_from(ping));
+			auto [consumed, remaining] = mn::ipc::sputnik_msg_read(client, mn::block_from(reply), {10000});
+			ok &= consumed == sizeof(reply) && remaining == 0;
+		});
+
+		mn::ipc::sputnik_msg_write(client, mn::block_lit("q"));
+		echo.join();
+	}
+
+	{
+		std::thread echo([server]{ sputnik_channel_echo_serve(server); });
+		auto client = mn::ipc::sputnik_connect(name);
+		REQUIRE(client != nullptr);
+		mn_defer(mn::ipc::sputnik_free(client));
+		auto channel = mn::ipc::sputnik_channel_new(client);
+		mn_defer(mn::ipc::sputnik_channel_free(channel));
+
+		auto messages = mn::buf_new<mn::Block>();
+		mn_defer(mn::buf_free(messages));
+		bench.run("sputnik channel write/read_batch 64B messages", [&]{
+			for (size_t i = 0; i < STREAM_COUNT; ++i)
+				mn::ipc::sputnik_channel_msg_write(channel, mn::block_from(stream));
+			mn::ipc::sputnik_channel_msg_write(channel, mn::block_from(ping));
+			mn::ipc::sputnik_channel_flush(channel);
+			ok &= mn::ipc::sputnik_channel_msg_read_batch(channel, messages, {10000}) == 1 && messages[0].size == sizeof(ping);
+		});
+
+		mn::ipc::sputnik_channel_msg_write(channel, mn::block_lit("q"));
+		mn::ipc::sputnik_channel_flush(channel);
+		echo.join();
+	}
+	CHECK(ok);
+}
+
+TEST_CASE("async io file read write")
+{
+	auto f = mn::fabric_new({});
+	mn_defer(mn::fabric_free(f));
+
+	for (bool force_fallback: {false, true})
+	{
+		mn::Async_IO_Settings settings{};
+		settings.queue_depth = 16;
+		settings.force_fallback = force_fallback;
+		auto io = mn::async_io_new(f, settings);
+		mn_defer(mn::async_io_free(io));
+		CHECK((force_fallback == false || mn::async_io_is_native(io) == false));
+
+		auto filename = mn::file_tmp(mn::str_lit(""), mn::str_lit("bin"), mn::memory::tmp());
+		auto file = mn::file_open(filename.ptr, mn::IO_MODE_READ_WRITE, mn::OPEN_MODE_CREATE_OVERWRITE);
+		REQUIRE(file != nullptr);
+		mn_defer({
+			mn::file_close(file);
+			mn::file_remove(filename);
+		});
+
+		constexpr size_t BLOCKS_COUNT = 64;
+		constexpr size_t BLOCK_SIZE = 4096;
+		auto data = mn::buf_with_count<uint8_t>(BLOCKS_COUNT * BLOCK_SIZE);
+		mn_defer(mn::buf_free(data));
+		for (size_t i = 0; i < data.count; ++i)
+			data[i] = uint8_t(i * 7 + i / BLOCK_SIZE);
+
+		// write all the blocks then sync the file, the sync is linked to the last write
+		std::atomic<size_t> written = 0;
+		std::atomic<size_t> failed = 0;
+		std::atomic<bool> synced = false;
+		for (size_t i = 0; i < BLOCKS_COUNT; ++i)
+		{
+			auto flags = i + 1 == BLOCKS_COUNT ? mn::ASYNC_IO_FLAG_LINK : mn::ASYNC_IO_FLAG_NONE;
+			mn::async_io_file_write(io, file, mn::Block{data.ptr + i * BLOCK_SIZE, BLOCK_SIZE}, i * BLOCK_SIZE, mn::async_io_callback([&](const mn::Async_IO_Completion& c) {
+				if (c.result == int64_t(BLOCK_SIZE))
+					written.fetch_add(c.result);
+				else
+					failed.fetch_add(1);
+			}), flags);
+		}
+		mn::async_io_file_sync(io, file, mn::async_io_callback([&](const mn::Async_IO_Completion& c) {
+			synced = c.result == 0;
+		}));
+		mn::async_io_submit(io);
+		mn::worker_block_on([&]{ return mn::async_io_pending(io) == 0; });
+		CHECK(written == data.count);
+		CHECK(failed == 0);
+		CHECK(synced == true);
+		CHECK(mn::file_size(file) == int64_t(data.count));
+
+		// read them back in reverse in a single batch
+		auto read_data = mn::buf_with_count<uint8_t>(data.count);
+		mn_defer(mn::buf_free(read_data));
+		mn::buf_fill(read_data, uint8_t(0));
+		std::atomic<size_t> read_bytes = 0;
+		for (size_t i = 0; i < BLOCKS_COUNT; ++i)
+		{
+			auto offset = (BLOCKS_COUNT - i - 1) * BLOCK_SIZE;
+			mn::async_io_file_read(io, file, mn::Block{read_data.ptr + offset, BLOCK_SIZE}, offset, mn::async_io_callback([&](const mn::Async_IO_Completion& c) {
+				if (c.result > 0)
+					read_bytes.fetch_add(c.result);
+			}));
+		}
+		mn::async_io_submit(io);
+		mn::worker_block_on([&]{ return mn::async_io_pending(io) == 0; });
+		CHECK(read_bytes == data.count);
+		CHECK(::memcmp(read_data.ptr, data.ptr, data.count) == 0);
+
+		// fixed buffer reads
+		auto fixed = mn::Block{read_data.ptr, read_data.count};
+		REQUIRE(mn::async_io_register_buffers(io, &fixed, 1));
+		mn::buf_fill(read_data, uint8_t(0));
+		read_bytes = 0;
+		for (size_t i = 0; i < BLOCKS_COUNT; ++i)
+		{
+			mn::async_io_file_read_fixed(io, file, 0, mn::Block{read_data.ptr + i * BLOCK_SIZE, BLOCK_SIZE}, i * BLOCK_SIZE, mn::async_io_callback([&](const mn::Async_IO_Completion& c) {
+				if (c.result > 0)
+					read_bytes.fetch_add(c.result);
+			}));
+		}
+		mn::async_io_submit(io);
+		mn::worker_block_on([&]{ return mn::async_io_pending(io) == 0; });
+		CHECK(read_bytes == data.count);
+		CHECK(::memcmp(read_data.ptr, data.ptr, data.count) == 0);
+	}
+}
+
+TEST_CASE("async io linked chain cancellation")
+{
+	auto f = mn::fabric_new({});
+	mn_defer(mn::fabric_free(f));
+
+	for (bool force_fallback: {false, true})
+	{
+		mn::Async_IO_Settings settings{};
+		settings.force_fallback = force_fallback;
+		auto io = mn::async_io_new(f, settings);
+		mn_defer(mn::async_io_free(io));
+
+		auto filename = mn::file_tmp(mn::str_lit(""), mn::str_lit("bin"), mn::memory::tmp());
+		auto writer = mn::file_open(filename.ptr, mn::IO_MODE_WRITE, mn::OPEN_MODE_CREATE_OVERWRITE);
+		REQUIRE(writer != nullptr);
+		mn::file_close(writer);
+		auto file = mn::file_open(filename.ptr, mn::IO_MODE_READ, mn::OPEN_MODE_OPEN_ONLY);
+		REQUIRE(file != nullptr);
+		mn_defer({
+			mn::file_close(file);
+			mn::file_remove(filename);
+		});
+
+		// writing to a read only file fails so the linked sync shouldn't run
+		std::atomic<int64_t> write_result = 0;
+		std::atomic<int64_t> sync_result = 0;
+		mn::async_io_file_write(io, file, mn::block_lit("mostafa"), 0, mn::async_io_callback([&](const mn::Async_IO_Completion& c) {
+			write_result = c.result;
+		}), mn::ASYNC_IO_FLAG_LINK);
+		mn::async_io_file_sync(io, file, mn::async_io_callback([&](const mn::Async_IO_Completion& c) {
+			sync_result = c.result;
+		}));
+		CHECK(mn::async_io_pending(io) == 2);
+		mn::async_io_submit(io);
+		mn::worker_block_on([&]{ return mn::async_io_pending(io) == 0; });
+		CHECK(write_result < 0);
+		CHECK(sync_result == -ECANCELED);
+	}
+}
+
+TEST_CASE("async io unterminated chain")
+{
+	auto f = mn::fabric_new({});
+	mn_defer(mn::fabric_free(f));
+
+	auto filename = mn::file_tmp(mn::str_lit(""), mn::str_lit("bin"), mn::memory::tmp());
+	auto file = mn::file_open(filename.ptr, mn::IO_MODE_WRITE, mn::OPEN_MODE_CREATE_OVERWRITE);
+	REQUIRE(file != nullptr);
+	mn_defer({
+		mn::file_close(file);
+		mn::file_remove(filename);
+	});
+
+	for (bool force_fallback: {false, true})
+	{
+		mn::Async_IO_Settings settings{};
+		settings.force_fallback = force_fallback;
+		auto io = mn::async_io_new(f, settings);
+
+		// the chain is never terminated, freeing the engine ends it at its last operation, the io_uring path might
+		// cancel the write before it starts like any other in flight operation
+		std::atomic<int64_t> write_result = 0;
+		mn::async_io_file_write(io, file, mn::block_lit("mostafa"), 0, mn::async_io_callback([&](const mn::Async_IO_Completion& c) {
+			write_result = c.result;
+		}), mn::ASYNC_IO_FLAG_LINK);
+		mn::async_io_free(io);
+		CHECK((write_result == 7 || (force_fallback == false && write_result == -ECANCELED)));
+	}
+}
+
+TEST_CASE("async io tiny queue")
+{
+	mn::Fabric_Settings fabric_settings{};
+	fabric_settings.workers_count = 4;
+	auto f = mn::fabric_new(fabric_settings);
+	mn_defer(mn::fabric_free(f));
+
+	auto filename = mn::file_tmp(mn::str_lit(""), mn::str_lit("bin"), mn::memory::tmp());
+	auto writer = mn::file_open(filename.ptr, mn::IO_MODE_WRITE, mn::OPEN_MODE_CREATE_OVERWRITE);
+	REQUIRE(writer != nullptr);
+	mn::file_write(writer, mn::block_lit("mostafa"));
+	mn::file_close(writer);
+	auto file = mn::file_open(filename.ptr, mn::IO_MODE_READ, mn::OPEN_MODE_OPEN_ONLY);
+	REQUIRE(file != nullptr);
+	mn_defer({
+		mn::file_close(file);
+		mn::file_remove(filename);
+	});
+
+	for (bool force_fallback: {false, true})
+	{
+		// many threads queue a lot more operations than the queues can hold, so the submitters wait for room while
+		// the completion queue keeps filling up
+		mn::Async_IO_Settings settings{};
+		settings.force_fallback = force_fallback;
+		settings.queue_depth = 2;
+		auto io = mn::async_io_new(f, settings);
+
+		constexpr size_t THREADS_COUNT = 4;
+		constexpr size_t OPS_COUNT = 2000;
+		std::atomic<size_t> read_bytes = 0;
+		// all the reads read the same content into the same buffer
+		char buffer[8];
+		std::thread threads[THREADS_COUNT];
+		for (auto& thread: threads)
+		{
+			thread = std::thread([&]{
+				for (size_t i = 0; i < OPS_COUNT; ++i)
+				{
+					mn::async_io_file_read(io, file, mn::Block{buffer, 7}, 0, mn::async_io_callback([&](const mn::Async_IO_Completion& c) {
+						read_bytes.fetch_add(size_t(c.result));
+					}));
+					if (i % 16 == 0)
+						mn::async_io_submit(io);
+				}
+				mn::async_io_submit(io);
+			});
+		}
+		for (auto& thread: threads)
+			thread.join();
+
+		mn::worker_block_on([&]{ return mn::async_io_pending(io) == 0; });
+		CHECK(read_bytes == THREADS_COUNT * OPS_COUNT * 7);
+		mn::async_io_free(io);
+	}
+}
+
+TEST_CASE("async io socket multishot accept")
+{
+	auto f = mn::fabric_new({});
+	mn_defer(mn::fabric_free(f));
+
+	for (bool force_fallback: {false, true})
+	{
+		mn::Async_IO_Settings settings{};
+		settings.force_fallback = force_fallback;
+		auto io = mn::async_io_new(f, settings);
+		auto port = force_fallback ? "4819" : "4818";
+
+		auto listener = mn::socket_open(mn::SOCKET_FAMILY_IPV4, mn::SOCKET_TYPE_TCP);
+		REQUIRE(listener != nullptr);
+		REQUIRE(mn::socket_bind(listener, port));
+		REQUIRE(mn::socket_listen(listener));
+
+		// each accepted connection reads a message then echoes it back
+		std::atomic<size_t> accepted = 0;
+		std::atomic<size_t> reads_cancelled = 0;
+		std::atomic<bool> accept_done = false;
+		mn::async_io_socket_accept(io, listener, true, mn::async_io_callback([&](const mn::Async_IO_Completion& c) {
+			if (c.more == false)
+				accept_done = true;
+			if (c.socket == nullptr)
+				return;
+			accepted.fetch_add(1);
+
+			auto socket = c.socket;
+			auto buffer = mn::alloc(8, alignof(char));
+			mn::async_io_socket_read(io, socket, buffer, mn::async_io_callback([io, socket, buffer, &reads_cancelled](const mn::Async_IO_Completion& r) {
+				if (r.result == -ECANCELED)
+					reads_cancelled.fetch_add(1);
+				if (r.result <= 0)
+				{
+					mn::socket_close(socket);
+					mn::free(buffer);
+					return;
+				}
+				mn::async_io_socket_write(io, socket, mn::Block{buffer.ptr, size_t(r.result)}, mn::async_io_callback([socket, buffer](const mn::Async_IO_Completion&) {
+					mn::socket_close(socket);
+					mn::free(buffer);
+				}));
+				mn::async_io_submit(io);
+			}));
+			mn::async_io_submit(io);
+		}));
+		mn::async_io_submit(io);
+
+		constexpr size_t CLIENTS_COUNT = 8;
+		size_t echoed = 0;
+		for (size_t i = 0; i < CLIENTS_COUNT; ++i)
+		{
+			auto client = mn::socket_open(mn::SOCKET_FAMILY_IPV4, mn::SOCKET_TYPE_TCP);
+			REQUIRE(client != nullptr);
+			REQUIRE(mn::socket_connect(client, "localhost", port));
+			mn::socket_write(client, mn::block_lit("mostafa"));
+			char buffer[8] = {};
+			auto [read_bytes, err] = mn::socket_read(client, mn::Block{buffer, 7}, {10000});
+			echoed += err == mn::MN_SOCKET_ERROR_OK && read_bytes == 7 && ::strcmp(buffer, "mostafa") == 0;
+			mn::socket_close(client);
+		}
+		CHECK(echoed == CLIENTS_COUNT);
+		CHECK(accepted == CLIENTS_COUNT);
+
+		// an idle connection leaves its read in flight
+		auto idle_client = mn::socket_open(mn::SOCKET_FAMILY_IPV4, mn::SOCKET_TYPE_TCP);
+		REQUIRE(idle_client != nullptr);
+		REQUIRE(mn::socket_connect(idle_client, "localhost", port));
+		while (accepted < CLIENTS_COUNT + 1)
+			std::this_thread::yield();
+
+		// freeing the engine cancels the multishot accept and the idle read
+		mn::async_io_free(io);
+		CHECK(accept_done == true);
+		CHECK(reads_cancelled == 1);
+		mn::socket_close(idle_client);
+		mn::socket_close(listener);
+	}
+}
+
+TEST_CASE("async io batched file read benchmark")
+{
+	auto f = mn::fabric_new({});
+	mn_defer(mn::fabric_free(f));
+
+	constexpr size_t FILE_SIZE = 16 * 1024 * 1024;
+	constexpr size_t BLOCK_SIZE = 4096;
+	constexpr size_t READS_COUNT = 1024;
+
+	auto filename = mn::file_tmp(mn::str_lit(""), mn::str_lit("bin"), mn::memory::tmp());
+	auto file = mn::file_open(filename.ptr, mn::IO_MODE_READ_WRITE, mn::OPEN_MODE_CREATE_OVERWRITE);
+	REQUIRE(file != nullptr);
+	mn_defer({
+		mn::file_close(file);
+		mn::file_remove(filename);
+	});
+
+	auto data = mn::buf_with_count<uint8_t>(FILE_SIZE);
+	mn_defer(mn::buf_free(data));
+	for (size_t i = 0; i < data.count; ++i)
+		data[i] = uint8_t(i * 31);
+	REQUIRE(mn::file_write(file, mn::Block{data.ptr, data.count}) == data.count);
+
+	auto offsets = mn::buf_with_count<int64_t>(READS_COUNT);
+	mn_defer(mn::buf_free(offsets));
+	uint64_t state = 0x9E3779B97F4A7C15;
+	for (auto& offset: offsets)
+	{
+		state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+		offset = int64_t((state % (FILE_SIZE / BLOCK_SIZE)) * BLOCK_SIZE);
+	}
+
+	auto buffer = mn::buf_with_count<uint8_t>(READS_COUNT * BLOCK_SIZE);
+	mn_defer(mn::buf_free(buffer));
+
+	ankerl::nanobench::Bench bench;
+	bench.batch(READS_COUNT).unit("read");
+
+	bench.run("file_read 4KB random reads", [&]{
+		for (size_t i = 0; i < READS_COUNT; ++i)
+		{
+			mn::file_cursor_set(file, offsets[i]);
+			mn::file_read(file, mn::Block{buffer.ptr + i * BLOCK_SIZE, BLOCK_SIZE});
+		}
+		ankerl::nanobench::doNotOptimizeAway(buffer.ptr);
+	});
+
+	for (bool force_fallback: {false, true})
+	{
+		mn::Async_IO_Settings settings{};
+		settings.force_fallback = force_fallback;
+		auto io = mn::async_io_new(f, settings);
+		mn_defer(mn::async_io_free(io));
+
+		std::atomic<size_t> read_bytes = 0;
+		auto name = mn::async_io_is_native(io) ? "async io (io_uring) 4KB random reads" : "async io (fallback) 4KB random reads";
+		bench.run(name, [&]{
+			read_bytes = 0;
+			for (size_t i = 0; i < READS_COUNT; ++i)
+			{
+				mn::async_io_file_read(io, file, mn::Block{buffer.ptr + i * BLOCK_SIZE, BLOCK_SIZE}, offsets[i], mn::async_io_callback([&](const mn::Async_IO_Completion& c) {
+					if (c.result > 0)
+						read_bytes.fetch_add(c.result);
+				}));
+			}
+			mn::async_io_submit(io);
+			mn::worker_block_on([&]{ return mn::async_io_pending(io) == 0; });
+		});
+		CHECK(read_bytes == READS_COUNT * BLOCK_SIZE);
+	}
+}
+
+TEST_CASE("Memory_Stream general case")
+{
+	auto mem = mn::memory_stream_new();
+	CHECK(mn::memory_stream_size(mem) == 0);
+	CHECK(mn::memory_stream_cursor_pos(mem) == 0);
+	mn::memory_stream_write(mem, mn::block_lit("Mostafa"));
+	CHECK(mn::memory_stream_size(mem) == 7);
+	CHECK(mn::memory_stream_cursor_pos(mem) == 7);
+
+	char name[8] = { 0 };
+	CHECK(mn::memory_stream_read(mem, mn::block_from(name)) == 0);
+	CHECK(mn::memory_stream_cursor_pos(mem) == 7);
+
+	mn::memory_stream_cursor_to_start(mem);
+	CHECK(mn::memory_stream_cursor_pos(mem) == 0);
+
+	CHECK(mn::memory_stream_read(mem, mn::block_from(name)) == 7);
+	CHECK(mn::memory_stream_cursor_pos(mem) == 7);
+
+	CHECK(::strcmp(name, "Mostafa") == 0);
+	mn::memory_stream_free(mem);
+}
+
+TEST_CASE("virtual memory allocation")
+{
+	size_t size = 1ULL * 1024ULL * 1024ULL * 1024ULL;
+	auto block = mn::virtual_alloc(nullptr, size);
+	CHECK(block.ptr != nullptr);
+	CHECK(block.size == size);
+	mn::virtual_free(block);
+}
+
+TEST_CASE("reads")
+{
+	int a, b;
+	float c, d;
+	auto e = mn::str_new();
+	size_t read_count = mn::reads("-123 20 1.23 0.123 Mostafa ", a, b, c, d, e);
+	CHECK(read_count == 5);
+	CHECK(a == -123);
+	CHECK(b == 20);
+	CHECK(c == 1.23f);
+	CHECK(d == 0.123f);
+	CHECK(e == "Mostafa");
+	mn::str_free(e);
+}
+
+TEST_CASE("reader")
+{
+	auto reader = mn::reader_wrap_str(nullptr, mn::str_lit("Mostafa Saad"));
+	auto str = mn::str_new();
+	size_t read_count = mn::readln(reader, str);
+	CHECK(read_count == 12);
+	CHECK(str == "Mostafa Saad");
+
+	mn::str_free(str);
+	mn::reader_free(reader);
+}
+
+TEST_CASE("reader with empty newline")
+{
+	auto text = R"""(my name is mostafa
+
+mostafa is 26 years old)""";
+	auto reader = mn::reader_wrap_str(nullptr, text);
+	auto str = mn::str_new();
+
+	size_t read_count = mn::readln(reader, str);
+	CHECK(read_count == 19);
+	CHECK(str == "my name is mostafa");
+
+	read_count = mn::readln(reader, str);
+	CHECK(read_count == 1);
+	CHECK(str == "");
+
+	read_count = mn::readln(reader, str);
+	CHECK(read_count == 23);
+	CHECK(str == "mostafa is 26 years old");
+
+	mn::str_free(str);
+	mn::reader_free(reader);
+}
+
+TEST_CASE("reader after the end")
+{
+	auto reader = mn::reader_str(mn::str_lit("41 42 43"));
+	mn_defer(mn::reader_free(reader));
+
+	int a = 0, b = 0, c = 0;
+	CHECK(mn::vreads(reader, a, b, c) == 3);
+	CHECK(a == 41);
+	CHECK(b == 42);
+	CHECK(c == 43);
+
+	// the consumed data shouldn't be parsed again
+	int d = -1;
+	CHECK(mn::vreads(reader, d) == 0);
+	CHECK(d == -1);
+	CHECK(mn::reader_peek(reader, 0).size == 0);
+}
+
+static void
+write_test_file(const mn::Str& filename, mn::Block data)
+{
+	auto file = mn::file_open(filename, mn::IO_MODE_WRITE, mn::OPEN_MODE_CREATE_OVERWRITE);
+	REQUIRE(file != nullptr);
+	mn_defer(mn::file_close(file));
+	REQUIRE(mn::file_write(file, data) == data.size);
+}
+
+TEST_CASE("mapped reader")
+{
+	auto filename = mn::file_tmp(mn::str_lit(""), mn::str_lit("txt"), mn::memory::tmp());
+	mn_defer(mn::file_remove(filename));
+
+	SUBCASE("lines")
+	{
+		write_test_file(filename, mn::block_from(mn::str_lit("first line\r\nsecond line\n\nlast line")));
+		auto reader = mn::reader_mapped(filename);
+		REQUIRE(reader != nullptr);
+		mn_defer(mn::reader_free(reader));
+
+		mn::Block line{};
+		CHECK(mn::readln_view(reader, line) == 12);
+		CHECK(mn::str_from_substr((char*)line.ptr, (char*)line.ptr + line.size, mn::memory::tmp()) == "first line");
+
+		auto str = mn::str_tmp();
+		CHECK(mn::readln(reader, str) == 12);
+		CHECK(str == "second line");
+
+		CHECK(mn::readln_view(reader, line) == 1);
+		CHECK(line.size == 0);
+
+		CHECK(mn::reader_progress(reader) < 1.0f);
+		CHECK(mn::readln_view(reader, line) == 9);
+		CHECK(mn::str_from_substr((char*)line.ptr, (char*)line.ptr + line.size, mn::memory::tmp()) == "last line");
+		CHECK(mn::reader_progress(reader) == 1.0f);
+
+		CHECK(mn::readln_view(reader, line) == 0);
+		CHECK(mn::readln(reader, str) == 0);
+	}
+
+	SUBCASE("numbers at the end of a page")
+	{
+		// the file size is a multiple of the page size, and it ends with a number so parsing it can't scan past the
+		// end of the mapping
+		auto content = mn::str_tmp();
+		while (content.count < 4096 - 6)
+			mn::str_push(content, "7 ");
+		while (content.count < 4096)
+			mn::str_push(content, "9");
+		write_test_file(filename, mn::block_from(content));
+
+		auto reader = mn::reader_mapped(filename);
+		REQUIRE(reader != nullptr);
+		mn_defer(mn::reader_free(reader));
+
+		size_t sevens = 0;
+		int value = 0;
+		while (mn::vreads(reader, value) == 1 && value == 7)
+			++sevens;
+		CHECK(sevens == (4096 - 6) / 2);
+		CHECK(value == 999999);
+		CHECK(mn::reader_consumed(reader) == 4096);
+	}
+
+	SUBCASE("read")
+	{
+		write_test_file(filename, mn::block_from(mn::str_lit("0123456789")));
+		auto reader = mn::reader_mapped(filename);
+		REQUIRE(reader != nullptr);
+		mn_defer(mn::reader_free(reader));
+
+		char buffer[4];
+		CHECK(mn::reader_read(reader, mn::block_from(buffer)) == 4);
+		CHECK(::memcmp(buffer, "0123", 4) == 0);
+		CHECK(mn::reader_skip(reader, 2) == 2);
+		CHECK(mn::reader_read(reader, mn::block_from(buffer)) == 4);
+		CHECK(::memcmp(buffer, "6789", 4) == 0);
+		CHECK(mn::reader_read(reader, mn::block_from(buffer)) == 0);
+	}
+
+	SUBCASE("empty and missing files")
+	{
+		write_test_file(filename, mn::Block{});
+		auto reader = mn::reader_mapped(filename);
+		REQUIRE(reader != nullptr);
+		mn_defer(mn::reader_free(reader));
+
+		mn::Block line{};
+		CHECK(mn::readln_view(reader, line) == 0);
+		CHECK(mn::reader_progress(reader) == 0.0f);
+
+		CHECK(mn::reader_mapped(mn::str_tmpf("{}.missing", filename)) == nullptr);
+	}
+}
+
+TEST_CASE("mapped reader benchmark")
+{
+	auto filename = mn::file_tmp(mn::str_lit(""), mn::str_lit("txt"), mn::memory::tmp());
+	mn_defer(mn::file_remove(filename));
+
+	auto content = mn::str_new();
+	mn_defer(mn::str_free(content));
+	size_t lines_count = 0;
+	while (content.count < 16 * 1024 * 1024)
+	{
+		mn::str_push(content, "the quick brown fox jumps over the lazy dog ");
+		mn::str_push(content, mn::str_tmpf("{}\n", lines_count++));
+	}
+	write_test_file(filename, mn::block_from(content));
+
+	ankerl::nanobench::Bench bench;
+	bench.batch(content.count).unit("byte").minEpochIterations(2);
+
+	auto line = mn::str_new();
+	mn_defer(mn::str_free(line));
+
+	size_t count = 0;
+	bench.run("stream reader readln 16MB", [&]{
+		count = 0;
+		auto file = mn::file_open(filename, mn::IO_MODE_READ, mn::OPEN_MODE_OPEN_ONLY);
+		auto reader = mn::reader_new(file);
+		while (mn::readln(reader, line))
+			++count;
+		mn::reader_free(reader);
+		mn::file_close(file);
+	});
+	CHECK(count == lines_count);
+
+	bench.run("mapped reader readln 16MB", [&]{
+		count = 0;
+		auto reader = mn::reader_mapped(filename);
+		while (mn::readln(reader, line))
+			++count;
+		mn::reader_free(reader);
+	});
+	CHECK(count == lines_count);
+
+	bench.run("mapped reader readln_view 16MB", [&]{
+		count = 0;
+		auto reader = mn::reader_mapped(filename);
+		mn::Block view{};
+		while (mn::readln_view(reader, view))
+			++count;
+		mn::reader_free(reader);
+	});
+	CHECK(count == lines_count);
+}
+
+TEST_CASE("virtual memory mirrored block")
+{
+	auto block = mn::virtual_alloc_mirrored(100);
+	REQUIRE(block.ptr != nullptr);
+	mn_defer(mn::virtual_free_mirrored(block));
+	CHECK(block.size >= 100);
+
+	auto ptr = (char*)block.ptr;
+	ptr[0] = 'a';
+	ptr[block.size - 1] = 'z';
+	CHECK(ptr[block.size] == 'a');
+	ptr[block.size + 1] = 'b';
+	CHECK(ptr[1] == 'b');
+	CHECK(ptr[2 * block.size - 1] == 'z');
+}
+
+TEST_CASE("ring reader")
+{
+	// lines of different sizes so that they wrap around the ring at different offsets
+	auto content = mn::str_new();
+	mn_defer(mn::str_free(content));
+	size_t lines_count = 0;
+	while (content.count < 64 * 1024)
+	{
+		mn::str_push(content, mn::str_tmpf("{} ", lines_count));
+		for (size_t i = 0; i < lines_count % 97; ++i)
+			mn::str_push(content, "x");
+		mn::str_push(content, "\n");
+		++lines_count;
+	}
+
+	for (bool disable_mirroring: {false, true})
+	{
+		auto stream = mn::memory_stream_new();
+		mn_defer(mn::memory_stream_free(stream));
+		mn::memory_stream_write(stream, mn::block_from(content));
+		mn::memory_stream_cursor_to_start(stream);
+
+		mn::Reader_Ring_Settings settings{};
+		settings.capacity = 4096;
+		settings.disable_mirroring = disable_mirroring;
+		auto reader = mn::reader_ring_new(stream, settings);
+		mn_defer(mn::reader_free(reader));
+
+		auto line = mn::str_tmp();
+		size_t count = 0;
+		size_t number = 0;
+		while (mn::readln(reader, line))
+		{
+			CHECK(mn::reads(line, number) == 1);
+			CHECK(number == count);
+			CHECK(line.count == mn::str_tmpf("{} ", count).count + count % 97);
+			++count;
+		}
+		CHECK(count == lines_count);
+		CHECK(mn::reader_consumed(reader) == content.count);
+
+		// peeks are bounded by the ring's capacity
+		mn::memory_stream_cursor_to_start(stream);
+		auto bytes = mn::reader_peek(reader, 1024 * 1024);
+		CHECK(bytes.size < 1024 * 1024);
+		CHECK(::memcmp(bytes.ptr, content.ptr, bytes.size) == 0);
+
+		// reads bigger than the buffer go to the stream directly
+		auto data = mn::buf_with_count<char>(content.count);
+		mn_defer(mn::buf_free(data));
+		size_t read_size = 0;
+		while (read_size < data.count)
+		{
+			auto res = mn::reader_read(reader, mn::Block{data.ptr + read_size, data.count - read_size});
+			if (res == 0)
+				break;
+			read_size += res;
+		}
+		CHECK(read_size == content.count);
+		CHECK(::memcmp(data.ptr, content.ptr, content.count) == 0);
+	}
+}
+
+TEST_CASE("ring reader benchmark")
+{
+	auto content = mn::str_new();
+	mn_defer(mn::str_free(content));
+	while (content.count < 8 * 1024 * 1024)
+		mn::str_push(content, "the quick brown fox jumps over the lazy dog 1234567890\n");
+
+	auto stream = mn::memory_stream_new();
+	mn_defer(mn::memory_stream_free(stream));
+	mn::memory_stream_write(stream, mn::block_from(content));
+
+	ankerl::nanobench::Bench bench;
+	bench.batch(content.count).unit("byte").minEpochIterations(2);
+
+	// a tokenizer which peeks a little ahead of what it consumes, so the reader never consumes all of its buffer
+	auto peek_ahead = [&](mn::Reader reader) {
+		size_t consumed = 0;
+		while (true)
+		{
+			auto bytes = mn::reader_peek(reader, 64);
+			if (bytes.size == 0)
+				break;
+			consumed += mn::reader_skip(reader, bytes.size < 32 ? bytes.size : 32);
+		}
+		return consumed;
+	};
+
+	size_t consumed = 0;
+	bench.run("reader_new peek ahead 8MB", [&]{
+		mn::memory_stream_cursor_to_start(stream);
+		auto reader = mn::reader_new(stream);
+		consumed = peek_ahead(reader);
+		mn::reader_free(reader);
+	});
+	CHECK(consumed == content.count);
+
+	bench.run("reader_ring_new peek ahead 8MB", [&]{
+		mn::memory_stream_cursor_to_start(stream);
+		auto reader = mn::reader_ring_new(stream);
+		consumed = peek_ahead(reader);
+		mn::reader_free(reader);
+	});
+	CHECK(consumed == content.count);
+
+	mn::Reader_Ring_Settings settings{};
+	settings.disable_mirroring = true;
+	bench.run("reader_ring_new (not mirrored) peek ahead 8MB", [&]{
+		mn::memory_stream_cursor_to_start(stream);
+		auto reader = mn::reader_ring_new(stream, settings);
+		consumed = peek_ahead(reader);
+		mn::reader_free(reader);
+	});
+	CHECK(consumed == content.count);
+}
+
+TEST_CASE("path windows os encoding")
+{
+	auto os_path = mn::path_os_encoding("C:/bin/my_file.exe");
+
+	#if OS_WINDOWS
+		CHECK(os_path == "C:\\bin\\my_file.exe");
+	#endif
+
+	mn::str_free(os_path);
+}
+
+TEST_CASE("file copy and parallel folder copy")
+{
+	auto root = mn::file_tmp(mn::str_lit(""), mn::str_lit("dir"), mn::memory::tmp());
+	REQUIRE(mn::folder_make(root));
+	mn_defer(mn::folder_remove(root));
+
+	auto src = mn::path_join(mn::str_tmp(), root, "src");
+	REQUIRE(mn::folder_make(src));
+	REQUIRE(mn::folder_make(mn::path_join(mn::str_tmp(), src, "nested")));
+	REQUIRE(mn::folder_make(mn::path_join(mn::str_tmp(), src, "nested", "deep")));
+
+	auto big = mn::buf_with_count<uint8_t>(3 * 1024 * 1024 + 17);
+	mn_defer(mn::buf_free(big));
+	for (size_t i = 0; i < big.count; ++i)
+		big[i] = uint8_t(i * 31 + 7);
+
+	const char* names[] = {"a.txt", "empty.txt", "nested/b.txt", "nested/deep/big.bin"};
+	write_test_file(mn::path_join(mn::str_tmp(), src, names[0]), mn::block_from(mn::str_lit("hello")));
+	write_test_file(mn::path_join(mn::str_tmp(), src, names[1]), mn::Block{});
+	write_test_file(mn::path_join(mn::str_tmp(), src, names[2]), mn::block_from(mn::str_lit("nested file")));
+	write_test_file(mn::path_join(mn::str_tmp(), src, names[3]), mn::Block{big.ptr, big.count});
+
+	SUBCASE("file copy")
+	{
+		auto a_copy = mn::path_join(mn::str_tmp(), root, "a_copy.txt");
+		CHECK(mn::file_copy(mn::path_join(mn::str_tmp(), src, names[0]), a_copy));
+		auto content = mn::file_content_str(a_copy, mn::memory::tmp());
+		CHECK(content == "hello");
+		// the destination should not be overwritten
+		CHECK(mn::file_copy(mn::path_join(mn::str_tmp(), src, names[3]), a_copy) == false);
+
+		auto big_copy = mn::path_join(mn::str_tmp(), root, "big_copy.bin");
+		CHECK(mn::file_copy(mn::path_join(mn::str_tmp(), src, names[3]), big_copy));
+		auto big_content = mn::file_content_str(big_copy, mn::memory::tmp());
+		REQUIRE(big_content.count == big.count);
+		CHECK(::memcmp(big_content.ptr, big.ptr, big.count) == 0);
+
+		CHECK(mn::file_copy(mn::path_join(mn::str_tmp(), src, "missing.txt"), mn::path_join(mn::str_tmp(), root, "missing.txt")) == false);
+	}
+
+	SUBCASE("parallel folder copy")
+	{
+		mn::Fabric_Settings settings{};
+		settings.workers_count = 3;
+		auto f = mn::fabric_new(settings);
+		mn_defer(mn::fabric_free(f));
+
+		auto dst = mn::path_join(mn::str_tmp(), root, "dst");
+		mn::Folder_Copy_Progress last{};
+		size_t calls = 0;
+		CHECK(mn::folder_copy(src, dst, f, [&](const mn::Folder_Copy_Progress& progress) {
+			CHECK(progress.files_copied == calls + 1);
+			++calls;
+			last = progress;
+		}));
+
+		CHECK(calls == 4);
+		CHECK(last.files_count == 4);
+		CHECK(last.files_copied == 4);
+		CHECK(last.bytes_count == int64_t(5 + 11 + big.count));
+		CHECK(last.bytes_copied == last.bytes_count);
+
+		CHECK(mn::file_content_str(mn::path_join(mn::str_tmp(), dst, names[0]), mn::memory::tmp()) == "hello");
+		CHECK(mn::file_content_str(mn::path_join(mn::str_tmp(), dst, names[1]), mn::memory::tmp()).count == 0);
+		CHECK(mn::file_content_str(mn::path_join(mn::str_tmp(), dst, names[2]), mn::memory::tmp()) == "nested file");
+		auto big_content = mn::file_content_str(mn::path_join(mn::str_tmp(), dst, names[3]), mn::memory::tmp());
+		REQUIRE(big_content.count == big.count);
+		CHECK(::memcmp(big_content.ptr, big.ptr, big.count) == 0);
+
+		// copying into an existing tree fails because files are never overwritten
+		CHECK(mn::folder_copy(src, dst, f) == false);
+	}
+
+#if OS_LINUX
+	SUBCASE("parallel folder copy with links")
+	{
+		mn::Fabric_Settings settings{};
+		settings.workers_count = 3;
+		auto f = mn::fabric_new(settings);
+		mn_defer(mn::fabric_free(f));
+
+		auto file_link = mn::path_join(mn::str_tmp(), src, "file_link");
+		auto folder_link = mn::path_join(mn::str_tmp(), src, "folder_link");
+		auto broken_link = mn::path_join(mn::str_tmp(), src, "broken_link");
+		REQUIRE(::symlink("a.txt", file_link.ptr) == 0);
+		REQUIRE(::symlink("nested", folder_link.ptr) == 0);
+		REQUIRE(::symlink("missing.txt", broken_link.ptr) == 0);
+		mn_defer({
+			::unlink(file_link.ptr);
+			::unlink(folder_link.ptr);
+			::unlink(broken_link.ptr);
+		});
+
+		auto dst = mn::path_join(mn::str_tmp(), root, "dst_links");
+		mn::Folder_Copy_Progress last{};
+		CHECK(mn::folder_copy(src, dst, f, [&](const mn::Folder_Copy_Progress& progress) { last = progress; }));
+
+		// the links are copied as the files/folders they point to
+		CHECK(last.files_count == 7);
+		CHECK(last.files_copied == 7);
+		CHECK(last.bytes_count == int64_t(2 * (5 + 11 + big.count)));
+		CHECK(last.bytes_copied == last.bytes_count);
+		CHECK(mn::file_content_str(mn::path_join(mn::str_tmp(), dst, "file_link"), mn::memory::tmp()) == "hello");
+		CHECK(mn::file_content_str(mn::path_join(mn::str_tmp(), dst, "folder_link", "b.txt"), mn::memory::tmp()) == "nested file");
+		CHECK(mn::path_is_file(mn::path_join(mn::str_tmp(), dst, "folder_link", "deep", "big.bin")));
+		CHECK(mn::path_exists(mn::path_join(mn::str_tmp(), dst, "broken_link")) == false);
+
+		// a link to one of its own parent folders can't be followed
+		auto cycle_link = mn::path_join(mn::str_tmp(), src, "nested", "cycle_link");
+		REQUIRE(::symlink("..", cycle_link.ptr) == 0);
+		mn_defer(::unlink(cycle_link.ptr));
+		CHECK(mn::folder_copy(src, mn::path_join(mn::str_tmp(), root, "dst_cycle"), f) == false);
+
+		// links which point to each other's folders are a cycle too
+		auto mutual = mn::path_join(mn::str_tmp(), root, "mutual");
+		REQUIRE(mn::folder_make(mutual));
+		REQUIRE(mn::folder_make(mn::path_join(mn::str_tmp(), mutual, "a")));
+		REQUIRE(mn::folder_make(mn::path_join(mn::str_tmp(), mutual, "b")));
+		auto a_link = mn::path_join(mn::str_tmp(), mutual, "a", "l1");
+		auto b_link = mn::path_join(mn::str_tmp(), mutual, "b", "l2");
+		REQUIRE(::symlink("../b", a_link.ptr) == 0);
+		REQUIRE(::symlink("../a", b_link.ptr) == 0);
+		mn_defer({
+			::unlink(a_link.ptr);
+			::unlink(b_link.ptr);
+		});
+		CHECK(mn::folder_copy(mutual, mn::path_join(mn::str_tmp(), root, "dst_mutual"), f) == false);
+	}
+#endif
+}
+
+TEST_CASE("file copy benchmark")
+{
+	constexpr size_t FILE_SIZE = 32 * 1024 * 1024;
+
+	auto root = mn::file_tmp(mn::str_lit(""), mn::str_lit("dir"), mn::memory::tmp());
+	REQUIRE(mn::folder_make(root));
+	mn_defer(mn::folder_remove(root));
+
+	auto data = mn::buf_with_count<uint8_t>(FILE_SIZE);
+	mn_defer(mn::buf_free(data));
+	mn::buf_fill(data, uint8_t(42));
+
+	auto src = mn::path_join(mn::str_tmp(), root, "src.bin");
+	auto dst = mn::path_join(mn::str_tmp(), root, "dst.bin");
+	write_test_file(src, mn::Block{data.ptr, data.count});
+
+	ankerl::nanobench::Bench bench;
+	bench.batch(FILE_SIZE).unit("byte");
+
+	bench.run("4KB read/write loop 32MB", [&]{
+		mn::file_remove(dst);
+		auto in = mn::file_open(src, mn::IO_MODE_READ, mn::OPEN_MODE_OPEN_ONLY);
+		auto out = mn::file_open(dst, mn::IO_MODE_WRITE, mn::OPEN_MODE_CREATE_ONLY);
+		char buffer[4096];
+		while (true)
+		{
+			auto nread = mn::file_read(in, mn::block_from(buffer));
+			if (nread == 0 || nread == size_t(-1))
+				break;
+			mn::file_write(out, mn::Block{buffer, nread});
+		}
+		mn::file_close(out);
+		mn::file_close(in);
+	});
+
+	bench.run("file_copy 32MB", [&]{
+		mn::file_remove(dst);
+		mn::file_copy(src, dst);
+	});
+
+	CHECK(mn::file_content_str(dst, mn::memory::tmp()).count == FILE_SIZE);
+}
+
+// creates a tree of the given folders count, each folder has the given files count and a nested folder with a
+// single file, and returns the total count of entries
+static size_t
+make_test_tree(const mn::Str& root, size_t folders_count, size_t files_count)
+{
+	size_t res = 0;
+	for (size_t i = 0; i < folders_count; ++i)
+	{
+		auto folder = mn::path_join(mn::str_tmp(), root, mn::str_tmpf("folder_{}", i));
+		REQUIRE(mn::folder_make(folder));
+		++res;
+		for (size_t j = 0; j < files_count; ++j)
+		{
+			write_test_file(mn::path_join(mn::str_tmp(), folder, mn::str_tmpf("file_{}.txt", j)), mn::block_from(mn::str_lit("content")));
+			++res;
+		}
+		auto nested = mn::path_join(mn::str_tmp(), folder, "nested");
+		REQUIRE(mn::folder_make(nested));
+		write_test_file(mn::path_join(mn::str_tmp(), nested, "deep.txt"), mn::block_from(mn::str_lit("deep")));
+		res += 2;
+	}
+	return res;
+}
+
+TEST_CASE("path walker")
+{
+	auto root = mn::file_tmp(mn::str_lit(""), mn::str_lit("dir"), mn::memory::tmp());
+	REQUIRE(mn::folder_make(root));
+	mn_defer(mn::folder_remove(root));
+	auto entries_count = make_test_tree(root, 4, 3);
+
+	CHECK(mn::path_walker_new(mn::path_join(mn::str_tmp(), root, "missing")) == nullptr);
+
+	SUBCASE("depth first")
+	{
+		mn::Path_Walk_Settings settings{};
+		settings.stat = true;
+		auto walker = mn::path_walker_new(root, settings);
+		REQUIRE(walker != nullptr);
+		mn_defer(mn::path_walker_free(walker));
+
+		size_t count = 0;
+		auto folders = mn::set_new<mn::Str>();
+		mn_defer(mn::destruct(folders));
+		mn::set_insert(folders, mn::str_from_c(root.ptr));
+		mn::Path_Walk_Entry entry{};
+		while (mn::path_walker_next(walker, entry))
+		{
+			++count;
+			CHECK(entry.has_stat);
+			CHECK(mn::str_suffix(mn::str_lit(entry.path), entry.name));
+			// a folder is reported before its content
+			CHECK(mn::set_lookup(folders, mn::file_directory(entry.path, mn::memory::tmp())) != nullptr);
+			if (entry.kind == mn::PATH_WALK_KIND_FOLDER)
+			{
+				mn::set_insert(folders, mn::str_from_c(entry.path));
+			}
+			else
+			{
+				CHECK(entry.kind == mn::PATH_WALK_KIND_FILE);
+				CHECK(entry.size == (entry.depth == 2 ? 7 : 4));
+			}
+		}
+		CHECK(count == entries_count);
+	}
+
+	SUBCASE("breadth first with skip")
+	{
+		mn::Path_Walk_Settings settings{};
+		settings.order = mn::PATH_WALK_ORDER_BREADTH_FIRST;
+		auto walker = mn::path_walker_new(root, settings);
+		REQUIRE(walker != nullptr);
+		mn_defer(mn::path_walker_free(walker));
+
+		size_t count = 0;
+		size_t depth = 0;
+		mn::Path_Walk_Entry entry{};
+		while (mn::path_walker_next(walker, entry))
+		{
+			++count;
+			CHECK(entry.has_stat == false);
+			CHECK(entry.depth >= depth);
+			depth = entry.depth;
+			if (entry.kind == mn::PATH_WALK_KIND_FOLDER && ::strcmp(entry.name, "nested") == 0)
+				mn::path_walker_skip(walker);
+		}
+		CHECK(depth == 2);
+		CHECK(count == entries_count - 4);
+	}
+
+	SUBCASE("max depth")
+	{
+		mn::Path_Walk_Settings settings{};
+		settings.max_depth = 1;
+		auto walker = mn::path_walker_new(root, settings);
+		REQUIRE(walker != nullptr);
+		mn_defer(mn::path_walker_free(walker));
+
+		size_t count = 0;
+		mn::Path_Walk_Entry entry{};
+		while (mn::path_walker_next(walker, entry))
+		{
+			++count;
+			CHECK(entry.depth == 1);
+			CHECK(entry.kind == mn::PATH_WALK_KIND_FOLDER);
+		}
+		CHECK(count == 4);
+	}
+
+	SUBCASE("parallel")
+	{
+		mn::Fabric_Settings fabric_settings{};
+		fabric_settings.workers_count = 3;
+		auto f = mn::fabric_new(fabric_settings);
+		mn_defer(mn::fabric_free(f));
+
+		std::atomic<size_t> count = 0;
+		std::atomic<size_t> deep_count = 0;
+		CHECK(mn::path_walk_parallel(root, f, [&](const mn::Path_Walk_Entry& entry) {
+			++count;
+			if (entry.depth == 3)
+				++deep_count;
+			return true;
+		}));
+		CHECK(count == entries_count);
+		CHECK(deep_count == 4);
+
+		count = 0;
+		CHECK(mn::path_walk_parallel(root, f, [&](const mn::Path_Walk_Entry& entry) {
+			++count;
+			return ::strcmp(entry.name, "nested") != 0;
+		}));
+		CHECK(count == entries_count - 4);
+
+		CHECK(mn::path_walk_parallel(mn::path_join(mn::str_tmp(), root, "missing"), f, [](const mn::Path_Walk_Entry&) { return true; }) == false);
+	}
+}
+
+static size_t
+path_entries_count_recursive(const mn::Str& path)
+{
+	size_t res = 0;
+	auto entries = mn::path_entries(path);
+	mn_defer(mn::destruct(entries));
+	for (const auto& entry: entries)
+	{
+		if (entry.name == "." || entry.name == "..")
+			continue;
+		++res;
+		if (entry.kind == mn::Path_Entry::KIND_FOLDER)
+		{
+			auto child = mn::path_join(mn::str_new(), path, entry.name);
+			mn_defer(mn::str_free(child));
+			res += path_entries_count_recursive(child);
+		}
+	}
+	return res;
+}
+
+TEST_CASE("path walker benchmark")
+{
+	auto root = mn::file_tmp(mn::str_lit(""), mn::str_lit("dir"), mn::memory::tmp());
+	REQUIRE(mn::folder_make(root));
+	mn_defer(mn::folder_remove(root));
+	auto entries_count = make_test_tree(root, 50, 100);
+
+	mn::Fabric_Settings fabric_settings{};
+	fabric_settings.workers_count = 4;
+	auto f = mn::fabric_new(fabric_settings);
+	mn_defer(mn::fabric_free(f));
+
+	ankerl::nanobench::Bench bench;
+	bench.batch(entries_count).unit("entry").minEpochIterations(3);
+
+	size_t count = 0;
+	bench.run("recursive path_entries", [&]{
+		count = path_entries_count_recursive(root);
+	});
+	CHECK(count == entries_count);
+
+	bench.run("path walker", [&]{
+		count = 0;
+		auto walker = mn::path_walker_new(root);
+		mn::Path_Walk_Entry entry{};
+		while (mn::path_walker_next(walker, entry))
+			++count;
+		mn::path_walker_free(walker);
+	});
+	CHECK(count == entries_count);
+
+	bench.run("path walker with stat", [&]{
+		count = 0;
+		mn::Path_Walk_Settings settings{};
+		settings.stat = true;
+		auto walker = mn::path_walker_new(root, settings);
+		mn::Path_Walk_Entry entry{};
+		while (mn::path_walker_next(walker, entry))
+			++count;
+		mn::path_walker_free(walker);
+	});
+	CHECK(count == entries_count);
+
+	std::atomic<size_t> parallel_count = 0;
+	bench.run("parallel path walk 4 workers", [&]{
+		parallel_count = 0;
+		mn::path_walk_parallel(root, f, [&](const mn::Path_Walk_Entry&) {
+			++parallel_count;
+			return true;
+		});
+	});
+	CHECK(parallel_count == entries_count);
+}
+
+TEST_CASE("Str_Intern general case")
+{
+	auto intern = mn::str_intern_new();
+
+	const char* is = mn::str_intern(intern, "Mostafa");
+	CHECK(is != nullptr);
+	CHECK(is == mn::str_intern(intern, "Mostafa"));
+
+	const char* big_str = "my name is Mostafa";
+	const char* begin = big_str + 11;
+	const char* end = begin + 7;
+	CHECK(is == mn::str_intern(intern, begin, end));
+
+	mn::str_intern_free(intern);
+}
+
+TEST_CASE("simple data ring case")
+{
+	mn::allocator_push(mn::memory::leak());
+
+	auto r = mn::ring_new<int>();
+
+	for (int i = 0; i < 10; ++i)
+		mn::ring_push_back(r, i);
+
+	for (size_t i = 0; i < r.count; ++i)
+		CHECK(r[i] == i);
+
+	for (int i = 0; i < 10; ++i)
+		mn::ring_push_front(r, i);
+
+	for (int i = 9; i >= 0; --i)
+	{
+		CHECK(mn::ring_back(r) == i);
+		mn::ring_pop_back(r);
+	}
+
+	for (int i = 9; i >= 0; --i)
+	{
+		CHECK(mn::ring_front(r) == i);
+		mn::ring_pop_front(r);
+	}
+
+	mn::ring_free(r);
+
+	mn::allocator_pop();
+}
+
+TEST_CASE("complex data ring case")
+{
+	mn::allocator_push(mn::memory::leak());
+	auto r = mn::ring_new<mn::Str>();
+
+	for (int i = 0; i < 10; ++i)
+		mn::ring_push_back(r, mn::str_from_c("Mostafa"));
+
+	for (int i = 0; i < 10; ++i)
+		mn::ring_push_front(r, mn::str_from_c("Saad"));
 
 	for (int i = 4; i >= 0; --i)
 	{
@@ -620,6 +3128,182 @@ TEST_CASE("Rune")
 	#endif
 }
 
+// a plain decoder which checks the decoded runes against the unicode ranges, it's the reference of the simd validator
+inline static bool
+naive_utf8_valid(const mn::Str& str)
+{
+	size_t i = 0;
+	while (i < str.count)
+	{
+		auto c = uint8_t(str.ptr[i]);
+		size_t size = 0;
+		mn::Rune r = 0;
+		if (c < 0x80) { size = 1; r = c; }
+		else if ((c & 0xE0) == 0xC0) { size = 2; r = c & 0x1F; }
+		else if ((c & 0xF0) == 0xE0) { size = 3; r = c & 0x0F; }
+		else if ((c & 0xF8) == 0xF0) { size = 4; r = c & 0x07; }
+		else return false;
+
+		if (i + size > str.count)
+			return false;
+		for (size_t j = 1; j < size; ++j)
+		{
+			auto cont = uint8_t(str.ptr[i + j]);
+			if ((cont & 0xC0) != 0x80)
+				return false;
+			r = (r << 6) | (cont & 0x3F);
+		}
+
+		const mn::Rune min_rune[] = {0, 0, 0x80, 0x800, 0x10000};
+		if (r < min_rune[size] || r > 0x10FFFF || (r >= 0xD800 && r <= 0xDFFF))
+			return false;
+		i += size;
+	}
+	return true;
+}
+
+TEST_CASE("rune simd")
+{
+	SUBCASE("utf8 validation")
+	{
+		const char* valid[] = {
+			"",
+			"hello world",
+			"مصطفى",
+			"PERCHÉa",
+			"\xE0\xA0\x80",
+			"\xED\x9F\xBF",
+			"\xEE\x80\x80",
+			"\xF0\x90\x80\x80",
+			"\xF4\x8F\xBF\xBF",
+			"the quick brown fox jumps over the lazy dog, the quick brown fox jumps over the lazy dog \xF0\x9F\x98\x80",
+		};
+		for (auto str: valid)
+			CHECK(mn::rune_utf8_valid(str, ::strlen(str)));
+
+		const char* invalid[] = {
+			"\x80",
+			"\xBF",
+			"\xC0\x80",
+			"\xC1\xBF",
+			"\xC2",
+			"\xE0\x80\x80",
+			"\xE0\x9F\xBF",
+			"\xED\xA0\x80",
+			"\xE1\x80",
+			"\xF0\x80\x80\x80",
+			"\xF0\x8F\xBF\xBF",
+			"\xF4\x90\x80\x80",
+			"\xF5\x80\x80\x80",
+			"\xFF",
+			"\xF0\x90\x80",
+			"the quick brown fox jumps over the lazy dog, the quick brown fox jumps over the lazy dog \xF0\x9F\x98",
+			"the quick brown fox jumps over \xC3 the lazy dog, the quick brown fox jumps over the lazy dog",
+		};
+		for (auto str: invalid)
+			CHECK(mn::rune_utf8_valid(str, ::strlen(str)) == false);
+	}
+
+	SUBCASE("random utf8")
+	{
+		std::mt19937 rng(42);
+		const mn::Rune ranges[][2] = {{0x20, 0x7E}, {0x80, 0x7FF}, {0x800, 0xD7FF}, {0xE000, 0xFFFF}, {0x10000, 0x10FFFF}};
+		auto str = mn::str_new();
+		mn_defer(mn::str_free(str));
+		for (size_t i = 0; i < 2000; ++i)
+		{
+			mn::str_clear(str);
+			auto runes_count = rng() % 100;
+			for (size_t j = 0; j < runes_count; ++j)
+			{
+				// mostly ascii runs so the ascii fast paths are exercised too
+				auto range = (rng() % 4 == 0) ? ranges[1 + rng() % 4] : ranges[0];
+				mn::str_push(str, mn::Rune(range[0] + rng() % (range[1] - range[0] + 1)));
+			}
+			CHECK(mn::str_utf8_valid(str));
+			CHECK(mn::str_rune_count(str) == runes_count);
+
+			// corrupt a byte sometimes
+			if (str.count > 0 && i % 2 == 0)
+				str.ptr[rng() % str.count] = char(rng() % 256);
+			CHECK(mn::str_utf8_valid(str) == naive_utf8_valid(str));
+
+			size_t expected_count = 0;
+			for (size_t j = 0; j < str.count; ++j)
+				expected_count += (str.ptr[j] & 0xC0) != 0x80;
+			CHECK(mn::str_rune_count(str) == expected_count);
+			CHECK(mn::rune_all_ascii(str.ptr, str.count) == std::all_of(begin(str), end(str), [](char c) { return uint8_t(c) < 0x80; }));
+		}
+	}
+
+	SUBCASE("case mapping")
+	{
+		auto text = mn::str_tmpf("{}", "The Quick Brown Fox Jumps Over The Lazy Dog [@`{] 0123456789 ");
+		auto mixed = mn::str_tmpf("{}PERCHÉ {}Æble {}", text, text, text);
+
+		auto lower = mn::str_from_c(mixed.ptr);
+		mn_defer(mn::str_free(lower));
+		mn::str_lower(lower);
+		CHECK(lower == mn::str_tmpf("{}perché {}æble {}", "the quick brown fox jumps over the lazy dog [@`{] 0123456789 ", "the quick brown fox jumps over the lazy dog [@`{] 0123456789 ", "the quick brown fox jumps over the lazy dog [@`{] 0123456789 "));
+
+		auto upper = mn::str_from_c(mixed.ptr);
+		mn_defer(mn::str_free(upper));
+		mn::str_upper(upper);
+		CHECK(upper == mn::str_tmpf("{}PERCHÉ {}ÆBLE {}", "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG [@`{] 0123456789 ", "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG [@`{] 0123456789 ", "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG [@`{] 0123456789 "));
+
+		auto empty = mn::str_new();
+		mn::str_upper(empty);
+		CHECK(empty.count == 0);
+		mn::str_free(empty);
+	}
+}
+
+TEST_CASE("rune simd benchmark")
+{
+	auto ascii = mn::str_new();
+	mn_defer(mn::str_free(ascii));
+	auto mixed = mn::str_new();
+	mn_defer(mn::str_free(mixed));
+	while (ascii.count < 16 * 1024 * 1024)
+		mn::str_push(ascii, "The Quick Brown Fox Jumps Over The Lazy Dog 0123456789\n");
+	while (mixed.count < 16 * 1024 * 1024)
+		mn::str_push(mixed, "The Quick Brown Fox مصطفى PERCHÉ Æble \xF0\x9F\x98\x80\n");
+
+	ankerl::nanobench::Bench bench;
+	bench.unit("byte").minEpochIterations(2);
+	for (auto [name, text]: {std::pair{"ascii", ascii}, std::pair{"mixed", mixed}})
+	{
+		bench.batch(text.count);
+
+		bench.run(mn::str_tmpf("scalar rune count {} 16MB", name).ptr, [&]{
+			size_t count = 0;
+			for (auto it = text.ptr; *it != '\0'; ++it)
+				count += ((*it & 0xC0) != 0x80);
+			ankerl::nanobench::doNotOptimizeAway(count);
+		});
+		bench.run(mn::str_tmpf("str_rune_count {} 16MB", name).ptr, [&]{
+			ankerl::nanobench::doNotOptimizeAway(mn::str_rune_count(text));
+		});
+		bench.run(mn::str_tmpf("str_utf8_valid {} 16MB", name).ptr, [&]{
+			ankerl::nanobench::doNotOptimizeAway(mn::str_utf8_valid(text));
+		});
+		bench.run(mn::str_tmpf("rune by rune lower {} 16MB", name).ptr, [&]{
+			auto res = mn::str_new();
+			mn::str_reserve(res, text.count);
+			for (const char* it = mn::begin(text); it != mn::end(text); it = mn::rune_next(it))
+				mn::str_push(res, mn::rune_lower(mn::rune_read(it)));
+			ankerl::nanobench::doNotOptimizeAway(res.count);
+			mn::str_free(res);
+		});
+		bench.run(mn::str_tmpf("str_lower {} 16MB", name).ptr, [&]{
+			auto res = mn::str_from_substr(mn::begin(text), mn::end(text));
+			mn::str_lower(res);
+			ankerl::nanobench::doNotOptimizeAway(res.count);
+			mn::str_free(res);
+		});
+	}
+}
+
 TEST_CASE("Task")
 {
 	CHECK(std::is_pod_v<mn::Task<void()>> == true);
@@ -635,6 +3319,24 @@ TEST_CASE("Task")
 
 	mn::task_free(add);
 	mn::task_free(inc);
+	CHECK(add == false);
+
+	// big closures are spilled into the given allocator
+	int data[64] = {};
+	data[63] = 42;
+	auto big = mn::Task<int()>::make([data] { return data[63]; });
+	CHECK(std::is_pod_v<decltype(big)> == true);
+	CHECK(big() == 42);
+	mn::task_free(big);
+
+	// lvalue callables are stored by reference
+	int counter = 0;
+	auto count = [&counter]() mutable { ++counter; };
+	auto ref = mn::Task<void()>::make(count);
+	ref();
+	ref();
+	CHECK(counter == 2);
+	mn::task_free(ref);
 }
 
 struct V2
@@ -896,94 +3598,523 @@ TEST_CASE("unbuffered channel from coroutine")
 		mn::chan_close(c);
 	});
 
-	g.wait();
-	CHECK(sum == 5050);
+	g.wait();
+	CHECK(sum == 5050);
+
+	mn::fabric_free(f);
+	mn::chan_free(c);
+}
+
+TEST_CASE("buffered channel from coroutine")
+{
+	mn::Fabric_Settings settings{};
+	settings.workers_count = 3;
+	auto f = mn::fabric_new(settings);
+	auto c = mn::chan_new<size_t>(1000);
+	mn::Auto_Waitgroup g;
+
+	size_t sum = 0;
+
+	g.add(1);
+	mn::go(f, [c, &sum, &g] {
+		for (auto num : c)
+			sum += num;
+		g.done();
+	});
+
+	mn::go(f, [c]{
+		for (size_t i = 0; i <= 10000; ++i)
+			mn::chan_send(c, i);
+		mn::chan_close(c);
+	});
+
+	g.wait();
+	CHECK(sum == 50005000);
+
+	mn::fabric_free(f);
+	mn::chan_free(c);
+}
+
+TEST_CASE("coroutine launching coroutines")
+{
+	mn::Fabric_Settings settings{};
+	settings.workers_count = 3;
+	auto f = mn::fabric_new(settings);
+	auto c = mn::chan_new<int>(1000);
+	mn::Auto_Waitgroup g;
+
+	size_t sum = 0;
+
+	g.add(1);
+	mn::go(f, [&g, &sum, c]{
+
+		mn::go([&g, &sum, c]{
+			for (auto num : c)
+				sum += num;
+			g.done();
+		});
+
+		for (int i = 0; i <= 10000; ++i)
+			mn::chan_send(c, i);
+		mn::chan_close(c);
+	});
+
+	g.wait();
+	CHECK(sum == 50005000);
+
+	mn::fabric_free(f);
+	mn::chan_free(c);
+}
+
+TEST_CASE("stress")
+{
+	auto f = mn::fabric_new({});
+	auto c = mn::chan_new<size_t>(100);
+	mn::Auto_Waitgroup g;
+
+	std::atomic<size_t> sum = 0;
+
+	for (size_t i = 0; i <= 1000; ++i)
+	{
+		g.add(1);
+		mn::go(f, [c, i] { mn::chan_send(c, i); });
+		mn::go(f, [c, &sum, &g] { auto[n, _] = mn::chan_recv(c); sum += n; g.done(); });
+	}
+
+	g.wait();
+	CHECK(sum == 500500);
+
+	mn::fabric_free(f);
+	mn::chan_free(c);
+}
+
+TEST_CASE("fabric fan out")
+{
+	mn::Fabric_Settings settings{};
+	settings.workers_count = 4;
+	auto f = mn::fabric_new(settings);
+	mn::Auto_Waitgroup g;
+
+	std::atomic<size_t> sum = 0;
+
+	g.add(1);
+	mn::go(f, [&sum, &g]{
+		for (size_t i = 0; i < 100; ++i)
+		{
+			g.add(1);
+			mn::go([&sum, &g, i]{
+				for (size_t j = 0; j < 100; ++j)
+				{
+					g.add(1);
+					mn::go([&sum, &g, i, j]{ sum += i * 100 + j; g.done(); });
+				}
+				g.done();
+			});
+		}
+		g.done();
+	});
+
+	g.wait();
+	CHECK(sum == 49995000);
+
+	mn::fabric_free(f);
+}
+
+TEST_CASE("fabric tiny tasks benchmark")
+{
+	static constexpr size_t TASKS_COUNT = 1000000;
+	static constexpr size_t FAN_OUT = 1000;
+
+	auto f = mn::fabric_new({});
+	mn_defer(mn::fabric_free(f));
+
+	auto w = mn::worker_new("benchmark worker");
+	mn_defer(mn::worker_free(w));
+
+	std::atomic<size_t> done = 0;
+	auto wait_for = [&done](size_t count) {
+		while (done.load() < count)
+			std::this_thread::yield();
+		done = 0;
+	};
+
+	auto bench = ankerl::nanobench::Bench().epochs(3).epochIterations(1).batch(TASKS_COUNT).unit("task");
+
+	bench.run("fabric external submit", [&]{
+		for (size_t i = 0; i < TASKS_COUNT; ++i)
+			mn::go(f, [&done] { done.fetch_add(1, std::memory_order_relaxed); });
+		wait_for(TASKS_COUNT);
+	});
+
+	bench.run("fabric fan out submit", [&]{
+		for (size_t i = 0; i < TASKS_COUNT / FAN_OUT; ++i)
+		{
+			mn::go(f, [&done] {
+				for (size_t j = 0; j < FAN_OUT; ++j)
+					mn::go([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+			});
+		}
+		wait_for(TASKS_COUNT);
+	});
+
+	bench.run("single worker submit", [&]{
+		for (size_t i = 0; i < TASKS_COUNT; ++i)
+			mn::go(w, [&done] { done.fetch_add(1, std::memory_order_relaxed); });
+		wait_for(TASKS_COUNT);
+	});
+
+	bench.run("fabric fan out submit 256 bytes closure", [&]{
+		for (size_t i = 0; i < TASKS_COUNT / FAN_OUT; ++i)
+		{
+			mn::go(f, [&done] {
+				for (size_t j = 0; j < FAN_OUT; ++j)
+				{
+					size_t payload[32] = {j};
+					mn::go([&done, payload] { done.fetch_add(1 + payload[0] * 0, std::memory_order_relaxed); });
+				}
+			});
+		}
+		wait_for(TASKS_COUNT);
+	});
+}
+
+TEST_CASE("fabric submit latency benchmark")
+{
+	static constexpr size_t SAMPLES_COUNT = 5000;
+
+	auto f = mn::fabric_new({});
+	mn_defer(mn::fabric_free(f));
+
+	auto latencies = mn::buf_with_capacity<int64_t>(SAMPLES_COUNT);
+	mn_defer(mn::buf_free(latencies));
+
+	auto measure = [&](const char* name, uint32_t idle_time_in_ms) {
+		mn::buf_clear(latencies);
+		for (size_t i = 0; i < SAMPLES_COUNT; ++i)
+		{
+			std::atomic<int64_t> latency = -1;
+			auto submit_time = std::chrono::steady_clock::now();
+			mn::go(f, [&latency, submit_time]{
+				auto start_time = std::chrono::steady_clock::now();
+				latency = std::chrono::duration_cast<std::chrono::nanoseconds>(start_time - submit_time).count();
+			});
+			while (latency.load() < 0)
+				std::this_thread::yield();
+			mn::buf_push(latencies, latency.load());
+
+			if (idle_time_in_ms > 0)
+				mn::thread_sleep(idle_time_in_ms);
+		}
+
+		std::sort(mn::begin(latencies), mn::end(latencies));
+		auto percentile = [&](double p) { return latencies[size_t(p * (latencies.count - 1))]; };
+		mn::print(
+			"  latency {:<38} p50: {} ns, p90: {} ns, p99: {} ns, p99.9: {} ns\n",
+			name,
+			percentile(0.5),
+			percentile(0.9),
+			percentile(0.99),
+			percentile(0.999)
+		);
+	};
+
+	measure("fabric submit to start (busy)", 0);
+	measure("fabric submit to start (idle)", 1);
+}
+
+TEST_CASE("fabric compute")
+{
+	mn::Fabric_Settings settings{};
+	settings.workers_count = 4;
+	auto f = mn::fabric_new(settings);
+	mn_defer(mn::fabric_free(f));
+
+	mn::Compute_Dims size{100, 30, 3};
+	auto hits = mn::buf_with_count<std::atomic<int>>(size.x * size.y * size.z);
+	mn_defer(mn::buf_free(hits));
+	auto reset = [&hits]{
+		for (auto& hit: hits)
+			hit = 0;
+	};
+	auto all_hit_once = [&hits]{
+		for (auto& hit: hits)
+			if (hit.load() != 1)
+				return false;
+		return true;
+	};
+	auto index_of = [size](mn::Compute_Dims id) { return id.x + id.y * size.x + id.z * size.x * size.y; };
+
+	reset();
+	mn::compute_sized(f, size, mn::Compute_Dims{8, 8, 1}, [&](mn::Compute_Args args) {
+		hits[index_of(args.global_invocation_id)]++;
+	});
+	CHECK(all_hit_once());
+
+	reset();
+	mn::compute_tiled(f, size, mn::Compute_Dims{10, 10, 1}, [&](mn::Compute_Args args) {
+		for (size_t y = 0; y < 10; ++y)
+			for (size_t x = 0; x < 10; ++x)
+				hits[index_of(mn::Compute_Dims{args.global_invocation_id.x + x, args.global_invocation_id.y + y, args.global_invocation_id.z})]++;
+	});
+	CHECK(all_hit_once());
+
+	reset();
+	mn::parallel_for(f, size, [&](mn::Compute_Dims id) {
+		hits[index_of(id)]++;
+	});
+	CHECK(all_hit_once());
+
+	auto sum = mn::parallel_reduce(f, size, size_t(0),
+		[&](size_t& acc, mn::Compute_Dims id) { acc += index_of(id); },
+		[](size_t& acc, size_t partial) { acc += partial; }
+	);
+	CHECK(sum == hits.count * (hits.count - 1) / 2);
+
+	auto single_threaded_sum = mn::parallel_reduce(nullptr, size, size_t(0),
+		[&](size_t& acc, mn::Compute_Dims id) { acc += index_of(id); },
+		[](size_t& acc, size_t partial) { acc += partial; }
+	);
+	CHECK(single_threaded_sum == sum);
+}
+
+TEST_CASE("fabric compute benchmark")
+{
+	auto f = mn::fabric_new({});
+	mn_defer(mn::fabric_free(f));
 
-	mn::fabric_free(f);
-	mn::chan_free(c);
+	mn::Compute_Dims size{1000, 1000, 1};
+	auto data = mn::buf_with_count<float>(size.x * size.y);
+	mn_defer(mn::buf_free(data));
+
+	auto bench = ankerl::nanobench::Bench().epochs(3).epochIterations(1).batch(data.count).unit("invocation");
+
+	bench.run("fabric compute 1000x1000", [&]{
+		mn::compute(f, size, mn::Compute_Dims{1, 1, 1}, [&](mn::Compute_Args args) {
+			auto i = args.global_invocation_id.x + args.global_invocation_id.y * size.x;
+			data[i] = float(i) * 0.5f;
+		});
+	});
+
+	bench.run("fabric parallel_for 1000x1000", [&]{
+		mn::parallel_for(f, size, [&](mn::Compute_Dims id) {
+			auto i = id.x + id.y * size.x;
+			data[i] = float(i) * 0.5f;
+		});
+	});
 }
 
-TEST_CASE("buffered channel from coroutine")
+TEST_CASE("fabric task pool")
 {
+	static constexpr size_t TASKS_COUNT = 100;
+
+	auto w = mn::worker_new("task pool worker");
+	mn_defer(mn::worker_free(w));
+
+	std::atomic<size_t> done = 0;
+	std::atomic<size_t> allocations = SIZE_MAX;
+
+	auto submit = [&done]{
+		char payload[256] = {};
+		for (size_t i = 0; i < TASKS_COUNT; ++i)
+			mn::go([&done, payload] { done.fetch_add(1 + payload[0]); });
+	};
+
+	// warm up the worker's task pool
+	mn::go(w, submit);
+	while (done.load() < TASKS_COUNT)
+		std::this_thread::yield();
+
+	// scheduling big closures from the worker should reuse the memory of the finished ones
+	mn::go(w, [&allocations, &submit]{
+		mn::allocator_push(mn::memory::fast_leak());
+		mn_defer(mn::allocator_pop());
+
+		auto before = mn::memory::fast_leak()->atomic_count.load();
+		submit();
+		allocations = mn::memory::fast_leak()->atomic_count.load() - before;
+	});
+	while (done.load() < 2 * TASKS_COUNT)
+		std::this_thread::yield();
+
+	CHECK(allocations == 0);
+
+	// over aligned closures should get memory with the requested alignment, the pool's block size isn't a multiple
+	// of the alignment so the pool's own blocks wouldn't be aligned enough
 	mn::Fabric_Settings settings{};
-	settings.workers_count = 3;
+	settings.workers_count = 1;
+	settings.task_spill_size = 200;
 	auto f = mn::fabric_new(settings);
-	auto c = mn::chan_new<size_t>(1000);
-	mn::Auto_Waitgroup g;
-
-	size_t sum = 0;
+	mn_defer(mn::fabric_free(f));
 
-	g.add(1);
-	mn::go(f, [c, &sum, &g] {
-		for (auto num : c)
-			sum += num;
-		g.done();
+	struct alignas(64) Aligned_Payload { char data[64]; };
+	std::atomic<size_t> misaligned = 0;
+	mn::fabric_do(f, [f, &done, &misaligned]{
+		for (size_t i = 0; i < TASKS_COUNT; ++i)
+		{
+			Aligned_Payload payload{};
+			mn::fabric_do(f, [&done, &misaligned, payload] {
+				// the volatile keeps the compiler from assuming the alignment and folding the check
+				void* volatile ptr = (void*)&payload;
+				if ((uintptr_t)ptr % alignof(Aligned_Payload) != 0)
+					misaligned.fetch_add(1);
+				done.fetch_add(1 + payload.data[0]);
+			});
+		}
 	});
+	while (done.load() < 3 * TASKS_COUNT)
+		std::this_thread::yield();
 
-	mn::go(f, [c]{
-		for (size_t i = 0; i <= 10000; ++i)
-			mn::chan_send(c, i);
-		mn::chan_close(c);
+	CHECK(misaligned == 0);
+
+	// a steady mix of over aligned and normal closures shouldn't grow the pool, the pool of the worker takes its
+	// memory from the allocator which is on top when the fabric is created
+	mn::allocator_push(mn::memory::fast_leak());
+	auto mixed = mn::fabric_new(settings);
+	mn::allocator_pop();
+	mn_defer({
+		mn::allocator_push(mn::memory::fast_leak());
+		mn::fabric_free(mixed);
+		mn::allocator_pop();
 	});
 
-	g.wait();
-	CHECK(sum == 50005000);
+	auto mixed_round = [&](size_t round) {
+		// the aligned closure schedules the normal one, so the normal one's block is on top of the free list when
+		// the next aligned closure is allocated
+		mn::fabric_do(mixed, [mixed, &done]{
+			Aligned_Payload aligned_payload{};
+			mn::fabric_do(mixed, [mixed, &done, aligned_payload] {
+				char payload[100] = {};
+				mn::fabric_do(mixed, [&done, payload] { done.fetch_add(1 + payload[0]); });
+				done.fetch_add(1 + aligned_payload.data[0]);
+			});
+		});
+		while (done.load() < 3 * TASKS_COUNT + 2 * (round + 1))
+			std::this_thread::yield();
+	};
 
-	mn::fabric_free(f);
-	mn::chan_free(c);
+	mixed_round(0);
+	auto live_blocks = mn::memory::fast_leak()->atomic_count.load();
+	for (size_t i = 1; i < 10 * TASKS_COUNT; ++i)
+		mixed_round(i);
+	CHECK(mn::memory::fast_leak()->atomic_count.load() == live_blocks);
 }
 
-TEST_CASE("coroutine launching coroutines")
+TEST_CASE("thread cache allocator")
 {
-	mn::Fabric_Settings settings{};
-	settings.workers_count = 3;
-	auto f = mn::fabric_new(settings);
-	auto c = mn::chan_new<int>(1000);
-	mn::Auto_Waitgroup g;
+	auto allocator = mn::memory::thread_cache();
 
-	size_t sum = 0;
+	// all the size classes and big blocks
+	auto blocks = mn::buf_new<mn::Block>();
+	mn_defer(mn::buf_free(blocks));
+	for (size_t size = 1; size <= 64 * 1024; size += size / 8 + 1)
+	{
+		auto block = mn::alloc_from(allocator, size, alignof(int));
+		CHECK((uintptr_t)block.ptr % 16 == 0);
+		::memset(block.ptr, int(size), size);
+		mn::buf_push(blocks, block);
+	}
+	for (auto block: blocks)
+	{
+		CHECK(((uint8_t*)block.ptr)[block.size - 1] == uint8_t(block.size));
+		mn::free_from(allocator, block);
+	}
 
-	g.add(1);
-	mn::go(f, [&g, &sum, c]{
+	// containers using the allocator on multiple threads, freeing each other's blocks
+	static constexpr size_t THREADS_COUNT = 4;
+	auto bufs = mn::buf_with_count<mn::Buf<mn::Str>>(THREADS_COUNT);
+	mn_defer(mn::destruct(bufs));
 
-		mn::go([&g, &sum, c]{
-			for (auto num : c)
-				sum += num;
-			g.done();
+	std::thread threads[THREADS_COUNT];
+	for (size_t i = 0; i < THREADS_COUNT; ++i)
+	{
+		threads[i] = std::thread([&bufs, i]{
+			mn::allocator_push(mn::memory::thread_cache());
+			mn_defer(mn::allocator_pop());
+
+			auto map = mn::map_new<int, mn::Str>();
+			mn_defer(mn::destruct(map));
+			for (int j = 0; j < 1000; ++j)
+				mn::map_insert(map, j, mn::strf("{}", j));
+
+			auto strs = mn::buf_new<mn::Str>();
+			for (int j = 0; j < 1000; ++j)
+				mn::buf_push(strs, mn::str_clone(mn::map_lookup(map, j)->value));
+			bufs[i] = strs;
 		});
+	}
+	for (auto& thread: threads)
+		thread.join();
 
-		for (int i = 0; i <= 10000; ++i)
-			mn::chan_send(c, i);
-		mn::chan_close(c);
-	});
+	for (size_t i = 0; i < THREADS_COUNT; ++i)
+		for (int j = 0; j < 1000; ++j)
+			CHECK(bufs[i][j] == mn::str_tmpf("{}", j));
+}
 
-	g.wait();
-	CHECK(sum == 50005000);
+TEST_CASE("thread cache allocator benchmark")
+{
+	static constexpr size_t THREADS_COUNT = 4;
+	static constexpr size_t OPS_COUNT = 100000;
+	static constexpr size_t LIVE_COUNT = 64;
+
+	auto bench = ankerl::nanobench::Bench().epochs(3).epochIterations(1).batch(THREADS_COUNT * OPS_COUNT).unit("op");
+
+	auto run = [&](const char* name, mn::Allocator allocator) {
+		bench.run(name, [&]{
+			std::thread threads[THREADS_COUNT];
+			for (size_t i = 0; i < THREADS_COUNT; ++i)
+			{
+				threads[i] = std::thread([allocator, i]{
+					mn::Block live[LIVE_COUNT] = {};
+					uint32_t seed = uint32_t(i + 1);
+					for (size_t j = 0; j < OPS_COUNT; ++j)
+					{
+						seed = seed * 1664525 + 1013904223;
+						auto& block = live[j % LIVE_COUNT];
+						if (block.ptr)
+							mn::free_from(allocator, block);
+						block = mn::alloc_from(allocator, 16 + (seed >> 8) % 1024, alignof(int));
+					}
+					for (auto block: live)
+						mn::free_from(allocator, block);
+				});
+			}
+			for (auto& thread: threads)
+				thread.join();
+		});
+	};
 
-	mn::fabric_free(f);
-	mn::chan_free(c);
+	run("clib 4 threads alloc/free", mn::memory::clib());
+	run("thread cache 4 threads alloc/free", mn::memory::thread_cache());
 }
 
-TEST_CASE("stress")
+TEST_CASE("fabric worker stats")
 {
-	auto f = mn::fabric_new({});
-	auto c = mn::chan_new<size_t>(100);
-	mn::Auto_Waitgroup g;
-
-	std::atomic<size_t> sum = 0;
+	auto w = mn::worker_new("stats worker");
+	mn_defer(mn::worker_free(w));
 
-	for (size_t i = 0; i <= 1000; ++i)
+	static constexpr size_t JOBS_COUNT = 100;
+	std::atomic<size_t> done = 0;
+	for (size_t i = 0; i < JOBS_COUNT; ++i)
 	{
-		g.add(1);
-		mn::go(f, [c, i] { mn::chan_send(c, i); });
-		mn::go(f, [c, &sum, &g] { auto[n, _] = mn::chan_recv(c); sum += n; g.done(); });
+		mn::go(w, [&done]{
+			auto nums = mn::buf_with_allocator<int>(mn::memory::tmp());
+			for (int j = 0; j < 1000; ++j)
+				mn::buf_push(nums, j);
+			done.fetch_add(1);
+		});
 	}
 
-	g.wait();
-	CHECK(sum == 500500);
+	auto stats = mn::worker_stats(w);
+	while (done.load() < JOBS_COUNT || stats.jobs_count < JOBS_COUNT)
+	{
+		std::this_thread::yield();
+		stats = mn::worker_stats(w);
+	}
 
-	mn::fabric_free(f);
-	mn::chan_free(c);
+	CHECK(stats.tmp_clear_count >= JOBS_COUNT);
+	CHECK(stats.tmp_readjust_count == 0);
+	CHECK(stats.tmp_highwater_mem >= 1000 * sizeof(int));
+	CHECK(stats.tmp_total_mem >= stats.tmp_highwater_mem);
 }
 
 TEST_CASE("buddy")
@@ -1170,6 +4301,7 @@ TEST_CASE("report simd")
 	mn::print("sse4a: {}\n", simd.sse4a_supportted);
 	mn::print("sse5: {}\n", simd.sse5_supportted);
 	mn::print("avx: {}\n", simd.avx_supportted);
+	mn::print("avx2: {}\n", simd.avx2_supportted);
 }
 
 TEST_CASE("json support")
@@ -1198,6 +4330,589 @@ TEST_CASE("json support")
 	mn::json::value_free(v);
 }
 
+TEST_CASE("json doc")
+{
+	auto json = R"""(
+		{
+			"name": "my name is \"mostafa\"",
+			"x": null,
+			"y": true,
+			"z": false,
+			"w": 213.123,
+			"a": [
+				1, false
+			],
+			"subobject": {
+				"name": "subobject"
+			}
+		}
+	)""";
+
+	auto [doc, err] = mn::json::doc_parse(json);
+	REQUIRE(err == false);
+	mn_defer(mn::json::doc_free(doc));
+
+	const auto& root = doc.tape[0];
+	CHECK(root.kind == mn::json::Value::KIND_OBJECT);
+	CHECK(root.count == 7);
+	CHECK(root.end == doc.tape.count);
+
+	CHECK(mn::json::doc_string(doc, mn::json::doc_object_lookup(doc, 0, "name")) == "my name is \"mostafa\"");
+	CHECK(doc.tape[mn::json::doc_object_lookup(doc, 0, "x")].kind == mn::json::Value::KIND_NULL);
+	CHECK(doc.tape[mn::json::doc_object_lookup(doc, 0, "y")].as_bool == true);
+	CHECK(doc.tape[mn::json::doc_object_lookup(doc, 0, "z")].as_bool == false);
+	CHECK(doc.tape[mn::json::doc_object_lookup(doc, 0, "w")].as_number == 213.123);
+	CHECK(mn::json::doc_object_lookup(doc, 0, "not found") == SIZE_MAX);
+
+	auto a = mn::json::doc_object_lookup(doc, 0, "a");
+	CHECK(doc.tape[a].count == 2);
+	CHECK(doc.tape[mn::json::doc_array_at(doc, a, 0)].as_number == 1);
+	CHECK(doc.tape[mn::json::doc_array_at(doc, a, 1)].as_bool == false);
+	CHECK(mn::json::doc_array_at(doc, a, 2) == SIZE_MAX);
+
+	auto subobject = mn::json::doc_object_lookup(doc, 0, "subobject");
+	CHECK(mn::json::doc_string(doc, mn::json::doc_object_lookup(doc, subobject, "name")) == "subobject");
+	CHECK(mn::json::doc_next(doc, subobject) == doc.tape.count);
+
+	SUBCASE("lazy unescaping")
+	{
+		auto [escaped, escaped_err] = mn::json::doc_parse(R"""(["plain", "a\"b\\c\/d\n\t", "é😀", "bad \x escape"])""");
+		REQUIRE(escaped_err == false);
+		mn_defer(mn::json::doc_free(escaped));
+
+		CHECK(escaped.tape[1].escaped == false);
+		CHECK(escaped.tape[2].escaped == true);
+		CHECK(escaped.tape[2].materialized == false);
+		CHECK(mn::json::doc_string(escaped, 1) == "plain");
+		CHECK(mn::json::doc_string(escaped, 2) == "a\"b\\c/d\n\t");
+		CHECK(escaped.tape[2].materialized == true);
+		CHECK(mn::json::doc_string(escaped, 3) == "\xC3\xA9\xF0\x9F\x98\x80");
+		CHECK(mn::json::doc_string(escaped, 4) == "bad \\x escape");
+	}
+
+	SUBCASE("big objects and repeated keys")
+	{
+		auto content = mn::str_tmpf("{{\"dup\": 0");
+		for (size_t i = 0; i < 100; ++i)
+			content = mn::strf(content, ", \"key{}\": {}", i, i);
+		content = mn::strf(content, ", \"dup\": 1}}");
+
+		auto [big, big_err] = mn::json::doc_parse(content);
+		REQUIRE(big_err == false);
+		mn_defer(mn::json::doc_free(big));
+
+		for (size_t i = 0; i < 100; ++i)
+			CHECK(big.tape[mn::json::doc_object_lookup(big, 0, mn::str_tmpf("key{}", i))].as_number == i);
+		CHECK(big.tape[mn::json::doc_object_lookup(big, 0, "dup")].as_number == 1);
+		CHECK(big.object_indices.count == 1);
+
+		auto [small, small_err] = mn::json::doc_parse(R"""({"dup": 0, "key": 1, "dup": 2})""");
+		REQUIRE(small_err == false);
+		mn_defer(mn::json::doc_free(small));
+		CHECK(small.tape[mn::json::doc_object_lookup(small, 0, "dup")].as_number == 2);
+		CHECK(small.object_indices.count == 0);
+	}
+
+	SUBCASE("conversion to value")
+	{
+		auto plain = R"""({"x": null, "y": true, "w": 213.123, "a": [1, false, [], {}], "s": {"name": "subobject"}})""";
+		auto [plain_doc, plain_err] = mn::json::doc_parse(plain);
+		REQUIRE(plain_err == false);
+		mn_defer(mn::json::doc_free(plain_doc));
+		auto [value, value_err] = mn::json::parse(plain);
+		REQUIRE(value_err == false);
+		mn_defer(mn::json::value_free(value));
+
+		auto converted = mn::json::doc_to_value(plain_doc, 0);
+		mn_defer(mn::json::value_free(converted));
+		CHECK(mn::str_tmpf("{}", converted) == mn::str_tmpf("{}", value));
+	}
+
+	SUBCASE("errors")
+	{
+		const char* invalid[] = {"", "[1, 2", "{\"a\" 1}", "{\"a\": }", "[1, 2,", "nope"};
+		for (auto content: invalid)
+		{
+			auto [invalid_doc, invalid_err] = mn::json::doc_parse(content);
+			CHECK(invalid_err == true);
+		}
+	}
+}
+
+inline static mn::Str
+json_telemetry_document(size_t size)
+{
+	auto res = mn::str_from_c("[");
+	for (size_t i = 0; res.count < size; ++i)
+	{
+		if (i != 0)
+			mn::str_push(res, ",\n");
+		res = mn::strf(
+			res,
+			R"""({{"id": {}, "name": "sensor {}", "ok": true, "error": null, "values": [1.5, -2.25, 3e2, {}], "tags": {{"site": "north", "unit": "celsius"}}}})""",
+			i, i, i % 100
+		);
+	}
+	mn::str_push(res, "]");
+	return res;
+}
+
+TEST_CASE("json structural index")
+{
+	// everything is checked with and without the index
+	mn::json::Parse_Settings settings_list[] = {{false}, {true}};
+
+	SUBCASE("blocks boundaries")
+	{
+		// moves the document across the 64 bytes blocks boundaries so that every token gets split by one
+		auto json = R"""({"k": "a\"b\\", "bs": "\\\\\"", "n": -12.5e1, "t": [true, false, null], "long": "0123456789012345678901234567890123456789012345678901234567890123456789"})""";
+		for (size_t offset = 0; offset < 130; ++offset)
+		for (auto settings: settings_list)
+		{
+			auto content = mn::str_tmpf("{:{}}{}", "", offset, json);
+			auto [doc, err] = mn::json::doc_parse(content, settings);
+			REQUIRE(err == false);
+			mn_defer(mn::json::doc_free(doc));
+
+			CHECK(doc.tape[0].count == 5);
+			CHECK(mn::json::doc_string(doc, mn::json::doc_object_lookup(doc, 0, "k")) == "a\"b\\");
+			CHECK(mn::json::doc_string(doc, mn::json::doc_object_lookup(doc, 0, "bs")) == "\\\\\"");
+			CHECK(doc.tape[mn::json::doc_object_lookup(doc, 0, "n")].as_number == -125.0);
+			auto t = mn::json::doc_object_lookup(doc, 0, "t");
+			CHECK(doc.tape[mn::json::doc_array_at(doc, t, 0)].as_bool == true);
+			CHECK(doc.tape[mn::json::doc_array_at(doc, t, 1)].as_bool == false);
+			CHECK(doc.tape[mn::json::doc_array_at(doc, t, 2)].kind == mn::json::Value::KIND_NULL);
+			CHECK(mn::json::doc_string(doc, mn::json::doc_object_lookup(doc, 0, "long")).count == 70);
+		}
+	}
+
+	SUBCASE("backslash runs")
+	{
+		// odd backslash runs escape the quote after them and even ones don't
+		for (size_t count = 0; count < 80; ++count)
+		for (auto settings: settings_list)
+		{
+			auto run = mn::str_tmpf("{:\\>{}}", "", count * 2);
+			auto content = mn::str_tmpf("[\"{}\", \"{}\\\"\", 1]", run, run);
+			auto [doc, err] = mn::json::doc_parse(content, settings);
+			REQUIRE(err == false);
+			mn_defer(mn::json::doc_free(doc));
+
+			CHECK(doc.tape[0].count == 3);
+			CHECK(mn::json::doc_string(doc, 1).count == count);
+			CHECK(mn::json::doc_string(doc, 2).count == count + 1);
+			CHECK(doc.tape[3].as_number == 1);
+		}
+	}
+
+	SUBCASE("numbers")
+	{
+		const char* numbers[] = {
+			"0", "-0", "1", "-1", "0.1", "0.3", "1e22", "1e23", "-2.5e-3", "123456789012345678",
+			"9007199254740993", "1.7976931348623157e308", "3.14159265358979323846", "1E5", "1e+2",
+		};
+		for (auto number: numbers)
+		for (auto settings: settings_list)
+		{
+			auto [doc, err] = mn::json::doc_parse(mn::str_tmpf("[{}]", number), settings);
+			REQUIRE(err == false);
+			mn_defer(mn::json::doc_free(doc));
+			CHECK(doc.tape[1].as_number == ::strtod(number, nullptr));
+		}
+	}
+
+	SUBCASE("same values as the rune by rune parser")
+	{
+		auto content = json_telemetry_document(64 * 1024);
+		mn_defer(mn::str_free(content));
+
+		auto [value, err] = mn::json::parse(content);
+		REQUIRE(err == false);
+		mn_defer(mn::json::value_free(value));
+		REQUIRE(value.kind == mn::json::Value::KIND_ARRAY);
+
+		for (size_t i = 0; i < value.as_array->count; ++i)
+		{
+			auto expected = mn::str_tmpf(
+				R"""({{"id":{}, "name":"sensor {}", "ok":true, "error":null, "values":[1.5, -2.25, 300, {}], "tags":{{"site":"north", "unit":"celsius"}}}})""",
+				i, i, i % 100
+			);
+			CHECK(mn::str_tmpf("{}", value.as_array->ptr[i]) == expected);
+		}
+	}
+
+	SUBCASE("same tape with and without the index")
+	{
+		auto content = json_telemetry_document(64 * 1024);
+		mn_defer(mn::str_free(content));
+		auto nested = R"""({"a": [[], {}, [{"b": [1, [2, {"c": {}}]]}], "x\"y"], "e": {"f": [true,], "g": {"h": null,},}, "z": -0.5})""";
+
+		for (auto json: {mn::str_lit(content.ptr), mn::str_lit(nested)})
+		{
+			auto [indexed, indexed_err] = mn::json::doc_parse(json);
+			REQUIRE(indexed_err == false);
+			mn_defer(mn::json::doc_free(indexed));
+
+			auto [unindexed, unindexed_err] = mn::json::doc_parse(json, mn::json::Parse_Settings{true});
+			REQUIRE(unindexed_err == false);
+			mn_defer(mn::json::doc_free(unindexed));
+
+			REQUIRE(indexed.tape.count == unindexed.tape.count);
+			for (size_t i = 0; i < indexed.tape.count; ++i)
+			{
+				auto& a = indexed.tape[i];
+				auto& b = unindexed.tape[i];
+				REQUIRE(a.kind == b.kind);
+				CHECK(a.count == b.count);
+				switch (a.kind)
+				{
+				case mn::json::Value::KIND_BOOL: CHECK(a.as_bool == b.as_bool); break;
+				case mn::json::Value::KIND_NUMBER: CHECK(a.as_number == b.as_number); break;
+				case mn::json::Value::KIND_STRING:
+					CHECK(a.escaped == b.escaped);
+					CHECK(a.as_string.ptr == b.as_string.ptr);
+					CHECK(a.as_string.count == b.as_string.count);
+					break;
+				case mn::json::Value::KIND_ARRAY:
+				case mn::json::Value::KIND_OBJECT:
+					CHECK(a.end == b.end);
+					break;
+				default: break;
+				}
+			}
+		}
+	}
+
+	SUBCASE("errors")
+	{
+		const char* invalid[] = {
+			"[true1]", "[nul]", "[1.5x]", "[-]", "[\"unclosed", "[\"escaped quote\\\"]", "{\"a\": 1 \"b\": 2}", "[1 2]",
+			"[", "{\"a\"", "{\"a\":", "{\"a\": 1", "[1,", "{1: 2}", "[}", "{\"a\": }", "[\"a\\\\\\\"]",
+		};
+		for (auto content: invalid)
+		for (auto settings: settings_list)
+		{
+			auto [doc, doc_err] = mn::json::doc_parse(content, settings);
+			CHECK(doc_err == true);
+
+			auto [value, value_err] = mn::json::parse(content, settings);
+			CHECK(value_err == true);
+		}
+	}
+}
+
+TEST_CASE("json doc benchmark")
+{
+	auto content = json_telemetry_document(8 * 1024 * 1024);
+	mn_defer(mn::str_free(content));
+
+	ankerl::nanobench::Bench bench;
+	bench.batch(content.count).unit("byte").minEpochIterations(2);
+
+	mn::json::Parse_Settings no_index{true};
+
+	bench.run("json::parse 8MB", [&]{
+		auto [value, err] = mn::json::parse(content);
+		ankerl::nanobench::doNotOptimizeAway(value.kind);
+		mn::json::value_free(value);
+	});
+
+	bench.run("json::parse 8MB no index", [&]{
+		auto [value, err] = mn::json::parse(content, no_index);
+		ankerl::nanobench::doNotOptimizeAway(value.kind);
+		mn::json::value_free(value);
+	});
+
+	bench.run("json::doc_parse 8MB", [&]{
+		auto [doc, err] = mn::json::doc_parse(content);
+		ankerl::nanobench::doNotOptimizeAway(doc.tape.count);
+		mn::json::doc_free(doc);
+	});
+
+	bench.run("json::doc_parse 8MB no index", [&]{
+		auto [doc, err] = mn::json::doc_parse(content, no_index);
+		ankerl::nanobench::doNotOptimizeAway(doc.tape.count);
+		mn::json::doc_free(doc);
+	});
+}
+
+// pulls the events of the given parser until the end and prints them in a compact form, the input is fed in chunks of
+// the given size when the parser asks for it
+inline static mn::Str
+json_events_str(mn::json::Event_Parser parser, const char* input = nullptr, size_t chunk_size = 0)
+{
+	auto res = mn::str_tmp();
+	auto input_count = input ? ::strlen(input) : 0;
+	size_t fed = 0;
+	while (true)
+	{
+		auto [event, err] = mn::json::event_parser_next(parser);
+		if (err)
+			return mn::strf(res, "error");
+
+		switch (event.kind)
+		{
+		case mn::json::Event::KIND_NEED_INPUT:
+		{
+			if (fed == input_count)
+			{
+				mn::json::event_parser_finish(parser);
+				break;
+			}
+			auto size = input_count - fed < chunk_size ? input_count - fed : chunk_size;
+			mn::json::event_parser_feed(parser, mn::Block{(void*)(input + fed), size});
+			fed += size;
+			break;
+		}
+		case mn::json::Event::KIND_END: return res;
+		case mn::json::Event::KIND_BEGIN_OBJECT: res = mn::strf(res, "{}{{ ", event.depth); break;
+		case mn::json::Event::KIND_END_OBJECT: res = mn::strf(res, "{}}} ", event.depth); break;
+		case mn::json::Event::KIND_BEGIN_ARRAY: res = mn::strf(res, "{}[ ", event.depth); break;
+		case mn::json::Event::KIND_END_ARRAY: res = mn::strf(res, "{}] ", event.depth); break;
+		case mn::json::Event::KIND_KEY: res = mn::strf(res, "{}k:{} ", event.depth, event.as_string); break;
+		case mn::json::Event::KIND_NULL: res = mn::strf(res, "{}null ", event.depth); break;
+		case mn::json::Event::KIND_BOOL: res = mn::strf(res, "{}{} ", event.depth, event.as_bool); break;
+		case mn::json::Event::KIND_NUMBER: res = mn::strf(res, "{}{} ", event.depth, event.as_number); break;
+		case mn::json::Event::KIND_STRING: res = mn::strf(res, "{}s:{} ", event.depth, event.as_string); break;
+		default: break;
+		}
+	}
+}
+
+TEST_CASE("json event parser")
+{
+	auto json = R"""({"name": "a\"b\\cé", "n": -12.5e1, "t": [true, false, null, []], "o": {"deep": {}}, "long": 1234567890})""";
+	auto expected = R"""(0{ 1k:name 1s:a"b\cé 1k:n 1-125 1k:t 1[ 2true 2false 2null 2[ 2] 1] 1k:o 1{ 2k:deep 2{ 2} 1} 1k:long 11234567890 0} )""";
+
+	SUBCASE("whole input")
+	{
+		auto parser = mn::json::event_parser_new();
+		mn_defer(mn::json::event_parser_free(parser));
+		mn::json::event_parser_feed(parser, json);
+		mn::json::event_parser_finish(parser);
+		CHECK(json_events_str(parser) == expected);
+	}
+
+	SUBCASE("chunks")
+	{
+		// every token gets split at some chunk size
+		for (size_t chunk_size = 1; chunk_size < 16; ++chunk_size)
+		{
+			auto parser = mn::json::event_parser_new();
+			mn_defer(mn::json::event_parser_free(parser));
+			CHECK(json_events_str(parser, json, chunk_size) == expected);
+		}
+	}
+
+	SUBCASE("stream and reader")
+	{
+		auto stream = mn::memory_stream_new();
+		mn_defer(mn::memory_stream_free(stream));
+		mn::memory_stream_write(stream, mn::block_lit(json));
+		mn::memory_stream_cursor_to_start(stream);
+
+		mn::json::Event_Parser_Settings settings{};
+		settings.read_size = 7;
+		auto stream_parser = mn::json::event_parser_stream_new(stream, settings);
+		mn_defer(mn::json::event_parser_free(stream_parser));
+		CHECK(json_events_str(stream_parser) == expected);
+
+		auto reader = mn::reader_str(mn::str_lit(json));
+		mn_defer(mn::reader_free(reader));
+		auto reader_parser = mn::json::event_parser_reader_new(reader, settings);
+		mn_defer(mn::json::event_parser_free(reader_parser));
+		CHECK(json_events_str(reader_parser) == expected);
+	}
+
+	SUBCASE("multiple documents")
+	{
+		mn::json::Event_Parser_Settings settings{};
+		settings.multiple_documents = true;
+		auto parser = mn::json::event_parser_new(settings);
+		mn_defer(mn::json::event_parser_free(parser));
+		CHECK(json_events_str(parser, "{\"a\": 1}\n[2]\n\n3 \"four\"\r\nnull", 5) == "0{ 1k:a 11 0} 0[ 12 0] 03 0s:four 0null ");
+
+		auto empty = mn::json::event_parser_new(settings);
+		mn_defer(mn::json::event_parser_free(empty));
+		CHECK(json_events_str(empty, " \n ", 1) == "");
+	}
+
+	SUBCASE("errors")
+	{
+		const char* invalid[] = {
+			"", "[1, 2", "{\"a\" 1}", "{\"a\": }", "[1, 2,]", "nope", "[true1]", "[1.5x]", "[-]", "[\"unclosed",
+			"{1: 2}", "[1 2]", "[1}", "{\"a\": 1]", "1 2", "]",
+		};
+		for (auto content: invalid)
+		{
+			auto parser = mn::json::event_parser_new();
+			mn_defer(mn::json::event_parser_free(parser));
+			CHECK(mn::str_suffix(json_events_str(parser, content, 3), "error"));
+
+			// errors are sticky
+			auto [event, err] = mn::json::event_parser_next(parser);
+			CHECK(err == true);
+		}
+	}
+
+	SUBCASE("limits")
+	{
+		mn::json::Event_Parser_Settings settings{};
+		settings.max_token_size = 8;
+		settings.max_depth = 2;
+
+		auto parser = mn::json::event_parser_new(settings);
+		mn_defer(mn::json::event_parser_free(parser));
+		CHECK(json_events_str(parser, "[[\"12345678\", 12345678]]", 4) == "0[ 1[ 2s:12345678 212345678 1] 0] ");
+
+		const char* invalid[][2] = {
+			{"[\"123456789\"]", "0[ error"},
+			{"[123456789]", "0[ error"},
+			{"[[[]]]", "0[ 1[ error"},
+		};
+		for (auto [content, events]: invalid)
+		{
+			auto invalid_parser = mn::json::event_parser_new(settings);
+			mn_defer(mn::json::event_parser_free(invalid_parser));
+			CHECK(json_events_str(invalid_parser, content, 4) == events);
+		}
+	}
+}
+
+TEST_CASE("ndjson")
+{
+	SUBCASE("next")
+	{
+		auto reader = mn::reader_str(mn::str_lit("{\"id\": 1}\r\n\n  \n[2, 3]\n{\"id\": \n{\"id\": 4}"));
+		mn_defer(mn::reader_free(reader));
+
+		auto line = mn::str_new();
+		mn_defer(mn::str_free(line));
+		mn::json::Doc doc{};
+		mn_defer(mn::json::doc_free(doc));
+
+		auto [first, first_err] = mn::json::ndjson_next(reader, line, doc);
+		REQUIRE(first == true);
+		CHECK(doc.tape[mn::json::doc_object_lookup(doc, 0, "id")].as_number == 1);
+
+		auto [second, second_err] = mn::json::ndjson_next(reader, line, doc);
+		REQUIRE(second == true);
+		CHECK(doc.tape[0].kind == mn::json::Value::KIND_ARRAY);
+		CHECK(doc.tape[0].count == 2);
+
+		auto [third, third_err] = mn::json::ndjson_next(reader, line, doc);
+		CHECK(third_err == true);
+
+		auto [fourth, fourth_err] = mn::json::ndjson_next(reader, line, doc);
+		REQUIRE(fourth == true);
+		CHECK(doc.tape[mn::json::doc_object_lookup(doc, 0, "id")].as_number == 4);
+
+		auto [end, end_err] = mn::json::ndjson_next(reader, line, doc);
+		CHECK(end_err == false);
+		CHECK(end == false);
+	}
+
+	SUBCASE("parallel")
+	{
+		constexpr size_t LINES_COUNT = 20000;
+		auto content = mn::str_new();
+		mn_defer(mn::str_free(content));
+		for (size_t i = 1; i <= LINES_COUNT; ++i)
+		{
+			if (i % 1000 == 0)
+				mn::str_push(content, "{\"id\": invalid}\n");
+			else if (i % 100 == 0)
+				mn::str_push(content, "\n");
+			else
+				content = mn::strf(content, "{{\"id\": {}, \"name\": \"line {}\"}}\n", i, i);
+		}
+
+		mn::Fabric_Settings fabric_settings{};
+		fabric_settings.workers_count = 4;
+		auto f = mn::fabric_new(fabric_settings);
+		mn_defer(mn::fabric_free(f));
+
+		auto reader = mn::reader_str(content);
+		mn_defer(mn::reader_free(reader));
+
+		mn::json::Ndjson_Parallel_Settings settings{};
+		settings.batch_size = 4096;
+		settings.max_batches = 4;
+		std::atomic<size_t> ids_sum = 0;
+		std::atomic<size_t> errors_count = 0;
+		std::atomic<size_t> mismatches_count = 0;
+		auto count = mn::json::ndjson_parse_parallel(reader, f, [&](size_t line_number, mn::json::Doc& doc, const mn::Err& err) {
+			if (err)
+			{
+				++errors_count;
+				if (line_number % 1000 != 0)
+					++mismatches_count;
+				return;
+			}
+			auto id = size_t(doc.tape[mn::json::doc_object_lookup(doc, 0, "id")].as_number);
+			if (id != line_number || mn::json::doc_string(doc, mn::json::doc_object_lookup(doc, 0, "name")) != mn::str_tmpf("line {}", id))
+				++mismatches_count;
+			ids_sum += id;
+		}, settings);
+
+		size_t expected_sum = 0;
+		size_t expected_count = 0;
+		for (size_t i = 1; i <= LINES_COUNT; ++i)
+		{
+			if (i % 100 == 0)
+				continue;
+			expected_sum += i;
+			++expected_count;
+		}
+		CHECK(count == expected_count + LINES_COUNT / 1000);
+		CHECK(errors_count == LINES_COUNT / 1000);
+		CHECK(mismatches_count == 0);
+		CHECK(ids_sum == expected_sum);
+	}
+}
+
+TEST_CASE("json event parser benchmark")
+{
+	auto content = json_telemetry_document(8 * 1024 * 1024);
+	mn_defer(mn::str_free(content));
+
+	ankerl::nanobench::Bench bench;
+	bench.batch(content.count).unit("byte").minEpochIterations(2);
+
+	bench.run("json::event_parser_next 8MB in 64KB chunks", [&]{
+		auto parser = mn::json::event_parser_new();
+		mn_defer(mn::json::event_parser_free(parser));
+		size_t fed = 0;
+		size_t events_count = 0;
+		while (true)
+		{
+			auto [event, err] = mn::json::event_parser_next(parser);
+			if (err || event.kind == mn::json::Event::KIND_END)
+				break;
+			if (event.kind == mn::json::Event::KIND_NEED_INPUT)
+			{
+				if (fed == content.count)
+				{
+					mn::json::event_parser_finish(parser);
+					continue;
+				}
+				auto size = content.count - fed < 64 * 1024 ? content.count - fed : 64 * 1024;
+				mn::json::event_parser_feed(parser, mn::Block{content.ptr + fed, size});
+				fed += size;
+				continue;
+			}
+			++events_count;
+		}
+		ankerl::nanobench::doNotOptimizeAway(events_count);
+	});
+
+	bench.run("json::doc_parse 8MB", [&]{
+		auto [doc, err] = mn::json::doc_parse(content);
+		ankerl::nanobench::doNotOptimizeAway(doc.tape.count);
+		mn::json::doc_free(doc);
+	});
+}
+
 inline static mn::Regex
 compile(const char* str)
 {